@@ -0,0 +1,167 @@
+#include <nbts/batch.h>
+#include <nbts/compression.h>
+#include <nbts/pool.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+enum : size_t { DEFAULT_PREFETCH = 4 };
+
+/// The state owned by one thread of the pool.
+struct worker {
+	struct nbts_buffer raw;
+	struct nbts_buffer decompressed;
+	/// The end of the range of files this thread has prefetched.
+	size_t prefetched;
+};
+
+struct batch {
+	char const *nonnull const *nonnull paths;
+	size_t count;
+	struct nbts_batch_options const *nonnull options;
+	enum nbts_error *nullable errors;
+	struct worker *nonnull workers;
+};
+
+struct nbts_batch_options nbts_batch_options(
+	nbts_batch_begin_fn *nonnull begin, nbts_batch_end_fn *nullable end, void *nullable userdata)
+{
+	return (struct nbts_batch_options){
+		.begin = begin,
+		.end = end,
+		.userdata = userdata,
+		.prefetch = DEFAULT_PREFETCH,
+	};
+}
+
+static void prefetch(
+	struct batch const *restrict nonnull batch, struct worker *restrict nonnull worker, size_t index)
+{
+	size_t begin = worker->prefetched > index + 1 ? worker->prefetched : index + 1;
+	size_t end = index + 1 + batch->options->prefetch;
+	if (end > batch->count) end = batch->count;
+
+	// The kernel reads the files asynchronously, so the number of reads in
+	// flight per thread is bounded by the prefetch distance.
+	for (size_t i = begin; i < end; ++i) {
+		int fd = open(batch->paths[i], O_RDONLY | O_CLOEXEC);
+		if (fd == -1) continue;
+		(void) posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+		close(fd);
+	}
+
+	if (end > worker->prefetched) worker->prefetched = end;
+}
+
+static enum nbts_error read_fd(struct nbts_buffer *restrict nonnull dest, int fd)
+{
+	struct stat st;
+	if (fstat(fd, &st) == -1) return NBTS_READ_ERR;
+	TRY(nbts_buffer_reserve(dest, st.st_size));
+
+	dest->size = 0;
+	while (dest->size < (size_t) st.st_size) {
+		ssize_t n = read(fd, &dest->data[dest->size], st.st_size - dest->size);
+		if (n == -1) return NBTS_READ_ERR;
+		if (n == 0) break;
+		dest->size += n;
+	}
+	return NBTS_OK;
+}
+
+static enum nbts_error
+read_file(struct nbts_buffer *restrict nonnull dest, char const *restrict nonnull path)
+{
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) return NBTS_READ_ERR;
+	enum nbts_error err = read_fd(dest, fd);
+	close(fd);
+	return err;
+}
+
+static enum nbts_error parse_file(
+	struct worker *restrict nonnull worker,
+	char const *restrict nonnull path,
+	struct nbts_handler const *restrict nullable handler,
+	void *nullable handler_userdata)
+{
+	TRY(read_file(&worker->raw, path));
+
+	struct nbts_buffer *input = &worker->raw;
+	enum nbts_compression format = nbts_detect_compression(input->data, input->size);
+	if (format != NBTS_COMPRESSION_NONE) {
+		TRY(nbts_decompress(&worker->decompressed, format, input->data, input->size));
+		input = &worker->decompressed;
+	}
+
+	FILE *stream = fmemopen(input->data, input->size, "rb");
+	if (!stream) return NBTS_READ_ERR;
+	enum nbts_error err = nbts_parse_tag(stream, handler, handler_userdata);
+	fclose(stream);
+	return err;
+}
+
+static void process(void *nullable userdata, size_t thread, size_t index)
+{
+	struct batch const *batch = userdata;
+	struct worker *worker = &batch->workers[thread];
+	struct nbts_batch_options const *options = batch->options;
+
+	prefetch(batch, worker, index);
+
+	struct nbts_handler const *handler = nullptr;
+	void *handler_userdata = nullptr;
+	enum nbts_error err =
+		options->begin(options->userdata, thread, index, &handler, &handler_userdata);
+	if (!err) {
+		err = parse_file(worker, batch->paths[index], handler, handler_userdata);
+		if (options->end) options->end(options->userdata, thread, index, handler_userdata, err);
+	}
+
+	if (batch->errors) batch->errors[index] = err;
+}
+
+enum nbts_error nbts_batch_parse(
+	char const *nonnull const *restrict nonnull paths,
+	size_t count,
+	struct nbts_batch_options const *restrict nonnull options,
+	enum nbts_error *restrict nullable errors)
+{
+	size_t threads = nbts_pool_threads(options->threads);
+	struct worker *workers = calloc(threads, sizeof(*workers));
+	if (!workers) return NBTS_ALLOC_ERR;
+
+	struct batch batch = {
+		.paths = paths,
+		.count = count,
+		.options = options,
+		.errors = errors,
+		.workers = workers,
+	};
+	enum nbts_error err = nbts_pool_run(count, threads, &process, &batch);
+
+	for (size_t i = 0; i < threads; ++i) {
+		nbts_buffer_free(&workers[i].raw);
+		nbts_buffer_free(&workers[i].decompressed);
+	}
+	free(workers);
+	return err;
+}
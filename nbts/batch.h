@@ -0,0 +1,77 @@
+#pragma once
+
+/// \file
+///
+/// \brief Parsing many small files on a thread pool.
+///
+/// \ref nbts_batch_parse reads every file into a per-thread buffer that is
+/// reused across files, decompresses it if it is gzip or zlib compressed,
+/// and parses one named tag from it. The files are distributed over a
+/// \ref nbts_pool_run thread pool. While parsing a file, each thread asks
+/// the kernel to start reading the next few files of its range, so that
+/// their contents are usually cached once the thread gets to them.
+
+#include <nbts/nbts.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// The type of a callback providing the handler for one file.
+///
+/// The callback shall store the handler for the file at `index` in `handler`
+/// and its userdata in `handler_userdata`. `thread` identifies the calling
+/// thread, see \ref nbts_pool_fn. If it returns an error, the file is not
+/// parsed and the error is reported for the file.
+typedef enum nbts_error nbts_batch_begin_fn(
+	void *nullable userdata,
+	size_t thread,
+	size_t index,
+	struct nbts_handler const *nullable *restrict nonnull handler,
+	void *nullable *restrict nonnull handler_userdata);
+
+/// The type of a callback called after a file has been processed.
+///
+/// `err` is the result of reading and parsing the file.
+typedef void nbts_batch_end_fn(
+	void *nullable userdata,
+	size_t thread,
+	size_t index,
+	void *nullable handler_userdata,
+	enum nbts_error err);
+
+/// Options for \ref nbts_batch_parse.
+struct nbts_batch_options {
+	/// Called before each file is parsed.
+	nbts_batch_begin_fn *nonnull begin;
+	/// Called after each file for which `begin` succeeded, if not `nullptr`.
+	nbts_batch_end_fn *nullable end;
+	/// Passed to `begin` and `end`.
+	void *nullable userdata;
+	/// The number of threads, see \ref nbts_pool_threads.
+	size_t threads;
+	/// The number of files each thread reads ahead.
+	size_t prefetch;
+};
+
+/// Returns options calling `begin` and `end` with default settings.
+struct nbts_batch_options nbts_batch_options(
+	nbts_batch_begin_fn *nonnull begin, nbts_batch_end_fn *nullable end, void *nullable userdata);
+
+/// Parses one named tag from each of the `count` files in `paths`.
+///
+/// The result for each file is stored in `errors`, if not `nullptr`. An
+/// error in one file does not stop the batch; the return value only reports
+/// errors setting up the batch itself.
+enum nbts_error nbts_batch_parse(
+	char const *nonnull const *restrict nonnull paths,
+	size_t count,
+	struct nbts_batch_options const *restrict nonnull options,
+	enum nbts_error *restrict nullable errors);
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,330 @@
+#include <nbts/bitpack.h>
+#include <nbts/write.h>
+
+#include <endian.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define NBTS_BYTE_ORDER BIG_ENDIAN
+
+#if NBTS_BYTE_ORDER == BIG_ENDIAN
+#define nbt64toh(...) be64toh(__VA_ARGS__)
+#define htonbt64(...) htobe64(__VA_ARGS__)
+#elif NBTS_BYTE_ORDER == LITTLE_ENDIAN
+#define nbt64toh(...) le64toh(__VA_ARGS__)
+#define htonbt64(...) htole64(__VA_ARGS__)
+#else
+#error "Byte order not supported"
+#endif
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+// NOLINTBEGIN(bugprone-easily-swappable-parameters)
+
+enum : size_t { LONG_BITS = 64, LONG_BYTES = sizeof(uint64_t) };
+
+static inline uint64_t load64(uint8_t const *restrict nonnull src)
+{
+	uint64_t x = 0;
+	memcpy(&x, src, sizeof(x));
+	return nbt64toh(x);
+}
+
+static inline void store64(uint8_t *restrict nonnull dest, uint64_t x)
+{
+	x = htonbt64(x);
+	memcpy(dest, &x, sizeof(x));
+}
+
+static inline uint64_t mask_of(size_t bits) { return (UINT64_C(1) << bits) - 1; }
+
+// The generic loops below are always inlined into one function per bit
+// width, so `bits` is a constant in each of them. This turns the shifts into
+// immediates and lets the compiler fully unroll the inner loops.
+
+[[gnu::always_inline]] static inline void unpack_padded(
+	uint16_t *restrict nonnull dest, size_t count, uint8_t const *restrict nonnull src, size_t bits)
+{
+	size_t per_long = LONG_BITS / bits;
+	uint64_t mask = mask_of(bits);
+
+	size_t full = count / per_long;
+	for (size_t i = 0; i < full; ++i) {
+		uint64_t x = load64(&src[i * LONG_BYTES]);
+		for (size_t j = 0; j < per_long; ++j) dest[i * per_long + j] = (x >> (j * bits)) & mask;
+	}
+
+	size_t rest = count - full * per_long;
+	if (!rest) return;
+	uint64_t x = load64(&src[full * LONG_BYTES]);
+	for (size_t j = 0; j < rest; ++j) dest[full * per_long + j] = (x >> (j * bits)) & mask;
+}
+
+[[gnu::always_inline]] static inline void pack_padded(
+	uint8_t *restrict nonnull dest, uint16_t const *restrict nonnull src, size_t count, size_t bits)
+{
+	size_t per_long = LONG_BITS / bits;
+	uint64_t mask = mask_of(bits);
+
+	size_t full = count / per_long;
+	for (size_t i = 0; i < full; ++i) {
+		uint64_t x = 0;
+		for (size_t j = 0; j < per_long; ++j) x |= (src[i * per_long + j] & mask) << (j * bits);
+		store64(&dest[i * LONG_BYTES], x);
+	}
+
+	size_t rest = count - full * per_long;
+	if (!rest) return;
+	uint64_t x = 0;
+	for (size_t j = 0; j < rest; ++j) x |= (src[full * per_long + j] & mask) << (j * bits);
+	store64(&dest[full * LONG_BYTES], x);
+}
+
+// With the spanning scheme, every block of 64 values occupies exactly `bits`
+// longs, so blocks are independent of each other.
+
+[[gnu::always_inline]] static inline void unpack_block(
+	uint16_t *restrict nonnull dest,
+	size_t count,
+	uint64_t const words[restrict NBTS_BITPACK_MAX_BITS + 1],
+	size_t bits)
+{
+	uint64_t mask = mask_of(bits);
+	for (size_t k = 0; k < count; ++k) {
+		size_t bit = k * bits;
+		size_t word = bit / LONG_BITS;
+		size_t offset = bit % LONG_BITS;
+		uint64_t x = words[word] >> offset;
+		if (offset + bits > LONG_BITS) x |= words[word + 1] << (LONG_BITS - offset);
+		dest[k] = x & mask;
+	}
+}
+
+[[gnu::always_inline]] static inline void pack_block(
+	uint64_t words[restrict NBTS_BITPACK_MAX_BITS + 1],
+	uint16_t const *restrict nonnull src,
+	size_t count,
+	size_t bits)
+{
+	uint64_t mask = mask_of(bits);
+	for (size_t k = 0; k < count; ++k) {
+		size_t bit = k * bits;
+		size_t word = bit / LONG_BITS;
+		size_t offset = bit % LONG_BITS;
+		uint64_t x = src[k] & mask;
+		words[word] |= x << offset;
+		if (offset + bits > LONG_BITS) words[word + 1] |= x >> (LONG_BITS - offset);
+	}
+}
+
+[[gnu::always_inline]] static inline void unpack_spanning(
+	uint16_t *restrict nonnull dest, size_t count, uint8_t const *restrict nonnull src, size_t bits)
+{
+	uint64_t words[NBTS_BITPACK_MAX_BITS + 1] = {};
+
+	size_t full = count / LONG_BITS;
+	for (size_t i = 0; i < full; ++i) {
+		for (size_t w = 0; w < bits; ++w) words[w] = load64(&src[(i * bits + w) * LONG_BYTES]);
+		unpack_block(&dest[i * LONG_BITS], LONG_BITS, words, bits);
+	}
+
+	size_t rest = count - full * LONG_BITS;
+	if (!rest) return;
+	size_t rest_words = (rest * bits + LONG_BITS - 1) / LONG_BITS;
+	for (size_t w = 0; w < rest_words; ++w) words[w] = load64(&src[(full * bits + w) * LONG_BYTES]);
+	unpack_block(&dest[full * LONG_BITS], rest, words, bits);
+}
+
+[[gnu::always_inline]] static inline void pack_spanning(
+	uint8_t *restrict nonnull dest, uint16_t const *restrict nonnull src, size_t count, size_t bits)
+{
+	size_t full = count / LONG_BITS;
+	for (size_t i = 0; i < full; ++i) {
+		uint64_t words[NBTS_BITPACK_MAX_BITS + 1] = {};
+		pack_block(words, &src[i * LONG_BITS], LONG_BITS, bits);
+		for (size_t w = 0; w < bits; ++w) store64(&dest[(i * bits + w) * LONG_BYTES], words[w]);
+	}
+
+	size_t rest = count - full * LONG_BITS;
+	if (!rest) return;
+	uint64_t words[NBTS_BITPACK_MAX_BITS + 1] = {};
+	pack_block(words, &src[full * LONG_BITS], rest, bits);
+	size_t rest_words = (rest * bits + LONG_BITS - 1) / LONG_BITS;
+	for (size_t w = 0; w < rest_words; ++w) store64(&dest[(full * bits + w) * LONG_BYTES], words[w]);
+}
+
+typedef void unpack_fn(
+	uint16_t *restrict nonnull dest, size_t count, uint8_t const *restrict nonnull src);
+typedef void pack_fn(
+	uint8_t *restrict nonnull dest, uint16_t const *restrict nonnull src, size_t count);
+
+#define SPECIALIZE(BITS)                                                                       \
+	static void unpack_padded_##BITS(                                                          \
+		uint16_t *restrict nonnull dest, size_t count, uint8_t const *restrict nonnull src)    \
+	{                                                                                          \
+		unpack_padded(dest, count, src, BITS);                                                 \
+	}                                                                                          \
+	static void unpack_spanning_##BITS(                                                        \
+		uint16_t *restrict nonnull dest, size_t count, uint8_t const *restrict nonnull src)    \
+	{                                                                                          \
+		unpack_spanning(dest, count, src, BITS);                                               \
+	}                                                                                          \
+	static void pack_padded_##BITS(                                                            \
+		uint8_t *restrict nonnull dest, uint16_t const *restrict nonnull src, size_t count)    \
+	{                                                                                          \
+		pack_padded(dest, src, count, BITS);                                                   \
+	}                                                                                          \
+	static void pack_spanning_##BITS(                                                          \
+		uint8_t *restrict nonnull dest, uint16_t const *restrict nonnull src, size_t count)    \
+	{                                                                                          \
+		pack_spanning(dest, src, count, BITS);                                                 \
+	}
+
+SPECIALIZE(1)
+SPECIALIZE(2)
+SPECIALIZE(3)
+SPECIALIZE(4)
+SPECIALIZE(5)
+SPECIALIZE(6)
+SPECIALIZE(7)
+SPECIALIZE(8)
+SPECIALIZE(9)
+SPECIALIZE(10)
+SPECIALIZE(11)
+SPECIALIZE(12)
+SPECIALIZE(13)
+SPECIALIZE(14)
+SPECIALIZE(15)
+SPECIALIZE(16)
+
+#define TABLE(NAME)                                                                           \
+	{                                                                                         \
+		nullptr, &NAME##_1, &NAME##_2, &NAME##_3, &NAME##_4, &NAME##_5, &NAME##_6, &NAME##_7, \
+			&NAME##_8, &NAME##_9, &NAME##_10, &NAME##_11, &NAME##_12, &NAME##_13, &NAME##_14, \
+			&NAME##_15, &NAME##_16,                                                           \
+	}
+
+static unpack_fn *const unpack_table[][NBTS_BITPACK_MAX_BITS + 1] = {
+	[NBTS_BITPACK_PADDED] = TABLE(unpack_padded),
+	[NBTS_BITPACK_SPANNING] = TABLE(unpack_spanning),
+};
+
+static pack_fn *const pack_table[][NBTS_BITPACK_MAX_BITS + 1] = {
+	[NBTS_BITPACK_PADDED] = TABLE(pack_padded),
+	[NBTS_BITPACK_SPANNING] = TABLE(pack_spanning),
+};
+
+static bool valid(enum nbts_bitpack scheme, size_t bits)
+{
+	return (scheme == NBTS_BITPACK_PADDED || scheme == NBTS_BITPACK_SPANNING) && bits >= 1 &&
+	       bits <= NBTS_BITPACK_MAX_BITS;
+}
+
+size_t nbts_bitpack_longs(enum nbts_bitpack scheme, size_t bits, size_t count)
+{
+	if (!valid(scheme, bits)) return 0;
+	if (scheme == NBTS_BITPACK_PADDED) {
+		size_t per_long = LONG_BITS / bits;
+		return (count + per_long - 1) / per_long;
+	}
+	return (count * bits + LONG_BITS - 1) / LONG_BITS;
+}
+
+enum nbts_error nbts_unpack_indices(
+	uint16_t *restrict nonnull dest,
+	size_t count,
+	void const *restrict nonnull src,
+	size_t bits,
+	enum nbts_bitpack scheme)
+{
+	if (!valid(scheme, bits)) return NBTS_INVALID_SIZE;
+	unpack_table[scheme][bits](dest, count, src);
+	return NBTS_OK;
+}
+
+enum nbts_error nbts_pack_indices(
+	void *restrict nonnull dest,
+	uint16_t const *restrict nonnull src,
+	size_t count,
+	size_t bits,
+	enum nbts_bitpack scheme)
+{
+	if (!valid(scheme, bits)) return NBTS_INVALID_SIZE;
+	pack_table[scheme][bits](dest, src, count);
+	return NBTS_OK;
+}
+
+/// Returns the number of values in one chunk of at most `BUFSIZE` longs.
+///
+/// Chunks consist of whole groups of longs that do not share values, so
+/// every chunk can be converted on its own.
+static size_t chunk_values(enum nbts_bitpack scheme, size_t bits, size_t max_longs)
+{
+	if (scheme == NBTS_BITPACK_PADDED) return max_longs * (LONG_BITS / bits);
+	return max_longs / bits * LONG_BITS;
+}
+
+enum nbts_error nbts_parse_packed_indices(
+	uint16_t *restrict nonnull dest,
+	size_t count,
+	size_t bits,
+	enum nbts_bitpack scheme,
+	FILE *restrict nonnull stream)
+{
+	enum : size_t { BUFSIZE = NBTS_STACK_BUFFER_SIZE / LONG_BYTES };
+
+	if (!valid(scheme, bits)) return NBTS_INVALID_SIZE;
+	unpack_fn *unpack = unpack_table[scheme][bits];
+	size_t max_values = chunk_values(scheme, bits, BUFSIZE);
+
+	uint8_t buffer[BUFSIZE * LONG_BYTES];
+	while (count) {
+		size_t chunk_size = count < max_values ? count : max_values;
+		size_t longs = nbts_bitpack_longs(scheme, bits, chunk_size);
+		TRY(nbts_parse_byte_array((nbts_byte *) buffer, longs * LONG_BYTES, stream));
+		unpack(dest, chunk_size, buffer);
+		dest += chunk_size;
+		count -= chunk_size;
+	}
+	return NBTS_OK;
+}
+
+enum nbts_error nbts_write_packed_indices(
+	FILE *restrict nonnull stream,
+	uint16_t const *restrict nonnull src,
+	size_t count,
+	size_t bits,
+	enum nbts_bitpack scheme)
+{
+	enum : size_t { BUFSIZE = NBTS_STACK_BUFFER_SIZE / LONG_BYTES };
+
+	if (!valid(scheme, bits)) return NBTS_INVALID_SIZE;
+	pack_fn *pack = pack_table[scheme][bits];
+	size_t max_values = chunk_values(scheme, bits, BUFSIZE);
+
+	uint8_t buffer[BUFSIZE * LONG_BYTES];
+	while (count) {
+		size_t chunk_size = count < max_values ? count : max_values;
+		size_t longs = nbts_bitpack_longs(scheme, bits, chunk_size);
+		pack(buffer, src, chunk_size);
+		TRY(nbts_write_byte_array(stream, (nbts_byte const *) buffer, longs * LONG_BYTES));
+		src += chunk_size;
+		count -= chunk_size;
+	}
+	return NBTS_OK;
+}
+
+// NOLINTEND(bugprone-easily-swappable-parameters)
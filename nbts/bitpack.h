@@ -0,0 +1,92 @@
+#pragma once
+
+/// \file
+///
+/// \brief Bit-packed index arrays as used for block states and heightmaps.
+///
+/// Minecraft stores arrays of small unsigned integers, such as palette
+/// indices and heights, bit-packed into a \ref NBTS_LONG_ARRAY. The
+/// functions here convert between the wire bytes of such an array and an
+/// array of `uint16_t` in one pass, fusing the byte swap into the unpacking
+/// loop. The loops are specialized for every bit width, so the compiler can
+/// unroll and vectorize them.
+
+#include <nbts/nbts.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// The largest supported number of bits per value.
+enum : size_t { NBTS_BITPACK_MAX_BITS = 16 };
+
+/// A bit packing scheme.
+enum nbts_bitpack : uint8_t {
+	/// Values do not span longs; the unused high bits of each long are zero.
+	/// Used since Minecraft 1.16.
+	NBTS_BITPACK_PADDED,
+	/// Values are packed back to back and may span two longs. Used before
+	/// Minecraft 1.16.
+	NBTS_BITPACK_SPANNING,
+};
+
+/// Returns the number of longs holding `count` values of `bits` bits packed
+/// with `scheme`, or `0` if `bits` is not supported.
+size_t nbts_bitpack_longs(enum nbts_bitpack scheme, size_t bits, size_t count);
+
+/// Unpacks `count` values of `bits` bits from the wire bytes of a long array
+/// at `src` into `dest`.
+///
+/// `src` holds \ref nbts_bitpack_longs longs in the wire byte order and does
+/// not need to be aligned, so it may point into a \ref nbts_mmap_view.
+enum nbts_error nbts_unpack_indices(
+	uint16_t *restrict nonnull dest,
+	size_t count,
+	void const *restrict nonnull src,
+	size_t bits,
+	enum nbts_bitpack scheme);
+
+/// Packs `count` values of `bits` bits from `src` into the wire bytes of a
+/// long array at `dest`.
+///
+/// `dest` has room for \ref nbts_bitpack_longs longs. Only the low `bits`
+/// bits of each value are stored.
+enum nbts_error nbts_pack_indices(
+	void *restrict nonnull dest,
+	uint16_t const *restrict nonnull src,
+	size_t count,
+	size_t bits,
+	enum nbts_bitpack scheme);
+
+/// Reads the elements of a long array holding `count` packed values from
+/// `stream` and unpacks them into `dest`.
+///
+/// This is the bulk counterpart of \ref nbts_parse_long_array. Like it, it
+/// reads \ref nbts_bitpack_longs elements but not the size of the array; the
+/// caller should check that the size matches. The array is processed in
+/// chunks of \ref NBTS_STACK_BUFFER_SIZE bytes.
+enum nbts_error nbts_parse_packed_indices(
+	uint16_t *restrict nonnull dest,
+	size_t count,
+	size_t bits,
+	enum nbts_bitpack scheme,
+	FILE *restrict nonnull stream);
+
+/// Packs `count` values from `src` and writes them to `stream` as the
+/// elements of a long array.
+///
+/// The size of the array has to be written separately, see
+/// \ref nbts_bitpack_longs.
+enum nbts_error nbts_write_packed_indices(
+	FILE *restrict nonnull stream,
+	uint16_t const *restrict nonnull src,
+	size_t count,
+	size_t bits,
+	enum nbts_bitpack scheme);
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,388 @@
+#include <nbts/cache.h>
+#include <nbts/compression.h>
+#include <nbts/pool.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+enum : size_t {
+	/// The number of shards per processor by default.
+	SHARDS_PER_THREAD = 4,
+	/// The initial number of hash buckets of a shard.
+	INITIAL_BUCKETS = 64,
+};
+
+struct entry {
+	/// The part visible to users, which \ref nbts_cache_get returns.
+	struct nbts_cache_entry public;
+	/// The digest of the path of the region file.
+	struct nbts_digest region;
+	uint64_t hash;
+	uint32_t timestamp;
+	uint16_t chunk;
+	/// Whether the entry was used since the clock hand last passed it.
+	bool referenced;
+	/// Whether the entry is in its shard, as opposed to evicted or too large.
+	bool cached;
+	/// The number of references returned by \ref nbts_cache_get.
+	size_t refs;
+	/// The index of the entry in the clock of its shard.
+	size_t clock_index;
+	/// The next entry in the same hash bucket.
+	struct entry *nullable next;
+};
+
+struct nbts_cache_shard {
+	alignas(64) mtx_t lock;
+	/// The hash table of entries, chained through \ref entry::next.
+	struct entry *nullable *nullable buckets;
+	size_t bucket_count;
+	/// The cached entries in the order the clock hand visits them.
+	struct entry *nullable *nullable clock;
+	size_t count;
+	size_t clock_capacity;
+	size_t hand;
+	/// The total size of the cached entries and its limit.
+	size_t size;
+	size_t capacity;
+	size_t hits;
+	size_t misses;
+	size_t evictions;
+};
+
+// NOLINTBEGIN(bugprone-easily-swappable-parameters)
+
+struct nbts_cache_options nbts_cache_options(
+	nbts_cache_decode_fn *nonnull decode,
+	nbts_cache_release_fn *nullable release,
+	void *nullable userdata,
+	size_t capacity)
+{
+	return (struct nbts_cache_options){
+		.decode = decode,
+		.release = release,
+		.userdata = userdata,
+		.capacity = capacity,
+	};
+}
+
+enum nbts_error nbts_cache_init(
+	struct nbts_cache *restrict nonnull cache,
+	struct nbts_cache_options const *restrict nonnull options)
+{
+	size_t shards = options->shards;
+	if (!shards) shards = nbts_pool_threads(0) * SHARDS_PER_THREAD;
+	size_t count = 1;
+	while (count < shards) count *= 2;
+
+	*cache = (struct nbts_cache){.options = *options};
+	cache->shards = aligned_alloc(alignof(struct nbts_cache_shard), count * sizeof(*cache->shards));
+	if (!cache->shards) return NBTS_ALLOC_ERR;
+
+	for (size_t i = 0; i < count; ++i) {
+		struct nbts_cache_shard *shard = &cache->shards[i];
+		*shard = (struct nbts_cache_shard){.capacity = options->capacity / count};
+		shard->buckets = calloc(INITIAL_BUCKETS, sizeof(*shard->buckets));
+		if (!shard->buckets || mtx_init(&shard->lock, mtx_plain) != thrd_success) {
+			free(shard->buckets);
+			cache->shard_count = i;
+			nbts_cache_free(cache);
+			return NBTS_ALLOC_ERR;
+		}
+		shard->bucket_count = INITIAL_BUCKETS;
+	}
+	cache->shard_count = count;
+	return NBTS_OK;
+}
+
+static void
+destroy(struct nbts_cache const *restrict nonnull cache, struct entry *restrict nonnull entry)
+{
+	struct nbts_cache_options const *options = &cache->options;
+	if (options->release) options->release(options->userdata, entry->public.value);
+	free(entry);
+}
+
+void nbts_cache_free(struct nbts_cache *restrict nonnull cache)
+{
+	for (size_t i = 0; i < cache->shard_count; ++i) {
+		struct nbts_cache_shard *shard = &cache->shards[i];
+		for (size_t j = 0; j < shard->count; ++j) destroy(cache, shard->clock[j]);
+		free(shard->buckets);
+		free(shard->clock);
+		mtx_destroy(&shard->lock);
+	}
+	free(cache->shards);
+	*cache = (struct nbts_cache){};
+}
+
+static struct nbts_cache_shard *nonnull
+shard_of(struct nbts_cache const *restrict nonnull cache, uint64_t hash)
+{
+	return &cache->shards[(hash >> 32) & (cache->shard_count - 1)];
+}
+
+static struct entry *nullable *nonnull
+bucket_of(struct nbts_cache_shard const *restrict nonnull shard, uint64_t hash)
+{
+	return &shard->buckets[hash & (shard->bucket_count - 1)];
+}
+
+/// Returns the entry of the chunk with `hash`, `region` and `chunk` in
+/// `shard` regardless of its timestamp, or `nullptr`.
+static struct entry *nullable find(
+	struct nbts_cache_shard const *restrict nonnull shard,
+	uint64_t hash,
+	struct nbts_digest region,
+	uint16_t chunk)
+{
+	for (struct entry *entry = *bucket_of(shard, hash); entry; entry = entry->next) {
+		if (entry->hash == hash && entry->chunk == chunk && entry->region.lo == region.lo &&
+			entry->region.hi == region.hi) {
+			return entry;
+		}
+	}
+	return nullptr;
+}
+
+/// Removes `entry` from `shard` and destroys it unless it is referenced.
+static void evict(
+	struct nbts_cache const *restrict nonnull cache,
+	struct nbts_cache_shard *restrict nonnull shard,
+	struct entry *restrict nonnull entry)
+{
+	struct entry **link = bucket_of(shard, entry->hash);
+	while (*link != entry) link = &(*link)->next;
+	*link = entry->next;
+
+	struct entry *last = shard->clock[--shard->count];
+	shard->clock[entry->clock_index] = last;
+	last->clock_index = entry->clock_index;
+	if (shard->hand >= shard->count) shard->hand = 0;
+
+	shard->size -= entry->public.size;
+	++shard->evictions;
+	entry->cached = false;
+	if (!entry->refs) destroy(cache, entry);
+}
+
+/// Evicts unreferenced entries from `shard` until `size` more bytes fit or
+/// only referenced entries are left.
+static void make_room(
+	struct nbts_cache const *restrict nonnull cache,
+	struct nbts_cache_shard *restrict nonnull shard,
+	size_t size)
+{
+	// Each entry is passed at most twice: once to clear its reference bit
+	// and once to evict it. Referenced entries are skipped.
+	size_t budget = 2 * shard->count;
+	while (shard->count && shard->size + size > shard->capacity && budget--) {
+		struct entry *entry = shard->clock[shard->hand];
+		if (!entry->refs && !entry->referenced) {
+			evict(cache, shard, entry);
+			continue;
+		}
+		entry->referenced = false;
+		shard->hand = (shard->hand + 1) % shard->count;
+	}
+}
+
+static enum nbts_error grow(struct nbts_cache_shard *restrict nonnull shard)
+{
+	if (shard->count == shard->clock_capacity) {
+		size_t capacity = shard->clock_capacity ? 2 * shard->clock_capacity : INITIAL_BUCKETS;
+		struct entry **clock = realloc(shard->clock, capacity * sizeof(*clock));
+		if (!clock) return NBTS_ALLOC_ERR;
+		shard->clock = clock;
+		shard->clock_capacity = capacity;
+	}
+
+	if (shard->count < shard->bucket_count) return NBTS_OK;
+
+	size_t bucket_count = 2 * shard->bucket_count;
+	struct entry **buckets = calloc(bucket_count, sizeof(*buckets));
+	if (!buckets) return NBTS_ALLOC_ERR;
+	for (size_t i = 0; i < shard->bucket_count; ++i) {
+		for (struct entry *entry = shard->buckets[i], *next = nullptr; entry; entry = next) {
+			next = entry->next;
+			struct entry **bucket = &buckets[entry->hash & (bucket_count - 1)];
+			entry->next = *bucket;
+			*bucket = entry;
+		}
+	}
+	free(shard->buckets);
+	shard->buckets = buckets;
+	shard->bucket_count = bucket_count;
+	return NBTS_OK;
+}
+
+/// Adds `entry` to `shard` if it fits, evicting other entries as needed.
+static void insert(
+	struct nbts_cache const *restrict nonnull cache,
+	struct nbts_cache_shard *restrict nonnull shard,
+	struct entry *restrict nonnull entry)
+{
+	if (entry->public.size > shard->capacity) return;
+	make_room(cache, shard, entry->public.size);
+	if (grow(shard)) return;
+
+	struct entry **bucket = bucket_of(shard, entry->hash);
+	entry->next = *bucket;
+	*bucket = entry;
+	entry->clock_index = shard->count;
+	shard->clock[shard->count++] = entry;
+	shard->size += entry->public.size;
+	entry->cached = true;
+}
+
+/// Decodes the chunk at `index` of `region` into `entry`.
+static enum nbts_error decode(
+	struct nbts_cache const *restrict nonnull cache,
+	struct nbts_region *restrict nonnull region,
+	size_t index,
+	struct entry *restrict nonnull entry)
+{
+	struct nbts_buffer raw = {};
+	struct nbts_buffer decompressed = {};
+	enum nbts_compression compression = NBTS_COMPRESSION_NONE;
+	enum nbts_error err = nbts_region_read(region, index, &raw, &compression);
+
+	struct nbts_buffer *input = &raw;
+	if (!err && compression != NBTS_COMPRESSION_NONE) {
+		err = nbts_decompress(&decompressed, compression, raw.data, raw.size);
+		input = &decompressed;
+	}
+
+	FILE *stream = nullptr;
+	if (!err) {
+		stream = fmemopen(input->data, input->size, "rb");
+		if (!stream) err = NBTS_READ_ERR;
+	}
+	if (!err) {
+		struct nbts_cache_options const *options = &cache->options;
+		err = options->decode(options->userdata, stream, &entry->public.value, &entry->public.size);
+	}
+
+	if (stream) fclose(stream);
+	nbts_buffer_free(&raw);
+	nbts_buffer_free(&decompressed);
+	return err;
+}
+
+enum nbts_error nbts_cache_get(
+	struct nbts_cache *restrict nonnull cache,
+	struct nbts_region *restrict nonnull region,
+	size_t index,
+	struct nbts_cache_entry const *nullable *restrict nonnull entry)
+{
+	*entry = nullptr;
+	if (!nbts_region_has_chunk(region, index)) return NBTS_INVALID_ID;
+
+	struct nbts_digest path = nbts_hash(region->path, strlen(region->path), 0);
+	uint64_t hash = path.lo + index * UINT64_C(0x9E3779B97F4A7C15);
+	uint32_t timestamp = region->timestamps[index];
+	struct nbts_cache_shard *shard = shard_of(cache, hash);
+
+	mtx_lock(&shard->lock);
+	struct entry *found = find(shard, hash, path, index);
+	if (found && found->timestamp != timestamp) {
+		// A handle on an older copy of the region file must not displace
+		// the chunk of a newer one.
+		if (found->timestamp < timestamp) evict(cache, shard, found);
+		found = nullptr;
+	}
+	if (found) {
+		found->referenced = true;
+		++found->refs;
+		++shard->hits;
+	} else {
+		++shard->misses;
+	}
+	mtx_unlock(&shard->lock);
+
+	if (found) {
+		*entry = &found->public;
+		return NBTS_OK;
+	}
+
+	// The chunk is decoded without holding the lock, so other threads may
+	// decode it at the same time. The first one to finish wins, unless the
+	// other decoded a newer version of the chunk, which stays cached while
+	// this one is returned uncached.
+	struct entry *created = malloc(sizeof(*created));
+	if (!created) return NBTS_ALLOC_ERR;
+	*created = (struct entry){
+		.region = path,
+		.hash = hash,
+		.timestamp = timestamp,
+		.chunk = index,
+		.refs = 1,
+	};
+	enum nbts_error err = decode(cache, region, index, created);
+	if (err) {
+		free(created);
+		return err;
+	}
+
+	mtx_lock(&shard->lock);
+	found = find(shard, hash, path, index);
+	bool raced = found && found->timestamp == timestamp;
+	if (raced) {
+		++found->refs;
+	} else if (!found || found->timestamp < timestamp) {
+		if (found) evict(cache, shard, found);
+		insert(cache, shard, created);
+	}
+	mtx_unlock(&shard->lock);
+
+	if (raced) {
+		destroy(cache, created);
+		created = found;
+	}
+	*entry = &created->public;
+	return NBTS_OK;
+}
+
+void nbts_cache_release(
+	struct nbts_cache *restrict nonnull cache,
+	struct nbts_cache_entry const *restrict nonnull entry)
+{
+	struct entry *e = (struct entry *) entry;
+	struct nbts_cache_shard *shard = shard_of(cache, e->hash);
+
+	mtx_lock(&shard->lock);
+	bool dead = !--e->refs && !e->cached;
+	mtx_unlock(&shard->lock);
+
+	if (dead) destroy(cache, e);
+}
+
+struct nbts_cache_stats nbts_cache_stats(struct nbts_cache *restrict nonnull cache)
+{
+	struct nbts_cache_stats stats = {};
+	for (size_t i = 0; i < cache->shard_count; ++i) {
+		struct nbts_cache_shard *shard = &cache->shards[i];
+		mtx_lock(&shard->lock);
+		stats.hits += shard->hits;
+		stats.misses += shard->misses;
+		stats.evictions += shard->evictions;
+		stats.size += shard->size;
+		mtx_unlock(&shard->lock);
+	}
+	return stats;
+}
+
+// NOLINTEND(bugprone-easily-swappable-parameters)
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,128 @@
+#pragma once
+
+/// \file
+///
+/// \brief A bounded cache of decoded chunks shared between threads.
+///
+/// \ref nbts_cache_get returns the value a user-supplied decode callback
+/// produced for a chunk of a region file, decoding it only if it is not
+/// cached. Entries are keyed by the path of the region file, the index of
+/// the chunk and its timestamp from the region header, so reopening a
+/// region after it was rewritten invalidates its changed chunks. A hit
+/// neither reads the file nor parses anything.
+///
+/// The cache is split into shards with a lock each, selected by the hash of
+/// the key, so threads looking up different chunks rarely contend. Each
+/// shard evicts entries with the CLOCK algorithm once the sizes reported by
+/// the decode callback exceed its share of the byte budget. Entries stay
+/// alive while they are referenced, even if they are evicted meanwhile.
+
+#include <nbts/hash.h>
+#include <nbts/region.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// The type of a callback decoding a chunk.
+///
+/// `stream` reads the decompressed chunk. The callback shall store the
+/// decoded value in `value` and the number of bytes it takes up in `size`.
+typedef enum nbts_error nbts_cache_decode_fn(
+	void *nullable userdata,
+	FILE *restrict nonnull stream,
+	void *nullable *restrict nonnull value,
+	size_t *restrict nonnull size);
+
+/// The type of a callback releasing a value returned by a
+/// \ref nbts_cache_decode_fn.
+typedef void nbts_cache_release_fn(void *nullable userdata, void *nullable value);
+
+/// Options for \ref nbts_cache_init.
+struct nbts_cache_options {
+	nbts_cache_decode_fn *nonnull decode;
+	/// Called for every value once it is evicted and unreferenced, if not
+	/// `nullptr`.
+	nbts_cache_release_fn *nullable release;
+	/// Passed to `decode` and `release`.
+	void *nullable userdata;
+	/// The total size of the cached values in bytes.
+	size_t capacity;
+	/// The number of shards, rounded up to a power of two, or `0` to choose
+	/// one from the number of processors.
+	size_t shards;
+};
+
+/// Returns options caching up to `capacity` bytes of values decoded by
+/// `decode` with default settings.
+struct nbts_cache_options nbts_cache_options(
+	nbts_cache_decode_fn *nonnull decode,
+	nbts_cache_release_fn *nullable release,
+	void *nullable userdata,
+	size_t capacity);
+
+/// A referenced value in a cache.
+struct nbts_cache_entry {
+	/// The value returned by the decode callback.
+	void *nullable value;
+	/// The size returned by the decode callback.
+	size_t size;
+};
+
+struct nbts_cache_shard;
+
+/// A cache of decoded chunks.
+struct nbts_cache {
+	struct nbts_cache_options options;
+	struct nbts_cache_shard *nullable shards;
+	size_t shard_count;
+};
+
+/// Initializes an empty `cache` with `options`.
+///
+/// The cache must be freed with \ref nbts_cache_free.
+enum nbts_error nbts_cache_init(
+	struct nbts_cache *restrict nonnull cache,
+	struct nbts_cache_options const *restrict nonnull options);
+
+/// Releases all values of `cache`.
+///
+/// No entry may be referenced anymore.
+void nbts_cache_free(struct nbts_cache *restrict nonnull cache);
+
+/// Stores a reference to the decoded value of the chunk at `index` of
+/// `region` in `entry`, decoding the chunk on a miss.
+///
+/// The reference must be dropped with \ref nbts_cache_release. Any number of
+/// threads may call this function concurrently, also with the same region.
+/// Returns \ref NBTS_INVALID_ID if the chunk does not exist and the error of
+/// the decode callback if it fails, in which case nothing is cached.
+enum nbts_error nbts_cache_get(
+	struct nbts_cache *restrict nonnull cache,
+	struct nbts_region *restrict nonnull region,
+	size_t index,
+	struct nbts_cache_entry const *nullable *restrict nonnull entry);
+
+/// Drops a reference to `entry` returned by \ref nbts_cache_get.
+void nbts_cache_release(
+	struct nbts_cache *restrict nonnull cache,
+	struct nbts_cache_entry const *restrict nonnull entry);
+
+/// Counts of the lookups of a cache.
+struct nbts_cache_stats {
+	size_t hits;
+	size_t misses;
+	size_t evictions;
+	/// The total size of the cached values.
+	size_t size;
+};
+
+/// Returns the counts of all lookups of `cache` so far.
+struct nbts_cache_stats nbts_cache_stats(struct nbts_cache *restrict nonnull cache);
+
+#undef nonnull
+#undef nullable
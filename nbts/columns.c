@@ -0,0 +1,620 @@
+#include <nbts/columns.h>
+#include <nbts/compression.h>
+#include <nbts/path.h>
+#include <nbts/walk.h>
+#include <nbts/write.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+enum : size_t {
+	DEFAULT_BATCH_ROWS = 4096,
+	DEFAULT_MAX_COLUMNS = 256,
+};
+
+static char const MAGIC[] = "NBTC";
+enum : uint8_t { VERSION = 1 };
+
+/// One column of the current batch.
+struct column {
+	/// The flattened name of the column.
+	nbts_char *nonnull name;
+	nbts_strsize name_size;
+	enum nbts_type type;
+	/// The size of a value, or `0` for strings.
+	size_t width;
+	/// The values of the rows, or the characters of strings.
+	struct nbts_buffer values;
+	/// For strings, the offsets of the characters of each row.
+	uint32_t *nullable offsets;
+	/// A bitmap of the rows the column is set in.
+	uint8_t *nonnull validity;
+	/// One more than the last row the column was set in.
+	size_t set;
+};
+
+struct context {
+	struct nbts_columns_options const *nonnull options;
+	FILE *nonnull istream;
+	struct column *nonnull columns;
+	size_t columns_size;
+	/// The number of rows in the current batch.
+	size_t rows;
+	/// Whether the columns have been written, so no more can be added.
+	bool schema_written;
+	/// The column after the last one looked up, where the next tag of a row
+	/// is expected.
+	size_t hint;
+	/// The flattened name of the current tag of a row.
+	nbts_char name[NBTS_STACK_BUFFER_SIZE];
+};
+
+// NOLINTBEGIN(bugprone-easily-swappable-parameters)
+
+struct nbts_columns_options nbts_columns_options(
+	char const *nonnull path, FILE *nonnull ostream, enum nbts_columns_format format)
+{
+	return (struct nbts_columns_options){
+		.path = path,
+		.ostream = ostream,
+		.format = format,
+		.batch_rows = DEFAULT_BATCH_ROWS,
+		.max_columns = DEFAULT_MAX_COLUMNS,
+	};
+}
+
+static size_t value_width(enum nbts_type type)
+{
+	switch (type) {
+	case NBTS_BYTE: return sizeof(nbts_byte);
+	case NBTS_SHORT: return sizeof(nbts_short);
+	case NBTS_INT: return sizeof(nbts_int);
+	case NBTS_LONG: return sizeof(nbts_long);
+	case NBTS_FLOAT: return sizeof(nbts_float);
+	case NBTS_DOUBLE: return sizeof(nbts_double);
+	case NBTS_END:
+	case NBTS_STRING:
+	case NBTS_BYTE_ARRAY:
+	case NBTS_INT_ARRAY:
+	case NBTS_LONG_ARRAY:
+	case NBTS_LIST:
+	case NBTS_COMPOUND: return 0;
+	}
+	return 0;
+}
+
+static size_t bitmap_size(size_t rows) { return (rows + 7) / 8; }
+
+static void free_column(struct column *restrict nonnull column)
+{
+	free(column->name);
+	free(column->offsets);
+	free(column->validity);
+	nbts_buffer_free(&column->values);
+}
+
+static struct column *nullable add_column(
+	struct context *restrict nonnull ctx, nbts_strsize name_size, enum nbts_type type)
+{
+	size_t rows = ctx->options->batch_rows;
+	struct column column = {
+		.name = malloc(name_size ? name_size : 1),
+		.name_size = name_size,
+		.type = type,
+		.width = value_width(type),
+		.validity = calloc(bitmap_size(rows), 1),
+	};
+	bool ok = column.name && column.validity;
+	if (ok && type == NBTS_STRING) {
+		column.offsets = calloc(rows + 1, sizeof(*column.offsets));
+		ok = column.offsets && !nbts_buffer_reserve(&column.values, rows);
+	} else if (ok) {
+		// Rows before the column was discovered are nulls.
+		ok = !nbts_buffer_reserve(&column.values, rows * column.width);
+		if (ok) memset(column.values.data, 0, rows * column.width);
+	}
+	if (!ok) {
+		free_column(&column);
+		return nullptr;
+	}
+
+	memcpy(column.name, ctx->name, name_size);
+	ctx->columns[ctx->columns_size] = column;
+	return &ctx->columns[ctx->columns_size++];
+}
+
+/// Looks up the column for the tag of `type` whose flattened name is the
+/// first `name_size` characters of the name buffer.
+///
+/// Returns `nullptr` in `dest` if the tag is not exported.
+static enum nbts_error find_column(
+	struct context *restrict nonnull ctx,
+	nbts_strsize name_size,
+	enum nbts_type type,
+	struct column *nullable *restrict nonnull dest)
+{
+	*dest = nullptr;
+
+	// Elements usually have their tags in the same order, so the column
+	// after the previous one is tried first.
+	size_t index = ctx->hint;
+	struct column *column = index < ctx->columns_size ? &ctx->columns[index] : nullptr;
+	if (!column || column->name_size != name_size || memcmp(column->name, ctx->name, name_size)) {
+		column = nullptr;
+		for (index = 0; index < ctx->columns_size; ++index) {
+			struct column *c = &ctx->columns[index];
+			if (c->name_size == name_size && !memcmp(c->name, ctx->name, name_size)) {
+				column = c;
+				break;
+			}
+		}
+	}
+
+	if (!column) {
+		if (ctx->schema_written || ctx->columns_size == ctx->options->max_columns) return NBTS_OK;
+		column = add_column(ctx, name_size, type);
+		if (!column) return NBTS_ALLOC_ERR;
+		index = ctx->columns_size - 1;
+	}
+
+	ctx->hint = index + 1;
+	if (column->type == type && column->set != ctx->rows + 1) *dest = column;
+	return NBTS_OK;
+}
+
+static void set_valid(struct column *restrict nonnull column, size_t row)
+{
+	column->validity[row / 8] |= (uint8_t) (1U << (row % 8));
+	column->set = row + 1;
+}
+
+static enum nbts_error parse_scalar(
+	struct context *restrict nonnull ctx, struct column *restrict nonnull column)
+{
+	uint8_t *dest = &column->values.data[ctx->rows * column->width];
+	switch (column->type) {
+	case NBTS_BYTE: TRY(nbts_parse_byte((nbts_byte *) dest, ctx->istream)); break;
+	case NBTS_SHORT: {
+		nbts_short x = 0;
+		TRY(nbts_parse_short(&x, ctx->istream));
+		memcpy(dest, &x, sizeof(x));
+		break;
+	}
+	case NBTS_INT: {
+		nbts_int x = 0;
+		TRY(nbts_parse_int(&x, ctx->istream));
+		memcpy(dest, &x, sizeof(x));
+		break;
+	}
+	case NBTS_LONG: {
+		nbts_long x = 0;
+		TRY(nbts_parse_long(&x, ctx->istream));
+		memcpy(dest, &x, sizeof(x));
+		break;
+	}
+	case NBTS_FLOAT: {
+		nbts_float x = 0;
+		TRY(nbts_parse_float(&x, ctx->istream));
+		memcpy(dest, &x, sizeof(x));
+		break;
+	}
+	case NBTS_DOUBLE: {
+		nbts_double x = 0;
+		TRY(nbts_parse_double(&x, ctx->istream));
+		memcpy(dest, &x, sizeof(x));
+		break;
+	}
+	default: return NBTS_INVALID_ID;
+	}
+	set_valid(column, ctx->rows);
+	return NBTS_OK;
+}
+
+static enum nbts_error parse_string(
+	struct context *restrict nonnull ctx, struct column *restrict nonnull column)
+{
+	nbts_strsize size = 0;
+	TRY(nbts_parse_strsize(&size, ctx->istream));
+
+	struct nbts_buffer *values = &column->values;
+	if (values->size + size > UINT32_MAX) return NBTS_LIMIT_EXCEEDED;
+	TRY(nbts_buffer_reserve(values, values->size + size));
+	TRY(nbts_parse_string(&values->data[values->size], size, ctx->istream));
+	values->size += size;
+
+	column->offsets[ctx->rows + 1] = values->size;
+	set_valid(column, ctx->rows);
+	return NBTS_OK;
+}
+
+static enum nbts_error skip_bytes(FILE *restrict nonnull stream, size_t size)
+{
+	nbts_byte buffer[NBTS_STACK_BUFFER_SIZE];
+	while (size) {
+		size_t chunk_size = size < sizeof(buffer) ? size : sizeof(buffer);
+		TRY(nbts_parse_byte_array(buffer, chunk_size, stream));
+		size -= chunk_size;
+	}
+	return NBTS_OK;
+}
+
+/// Parses the tags of a compound into the current row. The first `prefix`
+/// characters of the name buffer hold the flattened name of the compound.
+static enum nbts_error parse_row(struct context *restrict nonnull ctx, size_t prefix)
+{
+	while (1) {
+		enum nbts_type type = 0;
+		TRY(nbts_parse_typeid(&type, ctx->istream));
+		if (type == NBTS_END) break;
+
+		nbts_strsize name_size = 0;
+		TRY(nbts_parse_strsize(&name_size, ctx->istream));
+
+		// Tags whose flattened name does not fit are not exported. If the
+		// prefix fills the buffer, not even the separator fits.
+		size_t start = prefix ? prefix + 1 : 0;
+		if (start > NBTS_STACK_BUFFER_SIZE || name_size > NBTS_STACK_BUFFER_SIZE - start) {
+			TRY(skip_bytes(ctx->istream, name_size));
+			TRY(nbts_skip_payload(type, ctx->istream));
+			continue;
+		}
+		if (prefix) ctx->name[prefix] = '.';
+		TRY(nbts_parse_string(&ctx->name[start], name_size, ctx->istream));
+		size_t size = start + name_size;
+
+		if (type == NBTS_COMPOUND) {
+			TRY(parse_row(ctx, size));
+			continue;
+		}
+
+		struct column *column = nullptr;
+		if (type == NBTS_STRING || value_width(type)) TRY(find_column(ctx, size, type, &column));
+		if (!column) {
+			TRY(nbts_skip_payload(type, ctx->istream));
+		} else if (type == NBTS_STRING) {
+			TRY(parse_string(ctx, column));
+		} else {
+			TRY(parse_scalar(ctx, column));
+		}
+	}
+	return NBTS_OK;
+}
+
+static enum nbts_error
+write_short_array(FILE *restrict nonnull stream, uint8_t const *restrict nonnull src, size_t size)
+{
+	enum : size_t { BUFSIZE = NBTS_STACK_BUFFER_SIZE / sizeof(nbts_short) };
+
+	uint8_t buffer[BUFSIZE * sizeof(nbts_short)];
+	while (size) {
+		size_t chunk_size = size < BUFSIZE ? size : BUFSIZE;
+		for (size_t i = 0; i < chunk_size; ++i) {
+			uint16_t x = 0;
+			memcpy(&x, &src[i * sizeof(x)], sizeof(x));
+			buffer[2 * i] = x >> 8;
+			buffer[2 * i + 1] = x & 0xFF;
+		}
+		size_t bytes = chunk_size * sizeof(nbts_short);
+		TRY(nbts_write_byte_array(stream, (nbts_byte const *) buffer, bytes));
+		src += chunk_size * sizeof(nbts_short);
+		size -= chunk_size;
+	}
+	return NBTS_OK;
+}
+
+static enum nbts_error write_binary_schema(struct context const *restrict nonnull ctx)
+{
+	FILE *ostream = ctx->options->ostream;
+	TRY(nbts_write_string(ostream, (nbts_char const *) MAGIC, sizeof(MAGIC) - 1));
+	TRY(nbts_write_uint8(ostream, VERSION));
+	TRY(nbts_write_uint16(ostream, ctx->columns_size));
+	for (size_t i = 0; i < ctx->columns_size; ++i) {
+		struct column const *column = &ctx->columns[i];
+		TRY(nbts_write_typeid(ostream, column->type));
+		TRY(nbts_write_strsize(ostream, column->name_size));
+		TRY(nbts_write_string(ostream, column->name, column->name_size));
+	}
+	return NBTS_OK;
+}
+
+static enum nbts_error write_binary_batch(struct context const *restrict nonnull ctx)
+{
+	FILE *ostream = ctx->options->ostream;
+	size_t rows = ctx->rows;
+	TRY(nbts_write_uint32(ostream, rows));
+
+	for (size_t i = 0; i < ctx->columns_size; ++i) {
+		struct column const *column = &ctx->columns[i];
+		uint8_t const *values = column->values.data;
+		nbts_byte const *validity = (nbts_byte const *) column->validity;
+		TRY(nbts_write_byte_array(ostream, validity, bitmap_size(rows)));
+
+		switch (column->width) {
+		case 0:
+			TRY(nbts_write_int_array(ostream, (nbts_int const *) column->offsets, rows + 1));
+			TRY(nbts_write_string(ostream, values, column->offsets[rows]));
+			break;
+		case 1: TRY(nbts_write_byte_array(ostream, (nbts_byte const *) values, rows)); break;
+		case 2: TRY(write_short_array(ostream, values, rows)); break;
+		case 4: TRY(nbts_write_int_array(ostream, (nbts_int const *) values, rows)); break;
+		case 8: TRY(nbts_write_long_array(ostream, (nbts_long const *) values, rows)); break;
+		default: return NBTS_INVALID_ID;
+		}
+	}
+	return NBTS_OK;
+}
+
+static enum nbts_error write_csv_string(
+	FILE *restrict nonnull ostream, nbts_char const *restrict nonnull src, size_t size)
+{
+	if (putc('"', ostream) == EOF) return NBTS_WRITE_ERR;
+	while (size) {
+		nbts_char const *quote = memchr(src, '"', size);
+		size_t chunk_size = quote ? (size_t) (quote - src) + 1 : size;
+		TRY(nbts_write_string(ostream, src, chunk_size));
+		if (quote && putc('"', ostream) == EOF) return NBTS_WRITE_ERR;
+		src += chunk_size;
+		size -= chunk_size;
+	}
+	if (putc('"', ostream) == EOF) return NBTS_WRITE_ERR;
+	return NBTS_OK;
+}
+
+static enum nbts_error write_csv_schema(struct context const *restrict nonnull ctx)
+{
+	FILE *ostream = ctx->options->ostream;
+	for (size_t i = 0; i < ctx->columns_size; ++i) {
+		if (i && putc(',', ostream) == EOF) return NBTS_WRITE_ERR;
+		TRY(write_csv_string(ostream, ctx->columns[i].name, ctx->columns[i].name_size));
+	}
+	if (putc('\n', ostream) == EOF) return NBTS_WRITE_ERR;
+	return NBTS_OK;
+}
+
+static enum nbts_error write_csv_value(
+	FILE *restrict nonnull ostream, struct column const *restrict nonnull column, size_t row)
+{
+	uint8_t const *value = &column->values.data[row * column->width];
+	int n = 0;
+	switch (column->type) {
+	case NBTS_BYTE: {
+		nbts_byte x = 0;
+		memcpy(&x, value, sizeof(x));
+		n = fprintf(ostream, "%d", x);
+		break;
+	}
+	case NBTS_SHORT: {
+		nbts_short x = 0;
+		memcpy(&x, value, sizeof(x));
+		n = fprintf(ostream, "%d", x);
+		break;
+	}
+	case NBTS_INT: {
+		nbts_int x = 0;
+		memcpy(&x, value, sizeof(x));
+		n = fprintf(ostream, "%" PRId32, x);
+		break;
+	}
+	case NBTS_LONG: {
+		nbts_long x = 0;
+		memcpy(&x, value, sizeof(x));
+		n = fprintf(ostream, "%" PRId64, x);
+		break;
+	}
+	case NBTS_FLOAT: {
+		nbts_float x = 0;
+		memcpy(&x, value, sizeof(x));
+		n = fprintf(ostream, "%.9g", (double) x);
+		break;
+	}
+	case NBTS_DOUBLE: {
+		nbts_double x = 0;
+		memcpy(&x, value, sizeof(x));
+		n = fprintf(ostream, "%.17g", x);
+		break;
+	}
+	case NBTS_STRING: {
+		uint32_t begin = column->offsets[row];
+		uint32_t end = column->offsets[row + 1];
+		return write_csv_string(ostream, &column->values.data[begin], end - begin);
+	}
+	default: return NBTS_INVALID_ID;
+	}
+	return n < 0 ? NBTS_WRITE_ERR : NBTS_OK;
+}
+
+static enum nbts_error write_csv_batch(struct context const *restrict nonnull ctx)
+{
+	FILE *ostream = ctx->options->ostream;
+	for (size_t row = 0; row < ctx->rows; ++row) {
+		for (size_t i = 0; i < ctx->columns_size; ++i) {
+			struct column const *column = &ctx->columns[i];
+			if (i && putc(',', ostream) == EOF) return NBTS_WRITE_ERR;
+			bool valid = column->validity[row / 8] & (1U << (row % 8));
+			if (valid) TRY(write_csv_value(ostream, column, row));
+		}
+		if (putc('\n', ostream) == EOF) return NBTS_WRITE_ERR;
+	}
+	return NBTS_OK;
+}
+
+static enum nbts_error write_schema(struct context *restrict nonnull ctx)
+{
+	if (ctx->schema_written) return NBTS_OK;
+	ctx->schema_written = true;
+	if (ctx->options->format == NBTS_COLUMNS_CSV) return write_csv_schema(ctx);
+	return write_binary_schema(ctx);
+}
+
+static enum nbts_error flush(struct context *restrict nonnull ctx)
+{
+	if (!ctx->rows) return NBTS_OK;
+	TRY(write_schema(ctx));
+	if (ctx->options->format == NBTS_COLUMNS_CSV) {
+		TRY(write_csv_batch(ctx));
+	} else {
+		TRY(write_binary_batch(ctx));
+	}
+
+	for (size_t i = 0; i < ctx->columns_size; ++i) {
+		struct column *column = &ctx->columns[i];
+		memset(column->validity, 0, bitmap_size(ctx->rows));
+		column->set = 0;
+		if (column->offsets) column->values.size = 0;
+	}
+	ctx->rows = 0;
+	return NBTS_OK;
+}
+
+static enum nbts_error end_row(struct context *restrict nonnull ctx)
+{
+	size_t row = ctx->rows;
+	for (size_t i = 0; i < ctx->columns_size; ++i) {
+		struct column *column = &ctx->columns[i];
+		if (column->set == row + 1) continue;
+		if (column->offsets) {
+			column->offsets[row + 1] = column->offsets[row];
+		} else {
+			memset(&column->values.data[row * column->width], 0, column->width);
+		}
+	}
+
+	ctx->rows += 1;
+	ctx->hint = 0;
+	if (ctx->rows == ctx->options->batch_rows) return flush(ctx);
+	return NBTS_OK;
+}
+
+static enum nbts_error export_list(struct context *restrict nonnull ctx)
+{
+	enum nbts_type type = 0;
+	TRY(nbts_parse_typeid(&type, ctx->istream));
+	nbts_size size = 0;
+	TRY(nbts_parse_size(&size, ctx->istream));
+
+	if (type != NBTS_COMPOUND) return nbts_parse_list(type, size, ctx->istream, nullptr, nullptr);
+
+	for (nbts_size i = 0; i < size; ++i) {
+		TRY(parse_row(ctx, 0));
+		TRY(end_row(ctx));
+	}
+	return NBTS_OK;
+}
+
+static enum nbts_error visit_payload(
+	struct context *restrict nonnull ctx,
+	struct nbts_path const *restrict nonnull path,
+	enum nbts_type type);
+
+static enum nbts_error visit_child(
+	struct context *restrict nonnull ctx,
+	struct nbts_path const *restrict nullable parent,
+	enum nbts_type type)
+{
+	nbts_strsize name_size = 0;
+	TRY(nbts_parse_strsize(&name_size, ctx->istream));
+
+	nbts_char buffer[NBTS_NAME_BUFSIZE];
+	nbts_char *name = nbts_name_alloc(buffer, name_size);
+	if (!name) return NBTS_ALLOC_ERR;
+
+	enum nbts_error err = nbts_parse_string(name, name_size, ctx->istream);
+	if (!err) {
+		struct nbts_path path = nbts_path_name(parent, name, name_size);
+		err = visit_payload(ctx, &path, type);
+	}
+
+	nbts_name_free(name, buffer);
+	return err;
+}
+
+static enum nbts_error
+visit_compound(struct context *restrict nonnull ctx, struct nbts_path const *restrict nonnull path)
+{
+	while (1) {
+		enum nbts_type type = 0;
+		TRY(nbts_parse_typeid(&type, ctx->istream));
+		if (type == NBTS_END) break;
+		TRY(visit_child(ctx, path, type));
+	}
+	return NBTS_OK;
+}
+
+static enum nbts_error
+visit_list(struct context *restrict nonnull ctx, struct nbts_path const *restrict nonnull path)
+{
+	enum nbts_type type = 0;
+	TRY(nbts_parse_typeid(&type, ctx->istream));
+	nbts_size size = 0;
+	TRY(nbts_parse_size(&size, ctx->istream));
+
+	for (nbts_size i = 0; i < size; ++i) {
+		struct nbts_path element = nbts_path_index(path, i);
+		TRY(visit_payload(ctx, &element, type));
+	}
+	return NBTS_OK;
+}
+
+static enum nbts_error visit_payload(
+	struct context *restrict nonnull ctx,
+	struct nbts_path const *restrict nonnull path,
+	enum nbts_type type)
+{
+	char const *rest = nbts_path_match_prefix(ctx->options->path, path);
+	if (rest && !*rest && type == NBTS_LIST) return export_list(ctx);
+	if (!rest || !*rest) return nbts_skip_payload(type, ctx->istream);
+
+	switch (type) {
+	case NBTS_COMPOUND: return visit_compound(ctx, path);
+	case NBTS_LIST: return visit_list(ctx, path);
+	default: return nbts_skip_payload(type, ctx->istream);
+	}
+}
+
+enum nbts_error nbts_export_columns(
+	FILE *restrict nonnull istream, struct nbts_columns_options const *restrict nonnull options)
+{
+	if (!options->batch_rows || !options->max_columns) return NBTS_INVALID_SIZE;
+
+	struct context *ctx = malloc(sizeof(*ctx));
+	struct column *columns = calloc(options->max_columns, sizeof(*columns));
+	if (!ctx || !columns) {
+		free(ctx);
+		free(columns);
+		return NBTS_ALLOC_ERR;
+	}
+	*ctx = (struct context){.options = options, .istream = istream, .columns = columns};
+
+	enum nbts_type type = 0;
+	enum nbts_error err = nbts_parse_typeid(&type, istream);
+	if (!err && type == NBTS_END) err = NBTS_UNEXPECTED_END_TAG;
+	if (!err) err = visit_child(ctx, nullptr, type);
+	if (!err) err = flush(ctx);
+	if (!err) err = write_schema(ctx);
+	// The binary format ends with an empty batch.
+	bool binary = options->format == NBTS_COLUMNS_BINARY;
+	if (!err && binary) err = nbts_write_uint32(options->ostream, 0);
+
+	for (size_t i = 0; i < ctx->columns_size; ++i) free_column(&ctx->columns[i]);
+	free(columns);
+	free(ctx);
+	return err;
+}
+
+// NOLINTEND(bugprone-easily-swappable-parameters)
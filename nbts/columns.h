@@ -0,0 +1,77 @@
+#pragma once
+
+/// \file
+///
+/// \brief Exporting lists of compounds as tables.
+///
+/// \ref nbts_export_columns streams one named tag and turns every element
+/// of the lists of compounds at a path into a row. Each scalar or string
+/// tag in an element becomes a column; nested compounds are flattened, so
+/// `{Pos: {x: 1}}` yields the column `Pos.x`. Lists and arrays inside the
+/// elements are not exported.
+///
+/// Rows are collected in typed column buffers of a fixed number of rows and
+/// written out a batch at a time, so memory usage does not depend on the
+/// number of rows. The columns are discovered from the first batch; tags
+/// first appearing later are ignored. A missing tag, or a tag with a
+/// different type than the first one seen for its column, is a null.
+///
+/// The binary format consists of big-endian fields in the following order:
+///
+/// - The magic `NBTC` and a version byte of `1`.
+/// - The number of columns as a `uint16_t`, then for each column its
+///   \ref nbts_type and its name as a \ref nbts_strsize and characters.
+/// - Any number of batches, each consisting of its number of rows as a
+///   `uint32_t` followed by each column in turn. A column is a bitmap of its
+///   non-null rows, least significant bit first, and its values. Scalar
+///   values are stored like NBT arrays without the size, with nulls as
+///   zeros. Strings are stored as the `uint32_t` offsets of the first
+///   character of each row, plus the end of the last, followed by the
+///   characters.
+/// - A batch of zero rows marking the end.
+
+#include <nbts/nbts.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// An output format of \ref nbts_export_columns.
+enum nbts_columns_format : uint8_t {
+	NBTS_COLUMNS_CSV,     ///< RFC 4180 CSV with a header row.
+	NBTS_COLUMNS_BINARY,  ///< The columnar format described above.
+};
+
+/// Options for \ref nbts_export_columns.
+struct nbts_columns_options {
+	/// A pattern as accepted by \ref nbts_path_match designating the lists
+	/// to export.
+	char const *nonnull path;
+	/// The stream receiving the table.
+	FILE *nonnull ostream;
+	enum nbts_columns_format format;
+	/// The number of rows per batch.
+	size_t batch_rows;
+	/// The largest number of columns.
+	size_t max_columns;
+};
+
+/// Returns options exporting the lists at `path` to `ostream` in `format`
+/// with default settings.
+struct nbts_columns_options nbts_columns_options(
+	char const *nonnull path, FILE *nonnull ostream, enum nbts_columns_format format);
+
+/// Exports the elements of the lists matching `options->path` in one named
+/// tag from `istream`.
+///
+/// The elements of all matching lists go into the same table. Lists whose
+/// elements are not compounds are skipped.
+enum nbts_error nbts_export_columns(
+	FILE *restrict nonnull istream, struct nbts_columns_options const *restrict nonnull options);
+
+#undef nonnull
+#undef nullable
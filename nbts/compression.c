@@ -0,0 +1,377 @@
+#include <nbts/compression.h>
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if NBTS_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#if NBTS_WITH_LZ4
+#include <lz4.h>
+#endif
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+void nbts_buffer_free(struct nbts_buffer *restrict nonnull buffer)
+{
+	free(buffer->data);
+	*buffer = (struct nbts_buffer){};
+}
+
+enum nbts_error nbts_buffer_reserve(struct nbts_buffer *restrict nonnull buffer, size_t capacity)
+{
+	if (capacity <= buffer->capacity && buffer->data) return NBTS_OK;
+
+	size_t new_capacity = buffer->capacity ? buffer->capacity : 4096;
+	while (new_capacity < capacity) new_capacity *= 2;
+
+	uint8_t *data = realloc(buffer->data, new_capacity);
+	if (!data) return NBTS_ALLOC_ERR;
+	buffer->data = data;
+	buffer->capacity = new_capacity;
+	return NBTS_OK;
+}
+
+enum nbts_compression nbts_detect_compression(void const *restrict nonnull data, size_t size)
+{
+	uint8_t const *p = data;
+	if (size < 2) return NBTS_COMPRESSION_NONE;
+	if (p[0] == 0x1F && p[1] == 0x8B) return NBTS_COMPRESSION_GZIP;
+
+	// A zlib header with a window size of 512 bytes or more; the first byte
+	// of such a header is never a valid type ID.
+	bool deflate = (p[0] & 0x0F) == 8 && (p[0] >> 4) >= 1 && (p[0] >> 4) <= 7;
+	if (deflate && ((p[0] << 8) | p[1]) % 31 == 0) return NBTS_COMPRESSION_ZLIB;
+
+	return NBTS_COMPRESSION_NONE;
+}
+
+#if NBTS_WITH_ZLIB
+
+/// Returns the part of `size` that fits into the `uInt` sizes of zlib.
+static uInt zlib_chunk(size_t size) { return size < UINT_MAX ? (uInt) size : UINT_MAX; }
+
+static enum nbts_error inflate_buffer(
+	struct nbts_buffer *restrict nonnull dest,
+	int window_bits,
+	void const *restrict nonnull src,
+	size_t size)
+{
+	z_stream z = {};
+	if (inflateInit2(&z, window_bits) != Z_OK) return NBTS_ALLOC_ERR;
+
+	// Inputs and outputs larger than 4 GiB are passed to zlib in chunks.
+	uint8_t const *in = src;
+	size_t in_size = size;
+
+	enum nbts_error err = NBTS_OK;
+	dest->size = 0;
+	while (1) {
+		if (!z.avail_in) {
+			z.next_in = (Bytef *) in;
+			z.avail_in = zlib_chunk(in_size);
+			in += z.avail_in;
+			in_size -= z.avail_in;
+		}
+
+		if (dest->size == dest->capacity || !dest->data) {
+			err = nbts_buffer_reserve(dest, dest->size < size ? 4 * size : 2 * dest->size);
+			if (err) break;
+		}
+
+		uInt avail_out = zlib_chunk(dest->capacity - dest->size);
+		z.next_out = &dest->data[dest->size];
+		z.avail_out = avail_out;
+		int ret = inflate(&z, Z_NO_FLUSH);
+		dest->size += avail_out - z.avail_out;
+
+		if (ret == Z_STREAM_END) break;
+		if (ret == Z_MEM_ERROR) err = NBTS_ALLOC_ERR;
+		if (ret == Z_BUF_ERROR && z.avail_out) err = NBTS_UNEXPECTED_EOF;
+		if (ret == Z_DATA_ERROR || ret == Z_NEED_DICT || ret == Z_STREAM_ERROR) {
+			err = NBTS_COMPRESSION_ERR;
+		}
+		if (err) break;
+	}
+
+	inflateEnd(&z);
+	return err;
+}
+
+static enum nbts_error deflate_buffer(
+	struct nbts_buffer *restrict nonnull dest,
+	int window_bits,
+	int level,
+	void const *restrict nonnull src,
+	size_t size)
+{
+	z_stream z = {};
+	if (level < Z_DEFAULT_COMPRESSION || level > Z_BEST_COMPRESSION) return NBTS_INVALID_SIZE;
+	if (deflateInit2(&z, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		return NBTS_ALLOC_ERR;
+
+	// The bound includes room for the gzip header and trailer.
+	enum nbts_error err = nbts_buffer_reserve(dest, deflateBound(&z, size) + 18);
+	dest->size = 0;
+
+	// Inputs and outputs larger than 4 GiB are passed to zlib in chunks.
+	uint8_t const *in = src;
+	size_t in_size = size;
+
+	while (!err) {
+		if (!z.avail_in) {
+			z.next_in = (Bytef *) in;
+			z.avail_in = zlib_chunk(in_size);
+			in += z.avail_in;
+			in_size -= z.avail_in;
+		}
+
+		uInt avail_out = zlib_chunk(dest->capacity - dest->size);
+		z.next_out = &dest->data[dest->size];
+		z.avail_out = avail_out;
+		int ret = deflate(&z, in_size ? Z_NO_FLUSH : Z_FINISH);
+		dest->size += avail_out - z.avail_out;
+
+		if (ret == Z_STREAM_END) break;
+		if (ret != Z_OK) err = NBTS_COMPRESSION_ERR;
+	}
+
+	deflateEnd(&z);
+	return err;
+}
+
+#endif
+
+#if NBTS_WITH_LZ4
+
+// Minecraft stores LZ4 chunks in the block stream format of lz4-java: each
+// block is preceded by a 21 byte header, and an empty block ends the stream.
+// The checksum is a 32-bit xxHash, truncated to 28 bits by lz4-java.
+
+static char const LZ4_MAGIC[] = "LZ4Block";
+
+enum : size_t {
+	LZ4_MAGIC_SIZE = sizeof(LZ4_MAGIC) - 1,
+	LZ4_HEADER_SIZE = LZ4_MAGIC_SIZE + 1 + 3 * sizeof(uint32_t),
+	LZ4_BLOCK_SIZE = 64 * 1024,
+};
+
+enum : uint8_t {
+	LZ4_METHOD_RAW = 0x10,
+	LZ4_METHOD_LZ4 = 0x20,
+	/// The binary logarithm of the block size minus 10.
+	LZ4_LEVEL = 6,
+};
+
+enum : uint32_t { LZ4_SEED = 0x9747B28C, LZ4_CHECKSUM_MASK = 0x0FFFFFFF };
+
+static uint32_t rotl32(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+static uint32_t load32le(uint8_t const *nonnull p)
+{
+	return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static void store32le(uint8_t *nonnull p, uint32_t x)
+{
+	for (size_t i = 0; i < sizeof(x); ++i) p[i] = (uint8_t) (x >> (8 * i));
+}
+
+static uint32_t xxh32(uint8_t const *restrict nonnull data, size_t size, uint32_t seed)
+{
+	static uint32_t const P1 = 0x9E3779B1U, P2 = 0x85EBCA77U, P3 = 0xC2B2AE3DU, P4 = 0x27D4EB2FU,
+	                      P5 = 0x165667B1U;
+
+	uint8_t const *end = data + size;
+	uint32_t h = 0;
+	if (size >= 16) {
+		uint32_t v[4] = {seed + P1 + P2, seed + P2, seed, seed - P1};
+		for (; end - data >= 16; data += 16) {
+			for (size_t i = 0; i < 4; ++i) {
+				v[i] = rotl32(v[i] + load32le(&data[4 * i]) * P2, 13) * P1;
+			}
+		}
+		h = rotl32(v[0], 1) + rotl32(v[1], 7) + rotl32(v[2], 12) + rotl32(v[3], 18);
+	} else {
+		h = seed + P5;
+	}
+
+	h += (uint32_t) size;
+	for (; end - data >= 4; data += 4) h = rotl32(h + load32le(data) * P3, 17) * P4;
+	for (; data < end; ++data) h = rotl32(h + *data * P5, 11) * P1;
+
+	h ^= h >> 15;
+	h *= P2;
+	h ^= h >> 13;
+	h *= P3;
+	h ^= h >> 16;
+	return h;
+}
+
+static enum nbts_error lz4_decompress_buffer(
+	struct nbts_buffer *restrict nonnull dest, void const *restrict nonnull src, size_t size)
+{
+	uint8_t const *p = src;
+	uint8_t const *end = p + size;
+	dest->size = 0;
+
+	while (1) {
+		if ((size_t) (end - p) < LZ4_HEADER_SIZE) return NBTS_UNEXPECTED_EOF;
+		if (memcmp(p, LZ4_MAGIC, LZ4_MAGIC_SIZE)) return NBTS_COMPRESSION_ERR;
+		uint8_t method = p[LZ4_MAGIC_SIZE] & 0xF0;
+		uint32_t compressed_size = load32le(&p[LZ4_MAGIC_SIZE + 1]);
+		uint32_t original_size = load32le(&p[LZ4_MAGIC_SIZE + 5]);
+		uint32_t checksum = load32le(&p[LZ4_MAGIC_SIZE + 9]);
+		p += LZ4_HEADER_SIZE;
+
+		if (!original_size) return NBTS_OK;
+		if (compressed_size > (size_t) (end - p)) return NBTS_UNEXPECTED_EOF;
+		TRY(nbts_buffer_reserve(dest, dest->size + original_size));
+
+		uint8_t *out = &dest->data[dest->size];
+		if (method == LZ4_METHOD_RAW) {
+			if (compressed_size != original_size) return NBTS_COMPRESSION_ERR;
+			memcpy(out, p, original_size);
+		} else if (method == LZ4_METHOD_LZ4) {
+			if (compressed_size > INT_MAX || original_size > INT_MAX) return NBTS_COMPRESSION_ERR;
+			int n = LZ4_decompress_safe(
+				(char const *) p, (char *) out, (int) compressed_size, (int) original_size);
+			if (n < 0 || (uint32_t) n != original_size) return NBTS_COMPRESSION_ERR;
+		} else {
+			return NBTS_COMPRESSION_ERR;
+		}
+
+		if ((xxh32(out, original_size, LZ4_SEED) & LZ4_CHECKSUM_MASK) != checksum)
+			return NBTS_COMPRESSION_ERR;
+		dest->size += original_size;
+		p += compressed_size;
+	}
+}
+
+static void lz4_header(
+	uint8_t *restrict nonnull dest,
+	uint8_t method,
+	uint32_t compressed_size,
+	uint32_t original_size,
+	uint32_t checksum)
+{
+	memcpy(dest, LZ4_MAGIC, LZ4_MAGIC_SIZE);
+	dest[LZ4_MAGIC_SIZE] = method | LZ4_LEVEL;
+	store32le(&dest[LZ4_MAGIC_SIZE + 1], compressed_size);
+	store32le(&dest[LZ4_MAGIC_SIZE + 5], original_size);
+	store32le(&dest[LZ4_MAGIC_SIZE + 9], checksum);
+}
+
+static enum nbts_error lz4_compress_buffer(
+	struct nbts_buffer *restrict nonnull dest, void const *restrict nonnull src, size_t size)
+{
+	uint8_t const *p = src;
+	size_t blocks = (size + LZ4_BLOCK_SIZE - 1) / LZ4_BLOCK_SIZE;
+	size_t bound = LZ4_HEADER_SIZE + (size_t) LZ4_compressBound(LZ4_BLOCK_SIZE);
+	TRY(nbts_buffer_reserve(dest, blocks * bound + LZ4_HEADER_SIZE));
+	dest->size = 0;
+
+	for (size_t i = 0; i < blocks; ++i) {
+		size_t original_size = size - i * LZ4_BLOCK_SIZE;
+		if (original_size > LZ4_BLOCK_SIZE) original_size = LZ4_BLOCK_SIZE;
+		uint8_t const *block = &p[i * LZ4_BLOCK_SIZE];
+		uint8_t *out = &dest->data[dest->size];
+
+		// Blocks that do not shrink are stored raw.
+		int n = LZ4_compress_default(
+			(char const *) block, (char *) &out[LZ4_HEADER_SIZE], (int) original_size,
+			LZ4_compressBound(LZ4_BLOCK_SIZE));
+		uint8_t method = LZ4_METHOD_LZ4;
+		size_t compressed_size = n;
+		if (n <= 0 || (size_t) n >= original_size) {
+			method = LZ4_METHOD_RAW;
+			compressed_size = original_size;
+			memcpy(&out[LZ4_HEADER_SIZE], block, original_size);
+		}
+
+		uint32_t checksum = xxh32(block, original_size, LZ4_SEED) & LZ4_CHECKSUM_MASK;
+		lz4_header(out, method, compressed_size, original_size, checksum);
+		dest->size += LZ4_HEADER_SIZE + compressed_size;
+	}
+
+	lz4_header(&dest->data[dest->size], LZ4_METHOD_RAW, 0, 0, 0);
+	dest->size += LZ4_HEADER_SIZE;
+	return NBTS_OK;
+}
+
+#endif
+
+enum nbts_error nbts_decompress(
+	struct nbts_buffer *restrict nonnull dest,
+	enum nbts_compression format,
+	void const *restrict nonnull src,
+	size_t size)
+{
+	switch (format) {
+	case NBTS_COMPRESSION_NONE:
+		TRY(nbts_buffer_reserve(dest, size));
+		memcpy(dest->data, src, size);
+		dest->size = size;
+		return NBTS_OK;
+#if NBTS_WITH_ZLIB
+	case NBTS_COMPRESSION_GZIP: return inflate_buffer(dest, 16 + MAX_WBITS, src, size);
+	case NBTS_COMPRESSION_ZLIB: return inflate_buffer(dest, MAX_WBITS, src, size);
+#else
+	case NBTS_COMPRESSION_GZIP:
+	case NBTS_COMPRESSION_ZLIB: return NBTS_UNSUPPORTED;
+#endif
+#if NBTS_WITH_LZ4
+	case NBTS_COMPRESSION_LZ4: return lz4_decompress_buffer(dest, src, size);
+#else
+	case NBTS_COMPRESSION_LZ4: return NBTS_UNSUPPORTED;
+#endif
+	}
+	return NBTS_UNSUPPORTED;
+}
+
+enum nbts_error nbts_compress(
+	struct nbts_buffer *restrict nonnull dest,
+	enum nbts_compression format,
+	int level,
+	void const *restrict nonnull src,
+	size_t size)
+{
+#if !NBTS_WITH_ZLIB
+	(void) level;
+#endif
+
+	switch (format) {
+	case NBTS_COMPRESSION_NONE:
+		TRY(nbts_buffer_reserve(dest, size));
+		memcpy(dest->data, src, size);
+		dest->size = size;
+		return NBTS_OK;
+#if NBTS_WITH_ZLIB
+	case NBTS_COMPRESSION_GZIP: return deflate_buffer(dest, 16 + MAX_WBITS, level, src, size);
+	case NBTS_COMPRESSION_ZLIB: return deflate_buffer(dest, MAX_WBITS, level, src, size);
+#else
+	case NBTS_COMPRESSION_GZIP:
+	case NBTS_COMPRESSION_ZLIB: return NBTS_UNSUPPORTED;
+#endif
+#if NBTS_WITH_LZ4
+	case NBTS_COMPRESSION_LZ4: return lz4_compress_buffer(dest, src, size);
+#else
+	case NBTS_COMPRESSION_LZ4: return NBTS_UNSUPPORTED;
+#endif
+	}
+	return NBTS_UNSUPPORTED;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+/// \file
+///
+/// \brief Whole-buffer compression and decompression of NBT data.
+///
+/// The values of \ref nbts_compression match the compression type byte of
+/// chunks in region files. Which formats are supported depends on the
+/// libraries the library was built with; unsupported formats yield
+/// \ref NBTS_UNSUPPORTED.
+
+#include <nbts/nbts.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// A compression format.
+enum nbts_compression : uint8_t {
+	NBTS_COMPRESSION_GZIP = 1,  ///< RFC 1952 gzip.
+	NBTS_COMPRESSION_ZLIB = 2,  ///< RFC 1950 zlib.
+	NBTS_COMPRESSION_NONE = 3,  ///< Uncompressed.
+	NBTS_COMPRESSION_LZ4 = 4,   ///< LZ4 block stream as written by Minecraft.
+};
+
+/// A growable buffer receiving decompressed data.
+///
+/// The buffer may be reused for any number of calls to
+/// \ref nbts_decompress, so its memory is only reallocated when a larger
+/// payload comes along.
+struct nbts_buffer {
+	uint8_t *nullable data;
+	size_t size;
+	size_t capacity;
+};
+
+/// Releases the memory held by `buffer`.
+void nbts_buffer_free(struct nbts_buffer *restrict nonnull buffer);
+
+/// Ensures that `buffer` can hold at least `capacity` bytes.
+enum nbts_error nbts_buffer_reserve(struct nbts_buffer *restrict nonnull buffer, size_t capacity);
+
+/// Guesses the compression format of the `size` bytes at `data` from their
+/// first bytes.
+///
+/// Uncompressed NBT starts with a type ID, which never collides with the
+/// magic numbers of gzip or zlib.
+enum nbts_compression nbts_detect_compression(void const *restrict nonnull data, size_t size);
+
+/// Decompresses `size` bytes at `src` in `format` into `dest`.
+///
+/// Any previous content of `dest` is replaced.
+enum nbts_error nbts_decompress(
+	struct nbts_buffer *restrict nonnull dest,
+	enum nbts_compression format,
+	void const *restrict nonnull src,
+	size_t size);
+
+/// The compression level selecting the default of the format.
+enum : int { NBTS_COMPRESSION_DEFAULT_LEVEL = -1 };
+
+/// Compresses `size` bytes at `src` into `dest` in `format`.
+///
+/// `level` ranges from `0` to `9` for gzip and zlib, or is
+/// \ref NBTS_COMPRESSION_DEFAULT_LEVEL. It is ignored by other formats.
+/// Any previous content of `dest` is replaced.
+enum nbts_error nbts_compress(
+	struct nbts_buffer *restrict nonnull dest,
+	enum nbts_compression format,
+	int level,
+	void const *restrict nonnull src,
+	size_t size);
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,96 @@
+#pragma once
+
+/// \file
+///
+/// \brief Bounds checked reading of NBT held in memory.
+///
+/// The indexes over buffers, \ref tape.h and \ref view.h, walk the encoding
+/// with a \ref nbts_cursor instead of a stream. Every read checks the
+/// remaining size, so truncated or corrupt input fails with an error
+/// instead of reading past the buffer.
+///
+/// This header is internal to the library.
+
+#include <nbts/measure.h>
+#include <nbts/nbts.h>
+
+#include <endian.h>
+
+#include <string.h>
+
+#define NBTS_BYTE_ORDER BIG_ENDIAN
+
+#if NBTS_BYTE_ORDER == BIG_ENDIAN
+#define nbt16toh(...) be16toh(__VA_ARGS__)
+#define nbt32toh(...) be32toh(__VA_ARGS__)
+#elif NBTS_BYTE_ORDER == LITTLE_ENDIAN
+#define nbt16toh(...) le16toh(__VA_ARGS__)
+#define nbt32toh(...) le32toh(__VA_ARGS__)
+#else
+#error "Byte order not supported"
+#endif
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// A bounds checked read position in a buffer.
+struct nbts_cursor {
+	uint8_t const *nonnull data;
+	size_t size;
+	size_t position;
+};
+
+/// Whether all payloads of `type` have the size \ref nbts_measure_fixed,
+/// which is `0` for \ref NBTS_END.
+static inline bool nbts_has_fixed_size(enum nbts_type type) { return type <= NBTS_DOUBLE; }
+
+static inline enum nbts_error
+nbts_cursor_advance(struct nbts_cursor *restrict nonnull c, size_t size)
+{
+	if (size > c->size - c->position) return NBTS_UNEXPECTED_EOF;
+	c->position += size;
+	return NBTS_OK;
+}
+
+static inline enum nbts_error nbts_cursor_read_typeid(
+	struct nbts_cursor *restrict nonnull c, enum nbts_type *restrict nonnull dest)
+{
+	if (c->position >= c->size) return NBTS_UNEXPECTED_EOF;
+	uint8_t x = c->data[c->position++];
+	if (x >= NBTS_TYPE_ENUM_SIZE) return NBTS_INVALID_ID;
+	*dest = x;
+	return NBTS_OK;
+}
+
+static inline enum nbts_error nbts_cursor_read_strsize(
+	struct nbts_cursor *restrict nonnull c, nbts_strsize *restrict nonnull dest)
+{
+	if (c->size - c->position < sizeof(uint16_t)) return NBTS_UNEXPECTED_EOF;
+	uint16_t x = 0;
+	memcpy(&x, &c->data[c->position], sizeof(x));
+	c->position += sizeof(x);
+	*dest = nbt16toh(x);
+	return NBTS_OK;
+}
+
+/// Reads the size of a list or array, which must not be negative.
+static inline enum nbts_error
+nbts_cursor_read_size(struct nbts_cursor *restrict nonnull c, size_t *restrict nonnull dest)
+{
+	if (c->size - c->position < sizeof(uint32_t)) return NBTS_UNEXPECTED_EOF;
+	uint32_t x = 0;
+	memcpy(&x, &c->data[c->position], sizeof(x));
+	c->position += sizeof(x);
+	int32_t size = (int32_t) nbt32toh(x);
+	if (size < 0) return NBTS_INVALID_SIZE;
+	*dest = size;
+	return NBTS_OK;
+}
+
+#undef nonnull
+#undef nullable
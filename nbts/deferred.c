@@ -0,0 +1,163 @@
+#define _GNU_SOURCE
+
+#include <nbts/deferred.h>
+
+#include <stdio.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+// NOLINTBEGIN(bugprone-easily-swappable-parameters)
+
+static size_t element_size(enum nbts_type type)
+{
+	switch (type) {
+	case NBTS_STRING: return sizeof(nbts_char);
+	case NBTS_BYTE_ARRAY: return sizeof(nbts_byte);
+	case NBTS_INT_ARRAY: return sizeof(nbts_int);
+	case NBTS_LONG_ARRAY: return sizeof(nbts_long);
+	case NBTS_END:
+	case NBTS_BYTE:
+	case NBTS_SHORT:
+	case NBTS_INT:
+	case NBTS_LONG:
+	case NBTS_FLOAT:
+	case NBTS_DOUBLE:
+	case NBTS_LIST:
+	case NBTS_COMPOUND: return 0;
+	}
+	return 0;
+}
+
+enum nbts_error nbts_defer(
+	struct nbts_deferred *restrict nonnull dest, enum nbts_type type, FILE *restrict nonnull stream)
+{
+	size_t size = element_size(type);
+	if (!size) return NBTS_INVALID_ID;
+
+	size_t count = 0;
+	if (type == NBTS_STRING) {
+		nbts_strsize x = 0;
+		TRY(nbts_parse_strsize(&x, stream));
+		count = x;
+	} else {
+		nbts_size x = 0;
+		TRY(nbts_parse_size(&x, stream));
+		count = x;
+	}
+
+	off64_t offset = ftello64(stream);
+	if (offset == -1) return NBTS_READ_ERR;
+	if (fseeko64(stream, (off64_t) (count * size), SEEK_CUR) == -1) return NBTS_READ_ERR;
+
+	*dest = (struct nbts_deferred){
+		.stream = stream,
+		.offset = offset,
+		.count = count,
+		.type = type,
+	};
+	return NBTS_OK;
+}
+
+static enum nbts_error check_range(
+	struct nbts_deferred const *restrict nonnull src, enum nbts_type type, size_t first, size_t count)
+{
+	if (src->type != type) return NBTS_INVALID_ID;
+	if (first > src->count || count > src->count - first) return NBTS_INVALID_SIZE;
+	return NBTS_OK;
+}
+
+/// Moves `src->stream` to element `first` and stores its old position in
+/// `saved`.
+static enum nbts_error seek_to(
+	struct nbts_deferred const *restrict nonnull src, size_t first, off64_t *restrict nonnull saved)
+{
+	*saved = ftello64(src->stream);
+	if (*saved == -1) return NBTS_READ_ERR;
+
+	off64_t offset = (off64_t) (src->offset + first * element_size(src->type));
+	if (fseeko64(src->stream, offset, SEEK_SET) == -1) return NBTS_READ_ERR;
+	return NBTS_OK;
+}
+
+static enum nbts_error
+restore(struct nbts_deferred const *restrict nonnull src, off64_t saved, enum nbts_error err)
+{
+	if (fseeko64(src->stream, saved, SEEK_SET) == -1 && !err) return NBTS_READ_ERR;
+	return err;
+}
+
+enum nbts_error nbts_fetch_string(
+	nbts_char *restrict nonnull dest,
+	struct nbts_deferred const *restrict nonnull src,
+	size_t first,
+	size_t count)
+{
+	TRY(check_range(src, NBTS_STRING, first, count));
+	off64_t saved = 0;
+	TRY(seek_to(src, first, &saved));
+	return restore(src, saved, nbts_parse_string(dest, count, src->stream));
+}
+
+enum nbts_error nbts_fetch_byte_array(
+	nbts_byte *restrict nonnull dest,
+	struct nbts_deferred const *restrict nonnull src,
+	size_t first,
+	size_t count)
+{
+	TRY(check_range(src, NBTS_BYTE_ARRAY, first, count));
+	off64_t saved = 0;
+	TRY(seek_to(src, first, &saved));
+	return restore(src, saved, nbts_parse_byte_array(dest, count, src->stream));
+}
+
+enum nbts_error nbts_fetch_int_array(
+	nbts_int *restrict nonnull dest,
+	struct nbts_deferred const *restrict nonnull src,
+	size_t first,
+	size_t count)
+{
+	TRY(check_range(src, NBTS_INT_ARRAY, first, count));
+	off64_t saved = 0;
+	TRY(seek_to(src, first, &saved));
+	return restore(src, saved, nbts_parse_int_array(dest, count, src->stream));
+}
+
+enum nbts_error nbts_fetch_long_array(
+	nbts_long *restrict nonnull dest,
+	struct nbts_deferred const *restrict nonnull src,
+	size_t first,
+	size_t count)
+{
+	TRY(check_range(src, NBTS_LONG_ARRAY, first, count));
+	off64_t saved = 0;
+	TRY(seek_to(src, first, &saved));
+	return restore(src, saved, nbts_parse_long_array(dest, count, src->stream));
+}
+
+enum nbts_error nbts_deferred_view(
+	struct nbts_mmap *restrict nonnull map,
+	struct nbts_deferred const *restrict nonnull src,
+	size_t first,
+	size_t count,
+	void const *nullable *restrict nonnull dest)
+{
+	// Offsets in other streams do not refer to the mapped file.
+	if (src->stream != map->stream) return NBTS_UNSUPPORTED;
+	TRY(check_range(src, src->type, first, count));
+	size_t size = element_size(src->type);
+	return nbts_mmap_view_at(map, src->offset + first * size, count * size, dest);
+}
+
+// NOLINTEND(bugprone-easily-swappable-parameters)
@@ -0,0 +1,102 @@
+#pragma once
+
+/// \file
+///
+/// \brief Deferred access to strings and arrays.
+///
+/// A handler that does not know yet whether it needs an array can call
+/// \ref nbts_defer instead of parsing or skipping it. This records where the
+/// payload is and seeks past it, so parsing continues without touching the
+/// elements. The payload can later be fetched in whole or in part from the
+/// same stream, or viewed in place if the stream belongs to a
+/// \ref nbts_mmap.
+///
+/// The stream has to be seekable and must stay open as long as the
+/// \ref nbts_deferred is used. Streams on memory buffers, files and
+/// \ref nbts_mmap all qualify.
+
+#include <nbts/mmap.h>
+#include <nbts/nbts.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// The location of a string or array payload in a stream.
+struct nbts_deferred {
+	/// The stream containing the payload.
+	FILE *nonnull stream;
+	/// The offset of the first element in `stream`.
+	uint64_t offset;
+	/// The number of elements.
+	size_t count;
+	/// One of \ref NBTS_STRING, \ref NBTS_BYTE_ARRAY, \ref NBTS_INT_ARRAY and
+	/// \ref NBTS_LONG_ARRAY.
+	enum nbts_type type;
+};
+
+/// Records the payload of `type` at the current position of `stream` in
+/// `dest` and moves `stream` past it.
+///
+/// This reads only the size of the payload.
+enum nbts_error nbts_defer(
+	struct nbts_deferred *restrict nonnull dest, enum nbts_type type, FILE *restrict nonnull stream);
+
+/// Reads `count` characters starting at character `first` of `src` into
+/// `dest`.
+///
+/// The position of `src->stream` is restored afterwards, so this may be
+/// called while the stream is still being parsed.
+enum nbts_error nbts_fetch_string(
+	nbts_char *restrict nonnull dest,
+	struct nbts_deferred const *restrict nonnull src,
+	size_t first,
+	size_t count);
+
+/// Reads `count` elements starting at element `first` of `src` into `dest`.
+///
+/// See \ref nbts_fetch_string.
+enum nbts_error nbts_fetch_byte_array(
+	nbts_byte *restrict nonnull dest,
+	struct nbts_deferred const *restrict nonnull src,
+	size_t first,
+	size_t count);
+
+/// Reads `count` elements starting at element `first` of `src` into `dest`.
+///
+/// See \ref nbts_fetch_string.
+enum nbts_error nbts_fetch_int_array(
+	nbts_int *restrict nonnull dest,
+	struct nbts_deferred const *restrict nonnull src,
+	size_t first,
+	size_t count);
+
+/// Reads `count` elements starting at element `first` of `src` into `dest`.
+///
+/// See \ref nbts_fetch_string.
+enum nbts_error nbts_fetch_long_array(
+	nbts_long *restrict nonnull dest,
+	struct nbts_deferred const *restrict nonnull src,
+	size_t first,
+	size_t count);
+
+/// Returns `count` elements starting at element `first` of `src` in `dest`
+/// without copying.
+///
+/// Only payloads recorded from `map->stream` can be viewed; for any other
+/// stream, \ref NBTS_UNSUPPORTED is returned. The elements are in the wire
+/// byte order. The view is invalidated like the ones returned by
+/// \ref nbts_mmap_view.
+enum nbts_error nbts_deferred_view(
+	struct nbts_mmap *restrict nonnull map,
+	struct nbts_deferred const *restrict nonnull src,
+	size_t first,
+	size_t count,
+	void const *nullable *restrict nonnull dest);
+
+#undef nonnull
+#undef nullable
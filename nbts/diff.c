@@ -0,0 +1,598 @@
+#include <nbts/diff.h>
+#include <nbts/print.h>
+#include <nbts/walk.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+#define TRYF(EXPR)                                \
+	{                                             \
+		if ((EXPR) == EOF) return NBTS_WRITE_ERR; \
+	}
+
+enum : size_t {
+	DEFAULT_MAX_KEYS = 65536,
+	DEFAULT_MAX_NAME_BYTES = 1 << 20,
+	DEFAULT_MAX_EXTENTS = 1 << 20,
+};
+
+/// A child of a compound in the second input.
+struct entry {
+	size_t name;
+	nbts_strsize name_size;
+	enum nbts_type type;
+	bool matched;
+	long tag;
+	long payload;
+	long end;
+};
+
+/// The children of one compound in the second input.
+struct level {
+	struct entry *entries;
+	size_t entries_size;
+	size_t entries_capacity;
+	nbts_char *names;
+	size_t names_size;
+	size_t names_capacity;
+	nbts_char *scratch;
+	size_t scratch_capacity;
+};
+
+/// The end offsets of the compound and list payloads of one input, by start
+/// offset.
+///
+/// The payloads are skipped once, when the root is measured. Descending into
+/// a pair of differing tags then looks up the extents of their children
+/// instead of skipping them again at every level.
+struct ends {
+	long *starts;
+	long *ends;
+	size_t size;
+	size_t capacity;
+	/// The largest number of extents recorded.
+	size_t max_size;
+};
+
+struct nbts_diff_options nbts_diff_options(nbts_diff_fn *nonnull report, void *nullable userdata)
+{
+	return (struct nbts_diff_options){
+		.report = report,
+		.userdata = userdata,
+		.max_keys = DEFAULT_MAX_KEYS,
+		.max_name_bytes = DEFAULT_MAX_NAME_BYTES,
+		.max_extents = DEFAULT_MAX_EXTENTS,
+	};
+}
+
+static enum nbts_error xtell(long *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	long pos = ftell(stream);
+	if (pos == -1) return NBTS_READ_ERR;
+	*dest = pos;
+	return NBTS_OK;
+}
+
+static enum nbts_error xseek(FILE *restrict nonnull stream, long pos)
+{
+	if (fseek(stream, pos, SEEK_SET) == -1) return NBTS_READ_ERR;
+	return NBTS_OK;
+}
+
+static size_t ends_slot(struct ends const *restrict nonnull ends, long start)
+{
+	size_t mask = ends->capacity - 1;
+	size_t i = ((uint64_t) start * 0x9e3779b97f4a7c15u) >> 32 & mask;
+	while (ends->starts[i] != -1 && ends->starts[i] != start) i = (i + 1) & mask;
+	return i;
+}
+
+static enum nbts_error ends_insert(struct ends *restrict nonnull ends, long start, long end)
+{
+	if (ends->size == ends->max_size) return NBTS_LIMIT_EXCEEDED;
+	if (2 * (ends->size + 1) > ends->capacity) {
+		struct ends grown = {.capacity = ends->capacity ? 2 * ends->capacity : 64};
+		grown.starts = malloc(grown.capacity * sizeof(*grown.starts));
+		grown.ends = malloc(grown.capacity * sizeof(*grown.ends));
+		if (!grown.starts || !grown.ends) {
+			free(grown.starts);
+			free(grown.ends);
+			return NBTS_ALLOC_ERR;
+		}
+		for (size_t i = 0; i < grown.capacity; ++i) grown.starts[i] = -1;
+
+		for (size_t i = 0; i < ends->capacity; ++i) {
+			if (ends->starts[i] == -1) continue;
+			size_t slot = ends_slot(&grown, ends->starts[i]);
+			grown.starts[slot] = ends->starts[i];
+			grown.ends[slot] = ends->ends[i];
+		}
+		grown.size = ends->size;
+		grown.max_size = ends->max_size;
+		free(ends->starts);
+		free(ends->ends);
+		*ends = grown;
+	}
+
+	size_t slot = ends_slot(ends, start);
+	if (ends->starts[slot] == -1) ends->size += 1;
+	ends->starts[slot] = start;
+	ends->ends[slot] = end;
+	return NBTS_OK;
+}
+
+static void ends_free(struct ends *restrict nonnull ends)
+{
+	free(ends->starts);
+	free(ends->ends);
+}
+
+/// Skips a payload of `type`, like \ref nbts_skip_handler, and records the
+/// extents of the compounds and lists in it in `ends`.
+static enum nbts_error skip_recorded(
+	struct ends *restrict nonnull ends, enum nbts_type type, FILE *restrict nonnull stream)
+{
+	if (type != NBTS_COMPOUND && type != NBTS_LIST) return nbts_skip_payload(type, stream);
+
+	long start = 0;
+	TRY(xtell(&start, stream));
+	if (ends->capacity) {
+		size_t slot = ends_slot(ends, start);
+		if (ends->starts[slot] == start) return xseek(stream, ends->ends[slot]);
+	}
+
+	if (type == NBTS_COMPOUND) {
+		while (1) {
+			enum nbts_type child_type = 0;
+			TRY(nbts_parse_typeid(&child_type, stream));
+			if (child_type == NBTS_END) break;
+
+			nbts_strsize name_size = 0;
+			TRY(nbts_parse_strsize(&name_size, stream));
+			if (name_size && fseek(stream, name_size, SEEK_CUR) == -1) return NBTS_READ_ERR;
+			TRY(skip_recorded(ends, child_type, stream));
+		}
+	} else {
+		enum nbts_type element_type = 0;
+		nbts_size size = 0;
+		TRY(nbts_parse_typeid(&element_type, stream));
+		TRY(nbts_parse_size(&size, stream));
+
+		if (element_type == NBTS_COMPOUND || element_type == NBTS_LIST) {
+			for (nbts_size i = 0; i < size; ++i) {
+				TRY(skip_recorded(ends, element_type, stream));
+			}
+		} else {
+			TRY(xseek(stream, start));
+			TRY(nbts_skip_payload(NBTS_LIST, stream));
+		}
+	}
+
+	long end = 0;
+	TRY(xtell(&end, stream));
+	return ends_insert(ends, start, end);
+}
+
+static enum nbts_error
+xreserve(void *restrict nonnull ptr, size_t *restrict nonnull capacity, size_t size, size_t elsize)
+{
+	if (size <= *capacity && *(void **) ptr) return NBTS_OK;
+
+	size_t new_capacity = *capacity ? *capacity : 16;
+	while (new_capacity < size) new_capacity *= 2;
+
+	void *p = realloc(*(void **) ptr, new_capacity * elsize);
+	if (!p) return NBTS_ALLOC_ERR;
+	*(void **) ptr = p;
+	*capacity = new_capacity;
+	return NBTS_OK;
+}
+
+/// Compares the next `size` bytes of `a` and `b` and stores the number of
+/// bytes before the first difference in `dest`.
+static enum nbts_error same_bytes(
+	long *restrict nonnull dest, long size, FILE *restrict nonnull a, FILE *restrict nonnull b)
+{
+	enum : size_t { BUFSIZE = NBTS_STACK_BUFFER_SIZE / sizeof(nbts_byte) };
+
+	nbts_byte a_buffer[BUFSIZE];
+	nbts_byte b_buffer[BUFSIZE];
+	*dest = 0;
+	while (*dest < size) {
+		size_t rest_size = (size_t) (size - *dest);
+		size_t chunk_size = rest_size < BUFSIZE ? rest_size : BUFSIZE;
+		TRY(nbts_parse_byte_array(a_buffer, chunk_size, a));
+		TRY(nbts_parse_byte_array(b_buffer, chunk_size, b));
+		for (size_t i = 0; i < chunk_size; ++i, ++*dest) {
+			if (a_buffer[i] != b_buffer[i]) return NBTS_OK;
+		}
+	}
+	return NBTS_OK;
+}
+
+/// The extent of one payload in one of the inputs.
+struct extent {
+	FILE *nullable stream;
+	struct ends *nullable ends;
+	enum nbts_type type;
+	long start;
+	long end;
+};
+
+static enum nbts_error report(
+	struct nbts_diff_options const *restrict nonnull options,
+	enum nbts_diff_kind kind,
+	struct nbts_path const *restrict nonnull path,
+	struct extent a,
+	struct extent b)
+{
+	if (a.stream) TRY(xseek(a.stream, a.start));
+	if (b.stream) TRY(xseek(b.stream, b.start));
+	TRY(options->report(options->userdata, kind, path, a.type, a.stream, b.type, b.stream));
+	if (a.stream) TRY(xseek(a.stream, a.end));
+	if (b.stream) TRY(xseek(b.stream, b.end));
+	return NBTS_OK;
+}
+
+static enum nbts_error measure(struct extent *restrict nonnull extent)
+{
+	TRY(xtell(&extent->start, extent->stream));
+	TRY(skip_recorded(extent->ends, extent->type, extent->stream));
+	TRY(xtell(&extent->end, extent->stream));
+	return NBTS_OK;
+}
+
+static enum nbts_error diff_payload(
+	struct nbts_diff_options const *restrict nonnull options,
+	struct nbts_path const *restrict nonnull path,
+	struct extent a,
+	struct extent b,
+	long equal);
+
+/// Returns how many bytes at the start of a child at `a_offset` in `a` and
+/// `b_offset` in `b` are known to be equal, if the first `equal` bytes of the
+/// parents are.
+static long child_equal(struct extent a, long a_offset, struct extent b, long b_offset, long equal)
+{
+	if (a_offset - a.start != b_offset - b.start) return 0;
+	long offset = a_offset - a.start;
+	return equal > offset ? equal - offset : 0;
+}
+
+static enum nbts_error index_children(
+	struct nbts_diff_options const *restrict nonnull options,
+	struct level *restrict nonnull level,
+	struct extent b_parent)
+{
+	FILE *b = b_parent.stream;
+	while (1) {
+		long tag = 0;
+		TRY(xtell(&tag, b));
+
+		enum nbts_type type = 0;
+		TRY(nbts_parse_typeid(&type, b));
+		if (type == NBTS_END) break;
+
+		nbts_strsize name_size = 0;
+		TRY(nbts_parse_strsize(&name_size, b));
+
+		if (level->entries_size == options->max_keys) return NBTS_LIMIT_EXCEEDED;
+		if (level->names_size + name_size > options->max_name_bytes) return NBTS_LIMIT_EXCEEDED;
+
+		TRY(xreserve(
+			&level->entries, &level->entries_capacity, level->entries_size + 1,
+			sizeof(*level->entries)));
+		TRY(xreserve(
+			&level->names, &level->names_capacity, level->names_size + name_size,
+			sizeof(*level->names)));
+
+		struct entry *entry = &level->entries[level->entries_size];
+		*entry = (struct entry){
+			.name = level->names_size, .name_size = name_size, .type = type, .tag = tag};
+		TRY(nbts_parse_string(&level->names[entry->name], name_size, b));
+
+		struct extent extent = {.stream = b, .ends = b_parent.ends, .type = type};
+		TRY(measure(&extent));
+		entry->payload = extent.start;
+		entry->end = extent.end;
+
+		level->names_size += name_size;
+		level->entries_size += 1;
+	}
+	return NBTS_OK;
+}
+
+static struct entry *nullable find_entry(
+	struct level const *restrict nonnull level,
+	size_t hint,
+	nbts_char const *restrict nonnull name,
+	nbts_strsize name_size)
+{
+	// Most compounds list their keys in the same order in both inputs, so
+	// the entry at the same position is tried first.
+	for (size_t n = 0; n < level->entries_size; ++n) {
+		struct entry *entry = &level->entries[(hint + n) % level->entries_size];
+		if (entry->matched || entry->name_size != name_size) continue;
+		if (!memcmp(&level->names[entry->name], name, name_size)) return entry;
+	}
+	return nullptr;
+}
+
+static enum nbts_error diff_compound_level(
+	struct nbts_diff_options const *restrict nonnull options,
+	struct level *restrict nonnull level,
+	struct nbts_path const *restrict nonnull path,
+	struct extent a,
+	struct extent b,
+	long equal)
+{
+	TRY(index_children(options, level, b));
+
+	for (size_t i = 0;; ++i) {
+		long tag = 0;
+		TRY(xtell(&tag, a.stream));
+
+		enum nbts_type type = 0;
+		TRY(nbts_parse_typeid(&type, a.stream));
+		if (type == NBTS_END) break;
+
+		nbts_strsize name_size = 0;
+		TRY(nbts_parse_strsize(&name_size, a.stream));
+		TRY(xreserve(&level->scratch, &level->scratch_capacity, name_size, sizeof(nbts_char)));
+		TRY(nbts_parse_string(level->scratch, name_size, a.stream));
+
+		struct nbts_path child = nbts_path_name(path, level->scratch, name_size);
+
+		struct extent a_extent = {.stream = a.stream, .ends = a.ends, .type = type};
+		TRY(measure(&a_extent));
+
+		struct entry *entry = find_entry(level, i, level->scratch, name_size);
+		if (!entry) {
+			TRY(report(options, NBTS_DIFF_REMOVED, &child, a_extent, (struct extent){}));
+			continue;
+		}
+
+		entry->matched = true;
+		struct extent b_extent = {
+			.stream = b.stream,
+			.ends = b.ends,
+			.type = entry->type,
+			.start = entry->payload,
+			.end = entry->end,
+		};
+
+		if (entry->type != type) {
+			TRY(report(options, NBTS_DIFF_CHANGED, &child, a_extent, b_extent));
+			continue;
+		}
+
+		long known = child_equal(a, tag, b, entry->tag, equal);
+		known = known > a_extent.start - tag ? known - (a_extent.start - tag) : 0;
+		TRY(diff_payload(options, &child, a_extent, b_extent, known));
+	}
+
+	for (size_t i = 0; i < level->entries_size; ++i) {
+		struct entry const *entry = &level->entries[i];
+		if (entry->matched) continue;
+
+		struct nbts_path child =
+			nbts_path_name(path, &level->names[entry->name], entry->name_size);
+		struct extent b_extent = {
+			.stream = b.stream,
+			.type = entry->type,
+			.start = entry->payload,
+			.end = entry->end,
+		};
+		TRY(report(options, NBTS_DIFF_ADDED, &child, (struct extent){}, b_extent));
+	}
+
+	TRY(xseek(b.stream, b.end));
+	return NBTS_OK;
+}
+
+static enum nbts_error diff_compound(
+	struct nbts_diff_options const *restrict nonnull options,
+	struct nbts_path const *restrict nonnull path,
+	struct extent a,
+	struct extent b,
+	long equal)
+{
+	struct level level = {};
+	enum nbts_error err = diff_compound_level(options, &level, path, a, b, equal);
+	free(level.entries);
+	free(level.names);
+	free(level.scratch);
+	return err;
+}
+
+static enum nbts_error diff_list(
+	struct nbts_diff_options const *restrict nonnull options,
+	struct nbts_path const *restrict nonnull path,
+	struct extent a,
+	struct extent b,
+	long equal)
+{
+	enum nbts_type a_type = 0;
+	nbts_size a_size = 0;
+	TRY(nbts_parse_typeid(&a_type, a.stream));
+	TRY(nbts_parse_size(&a_size, a.stream));
+
+	enum nbts_type b_type = 0;
+	nbts_size b_size = 0;
+	TRY(nbts_parse_typeid(&b_type, b.stream));
+	TRY(nbts_parse_size(&b_size, b.stream));
+
+	if (a_size && b_size && a_type != b_type) {
+		return report(options, NBTS_DIFF_CHANGED, path, a, b);
+	}
+
+	nbts_size size = a_size > b_size ? a_size : b_size;
+	for (nbts_size i = 0; i < size; ++i) {
+		struct nbts_path child = nbts_path_index(path, i);
+
+		struct extent a_element = {};
+		if (i < a_size) {
+			a_element = (struct extent){.stream = a.stream, .ends = a.ends, .type = a_type};
+			TRY(measure(&a_element));
+		}
+
+		struct extent b_element = {};
+		if (i < b_size) {
+			b_element = (struct extent){.stream = b.stream, .ends = b.ends, .type = b_type};
+			TRY(measure(&b_element));
+		}
+
+		if (!b_element.stream) {
+			TRY(report(options, NBTS_DIFF_REMOVED, &child, a_element, b_element));
+		} else if (!a_element.stream) {
+			TRY(report(options, NBTS_DIFF_ADDED, &child, a_element, b_element));
+		} else {
+			long known = child_equal(a, a_element.start, b, b_element.start, equal);
+			TRY(diff_payload(options, &child, a_element, b_element, known));
+			TRY(xseek(a.stream, a_element.end));
+			TRY(xseek(b.stream, b_element.end));
+		}
+	}
+
+	return NBTS_OK;
+}
+
+static enum nbts_error diff_payload(
+	struct nbts_diff_options const *restrict nonnull options,
+	struct nbts_path const *restrict nonnull path,
+	struct extent a,
+	struct extent b,
+	long equal)
+{
+	// Only the bytes after the part known to be equal are compared, so each
+	// byte is compared once however deep the difference lies. Payloads are
+	// prefix-free, so payloads with equal bytes up to the end of the shorter
+	// one are the same.
+	long a_size = a.end - a.start;
+	long b_size = b.end - b.start;
+	long size = a_size < b_size ? a_size : b_size;
+	if (equal > size) equal = size;
+
+	long same = 0;
+	TRY(xseek(a.stream, a.start + equal));
+	TRY(xseek(b.stream, b.start + equal));
+	TRY(same_bytes(&same, size - equal, a.stream, b.stream));
+	equal += same;
+	if (equal == size && a_size == b_size) return NBTS_OK;
+
+	TRY(xseek(a.stream, a.start));
+	TRY(xseek(b.stream, b.start));
+	switch (a.type) {
+	case NBTS_COMPOUND: return diff_compound(options, path, a, b, equal);
+	case NBTS_LIST: return diff_list(options, path, a, b, equal);
+	default: return report(options, NBTS_DIFF_CHANGED, path, a, b);
+	}
+}
+
+static enum nbts_error diff_tag(
+	struct nbts_diff_options const *restrict nonnull options,
+	nbts_char *restrict nonnull a_name,
+	nbts_char *restrict nonnull b_name,
+	struct ends *restrict nonnull ends,
+	FILE *restrict nonnull a,
+	FILE *restrict nonnull b)
+{
+	enum nbts_type a_type = 0;
+	nbts_strsize a_name_size = 0;
+	TRY(nbts_parse_typeid(&a_type, a));
+	if (a_type == NBTS_END) return NBTS_UNEXPECTED_END_TAG;
+	TRY(nbts_parse_strsize(&a_name_size, a));
+	TRY(nbts_parse_string(a_name, a_name_size, a));
+
+	enum nbts_type b_type = 0;
+	nbts_strsize b_name_size = 0;
+	TRY(nbts_parse_typeid(&b_type, b));
+	if (b_type == NBTS_END) return NBTS_UNEXPECTED_END_TAG;
+	TRY(nbts_parse_strsize(&b_name_size, b));
+	TRY(nbts_parse_string(b_name, b_name_size, b));
+
+	struct nbts_path path = nbts_path_name(nullptr, a_name, a_name_size);
+
+	struct extent a_extent = {.stream = a, .ends = &ends[0], .type = a_type};
+	struct extent b_extent = {.stream = b, .ends = &ends[1], .type = b_type};
+	TRY(measure(&a_extent));
+	TRY(measure(&b_extent));
+
+	bool same_name = a_name_size == b_name_size && !memcmp(a_name, b_name, a_name_size);
+	if (!same_name || a_type != b_type) {
+		return report(options, NBTS_DIFF_CHANGED, &path, a_extent, b_extent);
+	}
+
+	TRY(diff_payload(options, &path, a_extent, b_extent, 0));
+	TRY(xseek(a, a_extent.end));
+	TRY(xseek(b, b_extent.end));
+	return NBTS_OK;
+}
+
+enum nbts_error nbts_diff_tag(
+	FILE *restrict nonnull a,
+	FILE *restrict nonnull b,
+	struct nbts_diff_options const *restrict nonnull options)
+{
+	enum : size_t { NAME_BUFSIZE = (nbts_strsize) -1 };
+
+	nbts_char *names = malloc(2 * NAME_BUFSIZE * sizeof(*names));
+	if (!names) return NBTS_ALLOC_ERR;
+	struct ends ends[2] = {{.max_size = options->max_extents}, {.max_size = options->max_extents}};
+	enum nbts_error err = diff_tag(options, names, &names[NAME_BUFSIZE], ends, a, b);
+	ends_free(&ends[0]);
+	ends_free(&ends[1]);
+	free(names);
+	return err;
+}
+
+static enum nbts_error
+print_value(FILE *restrict nonnull ostream, enum nbts_type type, FILE *restrict nonnull stream)
+{
+	struct nbts_print_handler_data data = nbts_print_handler_data(ostream);
+	nbts_handler_fn *print_fn = nbts_print_handler.handle[type];
+	if (!print_fn) return NBTS_OK;
+	return print_fn(&data, 0, stream);
+}
+
+enum nbts_error nbts_diff_print(
+	void *nullable userdata,
+	enum nbts_diff_kind kind,
+	struct nbts_path const *restrict nonnull path,
+	enum nbts_type a_type,
+	FILE *restrict nullable a,
+	enum nbts_type b_type,
+	FILE *restrict nullable b)
+{
+	FILE *ostream = userdata;
+
+	switch (kind) {
+	case NBTS_DIFF_ADDED: TRYF(fputs("+ ", ostream)); break;
+	case NBTS_DIFF_REMOVED: TRYF(fputs("- ", ostream)); break;
+	case NBTS_DIFF_CHANGED: TRYF(fputs("~ ", ostream)); break;
+	}
+
+	TRY(nbts_fprint_path(ostream, path));
+	TRYF(fputs(": ", ostream));
+
+	if (a) TRY(print_value(ostream, a_type, a));
+	if (a && b) TRYF(fputs(" -> ", ostream));
+	if (b) TRY(print_value(ostream, b_type, b));
+
+	TRYF(fputc('\n', ostream));
+	return NBTS_OK;
+}
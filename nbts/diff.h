@@ -0,0 +1,93 @@
+#pragma once
+
+/// \file
+///
+/// \brief A structural diff of two NBT inputs.
+///
+/// \ref nbts_diff_tag walks two seekable streams in lockstep. Compounds are
+/// matched by key, so reordering keys is not a change. To find the matching
+/// key, the children of each compound of the second input are indexed as
+/// `(type, name, offset)` entries, bounded by \ref nbts_diff_options. Before
+/// descending into a pair of matching tags, their raw payload bytes are
+/// compared, so identical subtrees are never parsed tag by tag.
+///
+/// The extents of all compounds and lists are recorded while the inputs are
+/// first skipped, and each comparison resumes after the bytes its parent
+/// already found to be equal, so a difference deep in the tree costs time
+/// linear in the size of the inputs.
+
+#include <nbts/nbts.h>
+#include <nbts/path.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// The kind of a difference reported by \ref nbts_diff_tag.
+enum nbts_diff_kind : uint8_t {
+	NBTS_DIFF_ADDED,    ///< The tag only exists in the second input.
+	NBTS_DIFF_REMOVED,  ///< The tag only exists in the first input.
+	NBTS_DIFF_CHANGED,  ///< The tag exists in both inputs with different payloads.
+};
+
+/// The type of a callback reporting a single difference.
+///
+/// `a` and `b` are positioned at the payloads of the respective tags, or
+/// `nullptr` if the tag does not exist in that input. The callback may read
+/// the payloads; the streams are repositioned afterwards.
+typedef enum nbts_error nbts_diff_fn(
+	void *nullable userdata,
+	enum nbts_diff_kind kind,
+	struct nbts_path const *restrict nonnull path,
+	enum nbts_type a_type,
+	FILE *restrict nullable a,
+	enum nbts_type b_type,
+	FILE *restrict nullable b);
+
+/// Options for \ref nbts_diff_tag.
+struct nbts_diff_options {
+	/// Called for every difference.
+	nbts_diff_fn *nonnull report;
+	/// Passed to `report`.
+	void *nullable userdata;
+	/// The maximum number of children indexed per compound.
+	size_t max_keys;
+	/// The maximum number of name bytes indexed per compound.
+	size_t max_name_bytes;
+	/// The maximum number of compounds and lists whose extents are recorded
+	/// per input.
+	size_t max_extents;
+};
+
+/// Returns options reporting to `report` with default limits.
+struct nbts_diff_options nbts_diff_options(nbts_diff_fn *nonnull report, void *nullable userdata);
+
+/// Compares one named tag from `a` with one named tag from `b`.
+///
+/// Both streams must be seekable. Returns \ref NBTS_LIMIT_EXCEEDED if a
+/// compound in `b` or the number of compounds and lists in either input
+/// exceeds the limits in `options`.
+enum nbts_error nbts_diff_tag(
+	FILE *restrict nonnull a,
+	FILE *restrict nonnull b,
+	struct nbts_diff_options const *restrict nonnull options);
+
+/// An \ref nbts_diff_fn writing differences to the `FILE *` in `userdata`.
+///
+/// Each difference is written as one line of the form `+ path: value`,
+/// `- path: value` or `~ path: old -> new`, using \ref nbts_print_handler.
+enum nbts_error nbts_diff_print(
+	void *nullable userdata,
+	enum nbts_diff_kind kind,
+	struct nbts_path const *restrict nonnull path,
+	enum nbts_type a_type,
+	FILE *restrict nullable a,
+	enum nbts_type b_type,
+	FILE *restrict nullable b);
+
+#undef nonnull
+#undef nullable
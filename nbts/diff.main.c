@@ -0,0 +1,60 @@
+#include <nbts/diff.h>
+#include <nbts/nbts.h>
+
+#include <stdio.h>
+
+// Like diff(1), the exit status is 0 if the inputs are the same, 1 if they
+// differ and 2 on errors.
+enum : int { SAME = 0, DIFFERENT = 1, TROUBLE = 2 };
+
+struct count {
+	FILE *ostream;
+	size_t differences;
+};
+
+static enum nbts_error count_print(
+	void *userdata,
+	enum nbts_diff_kind kind,
+	struct nbts_path const *path,
+	enum nbts_type a_type,
+	FILE *a,
+	enum nbts_type b_type,
+	FILE *b)
+{
+	struct count *count = userdata;
+	count->differences += 1;
+	return nbts_diff_print(count->ostream, kind, path, a_type, a, b_type, b);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s <a.nbt> <b.nbt>\n", argv[0]);
+		return TROUBLE;
+	}
+
+	FILE *a = fopen(argv[1], "rb");
+	if (!a) goto a_failed;
+
+	FILE *b = fopen(argv[2], "rb");
+	if (!b) goto b_failed;
+
+	struct count count = {.ostream = stdout};
+	struct nbts_diff_options options = nbts_diff_options(&count_print, &count);
+	enum nbts_error err = nbts_diff_tag(a, b, &options);
+
+	fclose(b);
+	fclose(a);
+	if (err) {
+		fflush(stdout);
+		fprintf(stderr, "error %d\n", err);
+		return TROUBLE;
+	}
+	return count.differences ? DIFFERENT : SAME;
+
+b_failed:
+	fclose(a);
+a_failed:
+	perror(nullptr);
+	return TROUBLE;
+}
@@ -0,0 +1,173 @@
+#include <nbts/error.h>
+#include <nbts/path.h>
+#include <nbts/walk.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+struct locator {
+	FILE *nonnull stream;
+	struct nbts_error_context *nonnull ctx;
+	bool found;
+};
+
+/// Stores `path` in the context, unless a deeper path was stored already.
+static void store_path(struct locator *restrict nonnull l, struct nbts_path const *nullable path)
+{
+	if (l->found) return;
+	l->found = true;
+	l->ctx->depth = nbts_path_depth(path);
+
+	char *buffer = nullptr;
+	size_t size = 0;
+	FILE *ostream = open_memstream(&buffer, &size);
+	if (!ostream) return;
+	enum nbts_error err = nbts_fprint_path(ostream, path);
+	if (fclose(ostream) == EOF || err) size = 0;
+
+	if (size >= NBTS_ERROR_PATH_SIZE) size = NBTS_ERROR_PATH_SIZE - 1;
+	if (size) memcpy(l->ctx->path, buffer, size);
+	l->ctx->path[size] = '\0';
+	free(buffer);
+}
+
+/// Stores `path` if the walk has reached the offset of the failure.
+static void check_offset(struct locator *restrict nonnull l, struct nbts_path const *nonnull path)
+{
+	if (ftello(l->stream) >= l->ctx->offset) store_path(l, path);
+}
+
+/// Evaluates `EXPR`, storing `PATH` and returning if it fails, and returns if
+/// the failure has been located.
+#define LOCATE(EXPR, PATH)                 \
+	{                                      \
+		enum nbts_error _err = (EXPR);     \
+		if (_err) store_path(l, (PATH));   \
+		if (_err || l->found) return _err; \
+	}
+
+static enum nbts_error locate_payload(
+	struct locator *restrict nonnull l, struct nbts_path const *nonnull path, enum nbts_type type);
+
+// NOLINTBEGIN(bugprone-easily-swappable-parameters)
+
+/// Walks a name and the payload of a tag of `type` below `parent`.
+static enum nbts_error locate_named(
+	struct locator *restrict nonnull l,
+	struct nbts_path const *nullable parent,
+	enum nbts_type type)
+{
+	nbts_strsize name_size = 0;
+	LOCATE(nbts_parse_strsize(&name_size, l->stream), parent);
+
+	nbts_char buffer[NBTS_NAME_BUFSIZE];
+	nbts_char *name = nbts_name_alloc(buffer, name_size);
+	if (!name) return NBTS_ALLOC_ERR;
+
+	enum nbts_error err = nbts_parse_string(name, name_size, l->stream);
+	struct nbts_path path = nbts_path_name(parent, name, name_size);
+	if (err) {
+		store_path(l, parent);
+	} else if (!(err = locate_payload(l, &path, type))) {
+		check_offset(l, &path);
+	}
+
+	nbts_name_free(name, buffer);
+	return err;
+}
+
+static enum nbts_error
+locate_list(struct locator *restrict nonnull l, struct nbts_path const *nonnull path)
+{
+	enum nbts_type type = 0;
+	LOCATE(nbts_parse_typeid(&type, l->stream), path);
+
+	nbts_size size = 0;
+	LOCATE(nbts_parse_size(&size, l->stream), path);
+	if (type == NBTS_END) return NBTS_OK;
+
+	for (nbts_size i = 0; i < size; ++i) {
+		struct nbts_path element = nbts_path_index(path, i);
+		LOCATE(locate_payload(l, &element, type), &element);
+		check_offset(l, &element);
+		if (l->found) return NBTS_OK;
+	}
+	return NBTS_OK;
+}
+
+static enum nbts_error locate_payload(
+	struct locator *restrict nonnull l, struct nbts_path const *nonnull path, enum nbts_type type)
+{
+	switch (type) {
+	case NBTS_LIST:
+		return locate_list(l, path);
+	case NBTS_COMPOUND:
+		while (1) {
+			enum nbts_type child = 0;
+			LOCATE(nbts_parse_typeid(&child, l->stream), path);
+			if (child == NBTS_END) return NBTS_OK;
+			LOCATE(locate_named(l, path, child), path);
+		}
+	default:
+		LOCATE(nbts_skip_payload(type, l->stream), path);
+		return NBTS_OK;
+	}
+}
+
+/// Fills in `ctx` for a failure of the tag starting at offset `start`.
+static void locate_failure(
+	FILE *restrict nonnull stream, int64_t start, struct nbts_error_context *restrict nonnull ctx)
+{
+	ctx->offset = ftello(stream);
+	ctx->depth = 0;
+	ctx->path[0] = '\0';
+	if (start == -1 || ctx->offset == -1) return;
+
+	clearerr(stream);
+	if (fseeko(stream, start, SEEK_SET) == -1) return;
+
+	// The tag is walked with the skip handler, which fails at the same offset
+	// as the original handler if the input is malformed. If the handler
+	// failed on well-formed input instead, the walk stops at the innermost
+	// tag or element ending at or after the offset of the failure.
+	struct locator l = {.stream = stream, .ctx = ctx};
+	enum nbts_type type = 0;
+	enum nbts_error err = nbts_parse_typeid(&type, stream);
+	if (!err && type != NBTS_END) (void) locate_named(&l, nullptr, type);
+
+	clearerr(stream);
+	(void) fseeko(stream, ctx->offset, SEEK_SET);
+}
+
+enum nbts_error nbts_parse_tag_ctx(
+	FILE *restrict nonnull stream,
+	struct nbts_handler const *restrict nullable handler,
+	void *restrict nullable userdata,
+	struct nbts_error_context *restrict nullable ctx)
+{
+	if (!ctx) return nbts_parse_tag(stream, handler, userdata);
+
+	// The only cost on success is finding the start of the tag.
+	int64_t start = ftello(stream);
+	enum nbts_error err = nbts_parse_tag(stream, handler, userdata);
+	if (!err) return NBTS_OK;
+
+	flockfile(stream);
+	ctx->err = err;
+	locate_failure(stream, start, ctx);
+	funlockfile(stream);
+	return err;
+}
+
+// NOLINTEND(bugprone-easily-swappable-parameters)
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,57 @@
+#pragma once
+
+/// \file
+///
+/// \brief Locating parse errors in the input.
+///
+/// \ref nbts_parse_tag only returns an error code, which says little about
+/// a corrupted file. \ref nbts_parse_tag_ctx also reports the offset in the
+/// stream and the path of the tag at which parsing failed.
+///
+/// Nothing is tracked while parsing succeeds. When it fails, the position of
+/// the stream is taken as the offset of the failure, and the path is
+/// reconstructed afterwards by walking the tag again from its start, up to
+/// that offset. Only seekable streams can be walked again; for others, just
+/// the error code and, if available, the offset are reported.
+
+#include <nbts/nbts.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// The size of \ref nbts_error_context::path, including the terminating NUL.
+enum : size_t { NBTS_ERROR_PATH_SIZE = 256 };
+
+/// Where parsing failed, as reported by \ref nbts_parse_tag_ctx.
+struct nbts_error_context {
+	enum nbts_error err;
+	/// The position of the stream when parsing failed, or `-1` if the stream
+	/// cannot tell.
+	int64_t offset;
+	/// The number of segments of `path`, or `0` if the path is unknown or the
+	/// name of the root tag could not be read.
+	size_t depth;
+	/// The path of the innermost tag or list element containing the failure,
+	/// in the form written by \ref nbts_fprint_path. Longer paths are
+	/// truncated, but are always terminated by NUL.
+	char path[NBTS_ERROR_PATH_SIZE];
+};
+
+/// Like \ref nbts_parse_tag, but on failure fills in `ctx`, if it is not
+/// `nullptr`.
+///
+/// The stream is left at the position where parsing failed. `ctx` is not
+/// modified on success.
+enum nbts_error nbts_parse_tag_ctx(
+	FILE *restrict nonnull stream,
+	struct nbts_handler const *restrict nullable handler,
+	void *restrict nullable userdata,
+	struct nbts_error_context *restrict nullable ctx);
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,171 @@
+#define _GNU_SOURCE
+
+#include <nbts/frame.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+static ssize_t frame_read(void *cookie, char *buffer, size_t size)
+{
+	struct nbts_framer *framer = cookie;
+	size_t available = framer->size - framer->position;
+	if (size > available) size = available;
+
+	size_t done = 0;
+	while (done < size) {
+		struct nbts_ring_segment const *segment = &framer->segments[0];
+		size_t position = framer->position;
+		if (position >= segment->size) {
+			position -= segment->size;
+			segment = &framer->segments[1];
+		}
+
+		size_t n = segment->size - position;
+		if (n > size - done) n = size - done;
+		memcpy(&buffer[done], &segment->data[position], n);
+		framer->position += n;
+		done += n;
+	}
+	return (ssize_t) done;
+}
+
+static int frame_seek(void *cookie, off64_t *offset, int whence)
+{
+	struct nbts_framer *framer = cookie;
+
+	int64_t base = 0;
+	switch (whence) {
+	case SEEK_SET: base = 0; break;
+	case SEEK_CUR: base = (int64_t) framer->position; break;
+	case SEEK_END: base = (int64_t) framer->size; break;
+	default: return -1;
+	}
+
+	int64_t position = base + *offset;
+	if (position < 0 || (uint64_t) position > framer->size) return -1;
+
+	framer->position = position;
+	*offset = position;
+	return 0;
+}
+
+enum nbts_error nbts_framer_init(
+	struct nbts_framer *restrict nonnull framer,
+	struct nbts_ring *restrict nonnull ring,
+	size_t max_frame_size)
+{
+	*framer = (struct nbts_framer){.ring = ring, .max_frame_size = max_frame_size};
+	framer->stream = fopencookie(
+		framer, "rb", (cookie_io_functions_t){.read = &frame_read, .seek = &frame_seek});
+	if (!framer->stream) return NBTS_ALLOC_ERR;
+	return NBTS_OK;
+}
+
+void nbts_framer_free(struct nbts_framer *restrict nonnull framer)
+{
+	if (framer->stream) fclose(framer->stream);
+	framer->stream = nullptr;
+}
+
+/// Returns the byte at `index` of the data split into `first` and `second`.
+static uint8_t segment_byte(
+	struct nbts_ring_segment const *restrict nonnull first,
+	struct nbts_ring_segment const *restrict nonnull second,
+	size_t index)
+{
+	return index < first->size ? first->data[index] : second->data[index - first->size];
+}
+
+/// Decodes the length prefix at the start of `size` readable bytes and
+/// stores the size of the prefix in `prefix_size`.
+static enum nbts_error decode_length(
+	uint32_t *restrict nonnull dest,
+	size_t *restrict nonnull prefix_size,
+	struct nbts_ring_segment const *restrict nonnull first,
+	struct nbts_ring_segment const *restrict nonnull second,
+	size_t size)
+{
+	uint32_t result = 0;
+	for (size_t i = 0; i < NBTS_VARINT_MAX_SIZE; ++i) {
+		if (i == size) return NBTS_UNEXPECTED_EOF;
+		uint8_t byte = segment_byte(first, second, i);
+		result |= (uint32_t) (byte & 0x7F) << (7 * i);
+		if (!(byte & 0x80)) {
+			// A length is never negative.
+			if (result > INT32_MAX) return NBTS_INVALID_SIZE;
+			*dest = result;
+			*prefix_size = i + 1;
+			return NBTS_OK;
+		}
+	}
+	return NBTS_INVALID_SIZE;
+}
+
+enum nbts_error nbts_framer_next(
+	struct nbts_framer *restrict nonnull framer,
+	nbts_frame_fn *nonnull fn,
+	void *nullable userdata)
+{
+	struct nbts_ring_segment first;
+	struct nbts_ring_segment second;
+	size_t available = nbts_ring_peek(framer->ring, &first, &second);
+
+	uint32_t size = 0;
+	size_t prefix_size = 0;
+	enum nbts_error err = decode_length(&size, &prefix_size, &first, &second, available);
+	if (err) return err;
+
+	if (size > framer->max_frame_size || size > framer->ring->capacity - prefix_size)
+		return NBTS_LIMIT_EXCEEDED;
+	if (available - prefix_size < size) return NBTS_UNEXPECTED_EOF;
+
+	// Point the segments of the frame into the ring, skipping the prefix.
+	if (prefix_size < first.size) {
+		size_t head = first.size - prefix_size;
+		if (head > size) head = size;
+		framer->segments[0] = (struct nbts_ring_segment){
+			.data = &first.data[prefix_size],
+			.size = head,
+		};
+		framer->segments[1] = (struct nbts_ring_segment){.data = second.data, .size = size - head};
+	} else {
+		framer->segments[0] = (struct nbts_ring_segment){
+			.data = &second.data[prefix_size - first.size],
+			.size = size,
+		};
+		framer->segments[1] = (struct nbts_ring_segment){};
+	}
+	framer->size = size;
+
+	// Seeking discards the data the stream has buffered from the last frame.
+	clearerr(framer->stream);
+	if (fseek(framer->stream, 0, SEEK_SET)) return NBTS_READ_ERR;
+
+	err = fn(userdata, framer->stream, size);
+	nbts_ring_consume(framer->ring, prefix_size + size);
+	return err;
+}
+
+enum nbts_error nbts_parse_varint(int32_t *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	uint32_t result = 0;
+	for (size_t i = 0; i < NBTS_VARINT_MAX_SIZE; ++i) {
+		uint8_t byte = 0;
+		enum nbts_error err = nbts_parse_uint8(&byte, stream);
+		if (err) return err;
+		result |= (uint32_t) (byte & 0x7F) << (7 * i);
+		if (!(byte & 0x80)) {
+			memcpy(dest, &result, sizeof(*dest));
+			return NBTS_OK;
+		}
+	}
+	return NBTS_INVALID_SIZE;
+}
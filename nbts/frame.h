@@ -0,0 +1,85 @@
+#pragma once
+
+/// \file
+///
+/// \brief Reading VarInt length-prefixed packets out of a \ref nbts_ring.
+///
+/// The Minecraft protocol frames every packet with its length as a VarInt.
+/// \ref nbts_framer_next finds the next complete frame in the readable data
+/// of a ring and hands it to a callback as a `FILE *`, which can be passed
+/// to \ref nbts_parse_network_tag once the packet fields in front of the NBT
+/// have been read. The stream reads directly from the ring, including
+/// frames wrapping around its end, so frames are never reassembled into a
+/// separate buffer.
+///
+/// The framer is used by the consumer thread of the ring, while the
+/// producer thread keeps filling it. Compressed packets are not supported;
+/// the stream contains the frame exactly as received.
+
+#include <nbts/nbts.h>
+#include <nbts/ring.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// The maximum number of bytes of a VarInt.
+enum : size_t { NBTS_VARINT_MAX_SIZE = 5 };
+
+/// The type of a callback processing one frame.
+///
+/// `frame` contains the `size` bytes of the frame following its length
+/// prefix. It is only valid during the call.
+typedef enum nbts_error
+nbts_frame_fn(void *nullable userdata, FILE *restrict nonnull frame, size_t size);
+
+/// The state of the consumer side of a framed ring.
+struct nbts_framer {
+	struct nbts_ring *nonnull ring;
+	/// A stream over `segments`, rewound for every frame.
+	FILE *nullable stream;
+	/// The current frame, split in two if it wraps around.
+	struct nbts_ring_segment segments[2];
+	/// The position of `stream` in the current frame.
+	size_t position;
+	/// The size of the current frame.
+	size_t size;
+	/// The largest frame accepted, not counting the length prefix.
+	size_t max_frame_size;
+};
+
+/// Initializes `framer` to read frames of at most `max_frame_size` bytes
+/// from `ring`.
+///
+/// The framer must be freed with \ref nbts_framer_free.
+enum nbts_error nbts_framer_init(
+	struct nbts_framer *restrict nonnull framer,
+	struct nbts_ring *restrict nonnull ring,
+	size_t max_frame_size);
+
+/// Frees the resources owned by `framer`.
+void nbts_framer_free(struct nbts_framer *restrict nonnull framer);
+
+/// Passes the next frame in the ring of `framer` to `fn`.
+///
+/// Returns \ref NBTS_UNEXPECTED_EOF without consuming anything if the ring
+/// does not contain a complete frame yet. Returns \ref NBTS_INVALID_SIZE if
+/// the length prefix is malformed and \ref NBTS_LIMIT_EXCEEDED if the frame
+/// is larger than the maximum frame size or could never fit into the ring;
+/// in both cases the connection cannot be resynchronized. Otherwise the
+/// frame is consumed after `fn` returns and its result is returned.
+enum nbts_error nbts_framer_next(
+	struct nbts_framer *restrict nonnull framer,
+	nbts_frame_fn *nonnull fn,
+	void *nullable userdata);
+
+/// Parses a VarInt from `stream`, such as the packet id at the start of a
+/// frame.
+enum nbts_error nbts_parse_varint(int32_t *restrict nonnull dest, FILE *restrict nonnull stream);
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,236 @@
+#include <nbts/grep.h>
+#include <nbts/walk.h>
+
+#include <stdbit.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+// NOLINTBEGIN(bugprone-easily-swappable-parameters)
+
+size_t nbts_find_bytes(
+	void const *restrict nonnull haystack,
+	size_t size,
+	void const *restrict nonnull needle,
+	size_t needle_size)
+{
+	uint8_t const *h = haystack;
+	uint8_t const *n = needle;
+	if (!needle_size) return 0;
+	if (needle_size > size) return SIZE_MAX;
+
+	size_t end = size - needle_size + 1;
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	// Compares the first and last byte of the needle with 16 positions at a
+	// time, so only positions where both match are compared in full.
+	__m128i first = _mm_set1_epi8((char) n[0]);
+	__m128i last = _mm_set1_epi8((char) n[needle_size - 1]);
+	for (; i + 16 <= end; i += 16) {
+		__m128i a = _mm_loadu_si128((__m128i const *) &h[i]);
+		__m128i b = _mm_loadu_si128((__m128i const *) &h[i + needle_size - 1]);
+		__m128i eq = _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last));
+		for (unsigned mask = _mm_movemask_epi8(eq); mask; mask &= mask - 1) {
+			size_t position = i + stdc_trailing_zeros(mask);
+			if (!memcmp(&h[position], n, needle_size)) return position;
+		}
+	}
+#endif
+
+	for (; i < end; ++i) {
+		if (h[i] == n[0] && !memcmp(&h[i], n, needle_size)) return i;
+	}
+	return SIZE_MAX;
+}
+
+struct nbts_grep_options nbts_grep_options(
+	char const *nonnull text,
+	enum nbts_grep_target targets,
+	nbts_grep_match_fn *nonnull match,
+	void *nullable userdata)
+{
+	return (struct nbts_grep_options){
+		.text = (nbts_char const *) text,
+		.text_size = strlen(text),
+		.targets = targets,
+		.match = match,
+		.userdata = userdata,
+	};
+}
+
+bool nbts_grep_candidate(
+	struct nbts_grep_options const *restrict nonnull options,
+	void const *restrict nonnull data,
+	size_t size)
+{
+	if (options->text_size > UINT16_MAX) return false;
+	if (!options->text_size) return true;
+
+	// The characters are searched for first, as they are far more selective
+	// than the size before them.
+	uint8_t const *bytes = data;
+	uint8_t hi = options->text_size >> 8;
+	uint8_t lo = options->text_size & 0xFF;
+	for (size_t i = sizeof(nbts_strsize); i < size;) {
+		size_t found = nbts_find_bytes(&bytes[i], size - i, options->text, options->text_size);
+		if (found == SIZE_MAX) return false;
+		i += found;
+		if (bytes[i - 2] == hi && bytes[i - 1] == lo) return true;
+		++i;
+	}
+	return false;
+}
+
+struct context {
+	FILE *nonnull stream;
+	struct nbts_grep_options const *nonnull options;
+};
+
+/// Reads `size` characters and stores whether they equal the text in
+/// `equal`.
+static enum nbts_error compare_text(
+	struct context const *restrict nonnull ctx, nbts_strsize size, bool *restrict nonnull equal)
+{
+	*equal = false;
+	if (size != ctx->options->text_size) {
+		nbts_char buffer[NBTS_STACK_BUFFER_SIZE];
+		for (size_t rest = size; rest;) {
+			size_t n = rest < sizeof(buffer) ? rest : sizeof(buffer);
+			TRY(nbts_parse_string(buffer, n, ctx->stream));
+			rest -= n;
+		}
+		return NBTS_OK;
+	}
+
+	nbts_char buffer[NBTS_NAME_BUFSIZE];
+	nbts_char *text = nbts_name_alloc(buffer, size);
+	if (!text) return NBTS_ALLOC_ERR;
+
+	enum nbts_error err = nbts_parse_string(text, size, ctx->stream);
+	if (!err) *equal = !memcmp(text, ctx->options->text, size);
+
+	nbts_name_free(text, buffer);
+	return err;
+}
+
+static enum nbts_error grep_payload(
+	struct context const *restrict nonnull ctx,
+	struct nbts_path const *restrict nonnull path,
+	enum nbts_type type);
+
+static enum nbts_error grep_string(
+	struct context const *restrict nonnull ctx, struct nbts_path const *restrict nonnull path)
+{
+	nbts_strsize size = 0;
+	TRY(nbts_parse_strsize(&size, ctx->stream));
+
+	bool equal = false;
+	TRY(compare_text(ctx, size, &equal));
+	if (!equal) return NBTS_OK;
+	return ctx->options->match(ctx->options->userdata, path, NBTS_STRING);
+}
+
+static enum nbts_error grep_named(
+	struct context const *restrict nonnull ctx,
+	struct nbts_path const *restrict nullable parent,
+	enum nbts_type type)
+{
+	nbts_strsize name_size = 0;
+	TRY(nbts_parse_strsize(&name_size, ctx->stream));
+
+	nbts_char buffer[NBTS_NAME_BUFSIZE];
+	nbts_char *name = nbts_name_alloc(buffer, name_size);
+	if (!name) return NBTS_ALLOC_ERR;
+
+	enum nbts_error err = nbts_parse_string(name, name_size, ctx->stream);
+	struct nbts_path path = nbts_path_name(parent, name, name_size);
+
+	struct nbts_grep_options const *options = ctx->options;
+	if (!err && options->targets & NBTS_GREP_NAME && name_size == options->text_size &&
+		!memcmp(name, options->text, name_size)) {
+		err = options->match(options->userdata, &path, type);
+	}
+	if (!err) err = grep_payload(ctx, &path, type);
+
+	nbts_name_free(name, buffer);
+	return err;
+}
+
+static enum nbts_error grep_list(
+	struct context const *restrict nonnull ctx, struct nbts_path const *restrict nonnull path)
+{
+	enum nbts_type type = 0;
+	TRY(nbts_parse_typeid(&type, ctx->stream));
+
+	nbts_size size = 0;
+	TRY(nbts_parse_size(&size, ctx->stream));
+
+	// Lists of scalars or arrays cannot contain names or string values.
+	if (type != NBTS_STRING && type != NBTS_LIST && type != NBTS_COMPOUND) {
+		return size > 0 ? nbts_parse_list(type, size, ctx->stream, nullptr, nullptr) : NBTS_OK;
+	}
+
+	for (nbts_size i = 0; i < size; ++i) {
+		struct nbts_path element = nbts_path_index(path, i);
+		TRY(grep_payload(ctx, &element, type));
+	}
+	return NBTS_OK;
+}
+
+static enum nbts_error grep_payload(
+	struct context const *restrict nonnull ctx,
+	struct nbts_path const *restrict nonnull path,
+	enum nbts_type type)
+{
+	switch (type) {
+	case NBTS_STRING:
+		if (!(ctx->options->targets & NBTS_GREP_VALUE)) break;
+		return grep_string(ctx, path);
+	case NBTS_LIST:
+		return grep_list(ctx, path);
+	case NBTS_COMPOUND:
+		while (1) {
+			enum nbts_type child = 0;
+			TRY(nbts_parse_typeid(&child, ctx->stream));
+			if (child == NBTS_END) return NBTS_OK;
+			TRY(grep_named(ctx, path, child));
+		}
+	default:
+		break;
+	}
+	return nbts_skip_payload(type, ctx->stream);
+}
+
+enum nbts_error nbts_grep_tag(
+	FILE *restrict nonnull stream, struct nbts_grep_options const *restrict nonnull options)
+{
+	struct context ctx = {.stream = stream, .options = options};
+
+	enum nbts_type type = 0;
+	TRY(nbts_parse_typeid(&type, stream));
+	if (type == NBTS_END) return NBTS_UNEXPECTED_END_TAG;
+	return grep_named(&ctx, nullptr, type);
+}
+
+// NOLINTEND(bugprone-easily-swappable-parameters)
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,84 @@
+#pragma once
+
+/// \file
+///
+/// \brief Searching NBT for tag names and string values.
+///
+/// Names and string values are both encoded as a \ref nbts_strsize followed
+/// by their characters, so a tag can only contain a given name or value if
+/// its encoding contains these bytes. \ref nbts_grep_candidate searches the
+/// raw bytes for them with a vectorized substring search, and
+/// \ref nbts_grep_tag confirms candidates with a structured parse that
+/// reports the path of every match. Most non-matching inputs are thus
+/// rejected at the speed of memory.
+///
+/// The text is compared byte by byte with the encoded characters, which are
+/// the same in modified UTF-8 unless it contains NUL or supplementary
+/// characters.
+
+#include <nbts/nbts.h>
+#include <nbts/path.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// Returns the offset of the first occurrence of the `needle_size` bytes at
+/// `needle` in the `size` bytes at `haystack`, or `SIZE_MAX` if there is
+/// none.
+size_t nbts_find_bytes(
+	void const *restrict nonnull haystack,
+	size_t size,
+	void const *restrict nonnull needle,
+	size_t needle_size);
+
+/// What \ref nbts_grep_tag matches the text against.
+enum nbts_grep_target : uint8_t {
+	NBTS_GREP_NAME = 1 << 0,   ///< The names of tags.
+	NBTS_GREP_VALUE = 1 << 1,  ///< String values, including list elements.
+	NBTS_GREP_ANY = NBTS_GREP_NAME | NBTS_GREP_VALUE,
+};
+
+/// The type of a callback called for every match of \ref nbts_grep_tag.
+///
+/// `path` designates the matching tag, or the string element, and `type` is
+/// its type.
+typedef enum nbts_error nbts_grep_match_fn(
+	void *nullable userdata, struct nbts_path const *restrict nonnull path, enum nbts_type type);
+
+/// Options for \ref nbts_grep_tag.
+struct nbts_grep_options {
+	/// The name or value to search for.
+	nbts_char const *nonnull text;
+	size_t text_size;
+	enum nbts_grep_target targets;
+	nbts_grep_match_fn *nonnull match;
+	void *nullable userdata;
+};
+
+/// Returns options searching for the NUL-terminated `text` in `targets`,
+/// calling `match` with `userdata` for every match.
+struct nbts_grep_options nbts_grep_options(
+	char const *nonnull text,
+	enum nbts_grep_target targets,
+	nbts_grep_match_fn *nonnull match,
+	void *nullable userdata);
+
+/// Returns whether the `size` bytes of uncompressed NBT at `data` may
+/// contain a match.
+bool nbts_grep_candidate(
+	struct nbts_grep_options const *restrict nonnull options,
+	void const *restrict nonnull data,
+	size_t size);
+
+/// Parses one named tag from `stream` and calls `options->match` for every
+/// matching name or string value in it.
+enum nbts_error nbts_grep_tag(
+	FILE *restrict nonnull stream, struct nbts_grep_options const *restrict nonnull options);
+
+#undef nonnull
+#undef nullable
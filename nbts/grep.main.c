@@ -0,0 +1,247 @@
+#define _GNU_SOURCE
+
+#include <nbts/compression.h>
+#include <nbts/grep.h>
+#include <nbts/mmap.h>
+#include <nbts/nbts.h>
+#include <nbts/pool.h>
+#include <nbts/region.h>
+
+#include <unistd.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Like grep(1), the exit status is 0 if the text was found, 1 if it was not
+// and 2 on errors, even if it was found elsewhere.
+enum : int { FOUND = 0, NOT_FOUND = 1, TROUBLE = 2 };
+
+/// The state owned by one thread of the pool.
+struct worker {
+	struct nbts_buffer raw;
+	struct nbts_buffer decompressed;
+};
+
+/// The outcome of searching one file.
+struct result {
+	bool found;
+	bool failed;
+};
+
+struct grep {
+	char *const *paths;
+	struct nbts_grep_options options;
+	struct worker *workers;
+	struct result *results;
+};
+
+/// Where the current match was found, passed to \ref print_match.
+struct location {
+	FILE *output;
+	char const *path;
+	/// The index of the chunk in a region file, or `SIZE_MAX`.
+	size_t chunk;
+	/// Whether an error was reported for any part of the file.
+	bool failed;
+};
+
+static void print_location(FILE *stream, struct location const *location)
+{
+	if (location->chunk == SIZE_MAX) {
+		fprintf(stream, "%s: ", location->path);
+	} else {
+		size_t x = location->chunk % 32;
+		size_t z = location->chunk / 32;
+		fprintf(stream, "%s[%zu,%zu]: ", location->path, x, z);
+	}
+}
+
+static enum nbts_error print_match(void *userdata, struct nbts_path const *path, enum nbts_type)
+{
+	struct location const *location = userdata;
+	print_location(location->output, location);
+	enum nbts_error err = nbts_fprint_path(location->output, path);
+	if (fputc('\n', location->output) == EOF && !err) err = NBTS_WRITE_ERR;
+	return err;
+}
+
+/// Writes `err` to `stderr` as one line, so lines of different threads do
+/// not interleave.
+static void report_error(struct location *location, enum nbts_error err)
+{
+	location->failed = true;
+	flockfile(stderr);
+	print_location(stderr, location);
+	fprintf(stderr, "error %d\n", err);
+	funlockfile(stderr);
+}
+
+/// Searches the `size` bytes at `data`, decompressing them if needed.
+static enum nbts_error grep_data(
+	struct grep const *grep,
+	struct worker *worker,
+	struct location *location,
+	void const *data,
+	size_t size,
+	enum nbts_compression compression)
+{
+	if (compression != NBTS_COMPRESSION_NONE) {
+		enum nbts_error err = nbts_decompress(&worker->decompressed, compression, data, size);
+		if (err) return err;
+		data = worker->decompressed.data;
+		size = worker->decompressed.size;
+	}
+
+	// Most inputs do not contain the text at all and are rejected here
+	// without being parsed.
+	if (!size || !nbts_grep_candidate(&grep->options, data, size)) return NBTS_OK;
+
+	FILE *stream = fmemopen((void *) data, size, "rb");
+	if (!stream) return NBTS_READ_ERR;
+
+	struct nbts_grep_options options = grep->options;
+	options.userdata = location;
+	enum nbts_error err = nbts_grep_tag(stream, &options);
+	fclose(stream);
+	return err;
+}
+
+/// Searches the chunks of a region file, reporting the errors of single
+/// chunks itself.
+static enum nbts_error
+grep_region(struct grep const *grep, struct worker *worker, struct location *location)
+{
+	struct nbts_region region;
+	enum nbts_error err = nbts_region_open(&region, location->path);
+	if (err) return err;
+
+	// A corrupt chunk is reported and the search goes on with the others.
+	for (size_t i = 0; i < NBTS_REGION_CHUNKS; ++i) {
+		if (!nbts_region_has_chunk(&region, i)) continue;
+		location->chunk = i;
+
+		enum nbts_compression compression = NBTS_COMPRESSION_NONE;
+		err = nbts_region_read(&region, i, &worker->raw, &compression);
+		if (!err) {
+			err = grep_data(
+				grep, worker, location, worker->raw.data, worker->raw.size, compression);
+		}
+		if (err) report_error(location, err);
+	}
+	location->chunk = SIZE_MAX;
+
+	nbts_region_close(&region);
+	return NBTS_OK;
+}
+
+static enum nbts_error
+grep_file(struct grep const *grep, struct worker *worker, struct location *location)
+{
+	struct nbts_mmap map;
+	enum nbts_error err = nbts_mmap_open(&map, location->path, 0);
+	if (err) return err;
+
+	if (map.file_size) {
+		enum nbts_compression compression = nbts_detect_compression(map.data, map.file_size);
+		err = grep_data(grep, worker, location, map.data, map.file_size, compression);
+	}
+
+	nbts_mmap_close(&map);
+	return err;
+}
+
+static bool is_region(char const *path)
+{
+	size_t size = strlen(path);
+	return size >= 4 && !strcmp(&path[size - 4], ".mca");
+}
+
+static void process(void *userdata, size_t thread, size_t index)
+{
+	struct grep const *grep = userdata;
+	struct worker *worker = &grep->workers[thread];
+
+	// Matches are collected per file and written at once, so the lines of
+	// different files do not interleave.
+	char *output = nullptr;
+	size_t output_size = 0;
+	struct location location = {
+		.output = open_memstream(&output, &output_size),
+		.path = grep->paths[index],
+		.chunk = SIZE_MAX,
+	};
+	if (!location.output) {
+		report_error(&location, NBTS_ALLOC_ERR);
+		grep->results[index].failed = true;
+		return;
+	}
+
+	enum nbts_error err = NBTS_OK;
+	if (is_region(location.path)) {
+		err = grep_region(grep, worker, &location);
+	} else {
+		err = grep_file(grep, worker, &location);
+	}
+	if (err) report_error(&location, err);
+
+	// Every match writes a line, so there are matches if there is output.
+	if (fclose(location.output)) report_error(&location, NBTS_ALLOC_ERR);
+	grep->results[index] = (struct result){.found = output_size > 0, .failed = location.failed};
+	fwrite(output, 1, output_size, stdout);
+	free(output);
+}
+
+int main(int argc, char **argv)
+{
+	enum nbts_grep_target targets = NBTS_GREP_ANY;
+	size_t threads = 0;
+
+	int opt = 0;
+	while ((opt = getopt(argc, argv, "nvj:")) != -1) {
+		switch (opt) {
+		case 'n': targets = NBTS_GREP_NAME; break;
+		case 'v': targets = NBTS_GREP_VALUE; break;
+		case 'j': threads = strtoul(optarg, nullptr, 10); break;
+		default: goto usage;
+		}
+	}
+	if (argc - optind < 2) goto usage;
+
+	char *const *paths = &argv[optind + 1];
+	size_t count = argc - optind - 1;
+	threads = nbts_pool_threads(threads);
+
+	struct grep grep = {
+		.paths = paths,
+		.options = nbts_grep_options(argv[optind], targets, &print_match, nullptr),
+		.workers = calloc(threads, sizeof(*grep.workers)),
+		.results = calloc(count, sizeof(*grep.results)),
+	};
+
+	enum nbts_error err = NBTS_ALLOC_ERR;
+	if (grep.workers && grep.results) err = nbts_pool_run(count, threads, &process, &grep);
+
+	int status = NOT_FOUND;
+	if (err) {
+		fflush(stdout);
+		fprintf(stderr, "error %d\n", err);
+		status = TROUBLE;
+	}
+	for (size_t i = 0; !err && i < count; ++i) {
+		if (grep.results[i].failed) status = TROUBLE;
+		if (grep.results[i].found && status == NOT_FOUND) status = FOUND;
+	}
+
+	for (size_t i = 0; grep.workers && i < threads; ++i) {
+		nbts_buffer_free(&grep.workers[i].raw);
+		nbts_buffer_free(&grep.workers[i].decompressed);
+	}
+	free(grep.workers);
+	free(grep.results);
+	return status;
+
+usage:
+	fprintf(stderr, "Usage: %s [-n | -v] [-j threads] <text> <file>...\n", argv[0]);
+	return TROUBLE;
+}
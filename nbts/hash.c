@@ -0,0 +1,431 @@
+#include <nbts/hash.h>
+
+#include <endian.h>
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+#define COVARIANT_CAST(FUNC, ...)                                                            \
+	(_Generic(                                                                               \
+		(&FUNC)((void *) 0, (nbts_strsize) 0, (FILE *restrict nonnull) 0),                   \
+		enum nbts_error: (enum nbts_error(*)(void *, nbts_strsize, FILE *restrict nonnull))( \
+			&FUNC)))
+
+struct nbts_handler const nbts_hash_handler = {
+	.handle[NBTS_BYTE] = COVARIANT_CAST(nbts_hash_handle_byte),
+	.handle[NBTS_SHORT] = COVARIANT_CAST(nbts_hash_handle_short),
+	.handle[NBTS_INT] = COVARIANT_CAST(nbts_hash_handle_int),
+	.handle[NBTS_LONG] = COVARIANT_CAST(nbts_hash_handle_long),
+	.handle[NBTS_FLOAT] = COVARIANT_CAST(nbts_hash_handle_float),
+	.handle[NBTS_DOUBLE] = COVARIANT_CAST(nbts_hash_handle_double),
+	.handle[NBTS_STRING] = COVARIANT_CAST(nbts_hash_handle_string),
+	.handle[NBTS_BYTE_ARRAY] = COVARIANT_CAST(nbts_hash_handle_byte_array),
+	.handle[NBTS_INT_ARRAY] = COVARIANT_CAST(nbts_hash_handle_int_array),
+	.handle[NBTS_LONG_ARRAY] = COVARIANT_CAST(nbts_hash_handle_long_array),
+	.handle[NBTS_LIST] = COVARIANT_CAST(nbts_hash_handle_list),
+	.handle[NBTS_COMPOUND] = COVARIANT_CAST(nbts_hash_handle_compound),
+};
+
+// The accumulation loop follows the design of XXH3: each lane multiplies the
+// low and high halves of its input word and additionally absorbs the input
+// of its neighbouring lane. This maps onto one PMULUDQ per pair of lanes.
+
+enum : uint64_t {
+	PRIME32_1 = 0x9E3779B1U,
+	PRIME64_1 = 0x9E3779B185EBCA87U,
+	PRIME64_2 = 0xC2B2AE3D27D4EB4FU,
+	PRIME64_3 = 0x165667B19E3779F9U,
+};
+
+enum : size_t { STRIPES_PER_BLOCK = 16 };
+
+static uint64_t const secret[NBTS_HASHER_LANES * 2] = {
+	0xBE4BA423396CFEB8U, 0x1CAD21F72C81017CU, 0xDB979083E96DD4DEU, 0x1F67B3B7A4A44072U,
+	0x78E5C0CC4EE679CBU, 0x2172FFCC7DD05A82U, 0x8E2443F7744608B8U, 0x4C263A81E69035E0U,
+	0xCB00C391BB52283CU, 0xA32E531B8B65D088U, 0x4EF90DA297486471U, 0xD8ACDEA946EF1938U,
+	0x3F349CE33F76FAA8U, 0x1D4F0BC7C7BBDCF9U, 0x3159B4CD4BE0518AU, 0x647378D9C97E9FC8U,
+};
+
+static inline uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+static inline uint64_t avalanche(uint64_t x)
+{
+	x ^= x >> 33;
+	x *= PRIME64_2;
+	x ^= x >> 29;
+	x *= PRIME64_3;
+	x ^= x >> 32;
+	return x;
+}
+
+#if defined(__SSE2__) && __BYTE_ORDER == __LITTLE_ENDIAN
+
+static inline void
+accumulate_stripe(uint64_t acc[restrict NBTS_HASHER_LANES], uint8_t const *restrict nonnull stripe)
+{
+	for (size_t i = 0; i < NBTS_HASHER_LANES; i += 2) {
+		__m128i a = _mm_loadu_si128((__m128i const *) &acc[i]);
+		__m128i v = _mm_loadu_si128((__m128i const *) &stripe[i * sizeof(uint64_t)]);
+		__m128i k = _mm_xor_si128(v, _mm_loadu_si128((__m128i const *) &secret[i]));
+		__m128i p = _mm_mul_epu32(k, _mm_shuffle_epi32(k, _MM_SHUFFLE(2, 3, 0, 1)));
+		__m128i s = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+		_mm_storeu_si128((__m128i *) &acc[i], _mm_add_epi64(a, _mm_add_epi64(p, s)));
+	}
+}
+
+#else
+
+static inline void
+accumulate_stripe(uint64_t acc[restrict NBTS_HASHER_LANES], uint8_t const *restrict nonnull stripe)
+{
+	uint64_t v[NBTS_HASHER_LANES];
+	memcpy(v, stripe, sizeof(v));
+	for (size_t i = 0; i < NBTS_HASHER_LANES; ++i) v[i] = le64toh(v[i]);
+	for (size_t i = 0; i < NBTS_HASHER_LANES; ++i) {
+		uint64_t k = v[i] ^ secret[i];
+		acc[i] += v[i ^ 1] + (k & 0xFFFFFFFFU) * (k >> 32);
+	}
+}
+
+#endif
+
+static inline void scramble(uint64_t acc[restrict NBTS_HASHER_LANES])
+{
+	for (size_t i = 0; i < NBTS_HASHER_LANES; ++i) {
+		acc[i] = (acc[i] ^ (acc[i] >> 47) ^ secret[NBTS_HASHER_LANES + i]) * PRIME32_1;
+	}
+}
+
+static inline void consume_stripe(
+	uint64_t acc[restrict NBTS_HASHER_LANES], uint8_t const *restrict nonnull stripe, uint64_t index)
+{
+	accumulate_stripe(acc, stripe);
+	if ((index + 1) % STRIPES_PER_BLOCK == 0) scramble(acc);
+}
+
+void nbts_hasher_init(struct nbts_hasher *restrict nonnull hasher, uint64_t seed)
+{
+	*hasher = (struct nbts_hasher){};
+	for (size_t i = 0; i < NBTS_HASHER_LANES; ++i) {
+		hasher->acc[i] = secret[NBTS_HASHER_LANES + i] ^ (seed + i * PRIME64_1);
+	}
+}
+
+void nbts_hasher_update(
+	struct nbts_hasher *restrict nonnull hasher, void const *restrict nonnull data, size_t size)
+{
+	uint8_t const *p = data;
+	uint64_t stripe_index = hasher->total / NBTS_HASHER_STRIPE;
+	hasher->total += size;
+
+	if (hasher->buffered) {
+		size_t fill = NBTS_HASHER_STRIPE - hasher->buffered;
+		if (size < fill) {
+			memcpy(&hasher->buffer[hasher->buffered], p, size);
+			hasher->buffered += size;
+			return;
+		}
+		memcpy(&hasher->buffer[hasher->buffered], p, fill);
+		consume_stripe(hasher->acc, hasher->buffer, stripe_index++);
+		hasher->buffered = 0;
+		p += fill;
+		size -= fill;
+	}
+
+	for (; size >= NBTS_HASHER_STRIPE; p += NBTS_HASHER_STRIPE, size -= NBTS_HASHER_STRIPE) {
+		consume_stripe(hasher->acc, p, stripe_index++);
+	}
+
+	memcpy(hasher->buffer, p, size);
+	hasher->buffered = size;
+}
+
+struct nbts_digest nbts_hasher_final(struct nbts_hasher const *restrict nonnull hasher)
+{
+	uint64_t acc[NBTS_HASHER_LANES];
+	memcpy(acc, hasher->acc, sizeof(acc));
+
+	if (hasher->buffered) {
+		uint8_t stripe[NBTS_HASHER_STRIPE] = {};
+		memcpy(stripe, hasher->buffer, hasher->buffered);
+		accumulate_stripe(acc, stripe);
+	}
+
+	uint64_t lo = hasher->total * PRIME64_1;
+	uint64_t hi = ~hasher->total * PRIME64_2;
+	for (size_t i = 0; i < NBTS_HASHER_LANES / 2; ++i) {
+		lo = rotl64(lo ^ avalanche(acc[i]), 27) * PRIME64_1 + PRIME64_3;
+		hi = rotl64(hi ^ avalanche(acc[NBTS_HASHER_LANES / 2 + i]), 31) * PRIME64_2 + PRIME64_1;
+	}
+	lo = avalanche(lo ^ rotl64(hi, 17));
+	hi = avalanche(hi ^ rotl64(lo, 41));
+
+	return (struct nbts_digest){.lo = lo, .hi = hi};
+}
+
+struct nbts_digest nbts_hash(void const *restrict nonnull data, size_t size, uint64_t seed)
+{
+	struct nbts_hasher hasher;
+	nbts_hasher_init(&hasher, seed);
+	nbts_hasher_update(&hasher, data, size);
+	return nbts_hasher_final(&hasher);
+}
+
+struct nbts_hash_handler_data nbts_hash_handler_data(uint64_t seed)
+{
+	return (struct nbts_hash_handler_data){.seed = seed};
+}
+
+static inline void hash_u64(struct nbts_hasher *restrict nonnull hasher, uint64_t x)
+{
+	x = htole64(x);
+	nbts_hasher_update(hasher, &x, sizeof(x));
+}
+
+static inline void
+hash_digest(struct nbts_hasher *restrict nonnull hasher, struct nbts_digest digest)
+{
+	hash_u64(hasher, digest.lo);
+	hash_u64(hasher, digest.hi);
+}
+
+static enum nbts_error
+hash_bytes(struct nbts_hasher *restrict nonnull hasher, size_t size, FILE *restrict nonnull stream)
+{
+	enum : size_t { BUFSIZE = NBTS_STACK_BUFFER_SIZE / sizeof(nbts_byte) };
+
+	nbts_byte buffer[BUFSIZE];
+	while (size) {
+		size_t chunk_size = size < BUFSIZE ? size : BUFSIZE;
+		TRY(nbts_parse_byte_array(buffer, chunk_size, stream));
+		nbts_hasher_update(hasher, buffer, chunk_size);
+		size -= chunk_size;
+	}
+	return NBTS_OK;
+}
+
+static enum nbts_error hash_payload(
+	struct nbts_hasher *restrict nonnull hasher,
+	enum nbts_type type,
+	FILE *restrict nonnull stream,
+	uint64_t seed);
+
+static enum nbts_error hash_compound(
+	struct nbts_hasher *restrict nonnull hasher, FILE *restrict nonnull stream, uint64_t seed)
+{
+	struct nbts_hash_handler_data children = nbts_hash_handler_data(seed);
+	TRY(nbts_parse_compound(stream, &nbts_hash_handler, &children));
+	hash_digest(hasher, children.digest);
+	hash_u64(hasher, children.count);
+	return NBTS_OK;
+}
+
+static enum nbts_error hash_list(
+	struct nbts_hasher *restrict nonnull hasher, FILE *restrict nonnull stream, uint64_t seed)
+{
+	enum nbts_type type = 0;
+	TRY(nbts_parse_typeid(&type, stream));
+
+	nbts_size size = 0;
+	TRY(nbts_parse_size(&size, stream));
+
+	nbts_hasher_update(hasher, &type, sizeof(type));
+	hash_u64(hasher, size);
+
+	if (type == NBTS_END) return NBTS_OK;
+	for (nbts_size i = 0; i < size; ++i) TRY(hash_payload(hasher, type, stream, seed));
+	return NBTS_OK;
+}
+
+static enum nbts_error hash_sized_bytes(
+	struct nbts_hasher *restrict nonnull hasher, size_t element_size, FILE *restrict nonnull stream)
+{
+	nbts_size size = 0;
+	TRY(nbts_parse_size(&size, stream));
+	hash_u64(hasher, size);
+	return hash_bytes(hasher, size * element_size, stream);
+}
+
+static enum nbts_error hash_payload(
+	struct nbts_hasher *restrict nonnull hasher,
+	enum nbts_type type,
+	FILE *restrict nonnull stream,
+	uint64_t seed)
+{
+	// Payloads are hashed in their big endian wire representation.
+	switch (type) {
+	case NBTS_END: return NBTS_OK;
+	case NBTS_BYTE: return hash_bytes(hasher, sizeof(nbts_byte), stream);
+	case NBTS_SHORT: return hash_bytes(hasher, sizeof(nbts_short), stream);
+	case NBTS_INT: return hash_bytes(hasher, sizeof(nbts_int), stream);
+	case NBTS_LONG: return hash_bytes(hasher, sizeof(nbts_long), stream);
+	case NBTS_FLOAT: return hash_bytes(hasher, sizeof(nbts_float), stream);
+	case NBTS_DOUBLE: return hash_bytes(hasher, sizeof(nbts_double), stream);
+	case NBTS_STRING: {
+		nbts_strsize size = 0;
+		TRY(nbts_parse_strsize(&size, stream));
+		hash_u64(hasher, size);
+		return hash_bytes(hasher, size * sizeof(nbts_char), stream);
+	}
+	case NBTS_BYTE_ARRAY: return hash_sized_bytes(hasher, sizeof(nbts_byte), stream);
+	case NBTS_INT_ARRAY: return hash_sized_bytes(hasher, sizeof(nbts_int), stream);
+	case NBTS_LONG_ARRAY: return hash_sized_bytes(hasher, sizeof(nbts_long), stream);
+	case NBTS_LIST: return hash_list(hasher, stream, seed);
+	case NBTS_COMPOUND: return hash_compound(hasher, stream, seed);
+	}
+	return NBTS_INVALID_ID;
+}
+
+static enum nbts_error hash_tag(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	enum nbts_type type,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	struct nbts_hasher hasher;
+	nbts_hasher_init(&hasher, data->seed);
+	nbts_hasher_update(&hasher, &type, sizeof(type));
+	hash_u64(&hasher, name_size);
+	TRY(hash_bytes(&hasher, name_size * sizeof(nbts_char), stream));
+	TRY(hash_payload(&hasher, type, stream, data->seed));
+
+	// Addition is commutative, so the combined digest of a compound does
+	// not depend on the order of its children. Unlike XOR, it does not
+	// cancel out duplicate children either.
+	struct nbts_digest digest = nbts_hasher_final(&hasher);
+	data->digest.lo += digest.lo;
+	data->digest.hi += digest.hi;
+	data->count += 1;
+	return NBTS_OK;
+}
+
+enum nbts_error
+nbts_hash_tag(struct nbts_digest *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	struct nbts_hash_handler_data data = nbts_hash_handler_data(0);
+	TRY(nbts_parse_tag(stream, &nbts_hash_handler, &data));
+	*dest = data.digest;
+	return NBTS_OK;
+}
+
+enum nbts_error
+nbts_hash_network_tag(struct nbts_digest *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	struct nbts_hash_handler_data data = nbts_hash_handler_data(0);
+	TRY(nbts_parse_network_tag(stream, &nbts_hash_handler, &data));
+	*dest = data.digest;
+	return NBTS_OK;
+}
+
+enum nbts_error nbts_hash_handle_byte(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return hash_tag(data, NBTS_BYTE, name_size, stream);
+}
+
+enum nbts_error nbts_hash_handle_short(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return hash_tag(data, NBTS_SHORT, name_size, stream);
+}
+
+enum nbts_error nbts_hash_handle_int(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return hash_tag(data, NBTS_INT, name_size, stream);
+}
+
+enum nbts_error nbts_hash_handle_long(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return hash_tag(data, NBTS_LONG, name_size, stream);
+}
+
+enum nbts_error nbts_hash_handle_float(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return hash_tag(data, NBTS_FLOAT, name_size, stream);
+}
+
+enum nbts_error nbts_hash_handle_double(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return hash_tag(data, NBTS_DOUBLE, name_size, stream);
+}
+
+enum nbts_error nbts_hash_handle_string(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return hash_tag(data, NBTS_STRING, name_size, stream);
+}
+
+enum nbts_error nbts_hash_handle_byte_array(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return hash_tag(data, NBTS_BYTE_ARRAY, name_size, stream);
+}
+
+enum nbts_error nbts_hash_handle_int_array(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return hash_tag(data, NBTS_INT_ARRAY, name_size, stream);
+}
+
+enum nbts_error nbts_hash_handle_long_array(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return hash_tag(data, NBTS_LONG_ARRAY, name_size, stream);
+}
+
+enum nbts_error nbts_hash_handle_list(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return hash_tag(data, NBTS_LIST, name_size, stream);
+}
+
+enum nbts_error nbts_hash_handle_compound(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return hash_tag(data, NBTS_COMPOUND, name_size, stream);
+}
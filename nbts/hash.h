@@ -0,0 +1,145 @@
+#pragma once
+
+/// \file
+///
+/// \brief A module computing canonical 128 bit digests of NBT tags.
+///
+/// The digest of a compound does not depend on the order of its children,
+/// so two payloads that only differ in key order hash to the same value. The
+/// order of list elements is significant. The tree is never materialized;
+/// names and arrays are fed to the hash function in chunks of
+/// \ref NBTS_STACK_BUFFER_SIZE bytes.
+///
+/// The hash function is a fast non-cryptographic one. Do not use it where an
+/// adversary may choose the input to provoke collisions.
+
+#include <nbts/nbts.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// A 128 bit digest.
+struct nbts_digest {
+	uint64_t lo;
+	uint64_t hi;
+};
+
+/// The number of 64 bit lanes processed in parallel by \ref nbts_hasher.
+enum : size_t { NBTS_HASHER_LANES = 8 };
+
+/// The number of bytes consumed by one round of \ref nbts_hasher.
+enum : size_t { NBTS_HASHER_STRIPE = NBTS_HASHER_LANES * sizeof(uint64_t) };
+
+/// Incremental state of the hash function underlying \ref nbts_hash_handler.
+struct nbts_hasher {
+	uint64_t acc[NBTS_HASHER_LANES];
+	uint8_t buffer[NBTS_HASHER_STRIPE];
+	size_t buffered;
+	uint64_t total;
+};
+
+/// Initializes `hasher` with `seed`.
+void nbts_hasher_init(struct nbts_hasher *restrict nonnull hasher, uint64_t seed);
+
+/// Feeds `size` bytes at `data` into `hasher`.
+void nbts_hasher_update(
+	struct nbts_hasher *restrict nonnull hasher, void const *restrict nonnull data, size_t size);
+
+/// Returns the digest of all bytes fed into `hasher` so far.
+///
+/// This does not modify `hasher`, so it may be updated further afterwards.
+struct nbts_digest nbts_hasher_final(struct nbts_hasher const *restrict nonnull hasher);
+
+/// Returns the digest of `size` bytes at `data`.
+struct nbts_digest nbts_hash(void const *restrict nonnull data, size_t size, uint64_t seed);
+
+extern struct nbts_handler const nbts_hash_handler;
+
+/// Userdata for \ref nbts_hash_handler.
+///
+/// Every tag handled with the same instance is combined into `digest`
+/// commutatively. After parsing a single tag, `digest` is the digest of that
+/// tag.
+struct nbts_hash_handler_data {
+	struct nbts_digest digest;
+	size_t count;
+	uint64_t seed;
+};
+
+struct nbts_hash_handler_data nbts_hash_handler_data(uint64_t seed);
+
+/// Computes the digest of one named tag from `stream` into `dest`.
+enum nbts_error
+nbts_hash_tag(struct nbts_digest *restrict nonnull dest, FILE *restrict nonnull stream);
+
+/// Computes the digest of one unnamed tag from `stream` into `dest`.
+enum nbts_error
+nbts_hash_network_tag(struct nbts_digest *restrict nonnull dest, FILE *restrict nonnull stream);
+
+enum nbts_error nbts_hash_handle_byte(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_hash_handle_short(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_hash_handle_int(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_hash_handle_long(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_hash_handle_float(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_hash_handle_double(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_hash_handle_string(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_hash_handle_byte_array(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_hash_handle_int_array(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_hash_handle_long_array(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_hash_handle_list(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_hash_handle_compound(
+	struct nbts_hash_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,153 @@
+#include <nbts/measure.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+extern inline size_t nbts_measure_fixed(enum nbts_type type);
+extern inline size_t nbts_measure_header(size_t name_size);
+extern inline size_t nbts_measure_string(size_t size);
+extern inline size_t nbts_measure_array(enum nbts_type type, size_t size);
+extern inline size_t nbts_measure_list(enum nbts_type type, size_t size);
+
+/// Moves `stream` forward by `size` bytes.
+///
+/// Regular files can be sought past their end, so the last byte is read
+/// to tell that the bytes exist.
+static enum nbts_error skip_bytes(FILE *restrict nonnull stream, size_t size)
+{
+	if (!size) return NBTS_OK;
+	if (size > 1 && fseeko(stream, (off_t) size - 1, SEEK_CUR) == -1) return NBTS_READ_ERR;
+	if (getc_unlocked(stream) == EOF) return ferror(stream) ? NBTS_READ_ERR : NBTS_UNEXPECTED_EOF;
+	return NBTS_OK;
+}
+
+static enum nbts_error
+measure_payload(size_t *restrict nonnull dest, FILE *restrict nonnull stream, enum nbts_type type);
+
+// NOLINTBEGIN(bugprone-easily-swappable-parameters)
+
+static enum nbts_error
+measure_list(size_t *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	enum nbts_type type = 0;
+	TRY(nbts_parse_typeid(&type, stream));
+
+	nbts_size size = 0;
+	TRY(nbts_parse_size(&size, stream));
+
+	// Lists of scalars are measured with a single seek, like arrays.
+	*dest += nbts_measure_list(type, size);
+	size_t fixed = nbts_measure_fixed(type);
+	if (fixed || type == NBTS_END) return skip_bytes(stream, size * fixed);
+
+	for (nbts_size i = 0; i < size; ++i) TRY(measure_payload(dest, stream, type));
+	return NBTS_OK;
+}
+
+static enum nbts_error
+measure_compound(size_t *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	while (1) {
+		enum nbts_type type = 0;
+		TRY(nbts_parse_typeid(&type, stream));
+		if (type == NBTS_END) break;
+
+		nbts_strsize name_size = 0;
+		TRY(nbts_parse_strsize(&name_size, stream));
+		TRY(skip_bytes(stream, name_size * sizeof(nbts_char)));
+		*dest += nbts_measure_header(name_size);
+		TRY(measure_payload(dest, stream, type));
+	}
+	*dest += NBTS_MEASURE_END;
+	return NBTS_OK;
+}
+
+static enum nbts_error
+measure_payload(size_t *restrict nonnull dest, FILE *restrict nonnull stream, enum nbts_type type)
+{
+	size_t fixed = nbts_measure_fixed(type);
+	if (fixed) {
+		*dest += fixed;
+		return skip_bytes(stream, fixed);
+	}
+
+	switch (type) {
+	case NBTS_STRING: {
+		nbts_strsize size = 0;
+		TRY(nbts_parse_strsize(&size, stream));
+		*dest += nbts_measure_string(size);
+		return skip_bytes(stream, size * sizeof(nbts_char));
+	}
+	case NBTS_BYTE_ARRAY:
+	case NBTS_INT_ARRAY:
+	case NBTS_LONG_ARRAY: {
+		nbts_size size = 0;
+		TRY(nbts_parse_size(&size, stream));
+		size_t array_size = nbts_measure_array(type, size);
+		*dest += array_size;
+		return skip_bytes(stream, array_size - sizeof(nbts_size));
+	}
+	case NBTS_LIST: return measure_list(dest, stream);
+	case NBTS_COMPOUND: return measure_compound(dest, stream);
+	default: return NBTS_OK;
+	}
+}
+
+enum nbts_error nbts_measure_payload(
+	size_t *restrict nonnull dest, FILE *restrict nonnull stream, enum nbts_type type)
+{
+	size_t size = 0;
+	flockfile(stream);
+	enum nbts_error err = measure_payload(&size, stream, type);
+	funlockfile(stream);
+	if (!err) *dest = size;
+	return err;
+}
+
+// NOLINTEND(bugprone-easily-swappable-parameters)
+
+enum nbts_error nbts_measure_tag(size_t *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	flockfile(stream);
+	enum nbts_type type = 0;
+	nbts_strsize name_size = 0;
+	enum nbts_error err = nbts_parse_typeid(&type, stream);
+	if (!err && type == NBTS_END) err = NBTS_UNEXPECTED_END_TAG;
+	if (!err) err = nbts_parse_strsize(&name_size, stream);
+	if (!err) err = skip_bytes(stream, name_size * sizeof(nbts_char));
+
+	size_t size = nbts_measure_header(name_size);
+	if (!err) err = measure_payload(&size, stream, type);
+	funlockfile(stream);
+	if (!err) *dest = size;
+	return err;
+}
+
+enum nbts_error
+nbts_measure_network_tag(size_t *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	flockfile(stream);
+	enum nbts_type type = 0;
+	enum nbts_error err = nbts_parse_typeid(&type, stream);
+	if (!err && type == NBTS_END) err = NBTS_UNEXPECTED_END_TAG;
+
+	size_t size = sizeof(uint8_t);
+	if (!err) err = measure_payload(&size, stream, type);
+	funlockfile(stream);
+	if (!err) *dest = size;
+	return err;
+}
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,98 @@
+#pragma once
+
+/// \file
+///
+/// \brief Computing the exact encoded size of NBT before writing it.
+///
+/// Length-prefixed packets and region sectors need the size of their
+/// content before it is written. Instead of serializing twice or into a
+/// temporary buffer, the size can be computed up front:
+///
+/// - For data described by the writer, the inline functions below give the
+///   size of each part written by the functions in \ref write.h. The size of
+///   a tag is the sum of the sizes of its parts, so it is usually known at
+///   compile time, except for names, strings and arrays.
+/// - For data in another stream, \ref nbts_measure_tag walks the tag like
+///   \ref nbts_skip_handler, but adds up the sizes of arrays, strings and
+///   lists of fixed-size elements instead of visiting their elements.
+
+#include <nbts/nbts.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// The size of the \ref NBTS_END tag closing a compound.
+enum : size_t { NBTS_MEASURE_END = sizeof(uint8_t) };
+
+/// Returns the size of a payload of `type` if it is the same for all
+/// payloads of the type, or `0` otherwise.
+inline size_t nbts_measure_fixed(enum nbts_type type)
+{
+	switch (type) {
+	case NBTS_BYTE: return sizeof(nbts_byte);
+	case NBTS_SHORT: return sizeof(nbts_short);
+	case NBTS_INT: return sizeof(nbts_int);
+	case NBTS_LONG: return sizeof(nbts_long);
+	case NBTS_FLOAT: return sizeof(nbts_float);
+	case NBTS_DOUBLE: return sizeof(nbts_double);
+	default: return 0;
+	}
+}
+
+/// Returns the size of the header of a tag with a name of `name_size`
+/// characters, as written by \ref nbts_write_tag_header.
+inline size_t nbts_measure_header(size_t name_size)
+{
+	return sizeof(uint8_t) + sizeof(nbts_strsize) + name_size * sizeof(nbts_char);
+}
+
+/// Returns the size of a string payload of `size` characters.
+inline size_t nbts_measure_string(size_t size)
+{
+	return sizeof(nbts_strsize) + size * sizeof(nbts_char);
+}
+
+/// Returns the size of an array payload of `type` with `size` elements.
+///
+/// `type` is one of \ref NBTS_BYTE_ARRAY, \ref NBTS_INT_ARRAY and
+/// \ref NBTS_LONG_ARRAY.
+inline size_t nbts_measure_array(enum nbts_type type, size_t size)
+{
+	size_t element = type == NBTS_LONG_ARRAY ? sizeof(nbts_long)
+	               : type == NBTS_INT_ARRAY  ? sizeof(nbts_int)
+	                                         : sizeof(nbts_byte);
+	return sizeof(nbts_size) + size * element;
+}
+
+/// Returns the size of a list payload of `size` elements of `type`.
+///
+/// If \ref nbts_measure_fixed is `0` for `type`, only the type and size of
+/// the list are counted, and the sizes of the elements have to be added.
+inline size_t nbts_measure_list(enum nbts_type type, size_t size)
+{
+	return sizeof(uint8_t) + sizeof(nbts_size) + size * nbts_measure_fixed(type);
+}
+
+/// Reads one named tag from `stream` and stores its encoded size in `dest`.
+///
+/// The stream is left after the tag, as if it had been skipped. Like the skip
+/// handlers, this seeks over payloads, so `stream` must be seekable.
+enum nbts_error nbts_measure_tag(size_t *restrict nonnull dest, FILE *restrict nonnull stream);
+
+/// Like \ref nbts_measure_tag, for a tag without a name as in the network
+/// format.
+enum nbts_error
+nbts_measure_network_tag(size_t *restrict nonnull dest, FILE *restrict nonnull stream);
+
+/// Reads one payload of `type` from `stream` and stores its encoded size in
+/// `dest`.
+enum nbts_error nbts_measure_payload(
+	size_t *restrict nonnull dest, FILE *restrict nonnull stream, enum nbts_type type);
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,170 @@
+#define _GNU_SOURCE
+
+#include <nbts/mmap.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+static size_t page_size(void)
+{
+	long size = sysconf(_SC_PAGESIZE);
+	return size > 0 ? (size_t) size : 4096;
+}
+
+static void advise(uint8_t const *restrict nonnull data, size_t size)
+{
+	// The hints are best effort, so failures are ignored.
+	(void) madvise((void *) data, size, MADV_SEQUENTIAL);
+	(void) madvise((void *) data, size, MADV_WILLNEED);
+}
+
+static bool in_window(struct nbts_mmap const *restrict nonnull map, uint64_t offset, size_t size)
+{
+	return map->data && offset >= map->data_offset &&
+	       offset + size <= map->data_offset + map->data_size;
+}
+
+static enum nbts_error
+map_window(struct nbts_mmap *restrict nonnull map, uint64_t offset, size_t min_size)
+{
+	if (map->data) munmap((void *) map->data, map->data_size);
+	map->data = nullptr;
+	map->data_size = 0;
+
+	size_t page = page_size();
+	uint64_t aligned = offset & ~(uint64_t) (page - 1);
+	size_t window_size = (offset - aligned + min_size + page - 1) / page * page;
+	if (window_size < map->window_size) window_size = map->window_size;
+
+	uint64_t rest = map->file_size - aligned;
+	size_t size = rest < window_size ? rest : window_size;
+
+	void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, map->fd, (off_t) aligned);
+	if (data == MAP_FAILED) return NBTS_READ_ERR;
+
+	map->data = data;
+	map->data_size = size;
+	map->data_offset = aligned;
+	advise(map->data, map->data_size);
+	return NBTS_OK;
+}
+
+static ssize_t cookie_read(void *cookie, char *buffer, size_t size)
+{
+	struct nbts_mmap *map = cookie;
+	if (map->position >= map->file_size) return 0;
+	if (!in_window(map, map->position, 1) && map_window(map, map->position, 1)) return -1;
+
+	size_t available = map->data_offset + map->data_size - map->position;
+	size_t n = size < available ? size : available;
+	memcpy(buffer, &map->data[map->position - map->data_offset], n);
+	map->position += n;
+	return (ssize_t) n;
+}
+
+static int cookie_seek(void *cookie, off64_t *offset, int whence)
+{
+	struct nbts_mmap *map = cookie;
+
+	int64_t base = 0;
+	switch (whence) {
+	case SEEK_SET: base = 0; break;
+	case SEEK_CUR: base = (int64_t) map->position; break;
+	case SEEK_END: base = (int64_t) map->file_size; break;
+	default: return -1;
+	}
+
+	int64_t position = base + *offset;
+	if (position < 0) return -1;
+
+	map->position = position;
+	*offset = position;
+	return 0;
+}
+
+enum nbts_error nbts_mmap_open(
+	struct nbts_mmap *restrict nonnull map, char const *restrict nonnull path, size_t window_size)
+{
+	*map = (struct nbts_mmap){.fd = open(path, O_RDONLY | O_CLOEXEC)};
+	if (map->fd == -1) return NBTS_READ_ERR;
+
+	struct stat st;
+	if (fstat(map->fd, &st) == -1) goto failed;
+	map->file_size = st.st_size;
+	(void) posix_fadvise(map->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	if (window_size) {
+		size_t page = page_size();
+		map->window_size = (window_size + page - 1) / page * page;
+	} else {
+		map->window_size = map->file_size;
+		if (map->window_size != map->file_size) goto failed;
+	}
+
+	if (map->file_size && map_window(map, 0, 0)) goto failed;
+
+	cookie_io_functions_t io = {.read = &cookie_read, .seek = &cookie_seek};
+	map->stream = fopencookie(map, "rb", io);
+	if (!map->stream) goto failed;
+
+	if (!window_size) map->window_size = 0;
+	return NBTS_OK;
+
+failed:
+	nbts_mmap_close(map);
+	return NBTS_READ_ERR;
+}
+
+void nbts_mmap_close(struct nbts_mmap *restrict nonnull map)
+{
+	if (map->stream) fclose(map->stream);
+	if (map->data) munmap((void *) map->data, map->data_size);
+	if (map->fd != -1) close(map->fd);
+	*map = (struct nbts_mmap){.fd = -1};
+}
+
+enum nbts_error nbts_mmap_view(
+	struct nbts_mmap *restrict nonnull map, size_t size, void const *nullable *restrict nonnull dest)
+{
+	off64_t position = ftello64(map->stream);
+	if (position == -1) return NBTS_READ_ERR;
+	TRY(nbts_mmap_view_at(map, position, size, dest));
+	if (fseeko64(map->stream, position + (off64_t) size, SEEK_SET) == -1) return NBTS_READ_ERR;
+	return NBTS_OK;
+}
+
+enum nbts_error nbts_mmap_view_at(
+	struct nbts_mmap *restrict nonnull map,
+	uint64_t offset,
+	size_t size,
+	void const *nullable *restrict nonnull dest)
+{
+	if (offset > map->file_size || size > map->file_size - offset) return NBTS_UNEXPECTED_EOF;
+
+	if (!in_window(map, offset, size)) {
+		if (!map->window_size) return NBTS_READ_ERR;
+		TRY(map_window(map, offset, size));
+	}
+
+	*dest = &map->data[offset - map->data_offset];
+	return NBTS_OK;
+}
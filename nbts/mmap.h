@@ -0,0 +1,80 @@
+#pragma once
+
+/// \file
+///
+/// \brief Memory-mapped file input.
+///
+/// \ref nbts_mmap_open maps a file and provides a `FILE *` reading from the
+/// mapping, so it can be passed to \ref nbts_parse_tag and any handler.
+///
+/// The stream keeps the default stdio buffer. Copying the mapping through it
+/// costs less than calling into the stream for each of the many small reads
+/// of a handler. Handlers that know about the mapping can avoid copying
+/// names, strings and arrays with \ref nbts_mmap_view, which returns them in
+/// place.
+///
+/// Files larger than the address space or the available memory can be
+/// mapped through a sliding window of fixed size.
+
+#include <nbts/nbts.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// A memory-mapped input file.
+struct nbts_mmap {
+	/// The stream reading from the mapping.
+	FILE *nullable stream;
+	/// The currently mapped part of the file.
+	uint8_t const *nullable data;
+	/// The size of `data`.
+	size_t data_size;
+	/// The file offset of `data`.
+	uint64_t data_offset;
+	/// The size of the file.
+	uint64_t file_size;
+	/// The size of the sliding window, or `0` if the whole file is mapped.
+	size_t window_size;
+	/// The read position of `stream`, excluding its buffer.
+	uint64_t position;
+	int fd;
+};
+
+/// Maps the file at `path` and opens `map->stream` on it.
+///
+/// If `window_size` is `0`, the whole file is mapped at once and
+/// `map->data` stays valid until \ref nbts_mmap_close. Otherwise at most
+/// `window_size` bytes, rounded up to the page size, are mapped at a time.
+enum nbts_error nbts_mmap_open(
+	struct nbts_mmap *restrict nonnull map, char const *restrict nonnull path, size_t window_size);
+
+/// Closes `map->stream` and unmaps the file.
+void nbts_mmap_close(struct nbts_mmap *restrict nonnull map);
+
+/// Returns the next `size` bytes of `map->stream` in `dest` without copying.
+///
+/// The stream is advanced past the bytes. With a sliding window, the view
+/// stays valid until the next read from `map->stream` leaves the window. If
+/// the bytes do not fit into the current window, a window large enough to
+/// hold them is mapped.
+enum nbts_error nbts_mmap_view(
+	struct nbts_mmap *restrict nonnull map, size_t size, void const *nullable *restrict nonnull dest);
+
+/// Returns the `size` bytes at file offset `offset` in `dest` without
+/// copying.
+///
+/// Unlike \ref nbts_mmap_view, this does not move `map->stream`. The view is
+/// invalidated like the ones returned by \ref nbts_mmap_view.
+enum nbts_error nbts_mmap_view_at(
+	struct nbts_mmap *restrict nonnull map,
+	uint64_t offset,
+	size_t size,
+	void const *nullable *restrict nonnull dest);
+
+#undef nonnull
+#undef nullable
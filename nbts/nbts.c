@@ -1,10 +1,15 @@
+#define _GNU_SOURCE
+
 #include <nbts/nbts.h>
+#include <nbts/probe.h>
 
 #include <endian.h>
 
 #include <stdio.h>
 #include <string.h>
 
+// The inline readers in nbts.h assemble big endian values byte by byte, so
+// this only affects the array readers below.
 #define NBTS_BYTE_ORDER BIG_ENDIAN
 
 #if NBTS_BYTE_ORDER == BIG_ENDIAN
@@ -43,124 +48,60 @@
 		__VA_ARGS__;     \
 	}
 
+#if NBTS_WITH_USDT
+thread_local unsigned nbts_probe_depth;
+
+#define PROBE_SEMAPHORE __attribute__((section(".probes"), used))
+unsigned short nbts_tag__entry_semaphore PROBE_SEMAPHORE;
+unsigned short nbts_tag__return_semaphore PROBE_SEMAPHORE;
+unsigned short nbts_compound__entry_semaphore PROBE_SEMAPHORE;
+unsigned short nbts_compound__return_semaphore PROBE_SEMAPHORE;
+unsigned short nbts_list__entry_semaphore PROBE_SEMAPHORE;
+unsigned short nbts_list__return_semaphore PROBE_SEMAPHORE;
+unsigned short nbts_print__entry_semaphore PROBE_SEMAPHORE;
+unsigned short nbts_print__return_semaphore PROBE_SEMAPHORE;
+#endif
+
 // NOLINTBEGIN(bugprone-easily-swappable-parameters)
 
 static enum nbts_error
 xfread(void *restrict nonnull ptr, size_t size, size_t count, FILE *restrict nonnull stream)
 {
-	if (fread(ptr, size, count, stream) != count) {
+	if (fread_unlocked(ptr, size, count, stream) != count) {
 		if (ferror(stream)) return NBTS_READ_ERR;
 		if (feof(stream)) return NBTS_UNEXPECTED_EOF;
 	}
 	return NBTS_OK;
 }
 
-enum nbts_error nbts_parse_uint8(uint8_t *restrict nonnull dest, FILE *restrict nonnull stream)
-{
-	return xfread(dest, sizeof(*dest), 1, stream);
-}
-
-enum nbts_error nbts_parse_uint16(uint16_t *restrict nonnull dest, FILE *restrict nonnull stream)
-{
-	TRY(xfread(dest, sizeof(*dest), 1, stream));
-	*dest = nbt16toh(*dest);
-	return NBTS_OK;
-}
-
-enum nbts_error nbts_parse_uint32(uint32_t *restrict nonnull dest, FILE *restrict nonnull stream)
-{
-	TRY(xfread(dest, sizeof(*dest), 1, stream));
-	*dest = nbt32toh(*dest);
-	return NBTS_OK;
-}
-
-enum nbts_error nbts_parse_uint64(uint64_t *restrict nonnull dest, FILE *restrict nonnull stream)
-{
-	TRY(xfread(dest, sizeof(*dest), 1, stream));
-	*dest = nbt64toh(*dest);
-	return NBTS_OK;
-}
-
-enum nbts_error
-nbts_parse_typeid(enum nbts_type *restrict nonnull dest, FILE *restrict nonnull stream)
-{
-	uint8_t result = 0;
-	TRY(nbts_parse_uint8(&result, stream));
-	if (!(result < NBTS_TYPE_ENUM_SIZE)) return NBTS_INVALID_ID;
-	static_assert(sizeof(*dest) == sizeof(result));
-	memcpy(dest, &result, sizeof(result));
-	return NBTS_OK;
-}
-
-enum nbts_error nbts_parse_size(nbts_size *restrict nonnull dest, FILE *restrict nonnull stream)
-{
-	nbts_int result = 0;
-	TRY(nbts_parse_int(&result, stream));
-	if (result < 0) return NBTS_INVALID_SIZE;
-	static_assert(sizeof(*dest) == sizeof(result));
-	memcpy(dest, &result, sizeof(result));
-	return NBTS_OK;
-}
-
-enum nbts_error
-nbts_parse_strsize(nbts_strsize *restrict nonnull dest, FILE *restrict nonnull stream)
-{
-	return nbts_parse_uint16(dest, stream);
-}
-
-enum nbts_error nbts_parse_byte(nbts_byte *restrict nonnull dest, FILE *restrict nonnull stream)
-{
-	uint8_t result = 0;
-	TRY(nbts_parse_uint8(&result, stream));
-	static_assert(sizeof(*dest) == sizeof(result));
-	memcpy(dest, &result, sizeof(result));
-	return NBTS_OK;
-}
-
-enum nbts_error nbts_parse_short(nbts_short *restrict nonnull dest, FILE *restrict nonnull stream)
-{
-	uint16_t result = 0;
-	TRY(nbts_parse_uint16(&result, stream));
-	static_assert(sizeof(*dest) == sizeof(result));
-	memcpy(dest, &result, sizeof(result));
-	return NBTS_OK;
-}
-
-enum nbts_error nbts_parse_int(nbts_int *restrict nonnull dest, FILE *restrict nonnull stream)
-{
-	uint32_t result = 0;
-	TRY(nbts_parse_uint32(&result, stream));
-	static_assert(sizeof(*dest) == sizeof(result));
-	memcpy(dest, &result, sizeof(result));
-	return NBTS_OK;
-}
-
-enum nbts_error nbts_parse_long(nbts_long *restrict nonnull dest, FILE *restrict nonnull stream)
-{
-	uint64_t result = 0;
-	TRY(nbts_parse_uint64(&result, stream));
-	static_assert(sizeof(*dest) == sizeof(result));
-	memcpy(dest, &result, sizeof(result));
-	return NBTS_OK;
-}
-
-enum nbts_error nbts_parse_float(nbts_float *restrict nonnull dest, FILE *restrict nonnull stream)
-{
-	uint32_t result = 0;
-	TRY(nbts_parse_uint32(&result, stream));
-	static_assert(sizeof(*dest) == sizeof(result));
-	memcpy(dest, &result, sizeof(result));
-	return NBTS_OK;
-}
-
-enum nbts_error nbts_parse_double(nbts_double *restrict nonnull dest, FILE *restrict nonnull stream)
-{
-	uint64_t result = 0;
-	TRY(nbts_parse_uint64(&result, stream));
-	static_assert(sizeof(*dest) == sizeof(result));
-	memcpy(dest, &result, sizeof(result));
-	return NBTS_OK;
-}
+extern inline enum nbts_error
+nbts_parse_uintn(uint64_t *restrict nonnull dest, size_t size, FILE *restrict nonnull stream);
+extern inline enum nbts_error
+nbts_parse_uint8(uint8_t *restrict nonnull dest, FILE *restrict nonnull stream);
+extern inline enum nbts_error
+nbts_parse_uint16(uint16_t *restrict nonnull dest, FILE *restrict nonnull stream);
+extern inline enum nbts_error
+nbts_parse_uint32(uint32_t *restrict nonnull dest, FILE *restrict nonnull stream);
+extern inline enum nbts_error
+nbts_parse_uint64(uint64_t *restrict nonnull dest, FILE *restrict nonnull stream);
+extern inline enum nbts_error
+nbts_parse_typeid(enum nbts_type *restrict nonnull dest, FILE *restrict nonnull stream);
+extern inline enum nbts_error
+nbts_parse_strsize(nbts_strsize *restrict nonnull dest, FILE *restrict nonnull stream);
+extern inline enum nbts_error
+nbts_parse_byte(nbts_byte *restrict nonnull dest, FILE *restrict nonnull stream);
+extern inline enum nbts_error
+nbts_parse_short(nbts_short *restrict nonnull dest, FILE *restrict nonnull stream);
+extern inline enum nbts_error
+nbts_parse_int(nbts_int *restrict nonnull dest, FILE *restrict nonnull stream);
+extern inline enum nbts_error
+nbts_parse_long(nbts_long *restrict nonnull dest, FILE *restrict nonnull stream);
+extern inline enum nbts_error
+nbts_parse_float(nbts_float *restrict nonnull dest, FILE *restrict nonnull stream);
+extern inline enum nbts_error
+nbts_parse_double(nbts_double *restrict nonnull dest, FILE *restrict nonnull stream);
+extern inline enum nbts_error
+nbts_parse_size(nbts_size *restrict nonnull dest, FILE *restrict nonnull stream);
 
 enum nbts_error
 nbts_parse_string(nbts_char *restrict nonnull dest, size_t size, FILE *restrict nonnull stream)
@@ -202,21 +143,50 @@ enum nbts_error nbts_parse_list(
 	nbts_handler_fn *handler_fn = handler ? handler->handle[type] : nullptr;
 	if (!handler_fn) handler_fn = nbts_skip_handler.handle[type];
 
-	for (size_t i = 0; i < size; ++i) TRY(handler_fn(userdata, 0, stream));
+	bool traced = NBTS_PROBED(list);
+	bool nested = NBTS_PROBING();
+	if (traced) {
+		NBTS_PROBE(list__entry, type, size, NBTS_PROBE_DEPTH(), NBTS_PROBE_OFFSET(stream));
+	}
+	if (nested) NBTS_PROBE_ENTER();
 
-	return NBTS_OK;
+	enum nbts_error err = NBTS_OK;
+	for (size_t i = 0; !err && i < size; ++i) err = handler_fn(userdata, 0, stream);
+
+	if (nested) NBTS_PROBE_LEAVE();
+	if (traced) {
+		NBTS_PROBE(list__return, type, size, NBTS_PROBE_DEPTH(), NBTS_PROBE_OFFSET(stream), err);
+	}
+	return err;
 }
 
+static enum nbts_error parse_tag(
+	FILE *restrict nonnull stream,
+	struct nbts_handler const *restrict nullable handler,
+	void *restrict nullable userdata);
+
 enum nbts_error nbts_parse_compound(
 	FILE *restrict nonnull stream,
 	struct nbts_handler const *restrict nullable handler,
 	void *restrict nullable userdata)
 {
-	while (1) TRY(nbts_parse_tag(stream, handler, userdata), CATCH(NBTS_UNEXPECTED_END_TAG, break));
-	return NBTS_OK;
+	bool traced = NBTS_PROBED(compound);
+	bool nested = NBTS_PROBING();
+	if (traced) NBTS_PROBE(compound__entry, NBTS_PROBE_DEPTH(), NBTS_PROBE_OFFSET(stream));
+	if (nested) NBTS_PROBE_ENTER();
+
+	enum nbts_error err = NBTS_OK;
+	while (!(err = parse_tag(stream, handler, userdata))) {}
+	if (err == NBTS_UNEXPECTED_END_TAG) err = NBTS_OK;
+
+	if (nested) NBTS_PROBE_LEAVE();
+	if (traced) {
+		NBTS_PROBE(compound__return, NBTS_PROBE_DEPTH(), NBTS_PROBE_OFFSET(stream), err);
+	}
+	return err;
 }
 
-enum nbts_error nbts_parse_tag(
+static enum nbts_error parse_tag(
 	FILE *restrict nonnull stream,
 	struct nbts_handler const *restrict nullable handler,
 	void *restrict nullable userdata)
@@ -231,11 +201,17 @@ enum nbts_error nbts_parse_tag(
 
 	nbts_strsize name_size = 0;
 	TRY(nbts_parse_strsize(&name_size, stream));
-	TRY(handler_fn(userdata, name_size, stream));
-	return NBTS_OK;
+
+	bool traced = NBTS_PROBED(tag);
+	if (traced) NBTS_PROBE(tag__entry, type, NBTS_PROBE_DEPTH(), NBTS_PROBE_OFFSET(stream));
+	enum nbts_error err = handler_fn(userdata, name_size, stream);
+	if (traced) {
+		NBTS_PROBE(tag__return, type, NBTS_PROBE_DEPTH(), NBTS_PROBE_OFFSET(stream), err);
+	}
+	return err;
 }
 
-enum nbts_error nbts_parse_network_tag(
+static enum nbts_error parse_network_tag(
 	FILE *restrict nonnull stream,
 	struct nbts_handler const *restrict nullable handler,
 	void *restrict nullable userdata)
@@ -252,6 +228,32 @@ enum nbts_error nbts_parse_network_tag(
 	return NBTS_OK;
 }
 
+// The stream is locked once per top-level tag, so that the primitive readers
+// can use the unlocked stdio functions. The lock is recursive, so handlers
+// calling these functions again only pay for a counter increment.
+
+enum nbts_error nbts_parse_tag(
+	FILE *restrict nonnull stream,
+	struct nbts_handler const *restrict nullable handler,
+	void *restrict nullable userdata)
+{
+	flockfile(stream);
+	enum nbts_error err = parse_tag(stream, handler, userdata);
+	funlockfile(stream);
+	return err;
+}
+
+enum nbts_error nbts_parse_network_tag(
+	FILE *restrict nonnull stream,
+	struct nbts_handler const *restrict nullable handler,
+	void *restrict nullable userdata)
+{
+	flockfile(stream);
+	enum nbts_error err = parse_network_tag(stream, handler, userdata);
+	funlockfile(stream);
+	return err;
+}
+
 struct nbts_handler const nbts_skip_handler = {
 	.handle[NBTS_END] = &nbts_skip_end,
 	.handle[NBTS_BYTE] = &nbts_skip_byte,
@@ -399,7 +401,7 @@ enum nbts_error
 nbts_skip_compound(void *nullable /**/, nbts_strsize name_size, FILE *restrict nonnull stream)
 {
 	TRY(skip_name(name_size, stream));
-	while (1) TRY(nbts_parse_tag(stream, nullptr, nullptr), CATCH(NBTS_UNEXPECTED_END_TAG, break));
+	while (1) TRY(parse_tag(stream, nullptr, nullptr), CATCH(NBTS_UNEXPECTED_END_TAG, break));
 	return NBTS_OK;
 }
 
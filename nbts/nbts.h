@@ -16,6 +16,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #if __clang__
 #define nonnull  _Nonnull
@@ -63,6 +64,10 @@ enum [[nodiscard]] nbts_error {
 	NBTS_UNEXPECTED_END_TAG,  ///< The parsed tag was an END tag.
 	NBTS_INVALID_ID,          ///< The value of the ID byte was out of range.
 	NBTS_INVALID_SIZE,        ///< The size of a list or array was negative.
+	NBTS_ALLOC_ERR,           ///< Error allocating memory.
+	NBTS_LIMIT_EXCEEDED,      ///< A caller-provided limit or capacity was exceeded.
+	NBTS_UNSUPPORTED,         ///< The operation is not supported by this build.
+	NBTS_COMPRESSION_ERR,     ///< Compressed input data was malformed.
 	NBTS_CUSTOM_ERR = 1000,   ///< The first value reserved for application-specific errors.
 };
 
@@ -109,43 +114,184 @@ struct nbts_handler {
 	nbts_handler_fn *nullable handle[NBTS_TYPE_ENUM_SIZE];
 };
 
+// The primitive readers below are defined inline, so that handlers reading
+// many small values do not pay for a function call per value. They read with
+// `getc_unlocked()`, so they do not lock the stream themselves.
+// \ref nbts_parse_tag and \ref nbts_parse_network_tag lock the stream while
+// they run, so handlers called by them need not care. Code reading a stream
+// shared between threads outside of these functions has to lock it with
+// `flockfile()` itself.
+//
+// Without POSIX, `getc_unlocked()` is not declared, and the two readers using
+// it are out of line instead of locking the stream for every byte.
+
+#if defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 199506L
+
+/// Reads one unsigned integer of `size` bytes from `stream` into `dest`,
+/// handling endian conversion.
+///
+/// `size` shall be at most `sizeof(uint64_t)`.
+inline enum nbts_error
+nbts_parse_uintn(uint64_t *restrict nonnull dest, size_t size, FILE *restrict nonnull stream)
+{
+	uint64_t result = 0;
+	for (size_t i = 0; i < size; ++i) {
+		int c = getc_unlocked(stream);
+		if (c == EOF) return ferror(stream) ? NBTS_READ_ERR : NBTS_UNEXPECTED_EOF;
+		result = result << 8 | (uint8_t) c;
+	}
+	*dest = result;
+	return NBTS_OK;
+}
+
 /// Reads one `uint8_t` from `stream` into `dest`.
+inline enum nbts_error
+nbts_parse_uint8(uint8_t *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	int c = getc_unlocked(stream);
+	if (c == EOF) return ferror(stream) ? NBTS_READ_ERR : NBTS_UNEXPECTED_EOF;
+	*dest = (uint8_t) c;
+	return NBTS_OK;
+}
+
+#else
+
+enum nbts_error
+nbts_parse_uintn(uint64_t *restrict nonnull dest, size_t size, FILE *restrict nonnull stream);
+
 enum nbts_error nbts_parse_uint8(uint8_t *restrict nonnull dest, FILE *restrict nonnull stream);
+
+#endif
+
 /// Reads one `uint16_t` from `stream` into `dest`, handling endian conversion.
-enum nbts_error nbts_parse_uint16(uint16_t *restrict nonnull dest, FILE *restrict nonnull stream);
+inline enum nbts_error
+nbts_parse_uint16(uint16_t *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	uint64_t result = 0;
+	enum nbts_error err = nbts_parse_uintn(&result, sizeof(*dest), stream);
+	if (!err) *dest = (uint16_t) result;
+	return err;
+}
+
 /// Reads one `uint32_t` from `stream` into `dest`, handling endian conversion.
-enum nbts_error nbts_parse_uint32(uint32_t *restrict nonnull dest, FILE *restrict nonnull stream);
+inline enum nbts_error
+nbts_parse_uint32(uint32_t *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	uint64_t result = 0;
+	enum nbts_error err = nbts_parse_uintn(&result, sizeof(*dest), stream);
+	if (!err) *dest = (uint32_t) result;
+	return err;
+}
+
 /// Reads one `uint64_t` from `stream` into `dest`, handling endian conversion.
-enum nbts_error nbts_parse_uint64(uint64_t *restrict nonnull dest, FILE *restrict nonnull stream);
+inline enum nbts_error
+nbts_parse_uint64(uint64_t *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	return nbts_parse_uintn(dest, sizeof(*dest), stream);
+}
 
 /// Reads one \ref nbts_type from `stream` into `dest`.
 ///
 /// Returns \ref NBTS_INVALID_ID if the value is out of range.
-enum nbts_error
-nbts_parse_typeid(enum nbts_type *restrict nonnull dest, FILE *restrict nonnull stream);
-
-/// Reads one \ref nbts_size from `stream` into `dest`.
-///
-/// Returns \ref NBTS_INVALID_SIZE if the value is negative.
-enum nbts_error nbts_parse_size(nbts_size *restrict nonnull dest, FILE *restrict nonnull stream);
+inline enum nbts_error
+nbts_parse_typeid(enum nbts_type *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	uint8_t result = 0;
+	enum nbts_error err = nbts_parse_uint8(&result, stream);
+	if (err) return err;
+	if (!(result < NBTS_TYPE_ENUM_SIZE)) return NBTS_INVALID_ID;
+	static_assert(sizeof(*dest) == sizeof(result));
+	memcpy(dest, &result, sizeof(result));
+	return NBTS_OK;
+}
 
 /// Reads one \ref nbts_strsize from `stream` into `dest`.
-enum nbts_error
-nbts_parse_strsize(nbts_strsize *restrict nonnull dest, FILE *restrict nonnull stream);
+inline enum nbts_error
+nbts_parse_strsize(nbts_strsize *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	return nbts_parse_uint16(dest, stream);
+}
 
 /// Reads one \ref nbts_byte from `stream` into `dest`.
-enum nbts_error nbts_parse_byte(nbts_byte *restrict nonnull dest, FILE *restrict nonnull stream);
+inline enum nbts_error
+nbts_parse_byte(nbts_byte *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	uint8_t result = 0;
+	enum nbts_error err = nbts_parse_uint8(&result, stream);
+	static_assert(sizeof(*dest) == sizeof(result));
+	if (!err) memcpy(dest, &result, sizeof(result));
+	return err;
+}
+
 /// Reads one \ref nbts_short from `stream` into `dest`.
-enum nbts_error nbts_parse_short(nbts_short *restrict nonnull dest, FILE *restrict nonnull stream);
+inline enum nbts_error
+nbts_parse_short(nbts_short *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	uint16_t result = 0;
+	enum nbts_error err = nbts_parse_uint16(&result, stream);
+	static_assert(sizeof(*dest) == sizeof(result));
+	if (!err) memcpy(dest, &result, sizeof(result));
+	return err;
+}
+
 /// Reads one \ref nbts_int from `stream` into `dest`.
-enum nbts_error nbts_parse_int(nbts_int *restrict nonnull dest, FILE *restrict nonnull stream);
+inline enum nbts_error
+nbts_parse_int(nbts_int *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	uint32_t result = 0;
+	enum nbts_error err = nbts_parse_uint32(&result, stream);
+	static_assert(sizeof(*dest) == sizeof(result));
+	if (!err) memcpy(dest, &result, sizeof(result));
+	return err;
+}
+
 /// Reads one \ref nbts_long from `stream` into `dest`.
-enum nbts_error nbts_parse_long(nbts_long *restrict nonnull dest, FILE *restrict nonnull stream);
+inline enum nbts_error
+nbts_parse_long(nbts_long *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	uint64_t result = 0;
+	enum nbts_error err = nbts_parse_uint64(&result, stream);
+	static_assert(sizeof(*dest) == sizeof(result));
+	if (!err) memcpy(dest, &result, sizeof(result));
+	return err;
+}
+
 /// Reads one \ref nbts_float from `stream` into `dest`.
-enum nbts_error nbts_parse_float(nbts_float *restrict nonnull dest, FILE *restrict nonnull stream);
+inline enum nbts_error
+nbts_parse_float(nbts_float *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	uint32_t result = 0;
+	enum nbts_error err = nbts_parse_uint32(&result, stream);
+	static_assert(sizeof(*dest) == sizeof(result));
+	if (!err) memcpy(dest, &result, sizeof(result));
+	return err;
+}
+
 /// Reads one \ref nbts_double from `stream` into `dest`.
-enum nbts_error
-nbts_parse_double(nbts_double *restrict nonnull dest, FILE *restrict nonnull stream);
+inline enum nbts_error
+nbts_parse_double(nbts_double *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	uint64_t result = 0;
+	enum nbts_error err = nbts_parse_uint64(&result, stream);
+	static_assert(sizeof(*dest) == sizeof(result));
+	if (!err) memcpy(dest, &result, sizeof(result));
+	return err;
+}
+
+/// Reads one \ref nbts_size from `stream` into `dest`.
+///
+/// Returns \ref NBTS_INVALID_SIZE if the value is negative.
+inline enum nbts_error
+nbts_parse_size(nbts_size *restrict nonnull dest, FILE *restrict nonnull stream)
+{
+	nbts_int result = 0;
+	enum nbts_error err = nbts_parse_int(&result, stream);
+	if (err) return err;
+	if (result < 0) return NBTS_INVALID_SIZE;
+	static_assert(sizeof(*dest) == sizeof(result));
+	memcpy(dest, &result, sizeof(result));
+	return NBTS_OK;
+}
 
 /// Reads a string of `size` \ref nbts_char from `stream` into `dest`.
 enum nbts_error
@@ -0,0 +1,584 @@
+#pragma once
+
+/// \file
+///
+/// \brief A header-only C++20 interface to NBTStreams.
+///
+/// Instead of a table of \ref nbts_handler_fn pointers, handlers are
+/// function objects passed as template arguments. The parser switches over
+/// the tag type in a function instantiated for the visitor, so the call to
+/// the handler is direct and can be inlined.
+///
+/// The input is an in-memory buffer. Values are passed to the visitor as
+///
+/// - \ref nbts_byte, \ref nbts_short, \ref nbts_int, \ref nbts_long,
+///   \ref nbts_float and \ref nbts_double for numbers,
+/// - `std::string_view` for strings, pointing into the buffer,
+/// - `std::span<nbts_byte const>` for byte arrays, pointing into the buffer,
+/// - \ref nbts::array_view for int and long arrays, which converts from the
+///   wire byte order on access,
+/// - \ref nbts::list_view and \ref nbts::compound_view for lists and
+///   compounds.
+///
+/// A visitor is called as `visitor(name, value)` and may return `void` or
+/// \ref nbts_error. Value types it cannot be called with are skipped, as are
+/// lists and compounds it does not descend into with `visit()`. Numbers are
+/// only passed to overloads taking exactly their type or `auto`, so an
+/// overload for \ref nbts_long does not receive every \ref nbts_int. Existing
+/// \ref nbts_handler modules can be used for any subtree by passing them to
+/// `visit()` instead of a visitor.
+///
+/// \code
+/// nbts::reader reader(data, size);
+/// auto err = nbts::parse_tag(reader, nbts::overloaded{
+///     [](std::string_view name, nbts_int x) { ... },
+///     [](std::string_view name, nbts::compound_view c) { return c.visit(...); },
+/// });
+/// \endcode
+
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+#ifndef restrict
+#define restrict __restrict
+#define NBTS_HPP_DEFINED_RESTRICT
+#endif
+
+extern "C" {
+#include <nbts/nbts.h>
+}
+
+#ifdef NBTS_HPP_DEFINED_RESTRICT
+#undef restrict
+#undef NBTS_HPP_DEFINED_RESTRICT
+#endif
+
+namespace nbts {
+
+/// Combines several function objects into one visitor.
+template <class... Fs>
+struct overloaded : Fs... {
+	using Fs::operator()...;
+};
+
+namespace detail {
+
+template <class T>
+using uint_of = std::conditional_t<
+	sizeof(T) == 1,
+	uint8_t,
+	std::conditional_t<
+		sizeof(T) == 2,
+		uint16_t,
+		std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>>;
+
+template <class U>
+constexpr U byteswap(U x) noexcept
+{
+	if constexpr (sizeof(U) == 1) return x;
+	else if constexpr (sizeof(U) == 2) return __builtin_bswap16(x);
+	else if constexpr (sizeof(U) == 4) return __builtin_bswap32(x);
+	else return __builtin_bswap64(x);
+}
+
+/// Loads one `T` in the NBT byte order from `src`.
+template <class T>
+T load(std::byte const *src) noexcept
+{
+	uint_of<T> x;
+	std::memcpy(&x, src, sizeof(x));
+	if constexpr (std::endian::native == std::endian::little) x = byteswap(x);
+	return std::bit_cast<T>(x);
+}
+
+} // namespace detail
+
+/// An array of `T` in the wire byte order.
+template <class T>
+class array_view {
+public:
+	using value_type = T;
+
+	array_view() = default;
+	explicit array_view(std::span<std::byte const> bytes) noexcept : bytes_(bytes) {}
+
+	std::size_t size() const noexcept { return bytes_.size() / sizeof(T); }
+	bool empty() const noexcept { return bytes_.empty(); }
+
+	/// Returns the element at `index`, converted to the native byte order.
+	T operator[](std::size_t index) const noexcept
+	{
+		return detail::load<T>(&bytes_[index * sizeof(T)]);
+	}
+
+	/// Returns the elements in the wire byte order.
+	std::span<std::byte const> bytes() const noexcept { return bytes_; }
+
+	/// Copies the first `dest.size()` elements into `dest`, converted to the
+	/// native byte order.
+	void copy_to(std::span<T> dest) const noexcept
+	{
+		for (std::size_t i = 0; i < dest.size(); ++i) dest[i] = (*this)[i];
+	}
+
+	class iterator {
+	public:
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+
+		iterator() = default;
+		iterator(std::byte const *pos) noexcept : pos_(pos) {}
+		T operator*() const noexcept { return detail::load<T>(pos_); }
+		iterator &operator++() noexcept
+		{
+			pos_ += sizeof(T);
+			return *this;
+		}
+		iterator operator++(int) noexcept
+		{
+			iterator old = *this;
+			pos_ += sizeof(T);
+			return old;
+		}
+		bool operator==(iterator const &) const = default;
+
+	private:
+		std::byte const *pos_ = nullptr;
+	};
+
+	iterator begin() const noexcept { return iterator(bytes_.data()); }
+	iterator end() const noexcept { return iterator(bytes_.data() + size() * sizeof(T)); }
+
+private:
+	std::span<std::byte const> bytes_;
+};
+
+/// A bounds checked read position in a buffer.
+class reader {
+public:
+	explicit reader(std::span<std::byte const> data) noexcept : data_(data) {}
+	reader(void const *data, std::size_t size) noexcept
+		: data_(static_cast<std::byte const *>(data), size)
+	{
+	}
+
+	std::size_t position() const noexcept { return position_; }
+	std::span<std::byte const> remaining() const noexcept { return data_.subspan(position_); }
+
+	/// Returns the next `size` bytes in `dest` and advances past them.
+	nbts_error take(std::size_t size, std::span<std::byte const> &dest) noexcept
+	{
+		if (size > data_.size() - position_) return NBTS_UNEXPECTED_EOF;
+		dest = data_.subspan(position_, size);
+		position_ += size;
+		return NBTS_OK;
+	}
+
+	nbts_error advance(std::size_t size) noexcept
+	{
+		if (size > data_.size() - position_) return NBTS_UNEXPECTED_EOF;
+		position_ += size;
+		return NBTS_OK;
+	}
+
+	/// Reads one number in the NBT byte order.
+	template <class T>
+	nbts_error read(T &dest) noexcept
+	{
+		if (sizeof(T) > data_.size() - position_) return NBTS_UNEXPECTED_EOF;
+		dest = detail::load<T>(&data_[position_]);
+		position_ += sizeof(T);
+		return NBTS_OK;
+	}
+
+	nbts_error read_type(nbts_type &dest) noexcept
+	{
+		uint8_t x = 0;
+		if (nbts_error err = read(x)) return err;
+		if (x >= NBTS_TYPE_ENUM_SIZE) return NBTS_INVALID_ID;
+		dest = static_cast<nbts_type>(x);
+		return NBTS_OK;
+	}
+
+	nbts_error read_size(std::size_t &dest) noexcept
+	{
+		nbts_size x = 0;
+		if (nbts_error err = read(x)) return err;
+		if (x < 0) return NBTS_INVALID_SIZE;
+		dest = static_cast<std::size_t>(x);
+		return NBTS_OK;
+	}
+
+	nbts_error read_name(std::string_view &dest) noexcept
+	{
+		nbts_strsize size = 0;
+		if (nbts_error err = read(size)) return err;
+		std::span<std::byte const> bytes;
+		if (nbts_error err = take(size, bytes)) return err;
+		dest = std::string_view(reinterpret_cast<char const *>(bytes.data()), bytes.size());
+		return NBTS_OK;
+	}
+
+	/// Advances past one payload of `type`.
+	nbts_error skip(nbts_type type) noexcept
+	{
+		switch (type) {
+		case NBTS_END: return NBTS_OK;
+		case NBTS_BYTE: return advance(sizeof(nbts_byte));
+		case NBTS_SHORT: return advance(sizeof(nbts_short));
+		case NBTS_INT: return advance(sizeof(nbts_int));
+		case NBTS_LONG: return advance(sizeof(nbts_long));
+		case NBTS_FLOAT: return advance(sizeof(nbts_float));
+		case NBTS_DOUBLE: return advance(sizeof(nbts_double));
+		case NBTS_STRING: {
+			nbts_strsize size = 0;
+			if (nbts_error err = read(size)) return err;
+			return advance(size);
+		}
+		case NBTS_BYTE_ARRAY: return skip_array(sizeof(nbts_byte));
+		case NBTS_INT_ARRAY: return skip_array(sizeof(nbts_int));
+		case NBTS_LONG_ARRAY: return skip_array(sizeof(nbts_long));
+		case NBTS_LIST: {
+			nbts_type element_type = NBTS_END;
+			std::size_t size = 0;
+			if (nbts_error err = read_type(element_type)) return err;
+			if (nbts_error err = read_size(size)) return err;
+			return skip_elements(element_type, size);
+		}
+		case NBTS_COMPOUND: return skip_children();
+		}
+		return NBTS_INVALID_ID;
+	}
+
+	/// Advances past `size` list elements of `type`.
+	nbts_error skip_elements(nbts_type type, std::size_t size) noexcept
+	{
+		switch (type) {
+		case NBTS_END: return NBTS_OK;
+		case NBTS_BYTE: return advance(size * sizeof(nbts_byte));
+		case NBTS_SHORT: return advance(size * sizeof(nbts_short));
+		case NBTS_INT: return advance(size * sizeof(nbts_int));
+		case NBTS_LONG: return advance(size * sizeof(nbts_long));
+		case NBTS_FLOAT: return advance(size * sizeof(nbts_float));
+		case NBTS_DOUBLE: return advance(size * sizeof(nbts_double));
+		default:
+			for (std::size_t i = 0; i < size; ++i)
+				if (nbts_error err = skip(type)) return err;
+			return NBTS_OK;
+		}
+	}
+
+	/// Advances past named tags until the next \ref NBTS_END tag inclusive.
+	nbts_error skip_children() noexcept
+	{
+		while (true) {
+			nbts_type type = NBTS_END;
+			if (nbts_error err = read_type(type)) return err;
+			if (type == NBTS_END) return NBTS_OK;
+			std::string_view name;
+			if (nbts_error err = read_name(name)) return err;
+			if (nbts_error err = skip(type)) return err;
+		}
+	}
+
+private:
+	nbts_error skip_array(std::size_t element_size) noexcept
+	{
+		std::size_t size = 0;
+		if (nbts_error err = read_size(size)) return err;
+		return advance(size * element_size);
+	}
+
+	std::span<std::byte const> data_;
+	std::size_t position_ = 0;
+};
+
+namespace detail {
+
+/// Parses the elements of a list or the children of a compound from the
+/// rest of the buffer of `r` with a C handler.
+template <class F>
+nbts_error visit_c(reader &r, F &&parse) noexcept
+{
+	std::span<std::byte const> rest = r.remaining();
+	if (rest.empty()) return NBTS_UNEXPECTED_EOF;
+
+	FILE *stream = fmemopen(const_cast<std::byte *>(rest.data()), rest.size(), "rb");
+	if (!stream) return NBTS_READ_ERR;
+	nbts_error err = parse(stream);
+	long position = ftell(stream);
+	fclose(stream);
+	if (err) return err;
+	if (position < 0) return NBTS_READ_ERR;
+	return r.advance(static_cast<std::size_t>(position));
+}
+
+} // namespace detail
+
+/// A list passed to a visitor.
+///
+/// If the visitor does not call \ref visit, the elements are skipped.
+class list_view {
+public:
+	list_view(reader &r, nbts_type element_type, std::size_t size, bool &consumed) noexcept
+		: reader_(&r), element_type_(element_type), size_(size), consumed_(&consumed)
+	{
+	}
+
+	nbts_type element_type() const noexcept { return element_type_; }
+	std::size_t size() const noexcept { return size_; }
+
+	/// Calls `visitor` with an empty name for each element.
+	template <class V>
+	nbts_error visit(V &&visitor);
+
+	/// Parses the elements with a C handler, as \ref nbts_parse_list would.
+	nbts_error visit(nbts_handler const *handler, void *userdata) noexcept
+	{
+		*consumed_ = true;
+		if (element_type_ == NBTS_END || !size_) return NBTS_OK;
+		return detail::visit_c(*reader_, [&](FILE *stream) {
+			return nbts_parse_list(element_type_, size_, stream, handler, userdata);
+		});
+	}
+
+private:
+	reader *reader_;
+	nbts_type element_type_;
+	std::size_t size_;
+	bool *consumed_;
+};
+
+/// A compound passed to a visitor.
+///
+/// If the visitor does not call \ref visit, the children are skipped.
+class compound_view {
+public:
+	compound_view(reader &r, bool &consumed) noexcept : reader_(&r), consumed_(&consumed) {}
+
+	/// Calls `visitor` with the name and value of each child.
+	template <class V>
+	nbts_error visit(V &&visitor);
+
+	/// Parses the children with a C handler, as \ref nbts_parse_compound
+	/// would.
+	nbts_error visit(nbts_handler const *handler, void *userdata) noexcept
+	{
+		*consumed_ = true;
+		return detail::visit_c(*reader_, [&](FILE *stream) {
+			return nbts_parse_compound(stream, handler, userdata);
+		});
+	}
+
+private:
+	reader *reader_;
+	bool *consumed_;
+};
+
+namespace detail {
+
+/// Converts only to `T`, to find out whether a function takes `T` without an
+/// implicit arithmetic conversion.
+template <class T>
+struct exactly {
+	template <class U>
+		requires std::same_as<U, T>
+	operator U() const noexcept;
+};
+
+/// Converts from a name, so that an overload taking it is worse than any
+/// overload taking the name as it is.
+struct any_name {
+	any_name(std::string_view) noexcept;
+};
+
+/// The result of \ref probe::operator().
+struct no_overload {};
+
+/// Adds an overload taking `T` to those of `V`.
+///
+/// A call with a name and a `T` selects an overload of `V` if it takes
+/// exactly `T` or is a template, is ambiguous if the best overload of `V`
+/// converts the `T`, and selects the added overload otherwise. Templates are
+/// only instantiated with `T`, unlike when calling `V` with \ref exactly.
+template <class V, class T>
+struct probe : V {
+	using V::operator();
+	no_overload operator()(any_name, T) const volatile;
+};
+
+/// Whether `visitor(name, value)` is called for values of type `T`.
+template <class V, class T>
+consteval bool accepts_value()
+{
+	if constexpr (!std::is_invocable_v<V &, std::string_view, T>) {
+		return false;
+	} else if constexpr (!std::is_arithmetic_v<T>) {
+		return true;
+	} else if constexpr (std::is_class_v<V> && !std::is_final_v<V>) {
+		using P = std::conditional_t<
+			std::is_const_v<V>,
+			probe<std::remove_const_t<V>, T> const,
+			probe<V, T>>;
+		if constexpr (std::is_invocable_v<P &, std::string_view, T>)
+			return !std::is_same_v<std::invoke_result_t<P &, std::string_view, T>, no_overload>;
+		else
+			return false;
+	} else {
+		return std::is_invocable_v<V &, std::string_view, exactly<T>>;
+	}
+}
+
+template <class V, class T>
+constexpr bool accepts = accepts_value<V, T>();
+
+template <class V, class T>
+nbts_error invoke(V &visitor, std::string_view name, T value)
+{
+	if constexpr (accepts<V, T>) {
+		using R = std::invoke_result_t<V &, std::string_view, T>;
+		if constexpr (std::is_void_v<R>) {
+			visitor(name, value);
+			return NBTS_OK;
+		} else {
+			return static_cast<nbts_error>(visitor(name, value));
+		}
+	} else {
+		return NBTS_OK;
+	}
+}
+
+template <class T, class V>
+nbts_error number(reader &r, std::string_view name, V &visitor)
+{
+	if constexpr (accepts<V, T>) {
+		T x{};
+		if (nbts_error err = r.read(x)) return err;
+		return invoke(visitor, name, x);
+	} else {
+		return r.advance(sizeof(T));
+	}
+}
+
+template <class T, class V>
+nbts_error array(reader &r, std::string_view name, V &visitor)
+{
+	std::size_t size = 0;
+	if (nbts_error err = r.read_size(size)) return err;
+	std::span<std::byte const> bytes;
+	if (nbts_error err = r.take(size * sizeof(T), bytes)) return err;
+
+	if constexpr (std::is_same_v<T, nbts_byte>) {
+		auto data = reinterpret_cast<nbts_byte const *>(bytes.data());
+		return invoke(visitor, name, std::span<nbts_byte const>(data, size));
+	} else {
+		return invoke(visitor, name, array_view<T>(bytes));
+	}
+}
+
+/// Parses one payload of `type`, dispatching to `visitor`.
+template <class V>
+nbts_error payload(reader &r, nbts_type type, std::string_view name, V &visitor)
+{
+	switch (type) {
+	case NBTS_END: return NBTS_OK;
+	case NBTS_BYTE: return number<nbts_byte>(r, name, visitor);
+	case NBTS_SHORT: return number<nbts_short>(r, name, visitor);
+	case NBTS_INT: return number<nbts_int>(r, name, visitor);
+	case NBTS_LONG: return number<nbts_long>(r, name, visitor);
+	case NBTS_FLOAT: return number<nbts_float>(r, name, visitor);
+	case NBTS_DOUBLE: return number<nbts_double>(r, name, visitor);
+	case NBTS_STRING: {
+		std::string_view value;
+		if (nbts_error err = r.read_name(value)) return err;
+		return invoke(visitor, name, value);
+	}
+	case NBTS_BYTE_ARRAY: return array<nbts_byte>(r, name, visitor);
+	case NBTS_INT_ARRAY: return array<nbts_int>(r, name, visitor);
+	case NBTS_LONG_ARRAY: return array<nbts_long>(r, name, visitor);
+	case NBTS_LIST: {
+		nbts_type element_type = NBTS_END;
+		std::size_t size = 0;
+		if (nbts_error err = r.read_type(element_type)) return err;
+		if (nbts_error err = r.read_size(size)) return err;
+
+		bool consumed = false;
+		if (nbts_error err = invoke(visitor, name, list_view(r, element_type, size, consumed)))
+			return err;
+		return consumed ? NBTS_OK : r.skip_elements(element_type, size);
+	}
+	case NBTS_COMPOUND: {
+		bool consumed = false;
+		if (nbts_error err = invoke(visitor, name, compound_view(r, consumed))) return err;
+		return consumed ? NBTS_OK : r.skip_children();
+	}
+	}
+	return NBTS_INVALID_ID;
+}
+
+} // namespace detail
+
+template <class V>
+nbts_error list_view::visit(V &&visitor)
+{
+	*consumed_ = true;
+	for (std::size_t i = 0; i < size_; ++i)
+		if (nbts_error err = detail::payload(*reader_, element_type_, {}, visitor)) return err;
+	return NBTS_OK;
+}
+
+template <class V>
+nbts_error compound_view::visit(V &&visitor)
+{
+	*consumed_ = true;
+	while (true) {
+		nbts_type type = NBTS_END;
+		if (nbts_error err = reader_->read_type(type)) return err;
+		if (type == NBTS_END) return NBTS_OK;
+
+		std::string_view name;
+		if (nbts_error err = reader_->read_name(name)) return err;
+		if (nbts_error err = detail::payload(*reader_, type, name, visitor)) return err;
+	}
+}
+
+/// Parses one named tag from `r`, calling `visitor` with its name and value.
+template <class V>
+nbts_error parse_tag(reader &r, V &&visitor)
+{
+	nbts_type type = NBTS_END;
+	if (nbts_error err = r.read_type(type)) return err;
+	if (type == NBTS_END) return NBTS_UNEXPECTED_END_TAG;
+
+	std::string_view name;
+	if (nbts_error err = r.read_name(name)) return err;
+	return detail::payload(r, type, name, visitor);
+}
+
+/// Parses one unnamed tag from `r`, calling `visitor` with an empty name and
+/// its value.
+template <class V>
+nbts_error parse_network_tag(reader &r, V &&visitor)
+{
+	nbts_type type = NBTS_END;
+	if (nbts_error err = r.read_type(type)) return err;
+	if (type == NBTS_END) return NBTS_UNEXPECTED_END_TAG;
+	return detail::payload(r, type, {}, visitor);
+}
+
+/// Parses one named tag from `r` with a C handler, as \ref nbts_parse_tag
+/// would.
+inline nbts_error parse_tag(reader &r, nbts_handler const *handler, void *userdata) noexcept
+{
+	return detail::visit_c(
+		r, [&](FILE *stream) { return nbts_parse_tag(stream, handler, userdata); });
+}
+
+} // namespace nbts
@@ -0,0 +1,125 @@
+#include <nbts/path.h>
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdlib.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+#define TRYF(EXPR)                                \
+	{                                             \
+		if ((EXPR) == EOF) return NBTS_WRITE_ERR; \
+	}
+
+struct nbts_path nbts_path_name(
+	struct nbts_path const *nullable parent, nbts_char const *nonnull name, size_t name_size)
+{
+	return (struct nbts_path){.parent = parent, .name = name, .name_size = name_size};
+}
+
+struct nbts_path nbts_path_index(struct nbts_path const *nullable parent, size_t index)
+{
+	return (struct nbts_path){.parent = parent, .index = index};
+}
+
+size_t nbts_path_depth(struct nbts_path const *nullable path)
+{
+	size_t depth = 0;
+	for (; path; path = path->parent) depth += 1;
+	return depth;
+}
+
+/// Returns whether `path` is a root tag without a name, which is left out of
+/// printed paths and optional in patterns.
+static bool is_unnamed_root(struct nbts_path const *restrict nonnull path)
+{
+	return !path->parent && path->name && !path->name_size;
+}
+
+enum nbts_error
+nbts_fprint_path(FILE *restrict nonnull ostream, struct nbts_path const *restrict nullable path)
+{
+	if (!path) return NBTS_OK;
+
+	TRY(nbts_fprint_path(ostream, path->parent));
+
+	if (!path->name) {
+		TRYF(fprintf(ostream, "[%zu]", path->index));
+		return NBTS_OK;
+	}
+
+	if (path->parent && !is_unnamed_root(path->parent)) TRYF(fputc('.', ostream));
+	if (fwrite(path->name, sizeof(*path->name), path->name_size, ostream) != path->name_size)
+		return NBTS_WRITE_ERR;
+	return NBTS_OK;
+}
+
+static char const *nullable match_name(
+	char const *restrict nonnull pattern, nbts_char const *restrict nonnull name, size_t name_size)
+{
+	if (pattern[0] == '*' && (!pattern[1] || pattern[1] == '.' || pattern[1] == '[')) {
+		return &pattern[1];
+	}
+
+	size_t i = 0;
+	for (; *pattern && *pattern != '.' && *pattern != '['; ++pattern, ++i) {
+		if (*pattern == '\\' && pattern[1]) ++pattern;
+		if (i == name_size || (nbts_char) *pattern != name[i]) return nullptr;
+	}
+	return i == name_size ? pattern : nullptr;
+}
+
+static char const *nullable match_index(char const *restrict nonnull pattern, size_t index)
+{
+	if (*pattern++ != '[') return nullptr;
+	if (pattern[0] == '*') return pattern[1] == ']' ? &pattern[2] : nullptr;
+	if (!isdigit((unsigned char) *pattern)) return nullptr;
+
+	char *end = nullptr;
+	unsigned long long value = strtoull(pattern, &end, 10);
+	if (*end != ']' || value != index) return nullptr;
+	return &end[1];
+}
+
+char const *nullable nbts_path_match_prefix(
+	char const *restrict nonnull pattern, struct nbts_path const *nullable path)
+{
+	if (!path) return pattern;
+
+	pattern = nbts_path_match_prefix(pattern, path->parent);
+	if (!pattern) return nullptr;
+
+	if (!path->name) return match_index(pattern, path->index);
+
+	if (is_unnamed_root(path)) {
+		char const *rest = match_name(pattern, path->name, path->name_size);
+		return rest ? rest : pattern;
+	}
+
+	if (path->parent) {
+		if (*pattern == '.') {
+			++pattern;
+		} else if (!is_unnamed_root(path->parent)) {
+			return nullptr;
+		}
+	}
+	return match_name(pattern, path->name, path->name_size);
+}
+
+bool nbts_path_match(char const *restrict nonnull pattern, struct nbts_path const *nullable path)
+{
+	char const *rest = nbts_path_match_prefix(pattern, path);
+	return rest && !*rest;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+/// \file
+///
+/// \brief Tag paths, identifying a tag by the names and list indices leading
+/// up to it.
+///
+/// A \ref nbts_path is a linked list running from a tag up to the root. Its
+/// nodes are meant to live on the stack of the functions descending into the
+/// tree, so building a path never allocates.
+
+#include <nbts/nbts.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// One segment of a tag path.
+///
+/// If `name` is `nullptr`, the segment refers to element `index` of a list.
+/// Otherwise it refers to the tag named by the `name_size` characters at
+/// `name`.
+struct nbts_path {
+	struct nbts_path const *nullable parent;
+	nbts_char const *nullable name;
+	size_t name_size;
+	size_t index;
+};
+
+/// Returns a path segment for the tag called `name` below `parent`.
+struct nbts_path nbts_path_name(
+	struct nbts_path const *nullable parent, nbts_char const *nonnull name, size_t name_size);
+
+/// Returns a path segment for list element `index` below `parent`.
+struct nbts_path nbts_path_index(struct nbts_path const *nullable parent, size_t index);
+
+/// Returns the number of segments in `path`.
+size_t nbts_path_depth(struct nbts_path const *nullable path);
+
+/// Writes `path` to `ostream`, in the form `a.b[3].c`.
+///
+/// If the root tag has no name, as in most files, it is left out and the path
+/// is written as `b[3].c`.
+enum nbts_error
+nbts_fprint_path(FILE *restrict nonnull ostream, struct nbts_path const *restrict nullable path);
+
+/// Returns whether `path` matches `pattern`.
+///
+/// Patterns have the form written by \ref nbts_fprint_path, starting with
+/// the name of the root tag. If the root tag has no name, the pattern may
+/// start with the name of its child, with or without a leading `.`. A name of
+/// `*` matches any name and an index of `[*]` matches any index. A backslash
+/// escapes the following character of a name, so names containing `.`, `[`
+/// or `*` can be matched.
+bool nbts_path_match(char const *restrict nonnull pattern, struct nbts_path const *nullable path);
+
+/// Matches `path` against the beginning of `pattern`.
+///
+/// Returns the part of `pattern` not consumed by `path`, or `nullptr` if
+/// `path` does not match the beginning of `pattern`. If the result is not
+/// empty, descendants of `path` may match `pattern`.
+char const *nullable nbts_path_match_prefix(
+	char const *restrict nonnull pattern, struct nbts_path const *nullable path);
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,340 @@
+#define _GNU_SOURCE
+
+#include <nbts/pipeline.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if NBTS_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+enum : size_t {
+	/// The largest buffer of the stream.
+	///
+	/// When glibc seeks a cookie stream outside of its buffer, it refills
+	/// the whole buffer, so every skip by the skip handler copies up to this
+	/// much. The buffer is kept small so that skipping stays cheap.
+	STREAM_BUFFER_SIZE = 4096,
+	/// The number of stream buffers kept behind the position of the stream.
+	///
+	/// glibc seeks to the start of a buffer-sized block and reads up to the
+	/// target, which can lie up to a buffer before the data already returned
+	/// to it.
+	HISTORY_BUFFERS = 2,
+};
+
+/// Returns the size of the buffer of the stream of `pipeline`, which is at
+/// most a block, so the history fits the ring.
+static size_t stream_buffer_size(struct nbts_pipeline const *restrict nonnull pipeline)
+{
+	return pipeline->block_size < STREAM_BUFFER_SIZE ? pipeline->block_size : STREAM_BUFFER_SIZE;
+}
+
+static bool is_power_of_two(size_t x) { return x && !(x & (x - 1)); }
+
+static void wait_until(
+	struct nbts_pipeline *restrict nonnull pipeline,
+	bool (*nonnull ready)(struct nbts_pipeline *restrict nonnull pipeline))
+{
+	mtx_lock(&pipeline->lock);
+	atomic_fetch_add(&pipeline->waiting, 1);
+	// Pairs with the fence in wake(): either this sees the progress of the
+	// other side, or the other side sees this waiting and signals.
+	atomic_thread_fence(memory_order_seq_cst);
+	while (!ready(pipeline)) cnd_wait(&pipeline->wake, &pipeline->lock);
+	atomic_fetch_sub(&pipeline->waiting, 1);
+	mtx_unlock(&pipeline->lock);
+}
+
+static void wake(struct nbts_pipeline *restrict nonnull pipeline)
+{
+	atomic_thread_fence(memory_order_seq_cst);
+	if (!atomic_load_explicit(&pipeline->waiting, memory_order_relaxed)) return;
+	mtx_lock(&pipeline->lock);
+	cnd_broadcast(&pipeline->wake);
+	mtx_unlock(&pipeline->lock);
+}
+
+// Producer side, run by the thread.
+
+static bool writable(struct nbts_pipeline *restrict nonnull pipeline)
+{
+	struct nbts_ring_segment segment;
+	nbts_ring_reserve(&pipeline->ring, &segment);
+	return segment.size || atomic_load_explicit(&pipeline->closed, memory_order_acquire);
+}
+
+/// Reserves up to a block of free space in the ring in `segment`.
+///
+/// Returns `false` if the pipeline has been closed instead.
+static bool reserve_block(
+	struct nbts_pipeline *restrict nonnull pipeline,
+	struct nbts_ring_segment *restrict nonnull segment)
+{
+	while (1) {
+		if (atomic_load_explicit(&pipeline->closed, memory_order_acquire)) return false;
+		nbts_ring_reserve(&pipeline->ring, segment);
+		if (segment->size) break;
+		wait_until(pipeline, &writable);
+	}
+	if (segment->size > pipeline->block_size) segment->size = pipeline->block_size;
+	return true;
+}
+
+static void commit_block(struct nbts_pipeline *restrict nonnull pipeline, size_t size)
+{
+	if (!size) return;
+	nbts_ring_commit(&pipeline->ring, size);
+	wake(pipeline);
+}
+
+static enum nbts_error copy_source(struct nbts_pipeline *restrict nonnull pipeline)
+{
+	struct nbts_ring_segment segment;
+	while (reserve_block(pipeline, &segment)) {
+		size_t n = fread(segment.data, 1, segment.size, pipeline->source);
+		commit_block(pipeline, n);
+		if (n < segment.size) return ferror(pipeline->source) ? NBTS_READ_ERR : NBTS_OK;
+	}
+	return NBTS_OK;
+}
+
+#if NBTS_WITH_ZLIB
+
+static enum nbts_error inflate_source(struct nbts_pipeline *restrict nonnull pipeline)
+{
+	int window_bits = pipeline->format == NBTS_COMPRESSION_GZIP ? 16 + MAX_WBITS : MAX_WBITS;
+	z_stream z = {};
+	if (inflateInit2(&z, window_bits) != Z_OK) return NBTS_ALLOC_ERR;
+
+	enum nbts_error err = NBTS_OK;
+	struct nbts_ring_segment segment;
+	while (reserve_block(pipeline, &segment)) {
+		if (!z.avail_in) {
+			uint8_t *input = pipeline->buffers;
+			size_t n = fread(input, 1, pipeline->block_size, pipeline->source);
+			if (!n) {
+				err = ferror(pipeline->source) ? NBTS_READ_ERR : NBTS_UNEXPECTED_EOF;
+				break;
+			}
+			z.next_in = input;
+			z.avail_in = n;
+		}
+
+		z.next_out = segment.data;
+		z.avail_out = segment.size;
+		int ret = inflate(&z, Z_NO_FLUSH);
+		commit_block(pipeline, segment.size - z.avail_out);
+
+		if (ret == Z_STREAM_END) break;
+		if (ret == Z_MEM_ERROR) err = NBTS_ALLOC_ERR;
+		if (ret == Z_DATA_ERROR || ret == Z_NEED_DICT || ret == Z_STREAM_ERROR) {
+			err = NBTS_COMPRESSION_ERR;
+		}
+		if (err) break;
+	}
+
+	inflateEnd(&z);
+	return err;
+}
+
+#endif
+
+static int run(void *arg)
+{
+	struct nbts_pipeline *pipeline = arg;
+	switch (pipeline->format) {
+#if NBTS_WITH_ZLIB
+	case NBTS_COMPRESSION_GZIP:
+	case NBTS_COMPRESSION_ZLIB: pipeline->err = inflate_source(pipeline); break;
+#endif
+	default: pipeline->err = copy_source(pipeline); break;
+	}
+
+	atomic_store_explicit(&pipeline->done, true, memory_order_release);
+	wake(pipeline);
+	return 0;
+}
+
+// Consumer side, run by the stream.
+
+/// Returns the number of committed bytes after the position of the stream.
+static size_t readable_size(struct nbts_pipeline *restrict nonnull pipeline)
+{
+	return atomic_load_explicit(&pipeline->ring.head, memory_order_acquire) - pipeline->position;
+}
+
+static bool readable(struct nbts_pipeline *restrict nonnull pipeline)
+{
+	return readable_size(pipeline) || atomic_load_explicit(&pipeline->done, memory_order_acquire);
+}
+
+/// Waits for data after the position of the stream and returns its size,
+/// or `0` at the end of the output.
+static size_t wait_readable(struct nbts_pipeline *restrict nonnull pipeline)
+{
+	while (1) {
+		bool done = atomic_load_explicit(&pipeline->done, memory_order_acquire);
+		size_t size = readable_size(pipeline);
+		if (size || done) return size;
+		wait_until(pipeline, &readable);
+	}
+}
+
+/// Hands the data more than `HISTORY_BUFFERS` stream buffers behind the
+/// position of the stream back to the thread.
+static void release(struct nbts_pipeline *restrict nonnull pipeline)
+{
+	size_t history = HISTORY_BUFFERS * stream_buffer_size(pipeline);
+	size_t tail = atomic_load_explicit(&pipeline->ring.tail, memory_order_relaxed);
+	if (pipeline->position - tail <= history) return;
+	nbts_ring_consume(&pipeline->ring, pipeline->position - history - tail);
+	wake(pipeline);
+}
+
+static ssize_t pipeline_read(void *cookie, char *buffer, size_t size)
+{
+	struct nbts_pipeline *pipeline = cookie;
+	size_t available = wait_readable(pipeline);
+	if (!available) return pipeline->err ? -1 : 0;
+	if (size > available) size = available;
+
+	size_t mask = pipeline->ring.capacity - 1;
+	for (size_t done = 0; done < size;) {
+		size_t offset = pipeline->position & mask;
+		size_t n = pipeline->ring.capacity - offset;
+		if (n > size - done) n = size - done;
+		memcpy(&buffer[done], &pipeline->ring.data[offset], n);
+		pipeline->position += n;
+		done += n;
+	}
+
+	release(pipeline);
+	return (ssize_t) size;
+}
+
+static int pipeline_seek(void *cookie, off64_t *offset, int whence)
+{
+	struct nbts_pipeline *pipeline = cookie;
+
+	int64_t base = 0;
+	switch (whence) {
+	case SEEK_SET: base = 0; break;
+	case SEEK_CUR: base = (int64_t) pipeline->position; break;
+	default: return -1;
+	}
+
+	int64_t position = base + *offset;
+	size_t tail = atomic_load_explicit(&pipeline->ring.tail, memory_order_relaxed);
+	if (position < 0 || (uint64_t) position < tail) return -1;
+
+	// Seeking forward discards the data in between as it arrives.
+	while (pipeline->position < (uint64_t) position) {
+		size_t available = wait_readable(pipeline);
+		if (!available) return -1;
+		size_t skip = (uint64_t) position - pipeline->position;
+		pipeline->position += skip < available ? skip : available;
+		release(pipeline);
+	}
+
+	pipeline->position = position;
+	*offset = position;
+	return 0;
+}
+
+// NOLINTBEGIN(bugprone-easily-swappable-parameters)
+
+enum nbts_error nbts_pipeline_open(
+	struct nbts_pipeline *restrict nonnull pipeline,
+	FILE *restrict nonnull source,
+	enum nbts_compression format,
+	size_t block_size,
+	size_t blocks)
+{
+	*pipeline = (struct nbts_pipeline){
+		.source = source,
+		.format = format,
+		.block_size = block_size,
+	};
+	atomic_init(&pipeline->waiting, 0);
+	atomic_init(&pipeline->done, false);
+	atomic_init(&pipeline->closed, false);
+
+	if (!is_power_of_two(block_size) || !is_power_of_two(blocks)) return NBTS_INVALID_SIZE;
+	if (blocks <= HISTORY_BUFFERS || blocks > SIZE_MAX / block_size) return NBTS_INVALID_SIZE;
+
+	switch (format) {
+#if NBTS_WITH_ZLIB
+	case NBTS_COMPRESSION_GZIP:
+	case NBTS_COMPRESSION_ZLIB:
+#endif
+	case NBTS_COMPRESSION_NONE: break;
+	default: return NBTS_UNSUPPORTED;
+	}
+
+	uint8_t *data = malloc(block_size * blocks);
+	if (!data) return NBTS_ALLOC_ERR;
+	(void) nbts_ring_init(&pipeline->ring, data, block_size * blocks);
+
+	pipeline->buffers = malloc(block_size + stream_buffer_size(pipeline));
+	if (!pipeline->buffers) goto free_buffers;
+
+	if (mtx_init(&pipeline->lock, mtx_plain) != thrd_success) goto free_buffers;
+	if (cnd_init(&pipeline->wake) != thrd_success) goto destroy_lock;
+
+	cookie_io_functions_t io = {.read = &pipeline_read, .seek = &pipeline_seek};
+	pipeline->stream = fopencookie(pipeline, "rb", io);
+	if (!pipeline->stream) goto destroy_wake;
+	// glibc ignores the size unless the buffer is given, and the size bounds
+	// how far it seeks back.
+	char *buffer = (char *) &pipeline->buffers[block_size];
+	if (setvbuf(pipeline->stream, buffer, _IOFBF, stream_buffer_size(pipeline))) {
+		goto close_stream;
+	}
+
+	if (thrd_create(&pipeline->thread, &run, pipeline) == thrd_success) return NBTS_OK;
+
+close_stream:
+	fclose(pipeline->stream);
+	pipeline->stream = nullptr;
+destroy_wake:
+	cnd_destroy(&pipeline->wake);
+destroy_lock:
+	mtx_destroy(&pipeline->lock);
+free_buffers:
+	free(pipeline->buffers);
+	free(data);
+	pipeline->buffers = nullptr;
+	return NBTS_ALLOC_ERR;
+}
+
+// NOLINTEND(bugprone-easily-swappable-parameters)
+
+enum nbts_error nbts_pipeline_close(struct nbts_pipeline *restrict nonnull pipeline)
+{
+	atomic_store_explicit(&pipeline->closed, true, memory_order_release);
+	wake(pipeline);
+	thrd_join(pipeline->thread, nullptr);
+
+	fclose(pipeline->stream);
+	pipeline->stream = nullptr;
+	cnd_destroy(&pipeline->wake);
+	mtx_destroy(&pipeline->lock);
+	free(pipeline->ring.data);
+	free(pipeline->buffers);
+	pipeline->buffers = nullptr;
+	return pipeline->err;
+}
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,113 @@
+#pragma once
+
+/// \file
+///
+/// \brief Decompressing a stream on a separate thread while it is parsed.
+///
+/// Inflating and parsing a large compressed file take comparable time, but
+/// \ref nbts_decompress runs them one after the other. A \ref nbts_pipeline
+/// instead starts a thread that reads the compressed input and inflates it
+/// block by block into a \ref nbts_ring, while `pipeline->stream` reads the
+/// decompressed data out of the ring on the calling thread. The whole run
+/// then takes about as long as the slower of the two.
+///
+/// The ring is allocated once when the pipeline is opened, and its blocks
+/// are reused for the whole input. The threads only synchronize through the
+/// counters of the ring, and only block on a condition variable while the
+/// ring is full or empty.
+///
+/// The stream can be skipped forward, as \ref nbts_skip_handler does, but
+/// only seeks back a few KiB. Its buffer is smaller than a block, since
+/// glibc refills the whole buffer on every skip.
+
+#include <nbts/compression.h>
+#include <nbts/nbts.h>
+#include <nbts/ring.h>
+
+#include <stdatomic.h>
+#include <threads.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// Default sizes for \ref nbts_pipeline_open, giving a 1 MiB ring.
+enum : size_t {
+	NBTS_PIPELINE_BLOCK_SIZE = 64 * 1024,
+	NBTS_PIPELINE_BLOCKS = 16,
+};
+
+/// A decompression thread and the stream reading its output.
+///
+/// The pipeline is referenced by its thread and stream, so it must not be
+/// moved while it is open.
+struct nbts_pipeline {
+	/// The stream over the decompressed data.
+	FILE *nullable stream;
+
+	/// The compressed input, only read by the thread.
+	FILE *nonnull source;
+	enum nbts_compression format;
+	/// The size of the blocks inflated at a time.
+	size_t block_size;
+	/// The buffer of the compressed input, `block_size` bytes, followed by
+	/// the smaller buffer of `stream`.
+	uint8_t *nullable buffers;
+
+	/// The decompressed data. Bytes are released to the thread two stream
+	/// buffers behind the position of `stream`, so short seeks back can be
+	/// served.
+	struct nbts_ring ring;
+	/// The offset in the decompressed data of the next byte returned to
+	/// `stream`.
+	size_t position;
+
+	thrd_t thread;
+	/// Guards waiting on `wake`.
+	mtx_t lock;
+	/// Signalled when either side makes progress while the other waits.
+	cnd_t wake;
+	/// The number of threads waiting on `wake`.
+	_Atomic unsigned waiting;
+	/// Set by the thread after it has committed all of its output.
+	_Atomic bool done;
+	/// Set by \ref nbts_pipeline_close to stop the thread early.
+	_Atomic bool closed;
+	/// The result of the thread, valid once `done` is set.
+	enum nbts_error err;
+};
+
+/// Starts decompressing `source` in `format` on a new thread and opens
+/// `pipeline->stream` on the output.
+///
+/// The output is buffered in a ring of `blocks` blocks of `block_size`
+/// bytes. Both must be powers of two and `blocks` must be at least `4`,
+/// otherwise \ref NBTS_INVALID_SIZE is returned. gzip and zlib need zlib,
+/// and \ref NBTS_COMPRESSION_NONE only moves the reading to the thread;
+/// other formats yield \ref NBTS_UNSUPPORTED.
+///
+/// On success, the pipeline must be closed with \ref nbts_pipeline_close,
+/// and `source` must stay open until then.
+enum nbts_error nbts_pipeline_open(
+	struct nbts_pipeline *restrict nonnull pipeline,
+	FILE *restrict nonnull source,
+	enum nbts_compression format,
+	size_t block_size,
+	size_t blocks);
+
+/// Stops the thread of `pipeline`, closes its stream and frees its
+/// resources.
+///
+/// Returns the error the thread ran into, if any. An error makes reads from
+/// the stream fail, so a parser only sees \ref NBTS_READ_ERR or
+/// \ref NBTS_UNEXPECTED_EOF, while this returns the cause, such as
+/// \ref NBTS_COMPRESSION_ERR. Closing the pipeline before the input is
+/// consumed is not an error.
+enum nbts_error nbts_pipeline_close(struct nbts_pipeline *restrict nonnull pipeline);
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,129 @@
+#include <nbts/pool.h>
+
+#include <unistd.h>
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <threads.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// A range of job indices packed as `begin << 32 | end`.
+///
+/// Packing both bounds into one word lets the owner and thieves update the
+/// range with a single compare-and-swap.
+typedef _Atomic uint64_t range;
+
+struct worker {
+	alignas(64) range range;
+	struct pool *nonnull pool;
+	size_t index;
+};
+
+struct pool {
+	struct worker *nonnull workers;
+	size_t workers_size;
+	nbts_pool_fn *nonnull fn;
+	void *nullable userdata;
+};
+
+static inline uint64_t pack(uint32_t begin, uint32_t end) { return (uint64_t) begin << 32 | end; }
+static inline uint32_t range_begin(uint64_t r) { return r >> 32; }
+static inline uint32_t range_end(uint64_t r) { return r & 0xFFFFFFFFU; }
+
+size_t nbts_pool_threads(size_t threads)
+{
+	if (threads) return threads;
+	long online = sysconf(_SC_NPROCESSORS_ONLN);
+	return online > 0 ? (size_t) online : 1;
+}
+
+static bool pop(struct worker *restrict nonnull worker, uint32_t *restrict nonnull dest)
+{
+	uint64_t r = atomic_load_explicit(&worker->range, memory_order_relaxed);
+	while (range_begin(r) < range_end(r)) {
+		uint64_t next = pack(range_begin(r) + 1, range_end(r));
+		if (atomic_compare_exchange_weak(&worker->range, &r, next)) {
+			*dest = range_begin(r);
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool steal(struct worker *restrict nonnull worker)
+{
+	struct pool *pool = worker->pool;
+	for (size_t n = 1; n < pool->workers_size; ++n) {
+		struct worker *victim = &pool->workers[(worker->index + n) % pool->workers_size];
+
+		uint64_t r = atomic_load_explicit(&victim->range, memory_order_relaxed);
+		while (range_begin(r) < range_end(r)) {
+			uint32_t half = (range_end(r) - range_begin(r) + 1) / 2;
+			uint32_t split = range_end(r) - half;
+			if (atomic_compare_exchange_weak(&victim->range, &r, pack(range_begin(r), split))) {
+				// Only the owner refills its empty range, so a plain store
+				// cannot race with another refill.
+				atomic_store(&worker->range, pack(split, range_end(r)));
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+static int work(void *arg)
+{
+	struct worker *worker = arg;
+	struct pool *pool = worker->pool;
+
+	do {
+		uint32_t index = 0;
+		while (pop(worker, &index)) pool->fn(pool->userdata, worker->index, index);
+	} while (steal(worker));
+
+	return 0;
+}
+
+enum nbts_error
+nbts_pool_run(size_t count, size_t threads, nbts_pool_fn *nonnull fn, void *nullable userdata)
+{
+	if (count > UINT32_MAX) return NBTS_LIMIT_EXCEEDED;
+
+	threads = nbts_pool_threads(threads);
+	if (threads > count) threads = count ? count : 1;
+
+	struct worker *workers = aligned_alloc(alignof(struct worker), threads * sizeof(*workers));
+	thrd_t *thrds = malloc(threads * sizeof(*thrds));
+	if (!workers || !thrds) {
+		free(workers);
+		free(thrds);
+		return NBTS_ALLOC_ERR;
+	}
+
+	struct pool pool = {.workers = workers, .workers_size = threads, .fn = fn, .userdata = userdata};
+	for (size_t i = 0; i < threads; ++i) {
+		workers[i].pool = &pool;
+		workers[i].index = i;
+		atomic_init(&workers[i].range, pack(count * i / threads, count * (i + 1) / threads));
+	}
+
+	// Threads that fail to start leave their range to be stolen by the others.
+	size_t started = 1;
+	for (; started < threads; ++started) {
+		if (thrd_create(&thrds[started], &work, &workers[started]) != thrd_success) break;
+	}
+
+	work(&workers[0]);
+	for (size_t i = 1; i < started; ++i) thrd_join(thrds[i], nullptr);
+
+	free(thrds);
+	free(workers);
+	return NBTS_OK;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+/// \file
+///
+/// \brief A work-stealing thread pool for running many independent jobs.
+///
+/// The jobs `[0, count)` are split into one contiguous range per thread.
+/// Each thread works through its own range from the front and, once it runs
+/// dry, steals half of the remaining range of another thread from the back.
+/// Jobs of similar cost thus rarely move between threads, while skewed
+/// workloads are still balanced.
+
+#include <nbts/nbts.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// The type of a job run by \ref nbts_pool_run.
+///
+/// `thread` is the index of the calling thread, below the thread count
+/// returned by \ref nbts_pool_threads, and can be used to select per-thread
+/// state without synchronization.
+typedef void nbts_pool_fn(void *nullable userdata, size_t thread, size_t index);
+
+/// Returns the number of threads \ref nbts_pool_run uses when asked for
+/// `threads` threads.
+///
+/// A value of `0` selects the number of online processors.
+size_t nbts_pool_threads(size_t threads);
+
+/// Calls `fn` with `userdata` for every index in `[0, count)` on `threads`
+/// threads, including the calling thread, and waits for all calls to return.
+///
+/// Returns \ref NBTS_LIMIT_EXCEEDED if `count` does not fit into 32 bits.
+enum nbts_error
+nbts_pool_run(size_t count, size_t threads, nbts_pool_fn *nonnull fn, void *nullable userdata);
+
+#undef nonnull
+#undef nullable
@@ -1,4 +1,5 @@
 #include <nbts/print.h>
+#include <nbts/probe.h>
 
 #include <inttypes.h>
 #include <string.h>
@@ -203,7 +204,7 @@ enum nbts_error nbts_print_handle_int_array(
 
 	nbts_size array_size = 0;
 	TRY(nbts_parse_size(&array_size, stream));
-	TRY(nbts_fprint_byte_array(data->ostream, stream, array_size));
+	TRY(nbts_fprint_int_array(data->ostream, stream, array_size));
 
 	data->index += 1;
 	return NBTS_OK;
@@ -218,13 +219,13 @@ enum nbts_error nbts_print_handle_long_array(
 
 	nbts_size array_size = 0;
 	TRY(nbts_parse_size(&array_size, stream));
-	TRY(nbts_fprint_byte_array(data->ostream, stream, array_size));
+	TRY(nbts_fprint_long_array(data->ostream, stream, array_size));
 
 	data->index += 1;
 	return NBTS_OK;
 }
 
-enum nbts_error nbts_print_handle_list(
+static enum nbts_error print_list(
 	struct nbts_print_handler_data *restrict nonnull data,
 	nbts_strsize name_size,
 	FILE *restrict nonnull stream)
@@ -250,7 +251,21 @@ enum nbts_error nbts_print_handle_list(
 	return NBTS_OK;
 }
 
-enum nbts_error nbts_print_handle_compound(
+enum nbts_error nbts_print_handle_list(
+	struct nbts_print_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	bool traced = NBTS_PROBED(print);
+	if (traced) NBTS_PROBE(print__entry, NBTS_LIST, NBTS_PROBE_DEPTH(), NBTS_PROBE_OFFSET(stream));
+	enum nbts_error err = print_list(data, name_size, stream);
+	if (traced) {
+		NBTS_PROBE(print__return, NBTS_LIST, NBTS_PROBE_DEPTH(), NBTS_PROBE_OFFSET(stream), err);
+	}
+	return err;
+}
+
+static enum nbts_error print_compound(
 	struct nbts_print_handler_data *restrict nonnull data,
 	nbts_strsize name_size,
 	FILE *restrict nonnull stream)
@@ -270,6 +285,22 @@ enum nbts_error nbts_print_handle_compound(
 	return NBTS_OK;
 }
 
+enum nbts_error nbts_print_handle_compound(
+	struct nbts_print_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	bool traced = NBTS_PROBED(print);
+	if (traced) {
+		NBTS_PROBE(print__entry, NBTS_COMPOUND, NBTS_PROBE_DEPTH(), NBTS_PROBE_OFFSET(stream));
+	}
+	enum nbts_error err = print_compound(data, name_size, stream);
+	if (traced) {
+		NBTS_PROBE(
+			print__return, NBTS_COMPOUND, NBTS_PROBE_DEPTH(), NBTS_PROBE_OFFSET(stream), err);
+	}
+	return err;
+}
 
 enum nbts_error nbts_fprint_bool(FILE *restrict nonnull stream, nbts_byte x)
 {
@@ -1,3 +1,4 @@
+#include <nbts/error.h>
 #include <nbts/nbts.h>
 #include <nbts/print.h>
 
@@ -7,8 +8,14 @@ int main()
 {
 	int err = 0;
 
+	struct nbts_error_context ctx;
 	struct nbts_print_handler_data data = nbts_print_handler_data(stdout);
-	if ((err = nbts_parse_tag(stdin, &nbts_print_handler, &data))) goto end;
+	if ((err = nbts_parse_tag_ctx(stdin, &nbts_print_handler, &data, &ctx))) {
+		fflush(stdout);
+		fprintf(stderr, "\nerror %d at offset %lld", err, (long long) ctx.offset);
+		fprintf(stderr, ctx.depth ? " in %s\n" : "\n", ctx.path);
+		goto end;
+	}
 	if ((err = (fputc('\n', stdout) < 0) * NBTS_WRITE_ERR)) goto end;
 
 end:
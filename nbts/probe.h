@@ -0,0 +1,72 @@
+#pragma once
+
+/// \file
+///
+/// \brief Static tracepoints for profiling the parser in production.
+///
+/// When built with `NBTS_WITH_USDT`, the library contains SystemTap-style
+/// USDT probes of the provider `nbts`, which tools like bpftrace can attach
+/// to without rebuilding:
+///
+/// - `tag__entry(type, depth, offset)` and
+///   `tag__return(type, depth, offset, err)` around the payload of every
+///   named tag parsed by \ref nbts_parse_tag and \ref nbts_parse_compound.
+/// - `compound__entry(depth, offset)` and
+///   `compound__return(depth, offset, err)` around
+///   \ref nbts_parse_compound.
+/// - `list__entry(type, size, depth, offset)` and
+///   `list__return(type, size, depth, offset, err)` around
+///   \ref nbts_parse_list.
+/// - `print__entry(type, depth, offset)` and
+///   `print__return(type, depth, offset, err)` around every list and
+///   compound printed by \ref nbts_print_handler.
+///
+/// `depth` is the number of lists and compounds being parsed on the calling
+/// thread and `offset` is the position of the input stream, or `-1` if it
+/// cannot tell. Every probe has a semaphore, so both are only computed
+/// while a tracer is attached. Without `NBTS_WITH_USDT`, the probes compile
+/// to nothing.
+///
+/// This header is internal to the library.
+
+#if NBTS_WITH_USDT
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+extern thread_local unsigned nbts_probe_depth;
+
+extern unsigned short nbts_tag__entry_semaphore;
+extern unsigned short nbts_tag__return_semaphore;
+extern unsigned short nbts_compound__entry_semaphore;
+extern unsigned short nbts_compound__return_semaphore;
+extern unsigned short nbts_list__entry_semaphore;
+extern unsigned short nbts_list__return_semaphore;
+extern unsigned short nbts_print__entry_semaphore;
+extern unsigned short nbts_print__return_semaphore;
+
+/// Whether a tracer is attached to the entry or return probe of `NAME`.
+#define NBTS_PROBED(NAME) \
+	__builtin_expect(nbts_##NAME##__entry_semaphore | nbts_##NAME##__return_semaphore, 0)
+
+/// Whether a tracer is attached to any probe, so the depth must be tracked.
+#define NBTS_PROBING() \
+	(NBTS_PROBED(tag) | NBTS_PROBED(compound) | NBTS_PROBED(list) | NBTS_PROBED(print))
+
+#define NBTS_PROBE(NAME, ...)  STAP_PROBEV(nbts, NAME, __VA_ARGS__)
+#define NBTS_PROBE_ENTER()     (++nbts_probe_depth)
+#define NBTS_PROBE_LEAVE()     (--nbts_probe_depth)
+#define NBTS_PROBE_DEPTH()     nbts_probe_depth
+#define NBTS_PROBE_OFFSET(STREAM) ((int64_t) ftello(STREAM))
+
+#else
+
+#define NBTS_PROBED(NAME)         false
+#define NBTS_PROBING()            false
+#define NBTS_PROBE(NAME, ...)     ((void) 0)
+#define NBTS_PROBE_ENTER()        ((void) 0)
+#define NBTS_PROBE_LEAVE()        ((void) 0)
+#define NBTS_PROBE_DEPTH()        0u
+#define NBTS_PROBE_OFFSET(STREAM) INT64_C(-1)
+
+#endif
@@ -0,0 +1,499 @@
+#include <nbts/pool.h>
+#include <nbts/region.h>
+#include <nbts/write.h>
+
+#include <endian.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+enum : size_t {
+	/// The number of sectors taken up by the header.
+	HEADER_SECTORS = 2,
+	/// The size of the length and compression type before each chunk.
+	CHUNK_HEADER_SIZE = sizeof(uint32_t) + sizeof(uint8_t),
+	/// The largest number of sectors a chunk can occupy in the file.
+	MAX_CHUNK_SECTORS = 255,
+	/// The largest sector offset a location can hold.
+	MAX_SECTOR_OFFSET = (1 << 24) - 1,
+	/// The number of chunks along each side of a region.
+	REGION_WIDTH = 32,
+};
+
+/// The flag in the compression type marking an external chunk.
+enum : uint8_t { EXTERNAL = 0x80 };
+
+// NOLINTBEGIN(bugprone-easily-swappable-parameters)
+
+struct nbts_region_options nbts_region_options(enum nbts_compression compression)
+{
+	return (struct nbts_region_options){
+		.compression = compression,
+		.level = NBTS_COMPRESSION_DEFAULT_LEVEL,
+	};
+}
+
+static uint32_t load32be(uint8_t const *nonnull p)
+{
+	uint32_t x = 0;
+	memcpy(&x, p, sizeof(x));
+	return be32toh(x);
+}
+
+/// Stores the path of the external file of the chunk at `index` of the
+/// region file at `region_path` in `dest`.
+static enum nbts_error
+external_path(char *restrict nonnull dest, char const *restrict nonnull region_path, size_t index)
+{
+	char const *slash = strrchr(region_path, '/');
+	char const *name = slash ? slash + 1 : region_path;
+	int dir_size = (int) (name - region_path);
+
+	int x = 0;
+	int z = 0;
+	int end = 0;
+	if (sscanf(name, "r.%d.%d.mca%n", &x, &z, &end) != 2 || name[end]) return NBTS_UNSUPPORTED;
+
+	int chunk_x = x * REGION_WIDTH + (int) (index % REGION_WIDTH);
+	int chunk_z = z * REGION_WIDTH + (int) (index / REGION_WIDTH);
+	int n = snprintf(dest, PATH_MAX, "%.*sc.%d.%d.mcc", dir_size, region_path, chunk_x, chunk_z);
+	if (n < 0 || n >= PATH_MAX) return NBTS_LIMIT_EXCEEDED;
+	return NBTS_OK;
+}
+
+static enum nbts_error
+read_file(struct nbts_buffer *restrict nonnull dest, char const *restrict nonnull path)
+{
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) return NBTS_READ_ERR;
+
+	enum nbts_error err = NBTS_OK;
+	struct stat st;
+	if (fstat(fd, &st) == -1) err = NBTS_READ_ERR;
+	if (!err) err = nbts_buffer_reserve(dest, st.st_size);
+
+	dest->size = 0;
+	while (!err && dest->size < (size_t) st.st_size) {
+		ssize_t n = read(fd, &dest->data[dest->size], st.st_size - dest->size);
+		if (n == -1) err = NBTS_READ_ERR;
+		if (n <= 0) break;
+		dest->size += n;
+	}
+
+	close(fd);
+	return err;
+}
+
+enum nbts_error
+nbts_region_open(struct nbts_region *restrict nonnull region, char const *restrict nonnull path)
+{
+	*region = (struct nbts_region){};
+	TRY(nbts_mmap_open(&region->map, path, 0));
+
+	enum nbts_error err = NBTS_OK;
+	region->path = strdup(path);
+	if (!region->path) err = NBTS_ALLOC_ERR;
+
+	void const *header = nullptr;
+	if (!err && region->map.file_size) {
+		err = nbts_mmap_view_at(&region->map, 0, HEADER_SECTORS * NBTS_REGION_SECTOR_SIZE, &header);
+	}
+	if (err) {
+		nbts_region_close(region);
+		return err;
+	}
+
+	if (header) {
+		uint8_t const *p = header;
+		for (size_t i = 0; i < NBTS_REGION_CHUNKS; ++i) {
+			region->locations[i] = load32be(&p[i * sizeof(uint32_t)]);
+			region->timestamps[i] = load32be(&p[NBTS_REGION_SECTOR_SIZE + i * sizeof(uint32_t)]);
+		}
+	}
+	return NBTS_OK;
+}
+
+void nbts_region_close(struct nbts_region *restrict nonnull region)
+{
+	nbts_mmap_close(&region->map);
+	free(region->path);
+	region->path = nullptr;
+}
+
+bool nbts_region_has_chunk(struct nbts_region const *restrict nonnull region, size_t index)
+{
+	return index < NBTS_REGION_CHUNKS && region->locations[index];
+}
+
+/// Stores the data of the chunk at `index` in `data` and `size`.
+///
+/// Chunks inside the region file are returned in place. External chunks are
+/// read into `buffer`.
+static enum nbts_error chunk_data(
+	struct nbts_region *restrict nonnull region,
+	size_t index,
+	struct nbts_buffer *restrict nonnull buffer,
+	void const *nullable *restrict nonnull data,
+	size_t *restrict nonnull size,
+	enum nbts_compression *restrict nonnull compression)
+{
+	if (!nbts_region_has_chunk(region, index)) return NBTS_INVALID_ID;
+
+	uint32_t location = region->locations[index];
+	uint64_t offset = (uint64_t) (location >> 8) * NBTS_REGION_SECTOR_SIZE;
+	size_t capacity = (location & 0xFF) * NBTS_REGION_SECTOR_SIZE;
+	if (capacity < CHUNK_HEADER_SIZE) return NBTS_INVALID_SIZE;
+
+	void const *header = nullptr;
+	TRY(nbts_mmap_view_at(&region->map, offset, CHUNK_HEADER_SIZE, &header));
+	uint32_t length = load32be(header);
+	uint8_t type = ((uint8_t const *) header)[sizeof(uint32_t)];
+	if (!length || length - 1 > capacity - CHUNK_HEADER_SIZE) return NBTS_INVALID_SIZE;
+
+	*compression = type & ~EXTERNAL;
+	if (*compression < NBTS_COMPRESSION_GZIP || *compression > NBTS_COMPRESSION_LZ4) {
+		return NBTS_UNSUPPORTED;
+	}
+
+	if (type & EXTERNAL) {
+		char path[PATH_MAX];
+		TRY(external_path(path, region->path, index));
+		TRY(read_file(buffer, path));
+		*data = buffer->data;
+		*size = buffer->size;
+		return NBTS_OK;
+	}
+
+	*size = length - 1;
+	return nbts_mmap_view_at(&region->map, offset + CHUNK_HEADER_SIZE, *size, data);
+}
+
+enum nbts_error nbts_region_read(
+	struct nbts_region *restrict nonnull region,
+	size_t index,
+	struct nbts_buffer *restrict nonnull dest,
+	enum nbts_compression *restrict nonnull compression)
+{
+	void const *data = nullptr;
+	size_t size = 0;
+	TRY(chunk_data(region, index, dest, &data, &size, compression));
+	if (data == dest->data) return NBTS_OK;
+
+	TRY(nbts_buffer_reserve(dest, size));
+	if (size) memcpy(dest->data, data, size);
+	dest->size = size;
+	return NBTS_OK;
+}
+
+/// The state of \ref nbts_region_write shared by all threads.
+struct job {
+	struct nbts_region_chunk const *nonnull chunks;
+	struct nbts_region_options const *nonnull options;
+	/// The recompressed data of each chunk, if it had to be recompressed.
+	struct nbts_buffer *nonnull outputs;
+	enum nbts_error *nonnull errors;
+	/// A buffer per thread for decompressed chunks.
+	struct nbts_buffer *nonnull scratch;
+};
+
+static bool needs_recompression(
+	struct nbts_region_chunk const *restrict nonnull chunk,
+	struct nbts_region_options const *restrict nonnull options)
+{
+	return chunk->data && (chunk->compression != options->compression || options->recompress);
+}
+
+static void recompress(void *nullable userdata, size_t thread, size_t index)
+{
+	struct job const *job = userdata;
+	struct nbts_region_chunk const *chunk = &job->chunks[index];
+	if (!needs_recompression(chunk, job->options)) return;
+
+	void const *data = chunk->data;
+	size_t size = chunk->size;
+	if (chunk->compression != NBTS_COMPRESSION_NONE) {
+		struct nbts_buffer *scratch = &job->scratch[thread];
+		job->errors[index] = nbts_decompress(scratch, chunk->compression, data, size);
+		if (job->errors[index]) return;
+		data = scratch->data;
+		size = scratch->size;
+	}
+
+	job->errors[index] = nbts_compress(
+		&job->outputs[index], job->options->compression, job->options->level, data, size);
+}
+
+/// Opens a new file next to `path` for writing and stores its name in `tmp`.
+static enum nbts_error open_temp(
+	char *restrict nonnull tmp,
+	char const *restrict nonnull path,
+	FILE *nullable *restrict nonnull dest)
+{
+	int n = snprintf(tmp, PATH_MAX, "%s.XXXXXX", path);
+	if (n < 0 || n >= PATH_MAX) return NBTS_LIMIT_EXCEEDED;
+
+	int fd = mkstemp(tmp);
+	if (fd == -1) return NBTS_WRITE_ERR;
+	(void) fchmod(fd, 0644);
+
+	*dest = fdopen(fd, "wb");
+	if (!*dest) {
+		close(fd);
+		unlink(tmp);
+		return NBTS_WRITE_ERR;
+	}
+	return NBTS_OK;
+}
+
+/// Closes `stream` once the contents of the file at `tmp` are on disk, or
+/// removes the file if `err` is set.
+static enum nbts_error
+close_temp(FILE *restrict nonnull stream, char const *restrict nonnull tmp, enum nbts_error err)
+{
+	if (!err && (fflush(stream) == EOF || fsync(fileno(stream)) == -1)) err = NBTS_WRITE_ERR;
+	if (fclose(stream) == EOF && !err) err = NBTS_WRITE_ERR;
+	if (err) unlink(tmp);
+	return err;
+}
+
+/// Closes `stream` and moves the file at `tmp` to `path` once its contents
+/// are on disk, or removes it if `err` is set.
+static enum nbts_error commit_temp(
+	FILE *restrict nonnull stream,
+	char const *restrict nonnull tmp,
+	char const *restrict nonnull path,
+	enum nbts_error err)
+{
+	err = close_temp(stream, tmp, err);
+	if (!err && rename(tmp, path) == -1) {
+		unlink(tmp);
+		err = NBTS_WRITE_ERR;
+	}
+	return err;
+}
+
+/// Writes the external file of a chunk under a temporary name next to
+/// `path` and stores that name in `dest`.
+///
+/// The file is only moved to `path` by \ref commit_externals, after the
+/// region file referring to it.
+static enum nbts_error write_external(
+	char *nullable *restrict nonnull dest,
+	char const *restrict nonnull path,
+	void const *restrict nonnull data,
+	size_t size)
+{
+	char tmp[PATH_MAX];
+	FILE *stream = nullptr;
+	TRY(open_temp(tmp, path, &stream));
+	enum nbts_error err = nbts_write_byte_array(stream, data, size);
+	TRY(close_temp(stream, tmp, err));
+
+	*dest = strdup(tmp);
+	if (!*dest) {
+		unlink(tmp);
+		return NBTS_ALLOC_ERR;
+	}
+	return NBTS_OK;
+}
+
+/// Pads `size` bytes written to `stream` to a whole number of sectors.
+static enum nbts_error write_padding(FILE *restrict nonnull stream, size_t size)
+{
+	static nbts_byte const zeros[NBTS_REGION_SECTOR_SIZE] = {};
+	size_t rest = size % NBTS_REGION_SECTOR_SIZE;
+	if (!rest) return NBTS_OK;
+	return nbts_write_byte_array(stream, zeros, NBTS_REGION_SECTOR_SIZE - rest);
+}
+
+/// Writes the region file from the final chunk data in `data` and `sizes`.
+///
+/// The chunks stored in external files are written to temporary files, whose
+/// names are stored in `externals`.
+static enum nbts_error write_region(
+	FILE *restrict nonnull stream,
+	char const *restrict nonnull path,
+	struct nbts_region_chunk const *restrict nonnull chunks,
+	void const *nullable *restrict nonnull data,
+	size_t const *restrict nonnull sizes,
+	uint8_t type,
+	char *nullable *restrict nonnull externals)
+{
+	uint32_t locations[NBTS_REGION_CHUNKS] = {};
+
+	size_t sector = HEADER_SECTORS;
+	for (size_t i = 0; i < NBTS_REGION_CHUNKS; ++i) {
+		if (!data[i]) continue;
+		if (sizes[i] >= UINT32_MAX) return NBTS_LIMIT_EXCEEDED;
+
+		size_t sectors = (CHUNK_HEADER_SIZE + sizes[i] + NBTS_REGION_SECTOR_SIZE - 1) /
+		                 NBTS_REGION_SECTOR_SIZE;
+		if (sectors > MAX_CHUNK_SECTORS) {
+			char external_name[PATH_MAX];
+			TRY(external_path(external_name, path, i));
+			TRY(write_external(&externals[i], external_name, data[i], sizes[i]));
+			sectors = 1;
+		}
+
+		if (sector > MAX_SECTOR_OFFSET) return NBTS_LIMIT_EXCEEDED;
+		locations[i] = (uint32_t) (sector << 8 | sectors);
+		sector += sectors;
+	}
+
+	for (size_t i = 0; i < NBTS_REGION_CHUNKS; ++i) TRY(nbts_write_uint32(stream, locations[i]));
+	for (size_t i = 0; i < NBTS_REGION_CHUNKS; ++i) {
+		TRY(nbts_write_uint32(stream, data[i] ? chunks[i].timestamp : 0));
+	}
+
+	for (size_t i = 0; i < NBTS_REGION_CHUNKS; ++i) {
+		if (!data[i]) continue;
+		size_t size = externals[i] ? 0 : sizes[i];
+		TRY(nbts_write_uint32(stream, (uint32_t) size + 1));
+		TRY(nbts_write_uint8(stream, externals[i] ? type | EXTERNAL : type));
+		TRY(nbts_write_byte_array(stream, data[i], size));
+		TRY(write_padding(stream, CHUNK_HEADER_SIZE + size));
+	}
+	return NBTS_OK;
+}
+
+/// Moves the temporary files in `externals` written for the region file at
+/// `path` into place and removes the external files of all other chunks.
+///
+/// Temporary files that cannot be moved are removed.
+static enum nbts_error commit_externals(
+	char const *restrict nonnull path, char *nullable const *restrict nonnull externals)
+{
+	enum nbts_error err = NBTS_OK;
+	for (size_t i = 0; i < NBTS_REGION_CHUNKS; ++i) {
+		// Chunks are only stored externally if their path is valid.
+		char external_name[PATH_MAX];
+		if (external_path(external_name, path, i)) continue;
+
+		if (!externals[i]) {
+			(void) unlink(external_name);
+		} else if (err || rename(externals[i], external_name) == -1) {
+			unlink(externals[i]);
+			err = NBTS_WRITE_ERR;
+		}
+	}
+	return err;
+}
+
+/// Removes the temporary files in `externals`.
+static void remove_externals(char *nullable const *restrict nonnull externals)
+{
+	for (size_t i = 0; i < NBTS_REGION_CHUNKS; ++i) {
+		if (externals[i]) unlink(externals[i]);
+	}
+}
+
+enum nbts_error nbts_region_write(
+	char const *restrict nonnull path,
+	struct nbts_region_chunk const *restrict nonnull chunks,
+	struct nbts_region_options const *restrict nonnull options)
+{
+	size_t threads = nbts_pool_threads(options->threads);
+	struct nbts_buffer *outputs = calloc(NBTS_REGION_CHUNKS, sizeof(*outputs));
+	enum nbts_error *errors = calloc(NBTS_REGION_CHUNKS, sizeof(*errors));
+	struct nbts_buffer *scratch = calloc(threads, sizeof(*scratch));
+	void const **data = calloc(NBTS_REGION_CHUNKS, sizeof(*data));
+	size_t *sizes = calloc(NBTS_REGION_CHUNKS, sizeof(*sizes));
+
+	enum nbts_error err = NBTS_OK;
+	if (!outputs || !errors || !scratch || !data || !sizes) err = NBTS_ALLOC_ERR;
+
+	if (!err) {
+		struct job job = {
+			.chunks = chunks,
+			.options = options,
+			.outputs = outputs,
+			.errors = errors,
+			.scratch = scratch,
+		};
+		err = nbts_pool_run(NBTS_REGION_CHUNKS, threads, &recompress, &job);
+	}
+
+	for (size_t i = 0; !err && i < NBTS_REGION_CHUNKS; ++i) {
+		err = errors[i];
+		bool recompressed = needs_recompression(&chunks[i], options);
+		data[i] = recompressed ? outputs[i].data : chunks[i].data;
+		sizes[i] = recompressed ? outputs[i].size : chunks[i].size;
+	}
+
+	if (!err) {
+		// External files are moved into place after the region file, so
+		// that a failed write leaves the external chunks of the old file
+		// intact.
+		char tmp[PATH_MAX];
+		FILE *stream = nullptr;
+		char *externals[NBTS_REGION_CHUNKS] = {};
+		err = open_temp(tmp, path, &stream);
+		if (!err) {
+			err = write_region(stream, path, chunks, data, sizes, options->compression, externals);
+			err = commit_temp(stream, tmp, path, err);
+		}
+		if (err) remove_externals(externals);
+		else err = commit_externals(path, externals);
+		for (size_t i = 0; i < NBTS_REGION_CHUNKS; ++i) free(externals[i]);
+	}
+
+	for (size_t i = 0; outputs && i < NBTS_REGION_CHUNKS; ++i) nbts_buffer_free(&outputs[i]);
+	for (size_t i = 0; scratch && i < threads; ++i) nbts_buffer_free(&scratch[i]);
+	free(outputs);
+	free(errors);
+	free(scratch);
+	free(data);
+	free(sizes);
+	return err;
+}
+
+enum nbts_error nbts_region_compact(
+	char const *nonnull dest,
+	char const *nonnull src,
+	struct nbts_region_options const *restrict nonnull options)
+{
+	struct nbts_region region;
+	TRY(nbts_region_open(&region, src));
+
+	// Chunks inside the region file are passed to the writer in place; only
+	// external chunks are read into buffers.
+	struct nbts_region_chunk *chunks = calloc(NBTS_REGION_CHUNKS, sizeof(*chunks));
+	struct nbts_buffer *buffers = calloc(NBTS_REGION_CHUNKS, sizeof(*buffers));
+	enum nbts_error err = chunks && buffers ? NBTS_OK : NBTS_ALLOC_ERR;
+
+	for (size_t i = 0; !err && i < NBTS_REGION_CHUNKS; ++i) {
+		if (!nbts_region_has_chunk(&region, i)) continue;
+		struct nbts_region_chunk *chunk = &chunks[i];
+		err = chunk_data(&region, i, &buffers[i], &chunk->data, &chunk->size, &chunk->compression);
+		chunk->timestamp = region.timestamps[i];
+	}
+
+	if (!err) err = nbts_region_write(dest, chunks, options);
+
+	for (size_t i = 0; buffers && i < NBTS_REGION_CHUNKS; ++i) nbts_buffer_free(&buffers[i]);
+	free(buffers);
+	free(chunks);
+	nbts_region_close(&region);
+	return err;
+}
+
+// NOLINTEND(bugprone-easily-swappable-parameters)
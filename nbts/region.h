@@ -0,0 +1,128 @@
+#pragma once
+
+/// \file
+///
+/// \brief Reading and writing Anvil region files.
+///
+/// A region file stores the chunks of a 32 by 32 chunk area in sectors of
+/// \ref NBTS_REGION_SECTOR_SIZE bytes. Its first two sectors hold the
+/// location and timestamp of each chunk; each chunk occupies a run of
+/// sectors starting with its length and compression type. Chunks larger
+/// than 255 sectors are stored in an external `c.<x>.<z>.mcc` file next to
+/// the region file.
+///
+/// When Minecraft updates a chunk that no longer fits its old place, it
+/// moves the chunk to the end of the file and leaves a hole, so region
+/// files fragment over time. \ref nbts_region_write always produces a
+/// compact file with the chunks in index order, replacing the target file
+/// atomically. Chunks are recompressed on a \ref nbts_pool_run thread pool
+/// as needed.
+
+#include <nbts/compression.h>
+#include <nbts/mmap.h>
+#include <nbts/nbts.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+enum : size_t {
+	/// The size of a sector of a region file.
+	NBTS_REGION_SECTOR_SIZE = 4096,
+	/// The number of chunks in a region file.
+	NBTS_REGION_CHUNKS = 1024,
+};
+
+/// An open region file.
+struct nbts_region {
+	struct nbts_mmap map;
+	/// The path of the file, for finding external chunks.
+	char *nullable path;
+	/// The sector offset and count of each chunk, as `offset << 8 | count`.
+	uint32_t locations[NBTS_REGION_CHUNKS];
+	/// The modification time of each chunk in seconds since the epoch.
+	uint32_t timestamps[NBTS_REGION_CHUNKS];
+};
+
+/// One chunk to be written by \ref nbts_region_write.
+struct nbts_region_chunk {
+	/// The chunk data, or `nullptr` if the chunk does not exist.
+	void const *nullable data;
+	size_t size;
+	/// The compression of `data`.
+	enum nbts_compression compression;
+	/// The modification time in seconds since the epoch.
+	uint32_t timestamp;
+};
+
+/// Options for \ref nbts_region_write.
+struct nbts_region_options {
+	/// The compression of the chunks in the written file.
+	enum nbts_compression compression;
+	/// The compression level, see \ref nbts_compress.
+	int level;
+	/// Whether chunks already compressed with `compression` are compressed
+	/// again, to apply `level`. Otherwise they are copied unchanged.
+	bool recompress;
+	/// The number of threads, see \ref nbts_pool_threads.
+	size_t threads;
+};
+
+/// Returns options writing chunks with `compression` at its default level.
+struct nbts_region_options nbts_region_options(enum nbts_compression compression);
+
+/// Opens the region file at `path` and reads its header.
+///
+/// An empty file is a region without chunks. The region must be closed with
+/// \ref nbts_region_close.
+enum nbts_error
+nbts_region_open(struct nbts_region *restrict nonnull region, char const *restrict nonnull path);
+
+/// Closes `region`.
+void nbts_region_close(struct nbts_region *restrict nonnull region);
+
+/// Returns whether the chunk at `index` exists in `region`.
+///
+/// The index of the chunk at `x`, `z` within the region is `x + 32 * z`.
+bool nbts_region_has_chunk(struct nbts_region const *restrict nonnull region, size_t index);
+
+/// Reads the data of the chunk at `index` into `dest` without decompressing
+/// it, and stores its compression in `compression`.
+///
+/// External chunks are read from their `.mcc` file. Returns
+/// \ref NBTS_INVALID_ID if the chunk does not exist.
+enum nbts_error nbts_region_read(
+	struct nbts_region *restrict nonnull region,
+	size_t index,
+	struct nbts_buffer *restrict nonnull dest,
+	enum nbts_compression *restrict nonnull compression);
+
+/// Writes the \ref NBTS_REGION_CHUNKS `chunks` to a compact region file at
+/// `path`.
+///
+/// The file is written under a temporary name and renamed to `path` once it
+/// is complete, so readers either see the old or the new file. Chunks that
+/// need external storage are written to temporary `.mcc` files as well,
+/// which are only renamed after the region file, so that a failed write
+/// leaves the old region file and its external chunks intact. Then the
+/// stale `.mcc` files of chunks now stored in the region file are removed.
+/// External chunks require `path` to have the name `r.<x>.<z>.mca`.
+enum nbts_error nbts_region_write(
+	char const *restrict nonnull path,
+	struct nbts_region_chunk const *restrict nonnull chunks,
+	struct nbts_region_options const *restrict nonnull options);
+
+/// Rewrites the region file at `src` to a compact file at `dest`.
+///
+/// `dest` may be the same as `src`.
+enum nbts_error nbts_region_compact(
+	char const *nonnull dest,
+	char const *nonnull src,
+	struct nbts_region_options const *restrict nonnull options);
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,86 @@
+#include <nbts/ring.h>
+
+#include <string.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+enum nbts_error nbts_ring_init(
+	struct nbts_ring *restrict nonnull ring, void *restrict nonnull data, size_t capacity)
+{
+	if (!capacity || (capacity & (capacity - 1))) return NBTS_INVALID_SIZE;
+	*ring = (struct nbts_ring){.data = data, .capacity = capacity};
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+	return NBTS_OK;
+}
+
+void nbts_ring_reserve(
+	struct nbts_ring *restrict nonnull ring, struct nbts_ring_segment *restrict nonnull dest)
+{
+	size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+	size_t free = ring->capacity - (head - tail);
+	size_t offset = head & (ring->capacity - 1);
+	size_t contiguous = ring->capacity - offset;
+	*dest = (struct nbts_ring_segment){
+		.data = &ring->data[offset],
+		.size = free < contiguous ? free : contiguous,
+	};
+}
+
+void nbts_ring_commit(struct nbts_ring *restrict nonnull ring, size_t size)
+{
+	size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	atomic_store_explicit(&ring->head, head + size, memory_order_release);
+}
+
+size_t nbts_ring_write(
+	struct nbts_ring *restrict nonnull ring, void const *restrict nonnull src, size_t size)
+{
+	uint8_t const *bytes = src;
+	size_t written = 0;
+	// At most two rounds are needed: up to the end of the buffer and from
+	// its start.
+	for (int i = 0; i < 2 && written < size; ++i) {
+		struct nbts_ring_segment segment;
+		nbts_ring_reserve(ring, &segment);
+		if (!segment.size) break;
+
+		size_t n = size - written < segment.size ? size - written : segment.size;
+		memcpy(segment.data, &bytes[written], n);
+		nbts_ring_commit(ring, n);
+		written += n;
+	}
+	return written;
+}
+
+size_t nbts_ring_peek(
+	struct nbts_ring *restrict nonnull ring,
+	struct nbts_ring_segment *restrict nonnull first,
+	struct nbts_ring_segment *restrict nonnull second)
+{
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+	size_t size = head - tail;
+	size_t offset = tail & (ring->capacity - 1);
+	size_t contiguous = ring->capacity - offset;
+	size_t first_size = size < contiguous ? size : contiguous;
+
+	*first = (struct nbts_ring_segment){.data = &ring->data[offset], .size = first_size};
+	*second = (struct nbts_ring_segment){.data = ring->data, .size = size - first_size};
+	return size;
+}
+
+void nbts_ring_consume(struct nbts_ring *restrict nonnull ring, size_t size)
+{
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	atomic_store_explicit(&ring->tail, tail + size, memory_order_release);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+/// \file
+///
+/// \brief A lock-free single-producer single-consumer byte ring.
+///
+/// One thread writes into the ring, typically straight from `recv()` through
+/// \ref nbts_ring_reserve and \ref nbts_ring_commit, while another reads from
+/// it with \ref nbts_ring_peek and \ref nbts_ring_consume. The two threads
+/// only share the write and read counters, which live on separate cache
+/// lines, so they can run on separate cores without contending.
+///
+/// Readable data that wraps around the end of the buffer is returned as two
+/// segments instead of being copied.
+
+#include <nbts/nbts.h>
+
+#include <stdatomic.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// A contiguous range of bytes in a \ref nbts_ring.
+struct nbts_ring_segment {
+	uint8_t *nullable data;
+	size_t size;
+};
+
+/// A ring over a caller-provided buffer.
+struct nbts_ring {
+	uint8_t *nonnull data;
+	/// The size of `data`, a power of two.
+	size_t capacity;
+
+	/// The total number of bytes written. Only modified by the producer.
+	alignas(64) _Atomic size_t head;
+	/// The total number of bytes read. Only modified by the consumer.
+	alignas(64) _Atomic size_t tail;
+};
+
+/// Initializes `ring` on the `capacity` bytes at `data`.
+///
+/// Returns \ref NBTS_INVALID_SIZE if `capacity` is not a power of two.
+enum nbts_error nbts_ring_init(
+	struct nbts_ring *restrict nonnull ring, void *restrict nonnull data, size_t capacity);
+
+/// Returns the largest contiguous writable region of `ring` in `dest`.
+///
+/// Producer only. The region may be smaller than the free space if the free
+/// space wraps around; write to it and call \ref nbts_ring_commit, then
+/// reserve again for the rest.
+void nbts_ring_reserve(
+	struct nbts_ring *restrict nonnull ring, struct nbts_ring_segment *restrict nonnull dest);
+
+/// Publishes `size` bytes written to the region returned by
+/// \ref nbts_ring_reserve to the consumer.
+///
+/// Producer only.
+void nbts_ring_commit(struct nbts_ring *restrict nonnull ring, size_t size);
+
+/// Copies up to `size` bytes from `src` into `ring` and returns the number
+/// of bytes copied.
+///
+/// Producer only.
+size_t nbts_ring_write(
+	struct nbts_ring *restrict nonnull ring, void const *restrict nonnull src, size_t size);
+
+/// Returns the readable data of `ring` in `first` and `second` and the
+/// total number of readable bytes.
+///
+/// Consumer only. `second` is empty unless the data wraps around the end of
+/// the buffer.
+size_t nbts_ring_peek(
+	struct nbts_ring *restrict nonnull ring,
+	struct nbts_ring_segment *restrict nonnull first,
+	struct nbts_ring_segment *restrict nonnull second);
+
+/// Releases `size` bytes at the front of the readable data to the producer.
+///
+/// Consumer only.
+void nbts_ring_consume(struct nbts_ring *restrict nonnull ring, size_t size);
+
+#undef nonnull
+#undef nullable
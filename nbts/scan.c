@@ -0,0 +1,430 @@
+#include <nbts/compression.h>
+#include <nbts/pool.h>
+#include <nbts/region.h>
+#include <nbts/scan.h>
+#include <nbts/write.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+/// The header of a manifest file, followed by its entries.
+struct header {
+	char magic[4];
+	uint32_t version;
+	uint64_t size;
+};
+
+static_assert(sizeof(struct header) % alignof(struct nbts_manifest_entry) == 0);
+
+enum : uint32_t { VERSION = 1 };
+
+static char const MAGIC[4] = {'N', 'B', 'T', 'M'};
+
+// NOLINTBEGIN(bugprone-easily-swappable-parameters)
+
+enum nbts_error nbts_manifest_open(
+	struct nbts_manifest *restrict nonnull manifest, char const *restrict nonnull path)
+{
+	*manifest = (struct nbts_manifest){.map = {.fd = -1}};
+
+	struct stat st;
+	if (stat(path, &st) == -1) return errno == ENOENT ? NBTS_OK : NBTS_READ_ERR;
+	if ((size_t) st.st_size < sizeof(struct header)) return NBTS_OK;
+	TRY(nbts_mmap_open(&manifest->map, path, 0));
+
+	struct header const *header = (void const *) manifest->map.data;
+	uint64_t capacity = (manifest->map.file_size - sizeof(*header)) / sizeof(*manifest->entries);
+	if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) || header->version != VERSION ||
+		header->size > capacity) {
+		nbts_manifest_close(manifest);
+		return NBTS_OK;
+	}
+
+	manifest->entries = (void const *) &header[1];
+	manifest->size = header->size;
+	return NBTS_OK;
+}
+
+void nbts_manifest_close(struct nbts_manifest *restrict nonnull manifest)
+{
+	nbts_mmap_close(&manifest->map);
+	manifest->entries = nullptr;
+	manifest->size = 0;
+}
+
+static int compare_key(
+	struct nbts_manifest_entry const *restrict nonnull entry,
+	int32_t region_x,
+	int32_t region_z,
+	uint16_t chunk)
+{
+	if (entry->region_x != region_x) return entry->region_x < region_x ? -1 : 1;
+	if (entry->region_z != region_z) return entry->region_z < region_z ? -1 : 1;
+	if (entry->chunk != chunk) return entry->chunk < chunk ? -1 : 1;
+	return 0;
+}
+
+size_t nbts_manifest_lower_bound(
+	struct nbts_manifest const *restrict nonnull manifest,
+	int32_t region_x,
+	int32_t region_z,
+	uint16_t chunk)
+{
+	size_t begin = 0;
+	size_t end = manifest->size;
+	while (begin < end) {
+		size_t middle = begin + (end - begin) / 2;
+		if (compare_key(&manifest->entries[middle], region_x, region_z, chunk) < 0) {
+			begin = middle + 1;
+		} else {
+			end = middle;
+		}
+	}
+	return begin;
+}
+
+enum nbts_error nbts_manifest_write(
+	char const *restrict nonnull path,
+	struct nbts_manifest_entry const *restrict nonnull entries,
+	size_t size)
+{
+	char tmp[PATH_MAX];
+	int n = snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+	if (n < 0 || n >= (int) sizeof(tmp)) return NBTS_LIMIT_EXCEEDED;
+
+	int fd = mkstemp(tmp);
+	if (fd == -1) return NBTS_WRITE_ERR;
+	(void) fchmod(fd, 0644);
+	FILE *stream = fdopen(fd, "wb");
+	if (!stream) {
+		close(fd);
+		unlink(tmp);
+		return NBTS_WRITE_ERR;
+	}
+
+	struct header header = {.version = VERSION, .size = size};
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	enum nbts_error err = nbts_write_byte_array(stream, (void const *) &header, sizeof(header));
+	if (!err && size) {
+		err = nbts_write_byte_array(stream, (void const *) entries, size * sizeof(*entries));
+	}
+
+	if (!err && (fflush(stream) == EOF || fsync(fileno(stream)) == -1)) err = NBTS_WRITE_ERR;
+	if (fclose(stream) == EOF && !err) err = NBTS_WRITE_ERR;
+	if (!err && rename(tmp, path) == -1) err = NBTS_WRITE_ERR;
+	if (err) unlink(tmp);
+	return err;
+}
+
+struct nbts_scan_options nbts_scan_options(
+	nbts_scan_begin_fn *nonnull begin, nbts_scan_end_fn *nullable end, void *nullable userdata)
+{
+	return (struct nbts_scan_options){
+		.begin = begin,
+		.end = end,
+		.userdata = userdata,
+	};
+}
+
+/// A region file found in the world and the result of scanning it.
+struct region {
+	int32_t x;
+	int32_t z;
+	/// The entries of the chunks found in the region, in order.
+	struct nbts_manifest_entry *nullable entries;
+	size_t size;
+	struct nbts_scan_stats stats;
+	enum nbts_error err;
+};
+
+/// The state owned by one thread of the pool.
+struct worker {
+	struct nbts_buffer raw;
+	struct nbts_buffer decompressed;
+};
+
+struct scan {
+	char const *nonnull region_dir;
+	struct nbts_manifest const *nonnull manifest;
+	struct nbts_scan_options const *nonnull options;
+	struct region *nonnull regions;
+	struct worker *nonnull workers;
+};
+
+static int compare_regions(void const *nonnull a, void const *nonnull b)
+{
+	struct region const *x = a;
+	struct region const *y = b;
+	if (x->x != y->x) return x->x < y->x ? -1 : 1;
+	if (x->z != y->z) return x->z < y->z ? -1 : 1;
+	return 0;
+}
+
+/// Stores the region files in `dir`, sorted by their coordinates, in
+/// `regions` and `size`.
+static enum nbts_error list_regions(
+	char const *restrict nonnull dir,
+	struct region *nullable *restrict nonnull regions,
+	size_t *restrict nonnull size)
+{
+	DIR *stream = opendir(dir);
+	if (!stream) return NBTS_READ_ERR;
+
+	enum nbts_error err = NBTS_OK;
+	size_t capacity = 0;
+	*regions = nullptr;
+	*size = 0;
+
+	struct dirent *entry = nullptr;
+	while (!err && (entry = readdir(stream))) {
+		int x = 0;
+		int z = 0;
+		int end = 0;
+		if (sscanf(entry->d_name, "r.%d.%d.mca%n", &x, &z, &end) != 2 || entry->d_name[end]) {
+			continue;
+		}
+
+		if (*size == capacity) {
+			capacity = capacity ? capacity * 2 : 64;
+			struct region *grown = realloc(*regions, capacity * sizeof(**regions));
+			if (!grown) {
+				err = NBTS_ALLOC_ERR;
+				break;
+			}
+			*regions = grown;
+		}
+		(*regions)[(*size)++] = (struct region){.x = x, .z = z};
+	}
+	closedir(stream);
+
+	if (err) {
+		free(*regions);
+		*regions = nullptr;
+		return err;
+	}
+	if (*size) qsort(*regions, *size, sizeof(**regions), &compare_regions);
+	return NBTS_OK;
+}
+
+/// Decompresses the chunk at `index` of `region`, stores its digest in
+/// `entry` and parses it if the digest differs from `old`.
+static enum nbts_error scan_chunk(
+	struct scan const *restrict nonnull scan,
+	size_t thread,
+	struct nbts_region *restrict nonnull region,
+	size_t index,
+	struct nbts_manifest_entry *restrict nonnull entry,
+	struct nbts_manifest_entry const *restrict nullable old,
+	struct nbts_scan_stats *restrict nonnull stats)
+{
+	struct worker *worker = &scan->workers[thread];
+	enum nbts_compression compression = NBTS_COMPRESSION_NONE;
+	TRY(nbts_region_read(region, index, &worker->raw, &compression));
+
+	struct nbts_buffer *input = &worker->raw;
+	if (compression != NBTS_COMPRESSION_NONE) {
+		TRY(nbts_decompress(&worker->decompressed, compression, input->data, input->size));
+		input = &worker->decompressed;
+	}
+	++stats->decompressed;
+
+	entry->digest = nbts_hash(input->data, input->size, 0);
+	if (old && !memcmp(&old->digest, &entry->digest, sizeof(entry->digest))) return NBTS_OK;
+
+	struct nbts_scan_options const *options = scan->options;
+	struct nbts_handler const *handler = nullptr;
+	void *handler_userdata = nullptr;
+	TRY(options->begin(options->userdata, thread, entry, &handler, &handler_userdata));
+	++stats->parsed;
+
+	enum nbts_error err = NBTS_READ_ERR;
+	FILE *stream = fmemopen(input->data, input->size, "rb");
+	if (stream) {
+		err = nbts_parse_tag(stream, handler, handler_userdata);
+		fclose(stream);
+	}
+	if (options->end) options->end(options->userdata, thread, entry, handler_userdata, err);
+	return err;
+}
+
+static void scan_region(void *nullable userdata, size_t thread, size_t index)
+{
+	struct scan const *scan = userdata;
+	struct region *result = &scan->regions[index];
+
+	char path[PATH_MAX];
+	int n = snprintf(path, sizeof(path), "%s/r.%d.%d.mca", scan->region_dir, result->x, result->z);
+	if (n < 0 || n >= (int) sizeof(path)) {
+		result->err = NBTS_LIMIT_EXCEEDED;
+		return;
+	}
+
+	struct nbts_region region;
+	result->err = nbts_region_open(&region, path);
+	if (result->err) return;
+
+	result->entries = malloc(NBTS_REGION_CHUNKS * sizeof(*result->entries));
+	if (!result->entries) {
+		result->err = NBTS_ALLOC_ERR;
+		nbts_region_close(&region);
+		return;
+	}
+
+	// The chunks of the region are contiguous in the manifest and in the same
+	// order as in the header, so they are looked up with a single cursor.
+	struct nbts_manifest const *manifest = scan->manifest;
+	size_t cursor = nbts_manifest_lower_bound(manifest, result->x, result->z, 0);
+
+	for (size_t i = 0; i < NBTS_REGION_CHUNKS; ++i) {
+		if (!nbts_region_has_chunk(&region, i)) continue;
+		++result->stats.chunks;
+
+		while (cursor < manifest->size &&
+			   compare_key(&manifest->entries[cursor], result->x, result->z, i) < 0) {
+			++cursor;
+		}
+		struct nbts_manifest_entry const *old = nullptr;
+		if (cursor < manifest->size &&
+			!compare_key(&manifest->entries[cursor], result->x, result->z, i)) {
+			old = &manifest->entries[cursor];
+		}
+
+		struct nbts_manifest_entry *entry = &result->entries[result->size];
+		*entry = (struct nbts_manifest_entry){
+			.region_x = result->x,
+			.region_z = result->z,
+			.timestamp = region.timestamps[i],
+			.sectors = region.locations[i] & 0xFF,
+			.chunk = i,
+		};
+
+		if (old && old->timestamp == entry->timestamp && old->sectors == entry->sectors) {
+			entry->digest = old->digest;
+		} else if (scan_chunk(scan, thread, &region, i, entry, old, &result->stats)) {
+			++result->stats.failed;
+			continue;
+		}
+		++result->size;
+	}
+
+	nbts_region_close(&region);
+}
+
+/// Appends the entries of `region` to `dest`, or the entries recorded for
+/// it in `manifest` if it could not be scanned.
+static void merge_region(
+	struct nbts_manifest_entry *restrict nonnull dest,
+	size_t *restrict nonnull size,
+	struct region const *restrict nonnull region,
+	struct nbts_manifest const *restrict nonnull manifest)
+{
+	if (!region->err) {
+		if (region->size) memcpy(&dest[*size], region->entries, region->size * sizeof(*dest));
+		*size += region->size;
+		return;
+	}
+
+	size_t begin = nbts_manifest_lower_bound(manifest, region->x, region->z, 0);
+	size_t end = begin;
+	while (end < manifest->size && manifest->entries[end].region_x == region->x &&
+		   manifest->entries[end].region_z == region->z) {
+		++end;
+	}
+	if (end > begin) memcpy(&dest[*size], &manifest->entries[begin], (end - begin) * sizeof(*dest));
+	*size += end - begin;
+}
+
+enum nbts_error nbts_scan_world(
+	char const *restrict nonnull region_dir,
+	char const *restrict nonnull manifest_path,
+	struct nbts_scan_options const *restrict nonnull options,
+	struct nbts_scan_stats *restrict nullable stats)
+{
+	struct region *regions = nullptr;
+	size_t count = 0;
+	TRY(list_regions(region_dir, &regions, &count));
+
+	struct nbts_manifest manifest;
+	enum nbts_error err = nbts_manifest_open(&manifest, manifest_path);
+	if (err) {
+		free(regions);
+		return err;
+	}
+
+	size_t threads = nbts_pool_threads(options->threads);
+	struct worker *workers = calloc(threads, sizeof(*workers));
+	if (!workers) err = NBTS_ALLOC_ERR;
+
+	if (!err) {
+		struct scan scan = {
+			.region_dir = region_dir,
+			.manifest = &manifest,
+			.options = options,
+			.regions = regions,
+			.workers = workers,
+		};
+		err = nbts_pool_run(count, threads, &scan_region, &scan);
+	}
+
+	// Regions that could not be scanned keep their old entries, so the
+	// result has at most one entry per chunk of each region.
+	size_t capacity = manifest.size + count * NBTS_REGION_CHUNKS;
+	struct nbts_manifest_entry *entries = nullptr;
+	if (!err) {
+		entries = malloc((capacity ? capacity : 1) * sizeof(*entries));
+		if (!entries) err = NBTS_ALLOC_ERR;
+	}
+
+	enum nbts_error region_err = NBTS_OK;
+	size_t size = 0;
+	if (stats) *stats = (struct nbts_scan_stats){};
+	for (size_t i = 0; !err && i < count; ++i) {
+		merge_region(entries, &size, &regions[i], &manifest);
+		if (!region_err) region_err = regions[i].err;
+		if (stats) {
+			stats->chunks += regions[i].stats.chunks;
+			stats->decompressed += regions[i].stats.decompressed;
+			stats->parsed += regions[i].stats.parsed;
+			stats->failed += regions[i].stats.failed;
+		}
+	}
+
+	if (!err) err = nbts_manifest_write(manifest_path, entries, size);
+
+	free(entries);
+	for (size_t i = 0; workers && i < threads; ++i) {
+		nbts_buffer_free(&workers[i].raw);
+		nbts_buffer_free(&workers[i].decompressed);
+	}
+	free(workers);
+	for (size_t i = 0; i < count; ++i) free(regions[i].entries);
+	free(regions);
+	nbts_manifest_close(&manifest);
+	return err ? err : region_err;
+}
+
+// NOLINTEND(bugprone-easily-swappable-parameters)
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,152 @@
+#pragma once
+
+/// \file
+///
+/// \brief Incremental scanning of the region files of a world.
+///
+/// \ref nbts_scan_world parses only the chunks that changed since the last
+/// run. It keeps a manifest file listing the timestamp, sector count and
+/// digest of every chunk it has seen. For chunks whose timestamp and sector
+/// count in the region header are unchanged, nothing but the 8 KiB header
+/// of their region file is read. Other chunks are decompressed and hashed,
+/// and only parsed if their contents differ from the recorded digest.
+///
+/// The manifest is memory-mapped and its entries are sorted, so looking up
+/// a chunk does not require reading the whole manifest first. It stores
+/// integers in native byte order; it is a cache, not an exchange format.
+
+#include <nbts/hash.h>
+#include <nbts/mmap.h>
+#include <nbts/nbts.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// The state of one chunk as recorded in a manifest.
+struct nbts_manifest_entry {
+	/// The digest of the decompressed chunk, see \ref nbts_hash.
+	struct nbts_digest digest;
+	/// The coordinates of the region file.
+	int32_t region_x;
+	int32_t region_z;
+	/// The timestamp from the region header.
+	uint32_t timestamp;
+	/// The number of sectors from the region header.
+	uint32_t sectors;
+	/// The index of the chunk in the region, see \ref nbts_region_has_chunk.
+	uint16_t chunk;
+	uint16_t reserved[3];
+};
+
+static_assert(sizeof(struct nbts_manifest_entry) == 40);
+
+/// A manifest opened for lookups.
+struct nbts_manifest {
+	struct nbts_mmap map;
+	/// The entries, sorted by region coordinates and chunk index.
+	struct nbts_manifest_entry const *nullable entries;
+	size_t size;
+};
+
+/// Opens the manifest at `path`.
+///
+/// A missing file or one written by an incompatible version is opened as an
+/// empty manifest. The manifest must be closed with
+/// \ref nbts_manifest_close.
+enum nbts_error nbts_manifest_open(
+	struct nbts_manifest *restrict nonnull manifest, char const *restrict nonnull path);
+
+/// Closes `manifest`.
+void nbts_manifest_close(struct nbts_manifest *restrict nonnull manifest);
+
+/// Returns the index of the first entry of `manifest` at or after the given
+/// region and chunk, or its size if there is none.
+size_t nbts_manifest_lower_bound(
+	struct nbts_manifest const *restrict nonnull manifest,
+	int32_t region_x,
+	int32_t region_z,
+	uint16_t chunk);
+
+/// Writes the `size` `entries`, which must be sorted, as a manifest to
+/// `path`, replacing any existing file atomically.
+enum nbts_error nbts_manifest_write(
+	char const *restrict nonnull path,
+	struct nbts_manifest_entry const *restrict nonnull entries,
+	size_t size);
+
+/// The type of a callback providing the handler for one changed chunk.
+///
+/// `entry` describes the new state of the chunk. The callback shall store
+/// the handler in `handler` and its userdata in `handler_userdata`.
+/// `thread` identifies the calling thread, see \ref nbts_pool_fn. If it
+/// returns an error, the chunk is not parsed and not recorded, so it is
+/// scanned again on the next run.
+typedef enum nbts_error nbts_scan_begin_fn(
+	void *nullable userdata,
+	size_t thread,
+	struct nbts_manifest_entry const *restrict nonnull entry,
+	struct nbts_handler const *nullable *restrict nonnull handler,
+	void *nullable *restrict nonnull handler_userdata);
+
+/// The type of a callback called after a changed chunk has been parsed.
+///
+/// `err` is the result of parsing the chunk. Chunks that fail to parse are
+/// not recorded.
+typedef void nbts_scan_end_fn(
+	void *nullable userdata,
+	size_t thread,
+	struct nbts_manifest_entry const *restrict nonnull entry,
+	void *nullable handler_userdata,
+	enum nbts_error err);
+
+/// Options for \ref nbts_scan_world.
+struct nbts_scan_options {
+	/// Called before each changed chunk is parsed.
+	nbts_scan_begin_fn *nonnull begin;
+	/// Called after each chunk for which `begin` succeeded, if not
+	/// `nullptr`.
+	nbts_scan_end_fn *nullable end;
+	/// Passed to `begin` and `end`.
+	void *nullable userdata;
+	/// The number of threads, see \ref nbts_pool_threads.
+	size_t threads;
+};
+
+/// Counts of the chunks handled by \ref nbts_scan_world.
+struct nbts_scan_stats {
+	/// The chunks found in the region files.
+	size_t chunks;
+	/// The chunks whose header entry changed and that were decompressed.
+	size_t decompressed;
+	/// The chunks whose contents changed and that were parsed.
+	size_t parsed;
+	/// The chunks that could not be read or parsed.
+	size_t failed;
+};
+
+/// Returns options calling `begin` and `end` with default settings.
+struct nbts_scan_options nbts_scan_options(
+	nbts_scan_begin_fn *nonnull begin, nbts_scan_end_fn *nullable end, void *nullable userdata);
+
+/// Parses the chunks of the region files `r.<x>.<z>.mca` in `region_dir`
+/// that changed since the manifest at `manifest_path` was written, and
+/// updates the manifest.
+///
+/// Regions are processed in parallel. Chunks that no longer exist are
+/// dropped from the manifest. Entries of region files that cannot be
+/// opened are kept, and the first error opening one is returned after the
+/// manifest has been written. The counts are stored in `stats`, if not
+/// `nullptr`.
+enum nbts_error nbts_scan_world(
+	char const *restrict nonnull region_dir,
+	char const *restrict nonnull manifest_path,
+	struct nbts_scan_options const *restrict nonnull options,
+	struct nbts_scan_stats *restrict nullable stats);
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,320 @@
+#include <nbts/measure.h>
+#include <nbts/path.h>
+#include <nbts/pool.h>
+#include <nbts/split.h>
+#include <nbts/view.h>
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+/// The number of chunks per thread when the chunk size is chosen
+/// automatically.
+enum : size_t { CHUNKS_PER_THREAD = 8 };
+
+/// The result of one chunk, written by the thread that parsed it.
+struct chunk {
+	void *nullable handler_userdata;
+	enum nbts_error err;
+	/// Whether the begin callback succeeded.
+	bool begun;
+};
+
+struct split {
+	uint8_t const *nonnull data;
+	size_t size;
+	struct nbts_split_options const *nonnull options;
+	enum nbts_type type;
+	size_t count;
+	size_t chunk_size;
+	/// The offsets of the first element of each chunk.
+	uint32_t const *nonnull offsets;
+	struct chunk *nonnull chunks;
+};
+
+/// A block of memory for the index.
+struct block {
+	struct block *nullable previous;
+	alignas(max_align_t) uint8_t data[];
+};
+
+/// The index of the scan, which lives in a chain of blocks.
+///
+/// The children of a node have to be contiguous, so a full arena cannot be
+/// moved or extended. Instead, a larger block is added and only the node
+/// that did not fit is indexed again.
+struct index {
+	/// The arena of the view, in the last block.
+	struct nbts_arena arena;
+	struct block *nullable last;
+};
+
+// NOLINTBEGIN(bugprone-easily-swappable-parameters)
+
+/// Makes a new block of `capacity` bytes the arena of `index`.
+static enum nbts_error add_block(struct index *nonnull index, size_t capacity)
+{
+	if (capacity > SIZE_MAX - sizeof(struct block)) return NBTS_ALLOC_ERR;
+	struct block *block = malloc(sizeof(*block) + capacity);
+	if (!block) return NBTS_ALLOC_ERR;
+	block->previous = index->last;
+	index->last = block;
+	index->arena = nbts_arena(block->data, capacity);
+	return NBTS_OK;
+}
+
+static void free_blocks(struct index *restrict nonnull index)
+{
+	while (index->last) {
+		struct block *previous = index->last->previous;
+		free(index->last);
+		index->last = previous;
+	}
+}
+
+/// Indexes the children of `node` as \ref nbts_view_children does, adding
+/// blocks to `index` until they fit.
+///
+/// The arena of `view` shall be `index->arena`, so neither pointer is
+/// `restrict`.
+static enum nbts_error index_children(
+	struct index *nonnull index,
+	struct nbts_view *nonnull view,
+	struct nbts_view_node *restrict nonnull node,
+	struct nbts_view_node *nullable *restrict nonnull children,
+	size_t *restrict nonnull size)
+{
+	// The number of elements of a list is known up front, so the block can
+	// be made large enough at once. Compounds are indexed again in blocks of
+	// twice the size until they fit.
+	size_t needed = 0;
+	if (!node->indexed && node->type == NBTS_LIST) {
+		enum nbts_type type = NBTS_END;
+		nbts_size count = 0;
+		nbts_view_list(view, node, &type, &count);
+		bool nodes = type != NBTS_END && !nbts_measure_fixed(type) && count > 0;
+		if (nodes && (size_t) count <= SIZE_MAX / sizeof(struct nbts_view_node))
+			needed = (size_t) count * sizeof(struct nbts_view_node);
+	}
+
+	struct nbts_arena *arena = &index->arena;
+	if (needed && needed + alignof(struct nbts_view_node) > arena->capacity - arena->size) {
+		size_t capacity = arena->capacity > SIZE_MAX / 2 ? SIZE_MAX : 2 * arena->capacity;
+		TRY(add_block(index, needed > capacity ? needed : capacity));
+	}
+
+	enum nbts_error err = nbts_view_children(view, node, children, size);
+	while (err == NBTS_ALLOC_ERR) {
+		if (arena->capacity > SIZE_MAX / 2) return NBTS_ALLOC_ERR;
+		TRY(add_block(index, 2 * arena->capacity));
+		err = nbts_view_children(view, node, children, size);
+	}
+	return err;
+}
+
+struct nbts_split_options nbts_split_options(
+	nbts_split_begin_fn *nonnull begin,
+	nbts_split_merge_fn *nullable merge,
+	void *nullable userdata)
+{
+	return (struct nbts_split_options){.begin = begin, .merge = merge, .userdata = userdata};
+}
+
+/// Stores the first list below `node` matching `pattern` in `dest`.
+///
+/// Only subtrees whose path is a prefix of `pattern` are indexed.
+static enum nbts_error find_list(
+	struct index *nonnull index,
+	struct nbts_view *nonnull view,
+	struct nbts_view_node *restrict nonnull node,
+	struct nbts_path const *restrict nonnull path,
+	char const *restrict nonnull pattern,
+	struct nbts_view_node *nullable *restrict nonnull dest)
+{
+	char const *rest = nbts_path_match_prefix(pattern, path);
+	if (!rest) return NBTS_OK;
+	if (!*rest) {
+		if (node->type == NBTS_LIST) *dest = node;
+		return NBTS_OK;
+	}
+	if (node->type != NBTS_COMPOUND && node->type != NBTS_LIST) return NBTS_OK;
+
+	struct nbts_view_node *children = nullptr;
+	size_t size = 0;
+	TRY(index_children(index, view, node, &children, &size));
+
+	for (size_t i = 0; i < size && !*dest; ++i) {
+		struct nbts_view_node *child = &children[i];
+		struct nbts_path child_path = node->type == NBTS_LIST
+		                                  ? nbts_path_index(path, i)
+		                                  : nbts_path_name(
+		                                        path, (nbts_char const *) &view->data[child->name],
+		                                        child->name_size);
+		TRY(find_list(index, view, child, &child_path, pattern, dest));
+	}
+	return NBTS_OK;
+}
+
+/// Returns `a / b` rounded up, without overflowing for any `b`.
+static size_t divide_up(size_t a, size_t b) { return a / b + (a % b != 0); }
+
+/// Locates the list at `pattern` and stores the offset of the first element
+/// of every chunk of `chunk_size` elements in `offsets`.
+static enum nbts_error scan(
+	struct split *restrict nonnull split,
+	struct index *nonnull index,
+	struct nbts_view *nonnull view,
+	char const *restrict nonnull pattern,
+	uint32_t *nullable *restrict nonnull offsets)
+{
+	nbts_strsize root_name_size = 0;
+	nbts_char const *root_name = nbts_view_name(view, &view->root, &root_name_size);
+	struct nbts_path root = nbts_path_name(nullptr, root_name, root_name_size);
+
+	struct nbts_view_node *list = nullptr;
+	TRY(find_list(index, view, &view->root, &root, pattern, &list));
+	if (!list) return NBTS_INVALID_ID;
+
+	nbts_size count = 0;
+	uint8_t const *first = nbts_view_list(view, list, &split->type, &count);
+	split->count = count;
+	if (!count) return NBTS_OK;
+
+	// Elements of fixed size are located arithmetically. All others are
+	// indexed as the children of the list.
+	size_t element_size = nbts_measure_fixed(split->type);
+	struct nbts_view_node *children = nullptr;
+	if (!element_size) {
+		size_t size = 0;
+		TRY(index_children(index, view, list, &children, &size));
+	}
+
+	size_t threads = nbts_pool_threads(split->options->threads);
+	size_t chunk_size = split->options->chunk_size;
+	if (!chunk_size) {
+		size_t chunks = threads * CHUNKS_PER_THREAD;
+		chunk_size = divide_up(count, chunks);
+	}
+	split->chunk_size = chunk_size;
+
+	size_t chunks = divide_up(split->count, chunk_size);
+	*offsets = malloc(chunks * sizeof(**offsets));
+	if (!*offsets) return NBTS_ALLOC_ERR;
+
+	uint32_t base = first - view->data;
+	for (size_t i = 0; i < chunks; ++i) {
+		size_t element = i * chunk_size;
+		(*offsets)[i] = element_size ? base + element * element_size : children[element].payload;
+	}
+	return NBTS_OK;
+}
+
+/// Returns the number of elements in chunk `chunk`.
+static size_t chunk_count(struct split const *restrict nonnull split, size_t chunk)
+{
+	size_t rest = split->count - chunk * split->chunk_size;
+	return rest < split->chunk_size ? rest : split->chunk_size;
+}
+
+static enum nbts_error parse_chunk(
+	struct split const *restrict nonnull split,
+	size_t chunk,
+	struct nbts_handler const *restrict nullable handler,
+	void *nullable handler_userdata)
+{
+	size_t count = chunk_count(split, chunk);
+	size_t offset = split->offsets[chunk];
+
+	FILE *stream = fmemopen((void *) &split->data[offset], split->size - offset, "rb");
+	if (!stream) return NBTS_READ_ERR;
+	enum nbts_error err = nbts_parse_list(split->type, count, stream, handler, handler_userdata);
+	fclose(stream);
+	return err;
+}
+
+static void process(void *nullable userdata, size_t thread, size_t index)
+{
+	struct split const *split = userdata;
+	struct nbts_split_options const *options = split->options;
+	struct chunk *chunk = &split->chunks[index];
+
+	size_t first = index * split->chunk_size;
+	size_t count = chunk_count(split, index);
+
+	struct nbts_handler const *handler = nullptr;
+	chunk->err = options->begin(
+		options->userdata, thread, index, first, count, &handler, &chunk->handler_userdata);
+	if (chunk->err) return;
+	chunk->begun = true;
+	chunk->err = parse_chunk(split, index, handler, chunk->handler_userdata);
+}
+
+static enum nbts_error run(struct split *restrict nonnull split)
+{
+	size_t chunks = divide_up(split->count, split->chunk_size);
+	split->chunks = calloc(chunks, sizeof(*split->chunks));
+	if (!split->chunks) return NBTS_ALLOC_ERR;
+
+	enum nbts_error err = nbts_pool_run(
+		chunks, nbts_pool_threads(split->options->threads), &process, split);
+
+	// Every chunk that was begun is merged, even after an error, so that
+	// the merge callback can release its state.
+	nbts_split_merge_fn *merge = split->options->merge;
+	for (size_t i = 0; i < chunks; ++i) {
+		struct chunk *chunk = &split->chunks[i];
+		enum nbts_error chunk_err = chunk->err;
+		if (chunk->begun && merge)
+			chunk_err = merge(split->options->userdata, i, chunk->handler_userdata, chunk->err);
+		if (!err) err = chunk_err;
+	}
+
+	free(split->chunks);
+	return err;
+}
+
+enum nbts_error nbts_split_parse(
+	void const *restrict nonnull data,
+	size_t size,
+	char const *restrict nonnull path,
+	struct nbts_split_options const *restrict nonnull options)
+{
+	struct split split = {.data = data, .size = size, .options = options};
+
+	// The index only holds the children of the compounds and lists on the
+	// path, so it starts small.
+	struct index index = {};
+	uint32_t *offsets = nullptr;
+	enum nbts_error err = add_block(&index, NBTS_STACK_BUFFER_SIZE);
+	if (!err) {
+		struct nbts_view view;
+		err = nbts_view_open(&view, data, size, &index.arena);
+		if (!err) err = scan(&split, &index, &view, path, &offsets);
+	}
+	free_blocks(&index);
+	if (err || !split.count) {
+		free(offsets);
+		return err;
+	}
+
+	split.offsets = offsets;
+	err = run(&split);
+	free(offsets);
+	return err;
+}
+
+// NOLINTEND(bugprone-easily-swappable-parameters)
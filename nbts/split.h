@@ -0,0 +1,94 @@
+#pragma once
+
+/// \file
+///
+/// \brief Parsing the elements of one large list on a thread pool.
+///
+/// Some inputs consist of a single tag whose bulk is one big list, such as
+/// the blocks or entities of a structure file. \ref nbts_split_parse finds
+/// that list in an in-memory buffer and parses its elements in parallel, in
+/// two phases:
+///
+/// 1. A sequential scan locates the list with a \ref nbts_view and indexes
+///    the start offsets of its elements. Only tag headers are decoded.
+/// 2. The elements are divided into chunks of consecutive elements, which
+///    are parsed on a \ref nbts_pool_run thread pool. Each chunk gets its
+///    own handler userdata from a callback, so threads never share state.
+///
+/// Afterwards, the results of the chunks are merged in element order on the
+/// calling thread.
+
+#include <nbts/nbts.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// The type of a callback providing the handler for one chunk.
+///
+/// The chunk `chunk` consists of the `count` elements starting at element
+/// `first`. The callback shall store the handler for them in `handler` and
+/// its userdata in `handler_userdata`. `thread` identifies the calling
+/// thread, see \ref nbts_pool_fn. If it returns an error, the chunk is not
+/// parsed and the error is reported for the chunk.
+typedef enum nbts_error nbts_split_begin_fn(
+	void *nullable userdata,
+	size_t thread,
+	size_t chunk,
+	size_t first,
+	size_t count,
+	struct nbts_handler const *nullable *restrict nonnull handler,
+	void *nullable *restrict nonnull handler_userdata);
+
+/// The type of a callback merging the result of one chunk.
+///
+/// It is called on the calling thread of \ref nbts_split_parse, in chunk
+/// order, for every chunk for which the begin callback succeeded. `err` is
+/// the result of parsing the chunk.
+typedef enum nbts_error nbts_split_merge_fn(
+	void *nullable userdata, size_t chunk, void *nullable handler_userdata, enum nbts_error err);
+
+/// Options for \ref nbts_split_parse.
+struct nbts_split_options {
+	/// Called before each chunk is parsed.
+	nbts_split_begin_fn *nonnull begin;
+	/// Called after all chunks have been parsed, if not `nullptr`.
+	nbts_split_merge_fn *nullable merge;
+	/// Passed to `begin` and `merge`.
+	void *nullable userdata;
+	/// The number of threads, see \ref nbts_pool_threads.
+	size_t threads;
+	/// The number of elements per chunk, or `0` to make a few chunks per
+	/// thread so that the pool can balance uneven elements.
+	size_t chunk_size;
+};
+
+/// Returns options calling `begin` and `merge` with default settings.
+struct nbts_split_options nbts_split_options(
+	nbts_split_begin_fn *nonnull begin,
+	nbts_split_merge_fn *nullable merge,
+	void *nullable userdata);
+
+/// Parses the elements of the list at `path` in the named tag at the start
+/// of the `size` bytes at `data` in parallel.
+///
+/// `path` is a pattern as accepted by \ref nbts_path_match, starting with
+/// the name of the root tag; the first matching list is used. Each element
+/// is passed to the handler of its chunk as an unnamed payload, as
+/// \ref nbts_parse_list does.
+///
+/// Returns \ref NBTS_INVALID_ID if no list matches `path`. Otherwise returns
+/// the first error in chunk order, either from parsing a chunk or from the
+/// merge callback.
+enum nbts_error nbts_split_parse(
+	void const *restrict nonnull data,
+	size_t size,
+	char const *restrict nonnull path,
+	struct nbts_split_options const *restrict nonnull options);
+
+#undef nonnull
+#undef nullable
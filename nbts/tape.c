@@ -0,0 +1,321 @@
+#include <nbts/cursor.h>
+#include <nbts/hash.h>
+#include <nbts/tape.h>
+#include <nbts/write.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+// NOLINTBEGIN(bugprone-easily-swappable-parameters)
+
+enum : uint32_t { TAPE_MAGIC = 0x4E425454, TAPE_VERSION = 1 };
+
+struct builder {
+	struct nbts_cursor c;
+	struct nbts_tape_entry *nonnull entries;
+	size_t capacity;
+	size_t count;
+};
+
+static enum nbts_error build_entry(
+	struct builder *restrict nonnull b, enum nbts_type type, size_t name, nbts_strsize name_size);
+
+static enum nbts_error build_array(struct builder *restrict nonnull b, size_t element_size)
+{
+	size_t size = 0;
+	TRY(nbts_cursor_read_size(&b->c, &size));
+	return nbts_cursor_advance(&b->c, size * element_size);
+}
+
+static enum nbts_error build_list(struct builder *restrict nonnull b)
+{
+	enum nbts_type type = 0;
+	TRY(nbts_cursor_read_typeid(&b->c, &type));
+	size_t size = 0;
+	TRY(nbts_cursor_read_size(&b->c, &size));
+
+	if (nbts_has_fixed_size(type)) {
+		return nbts_cursor_advance(&b->c, size * nbts_measure_fixed(type));
+	}
+	for (size_t i = 0; i < size; ++i) TRY(build_entry(b, type, 0, 0));
+	return NBTS_OK;
+}
+
+static enum nbts_error build_compound(struct builder *restrict nonnull b)
+{
+	while (1) {
+		enum nbts_type type = 0;
+		TRY(nbts_cursor_read_typeid(&b->c, &type));
+		if (type == NBTS_END) return NBTS_OK;
+
+		nbts_strsize name_size = 0;
+		TRY(nbts_cursor_read_strsize(&b->c, &name_size));
+		size_t name = b->c.position;
+		TRY(nbts_cursor_advance(&b->c, name_size));
+		TRY(build_entry(b, type, name, name_size));
+	}
+}
+
+static enum nbts_error build_payload(struct builder *restrict nonnull b, enum nbts_type type)
+{
+	switch (type) {
+	case NBTS_END:
+	case NBTS_BYTE:
+	case NBTS_SHORT:
+	case NBTS_INT:
+	case NBTS_LONG:
+	case NBTS_FLOAT:
+	case NBTS_DOUBLE: return nbts_cursor_advance(&b->c, nbts_measure_fixed(type));
+	case NBTS_STRING: {
+		nbts_strsize size = 0;
+		TRY(nbts_cursor_read_strsize(&b->c, &size));
+		return nbts_cursor_advance(&b->c, size);
+	}
+	case NBTS_BYTE_ARRAY: return build_array(b, sizeof(nbts_byte));
+	case NBTS_INT_ARRAY: return build_array(b, sizeof(nbts_int));
+	case NBTS_LONG_ARRAY: return build_array(b, sizeof(nbts_long));
+	case NBTS_LIST: return build_list(b);
+	case NBTS_COMPOUND: return build_compound(b);
+	}
+	return NBTS_INVALID_ID;
+}
+
+static enum nbts_error build_entry(
+	struct builder *restrict nonnull b, enum nbts_type type, size_t name, nbts_strsize name_size)
+{
+	// Entries past the capacity are only counted, so the caller learns how
+	// many are needed.
+	size_t index = b->count++;
+	size_t payload = b->c.position;
+	TRY(build_payload(b, type));
+	if (index >= b->capacity) return NBTS_OK;
+
+	b->entries[index] = (struct nbts_tape_entry){
+		.name = name,
+		.payload = payload,
+		.next = b->count,
+		.name_size = name_size,
+		.type = type,
+	};
+	return NBTS_OK;
+}
+
+enum nbts_error nbts_tape_build(
+	struct nbts_tape *restrict nonnull tape,
+	void const *restrict nonnull data,
+	size_t data_size,
+	struct nbts_tape_entry *restrict nonnull entries,
+	size_t capacity)
+{
+	*tape = (struct nbts_tape){
+		.data = data,
+		.data_size = data_size,
+		.entries = entries,
+		.capacity = capacity,
+	};
+	if (data_size > UINT32_MAX) return NBTS_LIMIT_EXCEEDED;
+
+	struct builder b = {
+		.c = {.data = data, .size = data_size},
+		.entries = entries,
+		.capacity = capacity,
+	};
+
+	enum nbts_type type = 0;
+	TRY(nbts_cursor_read_typeid(&b.c, &type));
+	if (type == NBTS_END) return NBTS_INVALID_ID;
+	nbts_strsize name_size = 0;
+	TRY(nbts_cursor_read_strsize(&b.c, &name_size));
+	size_t name = b.c.position;
+	TRY(nbts_cursor_advance(&b.c, name_size));
+	TRY(build_entry(&b, type, name, name_size));
+
+	tape->size = b.count;
+	if (b.count > capacity) return NBTS_LIMIT_EXCEEDED;
+	return NBTS_OK;
+}
+
+nbts_char const *nonnull nbts_tape_name(
+	struct nbts_tape const *restrict nonnull tape,
+	size_t index,
+	nbts_strsize *restrict nonnull size)
+{
+	struct nbts_tape_entry const *entry = &tape->entries[index];
+	*size = entry->name_size;
+	return &tape->data[entry->name];
+}
+
+uint8_t const *nonnull
+nbts_tape_payload(struct nbts_tape const *restrict nonnull tape, size_t index)
+{
+	return &tape->data[tape->entries[index].payload];
+}
+
+size_t nbts_tape_first(struct nbts_tape const *restrict nonnull tape, size_t index)
+{
+	if (index + 1 >= tape->entries[index].next) return NBTS_TAPE_NONE;
+	return index + 1;
+}
+
+size_t nbts_tape_next(struct nbts_tape const *restrict nonnull tape, size_t parent, size_t index)
+{
+	size_t next = tape->entries[index].next;
+	if (next >= tape->entries[parent].next) return NBTS_TAPE_NONE;
+	return next;
+}
+
+size_t nbts_tape_find(
+	struct nbts_tape const *restrict nonnull tape,
+	size_t index,
+	nbts_char const *restrict nonnull name,
+	nbts_strsize name_size)
+{
+	if (tape->entries[index].type != NBTS_COMPOUND) return NBTS_TAPE_NONE;
+
+	for (size_t i = nbts_tape_first(tape, index); i != NBTS_TAPE_NONE;
+	     i = nbts_tape_next(tape, index, i)) {
+		struct nbts_tape_entry const *entry = &tape->entries[i];
+		if (entry->name_size == name_size && !memcmp(&tape->data[entry->name], name, name_size))
+			return i;
+	}
+	return NBTS_TAPE_NONE;
+}
+
+size_t
+nbts_tape_element(struct nbts_tape const *restrict nonnull tape, size_t index, size_t element)
+{
+	if (tape->entries[index].type != NBTS_LIST) return NBTS_TAPE_NONE;
+
+	size_t i = nbts_tape_first(tape, index);
+	while (element-- && i != NBTS_TAPE_NONE) i = nbts_tape_next(tape, index, i);
+	return i;
+}
+
+uint8_t const *nonnull nbts_tape_list(
+	struct nbts_tape const *restrict nonnull tape,
+	size_t index,
+	enum nbts_type *restrict nonnull type,
+	nbts_size *restrict nonnull size)
+{
+	uint8_t const *payload = nbts_tape_payload(tape, index);
+	*type = payload[0];
+
+	uint32_t x = 0;
+	memcpy(&x, &payload[1], sizeof(x));
+	*size = (nbts_size) nbt32toh(x);
+	return &payload[1 + sizeof(x)];
+}
+
+enum nbts_error
+nbts_tape_write(FILE *restrict nonnull stream, struct nbts_tape const *restrict nonnull tape)
+{
+	struct nbts_digest digest = nbts_hash(tape->data, tape->data_size, 0);
+	TRY(nbts_write_uint32(stream, TAPE_MAGIC));
+	TRY(nbts_write_uint32(stream, TAPE_VERSION));
+	TRY(nbts_write_uint64(stream, tape->data_size));
+	TRY(nbts_write_uint64(stream, digest.lo));
+	TRY(nbts_write_uint64(stream, digest.hi));
+	TRY(nbts_write_uint64(stream, tape->size));
+
+	for (size_t i = 0; i < tape->size; ++i) {
+		struct nbts_tape_entry const *entry = &tape->entries[i];
+		TRY(nbts_write_uint32(stream, entry->name));
+		TRY(nbts_write_uint32(stream, entry->payload));
+		TRY(nbts_write_uint32(stream, entry->next));
+		TRY(nbts_write_strsize(stream, entry->name_size));
+		TRY(nbts_write_typeid(stream, entry->type));
+	}
+	return NBTS_OK;
+}
+
+/// Returns the size of the smallest payload of `type`, which the accessors
+/// may read without further checks.
+static size_t min_payload(enum nbts_type type)
+{
+	switch (type) {
+	case NBTS_STRING: return nbts_measure_string(0);
+	case NBTS_LIST: return nbts_measure_list(NBTS_END, 0);
+	case NBTS_COMPOUND: return NBTS_MEASURE_END;
+	case NBTS_BYTE_ARRAY:
+	case NBTS_INT_ARRAY:
+	case NBTS_LONG_ARRAY: return nbts_measure_array(type, 0);
+	default: return nbts_measure_fixed(type);
+	}
+}
+
+/// Checks that the entry at `index` of a loaded tape stays within the
+/// buffer and the tape.
+static bool valid_entry(struct nbts_tape const *restrict nonnull tape, size_t index)
+{
+	struct nbts_tape_entry const *entry = &tape->entries[index];
+	return entry->type != NBTS_END && entry->name <= tape->data_size &&
+	       entry->name_size <= tape->data_size - entry->name && entry->payload <= tape->data_size &&
+	       min_payload(entry->type) <= tape->data_size - entry->payload && entry->next > index &&
+	       entry->next <= tape->size;
+}
+
+enum nbts_error nbts_tape_read(
+	struct nbts_tape *restrict nonnull tape,
+	void const *restrict nonnull data,
+	size_t data_size,
+	struct nbts_tape_entry *restrict nonnull entries,
+	size_t capacity,
+	FILE *restrict nonnull stream)
+{
+	*tape = (struct nbts_tape){
+		.data = data,
+		.data_size = data_size,
+		.entries = entries,
+		.capacity = capacity,
+	};
+
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	uint64_t size = 0;
+	struct nbts_digest digest = {};
+	uint64_t count = 0;
+	TRY(nbts_parse_uint32(&magic, stream));
+	TRY(nbts_parse_uint32(&version, stream));
+	if (magic != TAPE_MAGIC || version != TAPE_VERSION) return NBTS_INVALID_ID;
+	TRY(nbts_parse_uint64(&size, stream));
+	TRY(nbts_parse_uint64(&digest.lo, stream));
+	TRY(nbts_parse_uint64(&digest.hi, stream));
+	TRY(nbts_parse_uint64(&count, stream));
+
+	struct nbts_digest expected = nbts_hash(data, data_size, 0);
+	if (size != data_size || digest.lo != expected.lo || digest.hi != expected.hi)
+		return NBTS_INVALID_ID;
+	if (count > capacity) {
+		tape->size = count;
+		return NBTS_LIMIT_EXCEEDED;
+	}
+
+	tape->size = count;
+	for (size_t i = 0; i < count; ++i) {
+		struct nbts_tape_entry *entry = &entries[i];
+		*entry = (struct nbts_tape_entry){};
+		TRY(nbts_parse_uint32(&entry->name, stream));
+		TRY(nbts_parse_uint32(&entry->payload, stream));
+		TRY(nbts_parse_uint32(&entry->next, stream));
+		TRY(nbts_parse_strsize(&entry->name_size, stream));
+		TRY(nbts_parse_typeid(&entry->type, stream));
+		if (!valid_entry(tape, i)) return NBTS_INVALID_ID;
+	}
+	return NBTS_OK;
+}
+
+// NOLINTEND(bugprone-easily-swappable-parameters)
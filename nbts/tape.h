@@ -0,0 +1,137 @@
+#pragma once
+
+/// \file
+///
+/// \brief A flat index of the tags in an in-memory NBT buffer.
+///
+/// \ref nbts_tape_build walks one named tag in a buffer once and records
+/// every tag in a flat array of \ref nbts_tape_entry, in document order.
+/// Each entry knows where its name and payload are in the buffer and where
+/// its subtree ends, so the tape can be navigated and revisited any number
+/// of times without parsing the buffer again.
+///
+/// Elements of lists with fixed size payloads are not recorded, since their
+/// position follows from the position of the list; see
+/// \ref nbts_tape_list.
+///
+/// Offsets are stored as 32 bit integers, so buffers are limited to 4 GiB.
+/// A tape can be saved with \ref nbts_tape_write and loaded again with
+/// \ref nbts_tape_read, so it may be cached alongside the data.
+
+#include <nbts/nbts.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// The index returned by navigation functions if there is no such entry.
+#define NBTS_TAPE_NONE SIZE_MAX
+
+/// One tag on a tape.
+struct nbts_tape_entry {
+	/// The offset of the name in the buffer, after its size.
+	uint32_t name;
+	/// The offset of the payload in the buffer.
+	uint32_t payload;
+	/// The index of the first entry after the subtree of this entry.
+	uint32_t next;
+	/// The size of the name. Elements of lists have no name.
+	nbts_strsize name_size;
+	enum nbts_type type;
+	uint8_t reserved;
+};
+
+static_assert(sizeof(struct nbts_tape_entry) == 16);
+
+/// A tape over a buffer.
+struct nbts_tape {
+	/// The buffer the tape indexes. It is not owned by the tape.
+	uint8_t const *nonnull data;
+	size_t data_size;
+	/// The entries, provided by the caller.
+	struct nbts_tape_entry *nonnull entries;
+	/// The number of entries in use.
+	size_t size;
+	/// The number of entries available.
+	size_t capacity;
+};
+
+/// Builds a tape of the named tag at the start of the `data_size` bytes at
+/// `data` into the `capacity` entries at `entries`.
+///
+/// If `entries` is too small, \ref NBTS_LIMIT_EXCEEDED is returned and
+/// `tape->size` is set to the number of entries needed.
+enum nbts_error nbts_tape_build(
+	struct nbts_tape *restrict nonnull tape,
+	void const *restrict nonnull data,
+	size_t data_size,
+	struct nbts_tape_entry *restrict nonnull entries,
+	size_t capacity);
+
+/// Returns the name of the entry at `index` and stores its size in `size`.
+nbts_char const *nonnull nbts_tape_name(
+	struct nbts_tape const *restrict nonnull tape, size_t index, nbts_strsize *restrict nonnull size);
+
+/// Returns the payload of the entry at `index`.
+///
+/// The payload is in the wire format; it can be parsed by opening a stream
+/// on it with `fmemopen()`.
+uint8_t const *nonnull nbts_tape_payload(struct nbts_tape const *restrict nonnull tape, size_t index);
+
+/// Returns the first child of the compound or list at `index`, or
+/// \ref NBTS_TAPE_NONE if it has none on the tape.
+size_t nbts_tape_first(struct nbts_tape const *restrict nonnull tape, size_t index);
+
+/// Returns the sibling following the child `index` of `parent`, or
+/// \ref NBTS_TAPE_NONE if `index` is the last child.
+size_t nbts_tape_next(struct nbts_tape const *restrict nonnull tape, size_t parent, size_t index);
+
+/// Returns the child of the compound at `index` named `name`, or
+/// \ref NBTS_TAPE_NONE if there is none.
+size_t nbts_tape_find(
+	struct nbts_tape const *restrict nonnull tape,
+	size_t index,
+	nbts_char const *restrict nonnull name,
+	nbts_strsize name_size);
+
+/// Returns the element `element` of the list at `index`, or
+/// \ref NBTS_TAPE_NONE if there is none on the tape.
+///
+/// This jumps over the preceding siblings, so iterating with
+/// \ref nbts_tape_next is cheaper when visiting every element.
+size_t nbts_tape_element(struct nbts_tape const *restrict nonnull tape, size_t index, size_t element);
+
+/// Stores the element type and size of the list at `index` in `type` and
+/// `size`, and returns a pointer to the payload of its first element.
+uint8_t const *nonnull nbts_tape_list(
+	struct nbts_tape const *restrict nonnull tape,
+	size_t index,
+	enum nbts_type *restrict nonnull type,
+	nbts_size *restrict nonnull size);
+
+/// Writes `tape` to `stream`.
+///
+/// A digest of the buffer is stored along with the entries, so a tape is
+/// only loaded again for the same buffer.
+enum nbts_error
+nbts_tape_write(FILE *restrict nonnull stream, struct nbts_tape const *restrict nonnull tape);
+
+/// Reads a tape of the buffer at `data` written by \ref nbts_tape_write from
+/// `stream` into the `capacity` entries at `entries`.
+///
+/// Returns \ref NBTS_INVALID_ID if the stream does not contain a tape of
+/// this buffer, and \ref NBTS_LIMIT_EXCEEDED if `entries` is too small.
+enum nbts_error nbts_tape_read(
+	struct nbts_tape *restrict nonnull tape,
+	void const *restrict nonnull data,
+	size_t data_size,
+	struct nbts_tape_entry *restrict nonnull entries,
+	size_t capacity,
+	FILE *restrict nonnull stream);
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,420 @@
+#define _GNU_SOURCE
+
+#include <nbts/tee.h>
+#include <nbts/write.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define COVARIANT_CAST(FUNC, ...)                                                            \
+	(_Generic(                                                                               \
+		(&FUNC)((void *) 0, (nbts_strsize) 0, (FILE *restrict nonnull) 0),                   \
+		enum nbts_error: (enum nbts_error(*)(void *, nbts_strsize, FILE *restrict nonnull))( \
+			&FUNC)))
+
+struct nbts_handler const nbts_tee_handler = {
+	.handle[NBTS_BYTE] = COVARIANT_CAST(nbts_tee_handle_byte),
+	.handle[NBTS_SHORT] = COVARIANT_CAST(nbts_tee_handle_short),
+	.handle[NBTS_INT] = COVARIANT_CAST(nbts_tee_handle_int),
+	.handle[NBTS_LONG] = COVARIANT_CAST(nbts_tee_handle_long),
+	.handle[NBTS_FLOAT] = COVARIANT_CAST(nbts_tee_handle_float),
+	.handle[NBTS_DOUBLE] = COVARIANT_CAST(nbts_tee_handle_double),
+	.handle[NBTS_STRING] = COVARIANT_CAST(nbts_tee_handle_string),
+	.handle[NBTS_BYTE_ARRAY] = COVARIANT_CAST(nbts_tee_handle_byte_array),
+	.handle[NBTS_INT_ARRAY] = COVARIANT_CAST(nbts_tee_handle_int_array),
+	.handle[NBTS_LONG_ARRAY] = COVARIANT_CAST(nbts_tee_handle_long_array),
+	.handle[NBTS_LIST] = COVARIANT_CAST(nbts_tee_handle_list),
+	.handle[NBTS_COMPOUND] = COVARIANT_CAST(nbts_tee_handle_compound),
+};
+
+enum : size_t {
+	/// The size of the worker stream buffers, and the unit of the ring.
+	BLOCK_SIZE = 4096,
+	/// The number of blocks in the ring.
+	RING_BLOCKS = 16,
+	RING_SIZE = BLOCK_SIZE * RING_BLOCKS,
+	/// The number of bytes kept behind the position of each busy worker, for
+	/// the seeks back of glibc described in tee.h.
+	HISTORY_SIZE = 2 * BLOCK_SIZE,
+};
+
+static_assert(RING_SIZE > HISTORY_SIZE);
+
+/// Returns the number of bytes that can be written to the ring without
+/// overwriting data a busy worker may still read.
+static size_t writable_size(struct nbts_tee_handler_data *restrict nonnull data)
+{
+	uint64_t oldest = data->head;
+	for (size_t i = 0; i < data->children_size; ++i) {
+		struct nbts_tee_worker const *worker = &data->workers[i];
+		if (!worker->fn) continue;
+		uint64_t kept = worker->position > HISTORY_SIZE ? worker->position - HISTORY_SIZE : 0;
+		if (kept < oldest) oldest = kept;
+	}
+	return RING_SIZE - (size_t) (data->head - oldest);
+}
+
+static ssize_t record_write(void *cookie, char const *buffer, size_t size)
+{
+	struct nbts_tee_handler_data *data = cookie;
+
+	mtx_lock(&data->lock);
+	for (size_t done = 0; done < size;) {
+		size_t n = writable_size(data);
+		if (!n) {
+			cnd_wait(&data->wake, &data->lock);
+			continue;
+		}
+
+		size_t offset = data->head % RING_SIZE;
+		if (n > RING_SIZE - offset) n = RING_SIZE - offset;
+		if (n > size - done) n = size - done;
+		memcpy(&data->ring[offset], &buffer[done], n);
+		data->head += n;
+		done += n;
+		cnd_broadcast(&data->wake);
+	}
+	mtx_unlock(&data->lock);
+	return (ssize_t) size;
+}
+
+/// Waits for data after the position of `worker` and returns its size, or
+/// `0` at the end of the current tag.
+static size_t wait_readable(struct nbts_tee_worker *restrict nonnull worker)
+{
+	struct nbts_tee_handler_data *data = worker->tee;
+	while (data->head == worker->position && !data->finished) {
+		cnd_wait(&data->wake, &data->lock);
+	}
+	return (size_t) (data->head - worker->position);
+}
+
+static ssize_t worker_read(void *cookie, char *buffer, size_t size)
+{
+	struct nbts_tee_worker *worker = cookie;
+	struct nbts_tee_handler_data *data = worker->tee;
+
+	mtx_lock(&data->lock);
+	size_t available = wait_readable(worker);
+	if (size > available) size = available;
+	for (size_t done = 0; done < size;) {
+		size_t offset = worker->position % RING_SIZE;
+		size_t n = RING_SIZE - offset;
+		if (n > size - done) n = size - done;
+		memcpy(&buffer[done], &data->ring[offset], n);
+		worker->position += n;
+		done += n;
+	}
+	if (size) cnd_broadcast(&data->wake);
+	mtx_unlock(&data->lock);
+	return (ssize_t) size;
+}
+
+static int worker_seek(void *cookie, off64_t *offset, int whence)
+{
+	struct nbts_tee_worker *worker = cookie;
+	struct nbts_tee_handler_data *data = worker->tee;
+
+	int64_t base = 0;
+	switch (whence) {
+	case SEEK_SET: base = 0; break;
+	case SEEK_CUR: base = (int64_t) worker->position; break;
+	default: return -1;
+	}
+
+	int64_t position = base + *offset;
+	if (position < 0 || (uint64_t) position + HISTORY_SIZE < worker->position) return -1;
+
+	// Seeking forward discards the data in between as it arrives.
+	mtx_lock(&data->lock);
+	while (worker->position < (uint64_t) position) {
+		size_t available = wait_readable(worker);
+		if (!available) break;
+		size_t skip = (uint64_t) position - worker->position;
+		worker->position += skip < available ? skip : available;
+		cnd_broadcast(&data->wake);
+	}
+	bool reached = worker->position >= (uint64_t) position;
+	if (reached) worker->position = position;
+	mtx_unlock(&data->lock);
+
+	if (!reached) return -1;
+	*offset = position;
+	return 0;
+}
+
+static int work(void *arg)
+{
+	struct nbts_tee_worker *worker = arg;
+	struct nbts_tee_handler_data *data = worker->tee;
+
+	mtx_lock(&data->lock);
+	while (1) {
+		while (!worker->fn && !data->closed) cnd_wait(&data->wake, &data->lock);
+		if (!worker->fn) break;
+		nbts_handler_fn *fn = worker->fn;
+		uint64_t start = data->start;
+		nbts_strsize name_size = data->name_size;
+		mtx_unlock(&data->lock);
+
+		// Discards what an earlier tag may have left in the buffer.
+		clearerr(worker->stream);
+		enum nbts_error err = NBTS_OK;
+		if (fseeko(worker->stream, (off_t) start, SEEK_SET)) err = NBTS_READ_ERR;
+		if (!err) err = fn(worker->child->userdata, name_size, worker->stream);
+
+		mtx_lock(&data->lock);
+		worker->err = err;
+		worker->fn = nullptr;
+		cnd_broadcast(&data->wake);
+	}
+	mtx_unlock(&data->lock);
+	return 0;
+}
+
+enum nbts_error nbts_tee_handler_data_init(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	struct nbts_tee_child const *restrict nonnull children,
+	size_t children_size)
+{
+	*data = (struct nbts_tee_handler_data){
+		.children = children,
+		.children_size = children_size,
+	};
+
+	if (mtx_init(&data->lock, mtx_plain) != thrd_success) return NBTS_ALLOC_ERR;
+	if (cnd_init(&data->wake) != thrd_success) {
+		mtx_destroy(&data->lock);
+		return NBTS_ALLOC_ERR;
+	}
+
+	data->workers = calloc(children_size, sizeof(*data->workers));
+	data->buffers = malloc(children_size * BLOCK_SIZE);
+	data->ring = malloc(RING_SIZE);
+	data->record = fopencookie(data, "wb", (cookie_io_functions_t){.write = &record_write});
+	if ((children_size && (!data->workers || !data->buffers)) || !data->ring || !data->record) {
+		goto failed;
+	}
+
+	cookie_io_functions_t io = {.read = &worker_read, .seek = &worker_seek};
+	for (size_t i = 0; i < children_size; ++i) {
+		struct nbts_tee_worker *worker = &data->workers[i];
+		*worker = (struct nbts_tee_worker){.tee = data, .child = &children[i]};
+		worker->stream = fopencookie(worker, "rb", io);
+		if (!worker->stream) goto failed;
+		// glibc ignores the size unless the buffer is given, and the size
+		// bounds how far it seeks back.
+		if (setvbuf(worker->stream, &data->buffers[i * BLOCK_SIZE], _IOFBF, BLOCK_SIZE)) {
+			goto failed;
+		}
+	}
+	return NBTS_OK;
+
+failed:
+	nbts_tee_handler_data_free(data);
+	return NBTS_ALLOC_ERR;
+}
+
+void nbts_tee_handler_data_free(struct nbts_tee_handler_data *restrict nonnull data)
+{
+	mtx_lock(&data->lock);
+	data->closed = true;
+	cnd_broadcast(&data->wake);
+	mtx_unlock(&data->lock);
+	for (size_t i = 0; data->workers && i < data->children_size; ++i) {
+		struct nbts_tee_worker *worker = &data->workers[i];
+		if (worker->started) thrd_join(worker->thread, nullptr);
+		if (worker->stream) fclose(worker->stream);
+	}
+	if (data->record) fclose(data->record);
+	cnd_destroy(&data->wake);
+	mtx_destroy(&data->lock);
+	free(data->workers);
+	free(data->buffers);
+	free(data->ring);
+	*data = (struct nbts_tee_handler_data){};
+}
+
+static nbts_handler_fn *nullable
+child_fn(struct nbts_tee_child const *restrict nonnull child, enum nbts_type type)
+{
+	return child->handler ? child->handler->handle[type] : nullptr;
+}
+
+/// Copies the tag from `stream` to the ring while the workers handling
+/// `type` parse it, and returns the first error.
+static enum nbts_error fan_out(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	enum nbts_type type,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	// Only this thread starts workers, so `started` needs no lock.
+	for (size_t i = 0; i < data->children_size; ++i) {
+		struct nbts_tee_worker *worker = &data->workers[i];
+		if (worker->started || !child_fn(worker->child, type)) continue;
+		if (thrd_create(&worker->thread, &work, worker) != thrd_success) {
+			(void) nbts_skip_handler.handle[type](nullptr, name_size, stream);
+			return NBTS_ALLOC_ERR;
+		}
+		worker->started = true;
+	}
+
+	mtx_lock(&data->lock);
+	data->start = data->head;
+	data->name_size = name_size;
+	data->finished = false;
+	for (size_t i = 0; i < data->children_size; ++i) {
+		struct nbts_tee_worker *worker = &data->workers[i];
+		worker->fn = child_fn(worker->child, type);
+		worker->position = data->start;
+	}
+	cnd_broadcast(&data->wake);
+	mtx_unlock(&data->lock);
+
+	// The whole tag is copied even if every child has failed, so the source
+	// is left after it.
+	enum nbts_error err = nbts_copy_bytes(data->record, stream, name_size * sizeof(nbts_char));
+	if (!err) err = nbts_copy_payload(data->record, stream, type);
+	if (fflush(data->record) == EOF && !err) err = NBTS_WRITE_ERR;
+
+	mtx_lock(&data->lock);
+	data->finished = true;
+	cnd_broadcast(&data->wake);
+	for (size_t i = 0; i < data->children_size; ++i) {
+		struct nbts_tee_worker *worker = &data->workers[i];
+		while (worker->fn) cnd_wait(&data->wake, &data->lock);
+		if (!err) err = worker->err;
+		worker->err = NBTS_OK;
+	}
+	mtx_unlock(&data->lock);
+	return err;
+}
+
+static enum nbts_error tee(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	enum nbts_type type,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	size_t count = 0;
+	struct nbts_tee_child const *only = nullptr;
+	for (size_t i = 0; i < data->children_size; ++i) {
+		if (!child_fn(&data->children[i], type)) continue;
+		only = &data->children[i];
+		++count;
+	}
+
+	if (count == 0) return nbts_skip_handler.handle[type](nullptr, name_size, stream);
+	if (count == 1) return child_fn(only, type)(only->userdata, name_size, stream);
+	return fan_out(data, type, name_size, stream);
+}
+
+// NOLINTBEGIN(bugprone-easily-swappable-parameters)
+
+enum nbts_error nbts_tee_handle_byte(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return tee(data, NBTS_BYTE, name_size, stream);
+}
+
+enum nbts_error nbts_tee_handle_short(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return tee(data, NBTS_SHORT, name_size, stream);
+}
+
+enum nbts_error nbts_tee_handle_int(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return tee(data, NBTS_INT, name_size, stream);
+}
+
+enum nbts_error nbts_tee_handle_long(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return tee(data, NBTS_LONG, name_size, stream);
+}
+
+enum nbts_error nbts_tee_handle_float(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return tee(data, NBTS_FLOAT, name_size, stream);
+}
+
+enum nbts_error nbts_tee_handle_double(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return tee(data, NBTS_DOUBLE, name_size, stream);
+}
+
+enum nbts_error nbts_tee_handle_string(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return tee(data, NBTS_STRING, name_size, stream);
+}
+
+enum nbts_error nbts_tee_handle_byte_array(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return tee(data, NBTS_BYTE_ARRAY, name_size, stream);
+}
+
+enum nbts_error nbts_tee_handle_int_array(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return tee(data, NBTS_INT_ARRAY, name_size, stream);
+}
+
+enum nbts_error nbts_tee_handle_long_array(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return tee(data, NBTS_LONG_ARRAY, name_size, stream);
+}
+
+enum nbts_error nbts_tee_handle_list(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return tee(data, NBTS_LIST, name_size, stream);
+}
+
+enum nbts_error nbts_tee_handle_compound(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream)
+{
+	return tee(data, NBTS_COMPOUND, name_size, stream);
+}
+
+// NOLINTEND(bugprone-easily-swappable-parameters)
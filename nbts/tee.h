@@ -0,0 +1,187 @@
+#pragma once
+
+/// \file
+///
+/// \brief A handler feeding one parse pass to several child handlers.
+///
+/// Handlers pull their input from a `FILE *`, so they cannot be driven in
+/// lockstep by a single caller. Instead, every child runs on a thread of its
+/// own, reading from a stream over a shared ring buffer. \ref nbts_tee_handler
+/// copies each tag it is given from the source into the ring, decoding only
+/// the headers of nested tags to find its end, while the children parse it
+/// as it arrives. The source is read and decompressed once, and memory stays
+/// bounded by the ring no matter how large the tag is.
+///
+/// The children run concurrently, so they must not share state that is not
+/// safe to share between threads. A child gets its thread the first time it
+/// handles a tag together with another child, so there is at most one thread
+/// per child, however many processors there are. A pool with fewer threads
+/// would not do: the children advance through the bounded ring together, and
+/// a child waiting for a thread would stall the others.
+///
+/// The worker streams rely on how glibc seeks a cookie stream, which it does
+/// not document: a seek outside of the buffer goes to the start of a
+/// buffer-sized block and reads up to the target, which can lie up to a block
+/// before the data returned so far. The ring keeps two blocks behind every
+/// child for this. If a C library seeks further back, the seek fails and the
+/// child sees \ref NBTS_READ_ERR, never wrong data.
+///
+/// If only one child handles a type, the tag is passed through to it on the
+/// calling thread, and if no child handles it, it is skipped.
+
+#include <nbts/nbts.h>
+
+#include <threads.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// One handler receiving the tags passed to \ref nbts_tee_handler.
+struct nbts_tee_child {
+	/// The handler of the child. `nullptr` handles no tags.
+	struct nbts_handler const *nullable handler;
+	/// The userdata passed to `handler`.
+	void *nullable userdata;
+};
+
+extern struct nbts_handler const nbts_tee_handler;
+
+struct nbts_tee_handler_data;
+
+/// The thread and stream of one \ref nbts_tee_child.
+struct nbts_tee_worker {
+	struct nbts_tee_handler_data *nonnull tee;
+	struct nbts_tee_child const *nonnull child;
+	/// Valid if `started` is set.
+	thrd_t thread;
+	/// Set once `thread` has been started.
+	bool started;
+	/// The stream over the ring, only used by `thread`.
+	FILE *nullable stream;
+	/// The offset in the ring of the next byte returned to `stream`.
+	uint64_t position;
+	/// The handler to run on the current tag, or `nullptr` when idle.
+	nbts_handler_fn *nullable fn;
+	/// The result of `fn`, valid once it is reset to `nullptr`.
+	enum nbts_error err;
+};
+
+/// Userdata for \ref nbts_tee_handler.
+///
+/// This is initialized with \ref nbts_tee_handler_data_init and has to be
+/// released with \ref nbts_tee_handler_data_free. It must not be moved in
+/// between.
+struct nbts_tee_handler_data {
+	struct nbts_tee_child const *nonnull children;
+	size_t children_size;
+	/// One worker per child.
+	struct nbts_tee_worker *nullable workers;
+	/// The buffers of the worker streams, one block each.
+	char *nullable buffers;
+
+	/// The tags copied from the source. Bytes are overwritten once every
+	/// busy worker is two blocks past them, so short seeks back can be
+	/// served.
+	uint8_t *nullable ring;
+	/// The number of bytes written to the ring.
+	uint64_t head;
+	/// The offset in the ring of the current tag.
+	uint64_t start;
+	/// The name size of the current tag.
+	nbts_strsize name_size;
+	/// Set once the current tag has been written completely.
+	bool finished;
+	/// Set by \ref nbts_tee_handler_data_free to stop the workers.
+	bool closed;
+	/// The stream appending to the ring.
+	FILE *nullable record;
+
+	/// Guards all of the fields above that change after initialization.
+	mtx_t lock;
+	/// Broadcast whenever the ring or the state of a worker changes.
+	cnd_t wake;
+};
+
+/// Initializes `data` to dispatch to the `children_size` handlers in
+/// `children`.
+///
+/// When several children fail on a tag, the error of the first one in
+/// `children` is returned, and if a thread cannot be started,
+/// \ref NBTS_ALLOC_ERR. The tag is consumed from the source either way.
+///
+/// `children` must outlive `data`.
+enum nbts_error nbts_tee_handler_data_init(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	struct nbts_tee_child const *restrict nonnull children,
+	size_t children_size);
+
+/// Releases the resources held by `data`.
+void nbts_tee_handler_data_free(struct nbts_tee_handler_data *restrict nonnull data);
+
+enum nbts_error nbts_tee_handle_byte(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_tee_handle_short(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_tee_handle_int(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_tee_handle_long(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_tee_handle_float(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_tee_handle_double(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_tee_handle_string(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_tee_handle_byte_array(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_tee_handle_int_array(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_tee_handle_long_array(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_tee_handle_list(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+enum nbts_error nbts_tee_handle_compound(
+	struct nbts_tee_handler_data *restrict nonnull data,
+	nbts_strsize name_size,
+	FILE *restrict nonnull stream);
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,220 @@
+#include <nbts/measure.h>
+#include <nbts/template.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+/// Stores the low `size` bytes of `x` at `dest` in big endian order.
+static void store_be(uint8_t *restrict nonnull dest, uint64_t x, size_t size)
+{
+	for (size_t i = size; i-- > 0; x >>= 8) dest[i] = (uint8_t) x;
+}
+
+enum nbts_error nbts_template_init(struct nbts_template *restrict nonnull tpl)
+{
+	*tpl = (struct nbts_template){};
+	tpl->stream = open_memstream(&tpl->buffer, &tpl->size);
+	if (!tpl->stream) return NBTS_ALLOC_ERR;
+	return NBTS_OK;
+}
+
+void nbts_template_free(struct nbts_template *restrict nonnull tpl)
+{
+	if (tpl->stream) fclose(tpl->stream);
+	free(tpl->buffer);
+	free(tpl->slots);
+	*tpl = (struct nbts_template){};
+}
+
+enum nbts_error nbts_template_add_slot(
+	struct nbts_template *restrict nonnull tpl, enum nbts_type type, size_t *restrict nonnull slot)
+{
+	if (type == NBTS_END || type == NBTS_LIST || type == NBTS_COMPOUND) return NBTS_INVALID_ID;
+
+	if (tpl->slot_count == tpl->slot_capacity) {
+		size_t capacity = tpl->slot_capacity ? 2 * tpl->slot_capacity : 8;
+		struct nbts_template_slot *slots = realloc(tpl->slots, capacity * sizeof(*slots));
+		if (!slots) return NBTS_ALLOC_ERR;
+		tpl->slots = slots;
+		tpl->slot_capacity = capacity;
+	}
+
+	off_t offset = ftello(tpl->stream);
+	if (offset == -1) return NBTS_WRITE_ERR;
+
+	// Strings and arrays start out empty, so only their size is written.
+	size_t size = nbts_measure_fixed(type);
+	if (type == NBTS_STRING) size = sizeof(nbts_strsize);
+	if (!size) size = sizeof(nbts_size);
+	static uint8_t const zero[sizeof(uint64_t)] = {};
+	if (fwrite(zero, 1, size, tpl->stream) != size) return NBTS_WRITE_ERR;
+
+	*slot = tpl->slot_count++;
+	tpl->slots[*slot] = (struct nbts_template_slot){.offset = offset, .type = type};
+	return NBTS_OK;
+}
+
+enum nbts_error nbts_template_finish(struct nbts_template *restrict nonnull tpl)
+{
+	int ret = fclose(tpl->stream);
+	tpl->stream = nullptr;
+	if (ret == EOF) return NBTS_WRITE_ERR;
+	tpl->data = (uint8_t *) tpl->buffer;
+	return NBTS_OK;
+}
+
+// NOLINTBEGIN(bugprone-easily-swappable-parameters)
+
+static uint8_t *nonnull slot_data(struct nbts_template *restrict nonnull tpl, size_t slot)
+{
+	return &tpl->data[tpl->slots[slot].offset];
+}
+
+void nbts_template_set_byte(struct nbts_template *restrict nonnull tpl, size_t slot, nbts_byte x)
+{
+	store_be(slot_data(tpl, slot), (uint8_t) x, sizeof(x));
+}
+
+void nbts_template_set_short(struct nbts_template *restrict nonnull tpl, size_t slot, nbts_short x)
+{
+	store_be(slot_data(tpl, slot), (uint16_t) x, sizeof(x));
+}
+
+void nbts_template_set_int(struct nbts_template *restrict nonnull tpl, size_t slot, nbts_int x)
+{
+	store_be(slot_data(tpl, slot), (uint32_t) x, sizeof(x));
+}
+
+void nbts_template_set_long(struct nbts_template *restrict nonnull tpl, size_t slot, nbts_long x)
+{
+	store_be(slot_data(tpl, slot), (uint64_t) x, sizeof(x));
+}
+
+void nbts_template_set_float(struct nbts_template *restrict nonnull tpl, size_t slot, nbts_float x)
+{
+	uint32_t bits = 0;
+	static_assert(sizeof(x) == sizeof(bits));
+	memcpy(&bits, &x, sizeof(bits));
+	store_be(slot_data(tpl, slot), bits, sizeof(bits));
+}
+
+void nbts_template_set_double(
+	struct nbts_template *restrict nonnull tpl, size_t slot, nbts_double x)
+{
+	uint64_t bits = 0;
+	static_assert(sizeof(x) == sizeof(bits));
+	memcpy(&bits, &x, sizeof(bits));
+	store_be(slot_data(tpl, slot), bits, sizeof(bits));
+}
+
+/// Resizes the payload of the string or array `slot` to `size` elements of
+/// `element_size` bytes, after a size prefix of `prefix_size` bytes, and
+/// stores the new prefix.
+///
+/// The encoding after the slot is moved, and the slots in it are updated.
+static enum nbts_error resize_slot(
+	struct nbts_template *restrict nonnull tpl,
+	size_t slot,
+	size_t prefix_size,
+	size_t element_size,
+	size_t size)
+{
+	struct nbts_template_slot *s = &tpl->slots[slot];
+	size_t start = s->offset + prefix_size;
+	size_t old_size = s->size * element_size;
+	size_t new_size = size * element_size;
+
+	if (new_size != old_size) {
+		size_t rest = tpl->size - start - old_size;
+		if (new_size > old_size) {
+			uint8_t *data = realloc(tpl->data, tpl->size + new_size - old_size);
+			if (!data) return NBTS_ALLOC_ERR;
+			tpl->data = data;
+			tpl->buffer = (char *) data;
+		}
+		memmove(&tpl->data[start + new_size], &tpl->data[start + old_size], rest);
+		tpl->size = tpl->size - old_size + new_size;
+
+		// Slots are added in the order of the encoding.
+		for (size_t i = slot + 1; i < tpl->slot_count; ++i) {
+			tpl->slots[i].offset = tpl->slots[i].offset - old_size + new_size;
+		}
+	}
+
+	s->size = size;
+	store_be(&tpl->data[s->offset], size, prefix_size);
+	return NBTS_OK;
+}
+
+enum nbts_error nbts_template_set_string(
+	struct nbts_template *restrict nonnull tpl,
+	size_t slot,
+	nbts_char const *restrict nonnull src,
+	size_t size)
+{
+	if (size > UINT16_MAX) return NBTS_LIMIT_EXCEEDED;
+	TRY(resize_slot(tpl, slot, sizeof(nbts_strsize), sizeof(*src), size));
+	memcpy(slot_data(tpl, slot) + sizeof(nbts_strsize), src, size * sizeof(*src));
+	return NBTS_OK;
+}
+
+enum nbts_error nbts_template_set_byte_array(
+	struct nbts_template *restrict nonnull tpl,
+	size_t slot,
+	nbts_byte const *restrict nonnull src,
+	size_t size)
+{
+	if (size > INT32_MAX) return NBTS_LIMIT_EXCEEDED;
+	TRY(resize_slot(tpl, slot, sizeof(nbts_size), sizeof(*src), size));
+	memcpy(slot_data(tpl, slot) + sizeof(nbts_size), src, size * sizeof(*src));
+	return NBTS_OK;
+}
+
+enum nbts_error nbts_template_set_int_array(
+	struct nbts_template *restrict nonnull tpl,
+	size_t slot,
+	nbts_int const *restrict nonnull src,
+	size_t size)
+{
+	if (size > INT32_MAX) return NBTS_LIMIT_EXCEEDED;
+	TRY(resize_slot(tpl, slot, sizeof(nbts_size), sizeof(*src), size));
+	uint8_t *dest = slot_data(tpl, slot) + sizeof(nbts_size);
+	for (size_t i = 0; i < size; ++i) {
+		store_be(&dest[i * sizeof(*src)], (uint32_t) src[i], sizeof(*src));
+	}
+	return NBTS_OK;
+}
+
+enum nbts_error nbts_template_set_long_array(
+	struct nbts_template *restrict nonnull tpl,
+	size_t slot,
+	nbts_long const *restrict nonnull src,
+	size_t size)
+{
+	if (size > INT32_MAX) return NBTS_LIMIT_EXCEEDED;
+	TRY(resize_slot(tpl, slot, sizeof(nbts_size), sizeof(*src), size));
+	uint8_t *dest = slot_data(tpl, slot) + sizeof(nbts_size);
+	for (size_t i = 0; i < size; ++i) {
+		store_be(&dest[i * sizeof(*src)], (uint64_t) src[i], sizeof(*src));
+	}
+	return NBTS_OK;
+}
+
+// NOLINTEND(bugprone-easily-swappable-parameters)
+
+#undef nonnull
+#undef nullable
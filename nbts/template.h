@@ -0,0 +1,122 @@
+#pragma once
+
+/// \file
+///
+/// \brief Pre-encoded messages with patchable values.
+///
+/// Servers send the same shapes of NBT, such as item stacks, over and over,
+/// with only a few values changing. A \ref nbts_template holds the encoding
+/// of such a message, written once with the functions in \ref write.h, and
+/// slots marking the values that change. Setting a slot stores the new value
+/// in the encoding in place, so each message only costs a few stores and a
+/// copy of `data`.
+///
+/// NBT has no byte lengths above the level of strings and arrays, so a slot
+/// whose size changes is handled by moving the rest of the encoding, and the
+/// message is never encoded again.
+
+#include <nbts/nbts.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// A value in a \ref nbts_template.
+struct nbts_template_slot {
+	/// The offset of the payload in the encoding.
+	size_t offset;
+	/// The number of characters or elements of a string or array.
+	size_t size;
+	enum nbts_type type;
+};
+
+/// An encoded message and the slots in it.
+struct nbts_template {
+	/// The encoding, valid after \ref nbts_template_finish.
+	uint8_t *nullable data;
+	size_t size;
+
+	struct nbts_template_slot *nullable slots;
+	size_t slot_count;
+	size_t slot_capacity;
+
+	/// The stream to write the message to, until it is finished.
+	FILE *nullable stream;
+	/// The buffer written by `stream`, which becomes `data`.
+	char *nullable buffer;
+};
+
+/// Starts building `tpl` and opens `tpl->stream`.
+///
+/// Write the message to `tpl->stream` with the functions in \ref write.h,
+/// writing payloads that change with \ref nbts_template_add_slot, then call
+/// \ref nbts_template_finish. The template must be freed with
+/// \ref nbts_template_free.
+enum nbts_error nbts_template_init(struct nbts_template *restrict nonnull tpl);
+
+/// Frees the resources owned by `tpl`.
+void nbts_template_free(struct nbts_template *restrict nonnull tpl);
+
+/// Writes a payload of `type` to `tpl->stream` and stores the index of the
+/// slot holding it in `slot`.
+///
+/// The payload is zero, or an empty string or array. `type` is neither
+/// \ref NBTS_LIST nor \ref NBTS_COMPOUND.
+enum nbts_error nbts_template_add_slot(
+	struct nbts_template *restrict nonnull tpl, enum nbts_type type, size_t *restrict nonnull slot);
+
+/// Closes `tpl->stream` and makes the encoding available in `tpl->data`.
+enum nbts_error nbts_template_finish(struct nbts_template *restrict nonnull tpl);
+
+// The setters below shall only be called on a finished template, with a
+// slot of the matching type.
+
+void nbts_template_set_byte(struct nbts_template *restrict nonnull tpl, size_t slot, nbts_byte x);
+void nbts_template_set_short(struct nbts_template *restrict nonnull tpl, size_t slot, nbts_short x);
+void nbts_template_set_int(struct nbts_template *restrict nonnull tpl, size_t slot, nbts_int x);
+void nbts_template_set_long(struct nbts_template *restrict nonnull tpl, size_t slot, nbts_long x);
+void nbts_template_set_float(struct nbts_template *restrict nonnull tpl, size_t slot, nbts_float x);
+void nbts_template_set_double(
+	struct nbts_template *restrict nonnull tpl, size_t slot, nbts_double x);
+
+/// Sets a string slot to the `size` characters at `src`.
+///
+/// If the size differs from the previous value, the rest of the encoding is
+/// moved, which may fail with \ref NBTS_ALLOC_ERR. Returns
+/// \ref NBTS_LIMIT_EXCEEDED if `size` does not fit into \ref nbts_strsize.
+enum nbts_error nbts_template_set_string(
+	struct nbts_template *restrict nonnull tpl,
+	size_t slot,
+	nbts_char const *restrict nonnull src,
+	size_t size);
+
+/// Sets an array slot to the `size` elements at `src`, like
+/// \ref nbts_template_set_string.
+enum nbts_error nbts_template_set_byte_array(
+	struct nbts_template *restrict nonnull tpl,
+	size_t slot,
+	nbts_byte const *restrict nonnull src,
+	size_t size);
+
+/// Sets an array slot to the `size` elements at `src`, like
+/// \ref nbts_template_set_string.
+enum nbts_error nbts_template_set_int_array(
+	struct nbts_template *restrict nonnull tpl,
+	size_t slot,
+	nbts_int const *restrict nonnull src,
+	size_t size);
+
+/// Sets an array slot to the `size` elements at `src`, like
+/// \ref nbts_template_set_string.
+enum nbts_error nbts_template_set_long_array(
+	struct nbts_template *restrict nonnull tpl,
+	size_t slot,
+	nbts_long const *restrict nonnull src,
+	size_t size);
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,256 @@
+#include <nbts/transform.h>
+#include <nbts/walk.h>
+#include <nbts/write.h>
+
+#include <string.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+struct context {
+	struct nbts_transform_rule const *nonnull rules;
+	size_t rules_size;
+	FILE *nonnull istream;
+	FILE *nonnull ostream;
+};
+
+struct nbts_transform_rule nbts_transform_drop(char const *nonnull path)
+{
+	return (struct nbts_transform_rule){.path = path, .action = NBTS_TRANSFORM_DROP};
+}
+
+struct nbts_transform_rule nbts_transform_rename(char const *nonnull path, char const *nonnull name)
+{
+	return (struct nbts_transform_rule){
+		.path = path,
+		.action = NBTS_TRANSFORM_RENAME,
+		.name = (nbts_char const *) name,
+		.name_size = strlen(name),
+	};
+}
+
+struct nbts_transform_rule nbts_transform_replace(
+	char const *nonnull path, nbts_transform_replace_fn *nonnull replace, void *nullable userdata)
+{
+	return (struct nbts_transform_rule){
+		.path = path,
+		.action = NBTS_TRANSFORM_REPLACE,
+		.replace = replace,
+		.userdata = userdata,
+	};
+}
+
+struct nbts_transform_rule nbts_transform_filter(
+	char const *nonnull path, nbts_transform_filter_fn *nonnull filter, void *nullable userdata)
+{
+	return (struct nbts_transform_rule){
+		.path = path,
+		.action = NBTS_TRANSFORM_FILTER,
+		.filter = filter,
+		.userdata = userdata,
+	};
+}
+
+static struct nbts_transform_rule const *nullable
+find_rule(struct context const *restrict nonnull ctx, struct nbts_path const *restrict nonnull path)
+{
+	for (size_t i = 0; i < ctx->rules_size; ++i) {
+		struct nbts_transform_rule const *rule = &ctx->rules[i];
+		if (rule->action == NBTS_TRANSFORM_FILTER) continue;
+		if (nbts_path_match(rule->path, path)) return rule;
+	}
+	return nullptr;
+}
+
+static struct nbts_transform_rule const *nullable
+find_filter(struct context const *restrict nonnull ctx, struct nbts_path const *restrict nonnull path)
+{
+	for (size_t i = 0; i < ctx->rules_size; ++i) {
+		struct nbts_transform_rule const *rule = &ctx->rules[i];
+		if (rule->action != NBTS_TRANSFORM_FILTER) continue;
+		if (nbts_path_match(rule->path, path)) return rule;
+	}
+	return nullptr;
+}
+
+static bool has_descendant_rules(
+	struct context const *restrict nonnull ctx, struct nbts_path const *restrict nonnull path)
+{
+	for (size_t i = 0; i < ctx->rules_size; ++i) {
+		char const *rest = nbts_path_match_prefix(ctx->rules[i].path, path);
+		if (rest && *rest) return true;
+	}
+	return false;
+}
+
+static enum nbts_error transform_payload(
+	struct context const *restrict nonnull ctx,
+	struct nbts_path const *restrict nonnull path,
+	enum nbts_type type);
+
+static enum nbts_error transform_named(
+	struct context const *restrict nonnull ctx,
+	struct nbts_path const *restrict nullable parent,
+	enum nbts_type type,
+	nbts_char const *restrict nonnull name,
+	nbts_strsize name_size)
+{
+	struct nbts_path path = nbts_path_name(parent, name, name_size);
+	struct nbts_transform_rule const *rule = find_rule(ctx, &path);
+
+	if (rule && rule->action == NBTS_TRANSFORM_DROP) return nbts_skip_payload(type, ctx->istream);
+
+	if (rule && rule->action == NBTS_TRANSFORM_RENAME) {
+		TRY(nbts_write_tag_header(ctx->ostream, type, rule->name, rule->name_size));
+	} else {
+		TRY(nbts_write_tag_header(ctx->ostream, type, name, name_size));
+	}
+
+	if (rule && rule->action == NBTS_TRANSFORM_REPLACE) {
+		return rule->replace(rule->userdata, &path, type, ctx->istream, ctx->ostream);
+	}
+
+	return transform_payload(ctx, &path, type);
+}
+
+static enum nbts_error transform_child(
+	struct context const *restrict nonnull ctx,
+	struct nbts_path const *restrict nullable parent,
+	enum nbts_type type)
+{
+	nbts_strsize name_size = 0;
+	TRY(nbts_parse_strsize(&name_size, ctx->istream));
+
+	nbts_char buffer[NBTS_NAME_BUFSIZE];
+	nbts_char *name = nbts_name_alloc(buffer, name_size);
+	if (!name) return NBTS_ALLOC_ERR;
+
+	enum nbts_error err = nbts_parse_string(name, name_size, ctx->istream);
+	if (!err) err = transform_named(ctx, parent, type, name, name_size);
+
+	nbts_name_free(name, buffer);
+	return err;
+}
+
+static enum nbts_error transform_compound(
+	struct context const *restrict nonnull ctx, struct nbts_path const *restrict nonnull path)
+{
+	while (1) {
+		enum nbts_type type = 0;
+		TRY(nbts_parse_typeid(&type, ctx->istream));
+		if (type == NBTS_END) break;
+		TRY(transform_child(ctx, path, type));
+	}
+	return nbts_write_typeid(ctx->ostream, NBTS_END);
+}
+
+static enum nbts_error filter_element(
+	struct context const *restrict nonnull ctx,
+	struct nbts_transform_rule const *restrict nonnull filter,
+	struct nbts_path const *restrict nonnull path,
+	enum nbts_type type,
+	bool *restrict nonnull keep)
+{
+	long start = ftell(ctx->istream);
+	if (start == -1) return NBTS_READ_ERR;
+
+	*keep = true;
+	TRY(filter->filter(filter->userdata, path, type, ctx->istream, keep));
+	if (fseek(ctx->istream, start, SEEK_SET) == -1) return NBTS_READ_ERR;
+	return NBTS_OK;
+}
+
+static enum nbts_error transform_list(
+	struct context const *restrict nonnull ctx, struct nbts_path const *restrict nonnull path)
+{
+	enum nbts_type type = 0;
+	TRY(nbts_parse_typeid(&type, ctx->istream));
+
+	nbts_size size = 0;
+	TRY(nbts_parse_size(&size, ctx->istream));
+
+	TRY(nbts_write_typeid(ctx->ostream, type));
+	long size_pos = ftell(ctx->ostream);
+	TRY(nbts_write_size(ctx->ostream, size));
+
+	struct nbts_transform_rule const *filter = find_filter(ctx, path);
+
+	nbts_size kept = 0;
+	for (nbts_size i = 0; i < size; ++i) {
+		struct nbts_path element = nbts_path_index(path, i);
+
+		bool keep = true;
+		if (filter) TRY(filter_element(ctx, filter, &element, type, &keep));
+
+		struct nbts_transform_rule const *rule = find_rule(ctx, &element);
+		if (rule && rule->action == NBTS_TRANSFORM_DROP) keep = false;
+
+		if (!keep) {
+			TRY(nbts_skip_payload(type, ctx->istream));
+			continue;
+		}
+
+		if (rule && rule->action == NBTS_TRANSFORM_REPLACE) {
+			TRY(rule->replace(rule->userdata, &element, type, ctx->istream, ctx->ostream));
+		} else {
+			TRY(transform_payload(ctx, &element, type));
+		}
+		kept += 1;
+	}
+
+	if (kept == size) return NBTS_OK;
+
+	// Elements were removed, so the size written up front is corrected.
+	long end_pos = ftell(ctx->ostream);
+	if (size_pos == -1 || end_pos == -1) return NBTS_WRITE_ERR;
+	if (fseek(ctx->ostream, size_pos, SEEK_SET) == -1) return NBTS_WRITE_ERR;
+	TRY(nbts_write_size(ctx->ostream, kept));
+	if (fseek(ctx->ostream, end_pos, SEEK_SET) == -1) return NBTS_WRITE_ERR;
+	return NBTS_OK;
+}
+
+static enum nbts_error transform_payload(
+	struct context const *restrict nonnull ctx,
+	struct nbts_path const *restrict nonnull path,
+	enum nbts_type type)
+{
+	bool descend = has_descendant_rules(ctx, path) || find_filter(ctx, path);
+	if (!descend) return nbts_copy_payload(ctx->ostream, ctx->istream, type);
+
+	switch (type) {
+	case NBTS_COMPOUND: return transform_compound(ctx, path);
+	case NBTS_LIST: return transform_list(ctx, path);
+	default: return nbts_copy_payload(ctx->ostream, ctx->istream, type);
+	}
+}
+
+enum nbts_error nbts_transform_tag(
+	FILE *restrict nonnull istream,
+	FILE *restrict nonnull ostream,
+	struct nbts_transform_rule const *restrict nonnull rules,
+	size_t rules_size)
+{
+	struct context ctx = {
+		.rules = rules,
+		.rules_size = rules_size,
+		.istream = istream,
+		.ostream = ostream,
+	};
+
+	enum nbts_type type = 0;
+	TRY(nbts_parse_typeid(&type, istream));
+	if (type == NBTS_END) return NBTS_UNEXPECTED_END_TAG;
+
+	return transform_child(&ctx, nullptr, type);
+}
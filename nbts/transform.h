@@ -0,0 +1,101 @@
+#pragma once
+
+/// \file
+///
+/// \brief A streaming read-modify-write stage.
+///
+/// \ref nbts_transform_tag copies one tag from an input to an output stream,
+/// applying a list of \ref nbts_transform_rule as the tags flow through.
+/// Subtrees that no rule can apply to are copied byte-for-byte as if by
+/// \ref nbts_copy_payload, without decoding their tags. Memory usage depends
+/// only on the nesting depth, not on the size of the input.
+
+#include <nbts/nbts.h>
+#include <nbts/path.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// The action taken by a \ref nbts_transform_rule.
+enum nbts_transform_action : uint8_t {
+	NBTS_TRANSFORM_DROP,     ///< Removes the tag from the output.
+	NBTS_TRANSFORM_RENAME,   ///< Writes the tag with a different name.
+	NBTS_TRANSFORM_REPLACE,  ///< Writes a different payload of the same type.
+	NBTS_TRANSFORM_FILTER,   ///< Removes list elements rejected by a predicate.
+};
+
+/// The type of a callback replacing a payload.
+///
+/// The callback shall read the payload of `type` from `istream` and write a
+/// payload of the same type to `ostream`.
+typedef enum nbts_error nbts_transform_replace_fn(
+	void *nullable userdata,
+	struct nbts_path const *restrict nonnull path,
+	enum nbts_type type,
+	FILE *restrict nonnull istream,
+	FILE *restrict nonnull ostream);
+
+/// The type of a callback deciding whether to keep a list element.
+///
+/// The callback may read the payload of `type` from `istream`; the stream is
+/// repositioned afterwards. It shall set `keep` to `false` to remove the
+/// element from the output.
+typedef enum nbts_error nbts_transform_filter_fn(
+	void *nullable userdata,
+	struct nbts_path const *restrict nonnull path,
+	enum nbts_type type,
+	FILE *restrict nonnull istream,
+	bool *restrict nonnull keep);
+
+/// A rule applied by \ref nbts_transform_tag.
+///
+/// `path` is a pattern as accepted by \ref nbts_path_match. For
+/// \ref NBTS_TRANSFORM_FILTER it designates the list whose elements are
+/// filtered. The first rule matching a tag is applied to it.
+struct nbts_transform_rule {
+	char const *nonnull path;
+	enum nbts_transform_action action;
+	/// The new name for \ref NBTS_TRANSFORM_RENAME.
+	nbts_char const *nullable name;
+	/// The size of `name`.
+	nbts_strsize name_size;
+	/// The callback for \ref NBTS_TRANSFORM_REPLACE.
+	nbts_transform_replace_fn *nullable replace;
+	/// The callback for \ref NBTS_TRANSFORM_FILTER.
+	nbts_transform_filter_fn *nullable filter;
+	/// Passed to `replace` and `filter`.
+	void *nullable userdata;
+};
+
+/// Returns a rule removing the tags matching `path`.
+struct nbts_transform_rule nbts_transform_drop(char const *nonnull path);
+
+/// Returns a rule renaming the tags matching `path` to the string `name`.
+struct nbts_transform_rule nbts_transform_rename(char const *nonnull path, char const *nonnull name);
+
+/// Returns a rule replacing the payloads matching `path` using `replace`.
+struct nbts_transform_rule nbts_transform_replace(
+	char const *nonnull path, nbts_transform_replace_fn *nonnull replace, void *nullable userdata);
+
+/// Returns a rule filtering the elements of the lists matching `path`.
+struct nbts_transform_rule nbts_transform_filter(
+	char const *nonnull path, nbts_transform_filter_fn *nonnull filter, void *nullable userdata);
+
+/// Copies one named tag from `istream` to `ostream`, applying `rules`.
+///
+/// `istream` must be seekable. `ostream` must be seekable if a
+/// \ref NBTS_TRANSFORM_FILTER rule removes list elements, so the size of the
+/// list can be corrected.
+enum nbts_error nbts_transform_tag(
+	FILE *restrict nonnull istream,
+	FILE *restrict nonnull ostream,
+	struct nbts_transform_rule const *restrict nonnull rules,
+	size_t rules_size);
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,297 @@
+#include <nbts/cursor.h>
+#include <nbts/view.h>
+
+#include <string.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+// NOLINTBEGIN(bugprone-easily-swappable-parameters)
+
+struct nbts_arena nbts_arena(void *nonnull data, size_t capacity)
+{
+	return (struct nbts_arena){.data = data, .capacity = capacity};
+}
+
+void *nullable
+nbts_arena_alloc(struct nbts_arena *restrict nonnull arena, size_t size, size_t align)
+{
+	uintptr_t base = (uintptr_t) arena->data;
+	size_t offset = ((base + arena->size + align - 1) & ~(uintptr_t) (align - 1)) - base;
+	if (offset > arena->capacity || size > arena->capacity - offset) return nullptr;
+	arena->size = offset + size;
+	return (uint8_t *) arena->data + offset;
+}
+
+static enum nbts_error skip_payload(struct nbts_cursor *restrict nonnull c, enum nbts_type type);
+
+static enum nbts_error skip_array(struct nbts_cursor *restrict nonnull c, size_t element_size)
+{
+	size_t size = 0;
+	TRY(nbts_cursor_read_size(c, &size));
+	return nbts_cursor_advance(c, size * element_size);
+}
+
+static enum nbts_error skip_list(struct nbts_cursor *restrict nonnull c)
+{
+	enum nbts_type type = 0;
+	TRY(nbts_cursor_read_typeid(c, &type));
+	size_t size = 0;
+	TRY(nbts_cursor_read_size(c, &size));
+
+	if (nbts_has_fixed_size(type)) return nbts_cursor_advance(c, size * nbts_measure_fixed(type));
+	for (size_t i = 0; i < size; ++i) TRY(skip_payload(c, type));
+	return NBTS_OK;
+}
+
+static enum nbts_error skip_compound(struct nbts_cursor *restrict nonnull c)
+{
+	while (1) {
+		enum nbts_type type = 0;
+		TRY(nbts_cursor_read_typeid(c, &type));
+		if (type == NBTS_END) return NBTS_OK;
+
+		nbts_strsize name_size = 0;
+		TRY(nbts_cursor_read_strsize(c, &name_size));
+		TRY(nbts_cursor_advance(c, name_size));
+		TRY(skip_payload(c, type));
+	}
+}
+
+static enum nbts_error skip_payload(struct nbts_cursor *restrict nonnull c, enum nbts_type type)
+{
+	switch (type) {
+	case NBTS_END:
+	case NBTS_BYTE:
+	case NBTS_SHORT:
+	case NBTS_INT:
+	case NBTS_LONG:
+	case NBTS_FLOAT:
+	case NBTS_DOUBLE: return nbts_cursor_advance(c, nbts_measure_fixed(type));
+	case NBTS_STRING: {
+		nbts_strsize size = 0;
+		TRY(nbts_cursor_read_strsize(c, &size));
+		return nbts_cursor_advance(c, size);
+	}
+	case NBTS_BYTE_ARRAY: return skip_array(c, sizeof(nbts_byte));
+	case NBTS_INT_ARRAY: return skip_array(c, sizeof(nbts_int));
+	case NBTS_LONG_ARRAY: return skip_array(c, sizeof(nbts_long));
+	case NBTS_LIST: return skip_list(c);
+	case NBTS_COMPOUND: return skip_compound(c);
+	}
+	return NBTS_INVALID_ID;
+}
+
+/// Checks the payload of the root as far as possible without walking its
+/// children, which are checked by \ref skip_payload when they are indexed.
+static enum nbts_error check_root(struct nbts_cursor *restrict nonnull c, enum nbts_type type)
+{
+	if (type == NBTS_COMPOUND) return NBTS_OK;
+	if (type != NBTS_LIST) return skip_payload(c, type);
+
+	enum nbts_type element = 0;
+	TRY(nbts_cursor_read_typeid(c, &element));
+	size_t size = 0;
+	TRY(nbts_cursor_read_size(c, &size));
+	if (!nbts_has_fixed_size(element)) return NBTS_OK;
+	return nbts_cursor_advance(c, size * nbts_measure_fixed(element));
+}
+
+enum nbts_error nbts_view_open(
+	struct nbts_view *restrict nonnull view,
+	void const *restrict nonnull data,
+	size_t data_size,
+	struct nbts_arena *restrict nonnull arena)
+{
+	*view = (struct nbts_view){
+		.data = data,
+		.data_size = data_size,
+		.arena = arena,
+	};
+	if (data_size > UINT32_MAX) return NBTS_LIMIT_EXCEEDED;
+
+	struct nbts_cursor c = {.data = data, .size = data_size};
+	enum nbts_type type = 0;
+	TRY(nbts_cursor_read_typeid(&c, &type));
+	if (type == NBTS_END) return NBTS_INVALID_ID;
+	nbts_strsize name_size = 0;
+	TRY(nbts_cursor_read_strsize(&c, &name_size));
+	size_t name = c.position;
+	TRY(nbts_cursor_advance(&c, name_size));
+	TRY(check_root(&c, type));
+
+	view->root = (struct nbts_view_node){
+		.name = name,
+		.payload = name + name_size,
+		.name_size = name_size,
+		.type = type,
+	};
+	return NBTS_OK;
+}
+
+static struct nbts_view_node *nullable
+push_node(struct nbts_arena *restrict nonnull arena, struct nbts_view_node node)
+{
+	struct nbts_view_node *dest =
+		nbts_arena_alloc(arena, sizeof(node), alignof(struct nbts_view_node));
+	if (dest) *dest = node;
+	return dest;
+}
+
+// The children of a node are allocated one after another while scanning.
+// Nothing else is allocated from the arena in between, so they end up
+// contiguous.
+
+static enum nbts_error index_compound(
+	struct nbts_view *restrict nonnull view,
+	struct nbts_view_node *restrict nonnull node,
+	struct nbts_view_node *nullable *restrict nonnull first)
+{
+	struct nbts_cursor c = {.data = view->data, .size = view->data_size, .position = node->payload};
+	uint32_t count = 0;
+	while (1) {
+		enum nbts_type type = 0;
+		TRY(nbts_cursor_read_typeid(&c, &type));
+		if (type == NBTS_END) break;
+
+		nbts_strsize name_size = 0;
+		TRY(nbts_cursor_read_strsize(&c, &name_size));
+		size_t name = c.position;
+		TRY(nbts_cursor_advance(&c, name_size));
+
+		struct nbts_view_node *child = push_node(
+			view->arena,
+			(struct nbts_view_node){
+				.name = name,
+				.payload = c.position,
+				.name_size = name_size,
+				.type = type,
+			});
+		if (!child) return NBTS_ALLOC_ERR;
+		if (!count++) *first = child;
+		TRY(skip_payload(&c, type));
+	}
+	node->children_size = count;
+	return NBTS_OK;
+}
+
+static enum nbts_error index_list(
+	struct nbts_view *restrict nonnull view,
+	struct nbts_view_node *restrict nonnull node,
+	struct nbts_view_node *nullable *restrict nonnull first)
+{
+	struct nbts_cursor c = {.data = view->data, .size = view->data_size, .position = node->payload};
+	enum nbts_type type = 0;
+	TRY(nbts_cursor_read_typeid(&c, &type));
+	size_t size = 0;
+	TRY(nbts_cursor_read_size(&c, &size));
+
+	node->children_size = 0;
+	if (nbts_has_fixed_size(type)) return NBTS_OK;
+
+	for (size_t i = 0; i < size; ++i) {
+		struct nbts_view_node *child =
+			push_node(view->arena, (struct nbts_view_node){.payload = c.position, .type = type});
+		if (!child) return NBTS_ALLOC_ERR;
+		if (!i) *first = child;
+		TRY(skip_payload(&c, type));
+	}
+	node->children_size = size;
+	return NBTS_OK;
+}
+
+enum nbts_error nbts_view_children(
+	struct nbts_view *restrict nonnull view,
+	struct nbts_view_node *restrict nonnull node,
+	struct nbts_view_node *nullable *restrict nonnull children,
+	size_t *restrict nonnull size)
+{
+	if (!node->indexed) {
+		if (node->type != NBTS_COMPOUND && node->type != NBTS_LIST) return NBTS_INVALID_ID;
+
+		// On failure, the partial index is released again.
+		size_t mark = view->arena->size;
+		struct nbts_view_node *first = nullptr;
+		enum nbts_error err = node->type == NBTS_COMPOUND ? index_compound(view, node, &first)
+		                                                  : index_list(view, node, &first);
+		if (err) {
+			view->arena->size = mark;
+			node->children_size = 0;
+			return err;
+		}
+		node->children = first;
+		node->indexed = true;
+	}
+
+	*children = node->children;
+	*size = node->children_size;
+	return NBTS_OK;
+}
+
+enum nbts_error nbts_view_find(
+	struct nbts_view *restrict nonnull view,
+	struct nbts_view_node *restrict nonnull node,
+	nbts_char const *restrict nonnull name,
+	nbts_strsize name_size,
+	struct nbts_view_node *nullable *restrict nonnull dest)
+{
+	*dest = nullptr;
+	if (node->type != NBTS_COMPOUND) return NBTS_INVALID_ID;
+
+	struct nbts_view_node *children = nullptr;
+	size_t size = 0;
+	TRY(nbts_view_children(view, node, &children, &size));
+
+	for (size_t i = 0; i < size; ++i) {
+		struct nbts_view_node *child = &children[i];
+		if (child->name_size == name_size && !memcmp(&view->data[child->name], name, name_size)) {
+			*dest = child;
+			break;
+		}
+	}
+	return NBTS_OK;
+}
+
+nbts_char const *nonnull nbts_view_name(
+	struct nbts_view const *restrict nonnull view,
+	struct nbts_view_node const *restrict nonnull node,
+	nbts_strsize *restrict nonnull size)
+{
+	*size = node->name_size;
+	return &view->data[node->name];
+}
+
+uint8_t const *nonnull nbts_view_payload(
+	struct nbts_view const *restrict nonnull view,
+	struct nbts_view_node const *restrict nonnull node)
+{
+	return &view->data[node->payload];
+}
+
+uint8_t const *nonnull nbts_view_list(
+	struct nbts_view const *restrict nonnull view,
+	struct nbts_view_node const *restrict nonnull node,
+	enum nbts_type *restrict nonnull type,
+	nbts_size *restrict nonnull size)
+{
+	uint8_t const *payload = nbts_view_payload(view, node);
+	*type = payload[0];
+
+	uint32_t x = 0;
+	memcpy(&x, &payload[1], sizeof(x));
+	*size = (nbts_size) nbt32toh(x);
+	return &payload[1 + sizeof(x)];
+}
+
+// NOLINTEND(bugprone-easily-swappable-parameters)
@@ -0,0 +1,123 @@
+#pragma once
+
+/// \file
+///
+/// \brief A lazily indexed read-only tree view of an in-memory NBT buffer.
+///
+/// Unlike \ref nbts_tape_build, which indexes a whole tag up front,
+/// \ref nbts_view_open only reads the header of the root tag. The children
+/// of a compound or list are indexed when they are first accessed, and only
+/// one level deep. Nested compounds and lists are skipped over without being
+/// recorded; strings and arrays are skipped in constant time. Since NBT
+/// does not store the size of compounds and lists, skipping still has to
+/// read the headers of the tags inside them.
+///
+/// The index lives in a caller-provided \ref nbts_arena. Nodes stay valid
+/// as long as the arena and the buffer do.
+
+#include <nbts/nbts.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// A caller-provided region of memory that is allocated from linearly.
+struct nbts_arena {
+	void *nonnull data;
+	size_t capacity;
+	size_t size;
+};
+
+/// Returns an empty arena in the `capacity` bytes at `data`.
+struct nbts_arena nbts_arena(void *nonnull data, size_t capacity);
+
+/// Returns `size` bytes aligned to `align` from `arena`, or `nullptr` if it
+/// is full.
+void *nullable nbts_arena_alloc(struct nbts_arena *restrict nonnull arena, size_t size, size_t align);
+
+/// One tag in a \ref nbts_view.
+struct nbts_view_node {
+	/// The children of a compound or list, or `nullptr` if not indexed yet.
+	struct nbts_view_node *nullable children;
+	/// The number of elements of `children`.
+	uint32_t children_size;
+	/// The offset of the name in the buffer, after its size.
+	uint32_t name;
+	/// The offset of the payload in the buffer.
+	uint32_t payload;
+	/// The size of the name. Elements of lists have no name.
+	nbts_strsize name_size;
+	enum nbts_type type;
+	/// Whether `children` is valid.
+	bool indexed;
+};
+
+/// A view of one named tag in a buffer.
+struct nbts_view {
+	/// The buffer the view reads from. It is not owned by the view.
+	uint8_t const *nonnull data;
+	size_t data_size;
+	/// The arena holding the index.
+	struct nbts_arena *nonnull arena;
+	struct nbts_view_node root;
+};
+
+/// Opens a view of the named tag at the start of the `data_size` bytes at
+/// `data`, keeping the index in `arena`.
+///
+/// Fails unless the root fits the buffer. Only the header of a compound
+/// root and the type and size of a list root are checked up front, unless
+/// the list holds numbers; their children are checked when they are indexed.
+enum nbts_error nbts_view_open(
+	struct nbts_view *restrict nonnull view,
+	void const *restrict nonnull data,
+	size_t data_size,
+	struct nbts_arena *restrict nonnull arena);
+
+/// Stores the children of the compound or list `node` in `children` and
+/// their number in `size`, indexing them first if necessary.
+///
+/// Lists with fixed size payloads have no child nodes; their elements are
+/// accessed with \ref nbts_view_list.
+///
+/// Returns \ref NBTS_ALLOC_ERR if the arena is full. The node is left
+/// unindexed then, so the call may be repeated with more room.
+enum nbts_error nbts_view_children(
+	struct nbts_view *restrict nonnull view,
+	struct nbts_view_node *restrict nonnull node,
+	struct nbts_view_node *nullable *restrict nonnull children,
+	size_t *restrict nonnull size);
+
+/// Stores the child of the compound `node` named `name` in `dest`, or
+/// `nullptr` if there is none.
+enum nbts_error nbts_view_find(
+	struct nbts_view *restrict nonnull view,
+	struct nbts_view_node *restrict nonnull node,
+	nbts_char const *restrict nonnull name,
+	nbts_strsize name_size,
+	struct nbts_view_node *nullable *restrict nonnull dest);
+
+/// Returns the name of `node` and stores its size in `size`.
+nbts_char const *nonnull nbts_view_name(
+	struct nbts_view const *restrict nonnull view,
+	struct nbts_view_node const *restrict nonnull node,
+	nbts_strsize *restrict nonnull size);
+
+/// Returns the payload of `node` in the wire format.
+uint8_t const *nonnull nbts_view_payload(
+	struct nbts_view const *restrict nonnull view, struct nbts_view_node const *restrict nonnull node);
+
+/// Stores the element type and size of the list `node` in `type` and
+/// `size`, and returns a pointer to the payload of its first element.
+uint8_t const *nonnull nbts_view_list(
+	struct nbts_view const *restrict nonnull view,
+	struct nbts_view_node const *restrict nonnull node,
+	enum nbts_type *restrict nonnull type,
+	nbts_size *restrict nonnull size);
+
+#undef nonnull
+#undef nullable
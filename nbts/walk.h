@@ -0,0 +1,51 @@
+#pragma once
+
+/// \file
+///
+/// \brief Helpers for walking the encoding in a stream by hand.
+///
+/// The modules that recurse over a tag themselves instead of through a
+/// handler, like \ref grep.h and \ref transform.h, all read names into a
+/// small stack buffer and skip the payloads they do not look into.
+///
+/// This header is internal to the library.
+
+#include <nbts/nbts.h>
+
+#include <stdlib.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// The size of the stack buffers for names, in characters. Longer names are
+/// rare, so they are allocated.
+enum : size_t { NBTS_NAME_BUFSIZE = 64 };
+
+/// Skips a payload of `type` in `stream`.
+static inline enum nbts_error
+nbts_skip_payload(enum nbts_type type, FILE *restrict nonnull stream)
+{
+	return nbts_skip_handler.handle[type](nullptr, 0, stream);
+}
+
+/// Returns storage for `size` characters: `buffer` of \ref NBTS_NAME_BUFSIZE
+/// characters if they fit, or else a new allocation, which is `nullptr` if
+/// allocating fails. The storage is released with \ref nbts_name_free.
+static inline nbts_char *nullable nbts_name_alloc(nbts_char *nonnull buffer, size_t size)
+{
+	return size <= NBTS_NAME_BUFSIZE ? buffer : malloc(size * sizeof(*buffer));
+}
+
+/// Releases storage returned by \ref nbts_name_alloc for `buffer`.
+static inline void nbts_name_free(nbts_char *nullable name, nbts_char const *nonnull buffer)
+{
+	if (name != buffer) free(name);
+}
+
+#undef nonnull
+#undef nullable
@@ -0,0 +1,281 @@
+#include <nbts/measure.h>
+#include <nbts/write.h>
+
+#include <endian.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define NBTS_BYTE_ORDER BIG_ENDIAN
+
+#if NBTS_BYTE_ORDER == BIG_ENDIAN
+#define htonbt16(...) htobe16(__VA_ARGS__)
+#define htonbt32(...) htobe32(__VA_ARGS__)
+#define htonbt64(...) htobe64(__VA_ARGS__)
+#elif NBTS_BYTE_ORDER == LITTLE_ENDIAN
+#define htonbt16(...) htole16(__VA_ARGS__)
+#define htonbt32(...) htole32(__VA_ARGS__)
+#define htonbt64(...) htole64(__VA_ARGS__)
+#else
+#error "Byte order not supported"
+#endif
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+#define TRY(EXPR)                      \
+	{                                  \
+		enum nbts_error _err = (EXPR); \
+		if (_err) return _err;         \
+	}
+
+// NOLINTBEGIN(bugprone-easily-swappable-parameters)
+
+static enum nbts_error xfwrite(
+	void const *restrict nonnull ptr, size_t size, size_t count, FILE *restrict nonnull stream)
+{
+	if (fwrite(ptr, size, count, stream) != count) return NBTS_WRITE_ERR;
+	return NBTS_OK;
+}
+
+enum nbts_error nbts_write_uint8(FILE *restrict nonnull stream, uint8_t x)
+{
+	return xfwrite(&x, sizeof(x), 1, stream);
+}
+
+enum nbts_error nbts_write_uint16(FILE *restrict nonnull stream, uint16_t x)
+{
+	x = htonbt16(x);
+	return xfwrite(&x, sizeof(x), 1, stream);
+}
+
+enum nbts_error nbts_write_uint32(FILE *restrict nonnull stream, uint32_t x)
+{
+	x = htonbt32(x);
+	return xfwrite(&x, sizeof(x), 1, stream);
+}
+
+enum nbts_error nbts_write_uint64(FILE *restrict nonnull stream, uint64_t x)
+{
+	x = htonbt64(x);
+	return xfwrite(&x, sizeof(x), 1, stream);
+}
+
+enum nbts_error nbts_write_typeid(FILE *restrict nonnull stream, enum nbts_type x)
+{
+	uint8_t result = 0;
+	static_assert(sizeof(x) == sizeof(result));
+	memcpy(&result, &x, sizeof(result));
+	return nbts_write_uint8(stream, result);
+}
+
+enum nbts_error nbts_write_size(FILE *restrict nonnull stream, nbts_size x)
+{
+	if (x < 0) return NBTS_INVALID_SIZE;
+	return nbts_write_int(stream, x);
+}
+
+enum nbts_error nbts_write_strsize(FILE *restrict nonnull stream, nbts_strsize x)
+{
+	return nbts_write_uint16(stream, x);
+}
+
+enum nbts_error nbts_write_byte(FILE *restrict nonnull stream, nbts_byte x)
+{
+	uint8_t result = 0;
+	static_assert(sizeof(x) == sizeof(result));
+	memcpy(&result, &x, sizeof(result));
+	return nbts_write_uint8(stream, result);
+}
+
+enum nbts_error nbts_write_short(FILE *restrict nonnull stream, nbts_short x)
+{
+	uint16_t result = 0;
+	static_assert(sizeof(x) == sizeof(result));
+	memcpy(&result, &x, sizeof(result));
+	return nbts_write_uint16(stream, result);
+}
+
+enum nbts_error nbts_write_int(FILE *restrict nonnull stream, nbts_int x)
+{
+	uint32_t result = 0;
+	static_assert(sizeof(x) == sizeof(result));
+	memcpy(&result, &x, sizeof(result));
+	return nbts_write_uint32(stream, result);
+}
+
+enum nbts_error nbts_write_long(FILE *restrict nonnull stream, nbts_long x)
+{
+	uint64_t result = 0;
+	static_assert(sizeof(x) == sizeof(result));
+	memcpy(&result, &x, sizeof(result));
+	return nbts_write_uint64(stream, result);
+}
+
+enum nbts_error nbts_write_float(FILE *restrict nonnull stream, nbts_float x)
+{
+	uint32_t result = 0;
+	static_assert(sizeof(x) == sizeof(result));
+	memcpy(&result, &x, sizeof(result));
+	return nbts_write_uint32(stream, result);
+}
+
+enum nbts_error nbts_write_double(FILE *restrict nonnull stream, nbts_double x)
+{
+	uint64_t result = 0;
+	static_assert(sizeof(x) == sizeof(result));
+	memcpy(&result, &x, sizeof(result));
+	return nbts_write_uint64(stream, result);
+}
+
+enum nbts_error
+nbts_write_string(FILE *restrict nonnull stream, nbts_char const *restrict nonnull src, size_t size)
+{
+	return xfwrite(src, sizeof(*src), size, stream);
+}
+
+enum nbts_error nbts_write_byte_array(
+	FILE *restrict nonnull stream, nbts_byte const *restrict nonnull src, size_t size)
+{
+	return xfwrite(src, sizeof(*src), size, stream);
+}
+
+enum nbts_error
+nbts_write_int_array(FILE *restrict nonnull stream, nbts_int const *restrict nonnull src, size_t size)
+{
+	enum : size_t { BUFSIZE = NBTS_STACK_BUFFER_SIZE / sizeof(uint32_t) };
+
+	uint32_t buffer[BUFSIZE];
+	while (size) {
+		size_t chunk_size = size < BUFSIZE ? size : BUFSIZE;
+		memcpy(buffer, src, chunk_size * sizeof(*src));
+		for (size_t i = 0; i < chunk_size; ++i) buffer[i] = htonbt32(buffer[i]);
+		TRY(xfwrite(buffer, sizeof(*buffer), chunk_size, stream));
+		src += chunk_size;
+		size -= chunk_size;
+	}
+	return NBTS_OK;
+}
+
+enum nbts_error nbts_write_long_array(
+	FILE *restrict nonnull stream, nbts_long const *restrict nonnull src, size_t size)
+{
+	enum : size_t { BUFSIZE = NBTS_STACK_BUFFER_SIZE / sizeof(uint64_t) };
+
+	uint64_t buffer[BUFSIZE];
+	while (size) {
+		size_t chunk_size = size < BUFSIZE ? size : BUFSIZE;
+		memcpy(buffer, src, chunk_size * sizeof(*src));
+		for (size_t i = 0; i < chunk_size; ++i) buffer[i] = htonbt64(buffer[i]);
+		TRY(xfwrite(buffer, sizeof(*buffer), chunk_size, stream));
+		src += chunk_size;
+		size -= chunk_size;
+	}
+	return NBTS_OK;
+}
+
+enum nbts_error nbts_write_tag_header(
+	FILE *restrict nonnull stream,
+	enum nbts_type type,
+	nbts_char const *restrict nullable name,
+	nbts_strsize name_size)
+{
+	TRY(nbts_write_typeid(stream, type));
+	TRY(nbts_write_strsize(stream, name_size));
+	if (name_size) TRY(nbts_write_string(stream, name, name_size));
+	return NBTS_OK;
+}
+
+enum nbts_error
+nbts_copy_bytes(FILE *restrict nonnull ostream, FILE *restrict nonnull istream, size_t size)
+{
+	enum : size_t { BUFSIZE = NBTS_STACK_BUFFER_SIZE / sizeof(nbts_byte) };
+
+	nbts_byte buffer[BUFSIZE];
+	while (size) {
+		size_t chunk_size = size < BUFSIZE ? size : BUFSIZE;
+		TRY(nbts_parse_byte_array(buffer, chunk_size, istream));
+		TRY(nbts_write_byte_array(ostream, buffer, chunk_size));
+		size -= chunk_size;
+	}
+	return NBTS_OK;
+}
+
+static enum nbts_error
+copy_array(FILE *restrict nonnull ostream, FILE *restrict nonnull istream, size_t element_size)
+{
+	nbts_size size = 0;
+	TRY(nbts_parse_size(&size, istream));
+	TRY(nbts_write_size(ostream, size));
+	return nbts_copy_bytes(ostream, istream, size * element_size);
+}
+
+static enum nbts_error copy_list(FILE *restrict nonnull ostream, FILE *restrict nonnull istream)
+{
+	enum nbts_type type = 0;
+	TRY(nbts_parse_typeid(&type, istream));
+	TRY(nbts_write_typeid(ostream, type));
+
+	nbts_size size = 0;
+	TRY(nbts_parse_size(&size, istream));
+	TRY(nbts_write_size(ostream, size));
+
+	if (type == NBTS_END) return NBTS_OK;
+
+	// Lists of fixed size payloads are copied in one go.
+	size_t element_size = nbts_measure_fixed(type);
+	if (element_size) return nbts_copy_bytes(ostream, istream, size * element_size);
+
+	for (nbts_size i = 0; i < size; ++i) TRY(nbts_copy_payload(ostream, istream, type));
+	return NBTS_OK;
+}
+
+static enum nbts_error copy_compound(FILE *restrict nonnull ostream, FILE *restrict nonnull istream)
+{
+	while (1) {
+		enum nbts_type type = 0;
+		TRY(nbts_parse_typeid(&type, istream));
+		TRY(nbts_write_typeid(ostream, type));
+		if (type == NBTS_END) break;
+
+		nbts_strsize name_size = 0;
+		TRY(nbts_parse_strsize(&name_size, istream));
+		TRY(nbts_write_strsize(ostream, name_size));
+		TRY(nbts_copy_bytes(ostream, istream, name_size * sizeof(nbts_char)));
+		TRY(nbts_copy_payload(ostream, istream, type));
+	}
+	return NBTS_OK;
+}
+
+enum nbts_error nbts_copy_payload(
+	FILE *restrict nonnull ostream, FILE *restrict nonnull istream, enum nbts_type type)
+{
+	switch (type) {
+	case NBTS_END:
+	case NBTS_BYTE:
+	case NBTS_SHORT:
+	case NBTS_INT:
+	case NBTS_LONG:
+	case NBTS_FLOAT:
+	case NBTS_DOUBLE: return nbts_copy_bytes(ostream, istream, nbts_measure_fixed(type));
+	case NBTS_STRING: {
+		nbts_strsize size = 0;
+		TRY(nbts_parse_strsize(&size, istream));
+		TRY(nbts_write_strsize(ostream, size));
+		return nbts_copy_bytes(ostream, istream, size * sizeof(nbts_char));
+	}
+	case NBTS_BYTE_ARRAY: return copy_array(ostream, istream, sizeof(nbts_byte));
+	case NBTS_INT_ARRAY: return copy_array(ostream, istream, sizeof(nbts_int));
+	case NBTS_LONG_ARRAY: return copy_array(ostream, istream, sizeof(nbts_long));
+	case NBTS_LIST: return copy_list(ostream, istream);
+	case NBTS_COMPOUND: return copy_compound(ostream, istream);
+	}
+	return NBTS_INVALID_ID;
+}
+
+// NOLINTEND(bugprone-easily-swappable-parameters)
@@ -0,0 +1,89 @@
+#pragma once
+
+/// \file
+///
+/// \brief The writing counterpart to the parsing functions in \ref nbts.h.
+///
+/// Like the parsing functions, these never allocate dynamic memory. Arrays
+/// are converted to the wire byte order in chunks of
+/// \ref NBTS_STACK_BUFFER_SIZE bytes.
+
+#include <nbts/nbts.h>
+
+#if __clang__
+#define nonnull  _Nonnull
+#define nullable _Nullable
+#else
+#define nonnull
+#define nullable
+#endif
+
+/// Writes one `uint8_t` to `stream`.
+enum nbts_error nbts_write_uint8(FILE *restrict nonnull stream, uint8_t x);
+/// Writes one `uint16_t` to `stream`, handling endian conversion.
+enum nbts_error nbts_write_uint16(FILE *restrict nonnull stream, uint16_t x);
+/// Writes one `uint32_t` to `stream`, handling endian conversion.
+enum nbts_error nbts_write_uint32(FILE *restrict nonnull stream, uint32_t x);
+/// Writes one `uint64_t` to `stream`, handling endian conversion.
+enum nbts_error nbts_write_uint64(FILE *restrict nonnull stream, uint64_t x);
+
+/// Writes one \ref nbts_type to `stream`.
+enum nbts_error nbts_write_typeid(FILE *restrict nonnull stream, enum nbts_type x);
+/// Writes one \ref nbts_size to `stream`.
+enum nbts_error nbts_write_size(FILE *restrict nonnull stream, nbts_size x);
+/// Writes one \ref nbts_strsize to `stream`.
+enum nbts_error nbts_write_strsize(FILE *restrict nonnull stream, nbts_strsize x);
+
+/// Writes one \ref nbts_byte to `stream`.
+enum nbts_error nbts_write_byte(FILE *restrict nonnull stream, nbts_byte x);
+/// Writes one \ref nbts_short to `stream`.
+enum nbts_error nbts_write_short(FILE *restrict nonnull stream, nbts_short x);
+/// Writes one \ref nbts_int to `stream`.
+enum nbts_error nbts_write_int(FILE *restrict nonnull stream, nbts_int x);
+/// Writes one \ref nbts_long to `stream`.
+enum nbts_error nbts_write_long(FILE *restrict nonnull stream, nbts_long x);
+/// Writes one \ref nbts_float to `stream`.
+enum nbts_error nbts_write_float(FILE *restrict nonnull stream, nbts_float x);
+/// Writes one \ref nbts_double to `stream`.
+enum nbts_error nbts_write_double(FILE *restrict nonnull stream, nbts_double x);
+
+/// Writes a string of `size` \ref nbts_char from `src` to `stream`.
+enum nbts_error
+nbts_write_string(FILE *restrict nonnull stream, nbts_char const *restrict nonnull src, size_t size);
+
+/// Writes an array of `size` \ref nbts_byte from `src` to `stream`.
+enum nbts_error nbts_write_byte_array(
+	FILE *restrict nonnull stream, nbts_byte const *restrict nonnull src, size_t size);
+
+/// Writes an array of `size` \ref nbts_int from `src` to `stream`.
+enum nbts_error
+nbts_write_int_array(FILE *restrict nonnull stream, nbts_int const *restrict nonnull src, size_t size);
+
+/// Writes an array of `size` \ref nbts_long from `src` to `stream`.
+enum nbts_error nbts_write_long_array(
+	FILE *restrict nonnull stream, nbts_long const *restrict nonnull src, size_t size);
+
+/// Writes the type, name size and name of a named tag to `stream`.
+///
+/// The payload has to be written separately.
+enum nbts_error nbts_write_tag_header(
+	FILE *restrict nonnull stream,
+	enum nbts_type type,
+	nbts_char const *restrict nullable name,
+	nbts_strsize name_size);
+
+/// Copies `size` bytes from `istream` to `ostream` unchanged.
+enum nbts_error
+nbts_copy_bytes(FILE *restrict nonnull ostream, FILE *restrict nonnull istream, size_t size);
+
+/// Copies one payload of `type` from `istream` to `ostream` unchanged.
+///
+/// Only the headers of nested tags are decoded, to find the extent of the
+/// payload. Everything else is copied in chunks of
+/// \ref NBTS_STACK_BUFFER_SIZE bytes. `istream` is read sequentially, so it
+/// does not need to be seekable.
+enum nbts_error nbts_copy_payload(
+	FILE *restrict nonnull ostream, FILE *restrict nonnull istream, enum nbts_type type);
+
+#undef nonnull
+#undef nullable
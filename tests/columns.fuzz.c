@@ -0,0 +1,33 @@
+#include <nbts/columns.h>
+#include <nbts/nbts.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+static char const *const paths[] = {"*", "*.*", "*[*]", "*[*].*"};
+
+/// The first byte selects the path, the format and the batch size. The rest
+/// of the input is the NBT exported.
+int LLVMFuzzerTestOneInput(uint8_t const *data, size_t data_size)
+{
+	if (!data_size) return 0;
+	char const *path = paths[data[0] % 4];
+	enum nbts_columns_format format = data[0] >> 2 & 1 ? NBTS_COLUMNS_BINARY : NBTS_COLUMNS_CSV;
+	size_t batch_rows = (data[0] >> 3) + 1;
+
+	FILE *istream = fmemopen((void *) &data[1], data_size - 1, "rb");
+	if (!istream) goto istream_failed;
+
+	FILE *ostream = fopen("/dev/null", "wb");
+	if (!ostream) goto ostream_failed;
+
+	struct nbts_columns_options options = nbts_columns_options(path, ostream, format);
+	options.batch_rows = batch_rows;
+	(void) nbts_export_columns(istream, &options);
+
+	fclose(ostream);
+ostream_failed:
+	fclose(istream);
+istream_failed:
+	return 0;
+}
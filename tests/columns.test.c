@@ -0,0 +1,59 @@
+#include <nbts/columns.h>
+#include <nbts/nbts.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The name of the nested compound fills the name buffer of the exporter, so
+// the flattened names of its children do not even have room for the dot.
+enum : size_t { LONG_NAME_SIZE = NBTS_STACK_BUFFER_SIZE };
+
+// {"":{rows:[{<long name>:{a:1},b:2},{b:3}]}}, with the long name of 'n'
+// characters between `head` and `tail`.
+static uint8_t const head[] = {
+	NBTS_COMPOUND, 0, 0,                                            //
+	NBTS_LIST, 0, 4, 'r', 'o', 'w', 's', NBTS_COMPOUND, 0, 0, 0, 2, //
+	NBTS_COMPOUND, LONG_NAME_SIZE >> 8, LONG_NAME_SIZE & 0xff,      //
+};
+static uint8_t const tail[] = {
+	NBTS_INT, 0, 1, 'a', 0, 0, 0, 1, NBTS_END,           //
+	NBTS_INT, 0, 1, 'b', 0, 0, 0, 2, NBTS_END,           //
+	NBTS_INT, 0, 1, 'b', 0, 0, 0, 3, NBTS_END, NBTS_END, //
+};
+
+// Only the column of `b` is exported, the one of `a` is dropped.
+static char const expected[] = "\"b\"\n2\n3\n";
+
+int main()
+{
+	static uint8_t input[sizeof(head) + LONG_NAME_SIZE + sizeof(tail)];
+	memcpy(input, head, sizeof(head));
+	memset(&input[sizeof(head)], 'n', LONG_NAME_SIZE);
+	memcpy(&input[sizeof(head) + LONG_NAME_SIZE], tail, sizeof(tail));
+
+	// Zeroed and larger than the expected output, so it stays terminated.
+	char output[2 * sizeof(expected)] = {};
+	FILE *istream = fmemopen(input, sizeof(input), "rb");
+	FILE *ostream = fmemopen(output, sizeof(output) - 1, "wb");
+
+	enum nbts_error err = NBTS_READ_ERR;
+	if (istream && ostream) {
+		struct nbts_columns_options options =
+			nbts_columns_options(".rows", ostream, NBTS_COLUMNS_CSV);
+		err = nbts_export_columns(istream, &options);
+	}
+	if (ostream) fclose(ostream);
+	if (istream) fclose(istream);
+
+	if (err) {
+		fprintf(stderr, "export failed with error %d\n", err);
+		return EXIT_FAILURE;
+	}
+	if (strcmp(output, expected)) {
+		fprintf(stderr, "exported \"%s\" instead of \"%s\"\n", output, expected);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
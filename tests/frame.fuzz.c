@@ -0,0 +1,47 @@
+#include <nbts/frame.h>
+#include <nbts/nbts.h>
+#include <nbts/ring.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+// A small ring makes frames wrap around its end.
+enum : size_t { RING_SIZE = 256, MAX_FRAME_SIZE = 200 };
+
+/// Reads a packet id followed by a network tag, as a packet handler would.
+///
+/// Errors in the packet are ignored, so the errors of the framer can be told
+/// apart.
+static enum nbts_error parse_frame(void *, FILE *frame, size_t)
+{
+	int32_t id = 0;
+	if (nbts_parse_varint(&id, frame)) return NBTS_OK;
+	(void) nbts_parse_network_tag(frame, &nbts_skip_handler, nullptr);
+	return NBTS_OK;
+}
+
+int LLVMFuzzerTestOneInput(uint8_t const *data, size_t data_size)
+{
+	static uint8_t buffer[RING_SIZE];
+	struct nbts_ring ring;
+	if (nbts_ring_init(&ring, buffer, sizeof(buffer))) goto ring_failed;
+
+	struct nbts_framer framer;
+	if (nbts_framer_init(&framer, &ring, MAX_FRAME_SIZE)) goto ring_failed;
+
+	// The input arrives in pieces as large as the free space of the ring.
+	while (1) {
+		size_t written = nbts_ring_write(&ring, data, data_size);
+		data += written;
+		data_size -= written;
+
+		enum nbts_error err = NBTS_OK;
+		while (!err) err = nbts_framer_next(&framer, &parse_frame, nullptr);
+		// Anything but a missing end of frame cannot be resynchronized.
+		if (err != NBTS_UNEXPECTED_EOF || !written) break;
+	}
+
+	nbts_framer_free(&framer);
+ring_failed:
+	return 0;
+}
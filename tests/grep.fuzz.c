@@ -0,0 +1,53 @@
+#define _GNU_SOURCE
+
+#include <nbts/grep.h>
+#include <nbts/nbts.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static enum nbts_error count_match(void *userdata, struct nbts_path const *, enum nbts_type)
+{
+	size_t *count = userdata;
+	*count += 1;
+	return NBTS_OK;
+}
+
+/// The first byte gives the size of the text, which follows it. The rest of
+/// the input is the NBT searched.
+int LLVMFuzzerTestOneInput(uint8_t const *data, size_t data_size)
+{
+	if (!data_size) return 0;
+	size_t text_size = data[0] % 8;
+	if (text_size >= data_size) return 0;
+	nbts_char const *text = &data[1];
+	uint8_t const *nbt = &data[1 + text_size];
+	size_t nbt_size = data_size - 1 - text_size;
+
+	// The vectorized search has to agree with the obvious one.
+	size_t offset = nbts_find_bytes(nbt, nbt_size, text, text_size);
+	uint8_t const *expected = memmem(nbt, nbt_size, text, text_size);
+	if (offset != (expected ? (size_t) (expected - nbt) : SIZE_MAX)) abort();
+
+	size_t count = 0;
+	struct nbts_grep_options options = {
+		.text = text,
+		.text_size = text_size,
+		.targets = NBTS_GREP_ANY,
+		.match = &count_match,
+		.userdata = &count,
+	};
+
+	FILE *istream = fmemopen((void *) nbt, nbt_size, "rb");
+	if (!istream) goto istream_failed;
+	(void) nbts_grep_tag(istream, &options);
+	fclose(istream);
+
+	// The prefilter must never reject an input with matches.
+	if (count && !nbts_grep_candidate(&options, nbt, nbt_size)) abort();
+
+istream_failed:
+	return 0;
+}
@@ -0,0 +1,18 @@
+#include <nbts/hash.h>
+#include <nbts/nbts.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+int LLVMFuzzerTestOneInput(uint8_t const *data, size_t data_size)
+{
+	FILE *istream = fmemopen((void *) data, data_size, "rb");
+	if (!istream) goto istream_failed;
+
+	struct nbts_digest digest;
+	(void) nbts_hash_tag(&digest, istream);
+
+	fclose(istream);
+istream_failed:
+	return 0;
+}
@@ -0,0 +1,210 @@
+// Benchmark of the C++ interface against a C handler table.
+//
+// Sums the ints and longs of a generated corpus and counts its lists and
+// compounds, once with an nbts_handler over a memory stream and once with a
+// visitor over the same buffer. Each time is the minimum over several runs.
+// Fails if the results differ or the visitor is not faster.
+//
+// Usage: nbts_perf_hpp
+
+#include <nbts/nbts.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+#include <vector>
+
+static constexpr std::size_t RUNS = 15;
+static constexpr std::size_t SECTIONS = 256;
+
+struct totals {
+	long long sum = 0;
+	std::size_t containers = 0;
+
+	bool operator==(totals const &) const = default;
+};
+
+class corpus {
+public:
+	std::vector<std::byte> data;
+
+	void type(nbts_type type) { data.push_back(static_cast<std::byte>(type)); }
+
+	template <class T>
+	void number(T x)
+	{
+		auto bits = static_cast<nbts::detail::uint_of<T>>(x);
+		for (std::size_t i = sizeof(T); i-- > 0;)
+			data.push_back(static_cast<std::byte>(bits >> 8 * i));
+	}
+
+	void string(std::string_view s)
+	{
+		number(static_cast<uint16_t>(s.size()));
+		for (char c : s) data.push_back(static_cast<std::byte>(c));
+	}
+
+	void name(nbts_type t, std::string_view s)
+	{
+		type(t);
+		string(s);
+	}
+};
+
+// A chunk-like compound: sections with a palette of block compounds and
+// packed block states, and some scalar fields.
+static corpus make_corpus()
+{
+	corpus c;
+	c.name(NBTS_COMPOUND, "");
+	c.name(NBTS_INT, "DataVersion");
+	c.number<nbts_int>(3465);
+	c.name(NBTS_LONG, "LastUpdate");
+	c.number<nbts_long>(123456789);
+	c.name(NBTS_LIST, "sections");
+	c.type(NBTS_COMPOUND);
+	c.number<nbts_size>(SECTIONS);
+	for (std::size_t i = 0; i < SECTIONS; ++i) {
+		c.name(NBTS_BYTE, "Y");
+		c.number<nbts_byte>(static_cast<nbts_byte>(i));
+		c.name(NBTS_LIST, "palette");
+		c.type(NBTS_COMPOUND);
+		c.number<nbts_size>(4);
+		for (std::size_t j = 0; j < 4; ++j) {
+			c.name(NBTS_STRING, "Name");
+			c.string(j % 2 ? "minecraft:stone" : "minecraft:air");
+			c.name(NBTS_INT, "light");
+			c.number<nbts_int>(static_cast<nbts_int>(j));
+			c.type(NBTS_END);
+		}
+		c.name(NBTS_LONG_ARRAY, "data");
+		c.number<nbts_size>(64);
+		for (std::size_t j = 0; j < 64; ++j) c.number<nbts_long>(static_cast<nbts_long>(i * j));
+		for (std::size_t j = 0; j < 8; ++j) {
+			c.name(NBTS_LONG, "tick");
+			c.number<nbts_long>(static_cast<nbts_long>(i + j));
+			c.name(NBTS_INT, "count");
+			c.number<nbts_int>(static_cast<nbts_int>(j));
+		}
+		c.type(NBTS_END);
+	}
+	c.type(NBTS_END);
+	return c;
+}
+
+static nbts_handler table;
+
+static nbts_error c_int(void *userdata, nbts_strsize name_size, FILE *stream)
+{
+	if (nbts_error err = nbts_skip_end(nullptr, name_size, stream)) return err;
+	nbts_int x = 0;
+	if (nbts_error err = nbts_parse_int(&x, stream)) return err;
+	static_cast<totals *>(userdata)->sum += x;
+	return NBTS_OK;
+}
+
+static nbts_error c_long(void *userdata, nbts_strsize name_size, FILE *stream)
+{
+	if (nbts_error err = nbts_skip_end(nullptr, name_size, stream)) return err;
+	nbts_long x = 0;
+	if (nbts_error err = nbts_parse_long(&x, stream)) return err;
+	static_cast<totals *>(userdata)->sum += x;
+	return NBTS_OK;
+}
+
+static nbts_error c_list(void *userdata, nbts_strsize name_size, FILE *stream)
+{
+	if (nbts_error err = nbts_skip_end(nullptr, name_size, stream)) return err;
+	static_cast<totals *>(userdata)->containers += 1;
+	nbts_type type = NBTS_END;
+	nbts_size size = 0;
+	if (nbts_error err = nbts_parse_typeid(&type, stream)) return err;
+	if (nbts_error err = nbts_parse_size(&size, stream)) return err;
+	return nbts_parse_list(type, size, stream, &table, userdata);
+}
+
+static nbts_error c_compound(void *userdata, nbts_strsize name_size, FILE *stream)
+{
+	if (nbts_error err = nbts_skip_end(nullptr, name_size, stream)) return err;
+	static_cast<totals *>(userdata)->containers += 1;
+	return nbts_parse_compound(stream, &table, userdata);
+}
+
+struct visitor {
+	totals &t;
+
+	void operator()(std::string_view, nbts_int x) { t.sum += x; }
+	void operator()(std::string_view, nbts_long x) { t.sum += x; }
+	nbts_error operator()(std::string_view, nbts::list_view l)
+	{
+		t.containers += 1;
+		return l.visit(*this);
+	}
+	nbts_error operator()(std::string_view, nbts::compound_view c)
+	{
+		t.containers += 1;
+		return c.visit(*this);
+	}
+};
+
+static nbts_error run_c(corpus &c, totals &t)
+{
+	FILE *stream = fmemopen(c.data.data(), c.data.size(), "rb");
+	if (!stream) return NBTS_READ_ERR;
+	nbts_error err = nbts_parse_tag(stream, &table, &t);
+	fclose(stream);
+	return err;
+}
+
+static nbts_error run_cpp(corpus &c, totals &t)
+{
+	nbts::reader r(c.data);
+	return nbts::parse_tag(r, visitor{t});
+}
+
+/// Returns the minimum time of `RUNS` runs of `run` in nanoseconds per byte.
+template <class F>
+static double measure(corpus &c, totals &t, F run)
+{
+	double best = HUGE_VAL;
+	for (std::size_t i = 0; i < RUNS; ++i) {
+		t = {};
+		auto start = std::chrono::steady_clock::now();
+		if (nbts_error err = run(c, t)) {
+			std::fprintf(stderr, "error %d\n", err);
+			return HUGE_VAL;
+		}
+		std::chrono::duration<double, std::nano> time = std::chrono::steady_clock::now() - start;
+		best = std::min(best, time.count());
+	}
+	return best / static_cast<double>(c.data.size());
+}
+
+int main()
+{
+	table.handle[NBTS_INT] = &c_int;
+	table.handle[NBTS_LONG] = &c_long;
+	table.handle[NBTS_LIST] = &c_list;
+	table.handle[NBTS_COMPOUND] = &c_compound;
+
+	corpus c = make_corpus();
+	totals c_totals;
+	totals cpp_totals;
+	double c_time = measure(c, c_totals, &run_c);
+	double cpp_time = measure(c, cpp_totals, &run_cpp);
+	if (c_time == HUGE_VAL || cpp_time == HUGE_VAL) return EXIT_FAILURE;
+
+	std::printf("handler table %8.3f ns per byte\n", c_time);
+	std::printf("visitor       %8.3f ns per byte, %.1fx\n", cpp_time, c_time / cpp_time);
+
+	if (!(c_totals == cpp_totals)) {
+		std::fprintf(stderr, "results differ: sum %lld and %lld, containers %zu and %zu\n",
+			c_totals.sum, cpp_totals.sum, c_totals.containers, cpp_totals.containers);
+		return EXIT_FAILURE;
+	}
+	return cpp_time < c_time ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,126 @@
+#include <nbts/nbts.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+// {"":{s:"ab",n:7,h:3s,d:0.5d,i:[I;1,-2],l:[3s,4s],c:{b:1B}}}
+static uint8_t const input[] = {
+	NBTS_COMPOUND, 0, 0,                                  //
+	NBTS_STRING, 0, 1, 's', 0, 2, 'a', 'b',               //
+	NBTS_INT, 0, 1, 'n', 0, 0, 0, 7,                      //
+	NBTS_SHORT, 0, 1, 'h', 0, 3,                          //
+	NBTS_DOUBLE, 0, 1, 'd', 0x3f, 0xe0, 0, 0, 0, 0, 0, 0, //
+	NBTS_INT_ARRAY, 0, 1, 'i', 0, 0, 0, 2,                //
+	0, 0, 0, 1, 0xff, 0xff, 0xff, 0xfe,                   //
+	NBTS_LIST, 0, 1, 'l', NBTS_SHORT, 0, 0, 0, 2,         //
+	0, 3, 0, 4,                                           //
+	NBTS_COMPOUND, 0, 1, 'c',                             //
+	NBTS_BYTE, 0, 1, 'b', 1,                              //
+	NBTS_END,                                             //
+	NBTS_END,                                             //
+};
+
+static char const expected[] = "s=ab n=7 h=3 d=0.5 i=[1,-2] l=[2] c={} ";
+
+// A generic lambda is called with every value the other overloads do not
+// take, so its body only has to compile for those types.
+static bool test_generic()
+{
+	std::ostringstream out;
+	auto children = nbts::overloaded{
+		[&](std::string_view name, std::span<nbts_byte const> a) {
+			out << name << "=[B;" << a.size() << "] ";
+		},
+		[&](std::string_view name, nbts::array_view<nbts_int> a) {
+			out << name << "=[";
+			for (std::size_t i = 0; i < a.size(); ++i) out << (i ? "," : "") << a[i];
+			out << "] ";
+		},
+		[&](std::string_view name, nbts::array_view<nbts_long> a) {
+			out << name << "=[L;" << a.size() << "] ";
+		},
+		[&](std::string_view name, nbts::list_view l) { out << name << "=[" << l.size() << "] "; },
+		[&](std::string_view name, nbts::compound_view) { out << name << "={} "; },
+		[&](std::string_view name, auto value) { out << name << '=' << value << ' '; },
+	};
+
+	nbts::reader r(input, sizeof(input));
+	nbts_error err = nbts::parse_tag(r, [&](std::string_view, nbts::compound_view c) {
+		return c.visit(children);
+	});
+
+	if (err) {
+		std::fprintf(stderr, "generic: error %d\n", err);
+		return false;
+	}
+	if (out.str() != expected) {
+		std::fprintf(
+			stderr, "generic: expected %s\n              got %s\n", expected, out.str().c_str());
+		return false;
+	}
+	return true;
+}
+
+// An overload for nbts_int is not called for the bytes and shorts that
+// would convert to it.
+static bool test_exact()
+{
+	nbts_int sum = 0;
+	std::size_t count = 0;
+	auto ints = [&](std::string_view, nbts_int x) {
+		sum += x;
+		++count;
+	};
+	auto children = nbts::overloaded{
+		ints,
+		[&](std::string_view, nbts::list_view l) { return l.visit(ints); },
+		[&](std::string_view, nbts::compound_view c) { return c.visit(ints); },
+	};
+
+	nbts::reader r(input, sizeof(input));
+	nbts_error err = nbts::parse_tag(r, [&](std::string_view, nbts::compound_view c) {
+		return c.visit(children);
+	});
+
+	if (err) {
+		std::fprintf(stderr, "exact: error %d\n", err);
+		return false;
+	}
+	if (count != 1 || sum != 7) {
+		std::fprintf(stderr, "exact: expected 1 int with sum 7, got %zu with sum %d\n", count, sum);
+		return false;
+	}
+	return true;
+}
+
+// A C handler parses a subtree and leaves the reader after it.
+static bool test_handler()
+{
+	nbts::reader r(input, sizeof(input));
+	nbts_error err = nbts::parse_tag(r, [&](std::string_view, nbts::compound_view c) {
+		return c.visit(&nbts_skip_handler, nullptr);
+	});
+
+	if (err) {
+		std::fprintf(stderr, "handler: error %d\n", err);
+		return false;
+	}
+	if (r.position() != sizeof(input)) {
+		std::fprintf(stderr, "handler: stopped at %zu of %zu\n", r.position(), sizeof(input));
+		return false;
+	}
+	return true;
+}
+
+int main()
+{
+	bool ok = test_generic();
+	ok = test_exact() && ok;
+	ok = test_handler() && ok;
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
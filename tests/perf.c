@@ -0,0 +1,434 @@
+// Performance regression test.
+//
+// Runs generated corpora through the skip, hash and print paths and
+// compares the cost per input byte with a baseline file. Cycles and
+// instructions are read from hardware counters where perf_event_open is
+// available; otherwise wall-clock nanoseconds are used. Each metric is the
+// minimum over several runs, which is far more stable than the mean.
+//
+// Usage: nbts_perf [--update] <baseline>
+//
+// Metrics missing from the baseline, all of them on the first run, are
+// appended to it, so that run only checks that every benchmark succeeds.
+// --update replaces the baseline instead.
+
+#include <nbts/hash.h>
+#include <nbts/nbts.h>
+#include <nbts/print.h>
+#include <nbts/write.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum : size_t {
+	RUNS = 15,
+	MAX_METRICS = 2,
+	MAX_RESULTS = 16,
+	NAME_SIZE = 64,
+};
+
+struct metric {
+	char const *name;
+	/// The largest accepted increase over the baseline, relative to it.
+	double tolerance;
+};
+
+static struct metric const COUNTER_METRICS[] = {{"instructions", 0.05}, {"cycles", 0.25}};
+static struct metric const CLOCK_METRICS[] = {{"ns", 0.5}};
+
+struct result {
+	char name[NAME_SIZE];
+	double values[MAX_METRICS];
+	/// Whether each value is not in the baseline yet.
+	bool missing[MAX_METRICS];
+};
+
+struct counters {
+	int leader;
+	int follower;
+};
+
+struct corpus {
+	char const *name;
+	char *data;
+	size_t size;
+};
+
+static uint64_t state = 0x9E3779B97F4A7C15;
+
+static uint64_t next_random(void)
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+static void write_name(FILE *stream, enum nbts_type type, char const *name)
+{
+	(void) nbts_write_tag_header(stream, type, (nbts_char const *) name, strlen(name));
+}
+
+static void write_string(FILE *stream, char const *name, char const *value)
+{
+	write_name(stream, NBTS_STRING, name);
+	(void) nbts_write_strsize(stream, strlen(value));
+	(void) nbts_write_string(stream, (nbts_char const *) value, strlen(value));
+}
+
+/// Writes a tag shaped like a chunk: few large arrays and many small
+/// compounds.
+static void write_chunk(FILE *stream)
+{
+	static char const *const blocks[] = {"minecraft:stone", "minecraft:dirt", "minecraft:air"};
+
+	write_name(stream, NBTS_COMPOUND, "");
+	write_string(stream, "Status", "minecraft:full");
+	write_name(stream, NBTS_LONG, "LastUpdate");
+	(void) nbts_write_long(stream, (nbts_long) next_random());
+
+	write_name(stream, NBTS_LIST, "sections");
+	(void) nbts_write_typeid(stream, NBTS_COMPOUND);
+	(void) nbts_write_size(stream, 24);
+	for (size_t i = 0; i < 24; ++i) {
+		write_name(stream, NBTS_BYTE, "Y");
+		(void) nbts_write_byte(stream, (nbts_byte) i);
+		write_name(stream, NBTS_COMPOUND, "block_states");
+		write_name(stream, NBTS_LIST, "palette");
+		(void) nbts_write_typeid(stream, NBTS_COMPOUND);
+		(void) nbts_write_size(stream, 3);
+		for (size_t j = 0; j < 3; ++j) {
+			write_string(stream, "Name", blocks[j]);
+			(void) nbts_write_typeid(stream, NBTS_END);
+		}
+		nbts_long data[256];
+		for (size_t j = 0; j < 256; ++j) data[j] = (nbts_long) next_random();
+		write_name(stream, NBTS_LONG_ARRAY, "data");
+		(void) nbts_write_size(stream, 256);
+		(void) nbts_write_long_array(stream, data, 256);
+		(void) nbts_write_typeid(stream, NBTS_END);
+		(void) nbts_write_typeid(stream, NBTS_END);
+	}
+
+	write_name(stream, NBTS_LIST, "entities");
+	(void) nbts_write_typeid(stream, NBTS_COMPOUND);
+	(void) nbts_write_size(stream, 64);
+	for (size_t i = 0; i < 64; ++i) {
+		write_string(stream, "id", "minecraft:zombie");
+		write_name(stream, NBTS_LIST, "Pos");
+		(void) nbts_write_typeid(stream, NBTS_DOUBLE);
+		(void) nbts_write_size(stream, 3);
+		for (size_t j = 0; j < 3; ++j) (void) nbts_write_double(stream, next_random() % 4096);
+		write_name(stream, NBTS_FLOAT, "Health");
+		(void) nbts_write_float(stream, 20);
+		write_name(stream, NBTS_INT_ARRAY, "UUID");
+		(void) nbts_write_size(stream, 4);
+		for (size_t j = 0; j < 4; ++j) (void) nbts_write_int(stream, (nbts_int) next_random());
+		(void) nbts_write_typeid(stream, NBTS_END);
+	}
+
+	(void) nbts_write_typeid(stream, NBTS_END);
+}
+
+/// Writes a tag shaped like player data: many small named scalars.
+static void write_player(FILE *stream)
+{
+	write_name(stream, NBTS_COMPOUND, "");
+	write_name(stream, NBTS_LIST, "Inventory");
+	(void) nbts_write_typeid(stream, NBTS_COMPOUND);
+	(void) nbts_write_size(stream, 512);
+	for (size_t i = 0; i < 512; ++i) {
+		write_name(stream, NBTS_BYTE, "Slot");
+		(void) nbts_write_byte(stream, (nbts_byte) i);
+		write_string(stream, "id", i % 2 ? "minecraft:diamond_sword" : "minecraft:torch");
+		write_name(stream, NBTS_BYTE, "Count");
+		(void) nbts_write_byte(stream, (nbts_byte) (next_random() % 64));
+		write_name(stream, NBTS_COMPOUND, "tag");
+		write_name(stream, NBTS_INT, "Damage");
+		(void) nbts_write_int(stream, (nbts_int) (next_random() % 1500));
+		write_name(stream, NBTS_SHORT, "RepairCost");
+		(void) nbts_write_short(stream, 3);
+		(void) nbts_write_typeid(stream, NBTS_END);
+		(void) nbts_write_typeid(stream, NBTS_END);
+	}
+	(void) nbts_write_typeid(stream, NBTS_END);
+}
+
+static int make_corpus(struct corpus *corpus, char const *name, void (*write)(FILE *))
+{
+	corpus->name = name;
+	FILE *stream = open_memstream(&corpus->data, &corpus->size);
+	if (!stream) return -1;
+	write(stream);
+	return fclose(stream);
+}
+
+static enum nbts_error run_skip(FILE *istream, FILE *)
+{
+	return nbts_parse_tag(istream, nullptr, nullptr);
+}
+
+static enum nbts_error run_hash(FILE *istream, FILE *)
+{
+	struct nbts_digest digest;
+	return nbts_hash_tag(&digest, istream);
+}
+
+static enum nbts_error run_print(FILE *istream, FILE *ostream)
+{
+	struct nbts_print_handler_data data = nbts_print_handler_data(ostream);
+	return nbts_parse_tag(istream, &nbts_print_handler, &data);
+}
+
+struct benchmark {
+	char const *name;
+	enum nbts_error (*run)(FILE *istream, FILE *ostream);
+};
+
+static struct benchmark const BENCHMARKS[] = {
+	{"skip", &run_skip},
+	{"hash", &run_hash},
+	{"print", &run_print},
+};
+
+#if defined(__linux__)
+static int open_counter(uint64_t config, int group)
+{
+	struct perf_event_attr attr = {
+		.type = PERF_TYPE_HARDWARE,
+		.size = sizeof(attr),
+		.config = config,
+		.disabled = group == -1,
+		.exclude_kernel = 1,
+		.exclude_hv = 1,
+		.read_format = PERF_FORMAT_GROUP,
+	};
+	return (int) syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+static bool open_counters(struct counters *counters)
+{
+	counters->leader = open_counter(PERF_COUNT_HW_INSTRUCTIONS, -1);
+	if (counters->leader == -1) return false;
+	counters->follower = open_counter(PERF_COUNT_HW_CPU_CYCLES, counters->leader);
+	if (counters->follower != -1) return true;
+	close(counters->leader);
+	return false;
+}
+
+static void close_counters(struct counters *counters)
+{
+	close(counters->follower);
+	close(counters->leader);
+}
+
+static void start_counters(struct counters *counters)
+{
+	ioctl(counters->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(counters->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+static bool stop_counters(struct counters *counters, double *values)
+{
+	ioctl(counters->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	uint64_t group[1 + MAX_METRICS];
+	if (read(counters->leader, group, sizeof(group)) != sizeof(group)) return false;
+	values[0] = (double) group[1];
+	values[1] = (double) group[2];
+	return true;
+}
+#else
+static bool open_counters(struct counters *) { return false; }
+static void close_counters(struct counters *) {}
+static void start_counters(struct counters *) {}
+static bool stop_counters(struct counters *, double *) { return false; }
+#endif
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/// Stores the minimum cost per byte of `RUNS` runs of `benchmark` over
+/// `corpus` in `values`.
+static enum nbts_error measure(
+	struct benchmark const *benchmark,
+	struct corpus const *corpus,
+	struct counters *counters,
+	bool use_counters,
+	FILE *ostream,
+	double *values)
+{
+	for (size_t i = 0; i < MAX_METRICS; ++i) values[i] = HUGE_VAL;
+
+	for (size_t run = 0; run < RUNS; ++run) {
+		FILE *istream = fmemopen(corpus->data, corpus->size, "rb");
+		if (!istream) return NBTS_READ_ERR;
+
+		double sample[MAX_METRICS] = {};
+		double start = now();
+		if (use_counters) start_counters(counters);
+		enum nbts_error err = benchmark->run(istream, ostream);
+		if (use_counters && !stop_counters(counters, sample)) err = NBTS_READ_ERR;
+		if (!use_counters) sample[0] = now() - start;
+		fclose(istream);
+		if (err) return err;
+
+		for (size_t i = 0; i < MAX_METRICS; ++i) {
+			double value = sample[i] / (double) corpus->size;
+			if (value < values[i]) values[i] = value;
+		}
+	}
+	return NBTS_OK;
+}
+
+/// Looks up the value of `metric` for `name` in `baseline`.
+static bool find_baseline(FILE *baseline, char const *name, char const *metric, double *value)
+{
+	rewind(baseline);
+	char line_name[NAME_SIZE];
+	char line_metric[NAME_SIZE];
+	double line_value = 0;
+	while (fscanf(baseline, "%63s %63s %lf", line_name, line_metric, &line_value) == 3) {
+		if (!strcmp(line_name, name) && !strcmp(line_metric, metric)) {
+			*value = line_value;
+			return true;
+		}
+	}
+	return false;
+}
+
+/// Writes the values of `results` to the baseline at `path`, opened with
+/// `mode`. Unless `all` is set, only missing values are written.
+static bool write_baseline(
+	char const *path,
+	char const *mode,
+	struct result const *results,
+	size_t result_count,
+	struct metric const *metrics,
+	size_t metric_count,
+	bool all)
+{
+	FILE *baseline = fopen(path, mode);
+	if (!baseline) {
+		perror(path);
+		return false;
+	}
+	for (size_t i = 0; i < result_count; ++i) {
+		for (size_t j = 0; j < metric_count; ++j) {
+			if (!all && !results[i].missing[j]) continue;
+			fprintf(baseline, "%s %s %.4f\n", results[i].name, metrics[j].name,
+				results[i].values[j]);
+		}
+	}
+	if (fclose(baseline) == EOF) {
+		perror(path);
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	bool update = argc == 3 && !strcmp(argv[1], "--update");
+	if (argc != 2 && !update) {
+		fprintf(stderr, "Usage: %s [--update] <baseline>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	char const *path = argv[argc - 1];
+
+	struct corpus corpora[2] = {};
+	if (make_corpus(&corpora[0], "chunk", &write_chunk) ||
+		make_corpus(&corpora[1], "player", &write_player)) {
+		perror("corpus");
+		return EXIT_FAILURE;
+	}
+
+	FILE *ostream = fopen("/dev/null", "wb");
+	if (!ostream) {
+		perror("/dev/null");
+		return EXIT_FAILURE;
+	}
+
+	struct counters counters = {};
+	bool use_counters = open_counters(&counters);
+	struct metric const *metrics = use_counters ? COUNTER_METRICS : CLOCK_METRICS;
+	size_t metric_count = use_counters ? 2 : 1;
+	if (!use_counters) fprintf(stderr, "Hardware counters unavailable, using the clock\n");
+
+	struct result results[MAX_RESULTS] = {};
+	size_t result_count = 0;
+	int status = EXIT_SUCCESS;
+	for (size_t i = 0; i < sizeof(corpora) / sizeof(*corpora); ++i) {
+		for (size_t j = 0; j < sizeof(BENCHMARKS) / sizeof(*BENCHMARKS); ++j) {
+			struct result *result = &results[result_count++];
+			snprintf(result->name, NAME_SIZE, "%s/%s", corpora[i].name, BENCHMARKS[j].name);
+			enum nbts_error err = measure(
+				&BENCHMARKS[j], &corpora[i], &counters, use_counters, ostream, result->values);
+			if (err) {
+				fprintf(stderr, "%s: error %d\n", result->name, err);
+				status = EXIT_FAILURE;
+			}
+		}
+	}
+
+	if (status == EXIT_SUCCESS && update) {
+		if (!write_baseline(path, "w", results, result_count, metrics, metric_count, true)) {
+			status = EXIT_FAILURE;
+		}
+	} else if (status == EXIT_SUCCESS) {
+		// A baseline that does not exist yet is created.
+		FILE *baseline = fopen(path, "r");
+		bool readable = baseline || errno == ENOENT;
+		if (!readable) {
+			perror(path);
+			status = EXIT_FAILURE;
+		}
+
+		size_t missing = 0;
+		for (size_t i = 0; readable && i < result_count; ++i) {
+			for (size_t j = 0; j < metric_count; ++j) {
+				double expected = 0;
+				double actual = results[i].values[j];
+				if (!baseline ||
+					!find_baseline(baseline, results[i].name, metrics[j].name, &expected)) {
+					results[i].missing[j] = true;
+					++missing;
+					printf("%-14s %-12s %10.4f per byte, recorded\n", results[i].name,
+						metrics[j].name, actual);
+					continue;
+				}
+
+				bool regressed = actual > expected * (1 + metrics[j].tolerance);
+				printf("%-14s %-12s %10.4f per byte, baseline %10.4f%s\n", results[i].name,
+					metrics[j].name, actual, expected, regressed ? "  REGRESSED" : "");
+				if (regressed) status = EXIT_FAILURE;
+			}
+		}
+		if (baseline) fclose(baseline);
+
+		if (missing &&
+			!write_baseline(path, "a", results, result_count, metrics, metric_count, false)) {
+			status = EXIT_FAILURE;
+		}
+	}
+
+	if (use_counters) close_counters(&counters);
+	fclose(ostream);
+	for (size_t i = 0; i < sizeof(corpora) / sizeof(*corpora); ++i) free(corpora[i].data);
+	return status;
+}
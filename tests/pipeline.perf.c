@@ -0,0 +1,202 @@
+// Benchmark of nbts_pipeline against decompressing first.
+//
+// Generates a chunk-like tag of small scalars, strings and arrays, gzips it
+// and parses it with the skip and print handlers, once after decompressing
+// it into memory and once through a pipeline with the default sizes. Each
+// time is the minimum over several runs. Fails if a run fails or the
+// pipeline takes more than MAX_SLOWDOWN times as long as decompressing
+// first. With more than one processor it should take less.
+//
+// Without zlib, the corpus is not compressed and the pipeline only reads.
+//
+// Usage: nbts_perf_pipeline [sections]
+
+#include <nbts/compression.h>
+#include <nbts/nbts.h>
+#include <nbts/pipeline.h>
+#include <nbts/print.h>
+#include <nbts/write.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum : size_t {
+	RUNS = 5,
+	DEFAULT_SECTIONS = 1 << 14,
+};
+
+static double const MAX_SLOWDOWN = 1.5;
+
+static void write_name(FILE *stream, enum nbts_type type, char const *name)
+{
+	(void) nbts_write_tag_header(stream, type, (nbts_char const *) name, strlen(name));
+}
+
+/// Writes a compound shaped like the sections of a chunk, whose strings and
+/// arrays make the skip handler seek often and not far.
+static int make_corpus(char **data, size_t *size, size_t sections)
+{
+	FILE *stream = open_memstream(data, size);
+	if (!stream) return -1;
+
+	write_name(stream, NBTS_COMPOUND, "");
+	write_name(stream, NBTS_LIST, "sections");
+	(void) nbts_write_typeid(stream, NBTS_COMPOUND);
+	(void) nbts_write_size(stream, (nbts_size) sections);
+	for (size_t i = 0; i < sections; ++i) {
+		write_name(stream, NBTS_BYTE, "Y");
+		(void) nbts_write_byte(stream, (nbts_byte) i);
+		write_name(stream, NBTS_STRING, "biome");
+		char const *biome = i % 3 ? "minecraft:plains" : "minecraft:river";
+		(void) nbts_write_strsize(stream, strlen(biome));
+		(void) nbts_write_string(stream, (nbts_char const *) biome, strlen(biome));
+		write_name(stream, NBTS_BYTE_ARRAY, "light");
+		(void) nbts_write_size(stream, 64);
+		for (size_t j = 0; j < 64; ++j) (void) nbts_write_byte(stream, (nbts_byte) (i * j));
+		write_name(stream, NBTS_LONG_ARRAY, "data");
+		(void) nbts_write_size(stream, 16);
+		for (size_t j = 0; j < 16; ++j) (void) nbts_write_long(stream, (nbts_long) (i ^ j));
+		write_name(stream, NBTS_INT, "count");
+		(void) nbts_write_int(stream, (nbts_int) i);
+		(void) nbts_write_typeid(stream, NBTS_END);
+	}
+	(void) nbts_write_typeid(stream, NBTS_END);
+
+	return fclose(stream);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+struct input {
+	struct nbts_buffer compressed;
+	enum nbts_compression format;
+	/// The stream receiving the output of the print handler.
+	FILE *ostream;
+};
+
+static enum nbts_error parse(FILE *stream, FILE *ostream)
+{
+	if (!ostream) return nbts_parse_tag(stream, nullptr, nullptr);
+	struct nbts_print_handler_data data = nbts_print_handler_data(ostream);
+	return nbts_parse_tag(stream, &nbts_print_handler, &data);
+}
+
+static enum nbts_error run_serial(struct input const *input, FILE *ostream)
+{
+	struct nbts_buffer decompressed = {};
+	enum nbts_error err = nbts_decompress(
+		&decompressed, input->format, input->compressed.data, input->compressed.size);
+	if (!err) {
+		FILE *stream = fmemopen(decompressed.data, decompressed.size, "rb");
+		err = stream ? parse(stream, ostream) : NBTS_READ_ERR;
+		if (stream) fclose(stream);
+	}
+	nbts_buffer_free(&decompressed);
+	return err;
+}
+
+static enum nbts_error run_pipeline(struct input const *input, FILE *ostream)
+{
+	FILE *source = fmemopen(input->compressed.data, input->compressed.size, "rb");
+	if (!source) return NBTS_READ_ERR;
+
+	struct nbts_pipeline pipeline;
+	enum nbts_error err = nbts_pipeline_open(
+		&pipeline, source, input->format, NBTS_PIPELINE_BLOCK_SIZE, NBTS_PIPELINE_BLOCKS);
+	if (!err) {
+		err = parse(pipeline.stream, ostream);
+		enum nbts_error close_err = nbts_pipeline_close(&pipeline);
+		if (!err) err = close_err;
+	}
+	fclose(source);
+	return err;
+}
+
+/// Stores the minimum time of `RUNS` runs of `run` in `time`.
+static enum nbts_error measure(
+	struct input const *input,
+	FILE *ostream,
+	enum nbts_error (*run)(struct input const *, FILE *),
+	double *time)
+{
+	*time = HUGE_VAL;
+	for (size_t i = 0; i < RUNS; ++i) {
+		double start = now();
+		enum nbts_error err = run(input, ostream);
+		double elapsed = now() - start;
+		if (err) return err;
+		if (elapsed < *time) *time = elapsed;
+	}
+	return NBTS_OK;
+}
+
+int main(int argc, char **argv)
+{
+	size_t sections = argc > 1 ? strtoull(argv[1], nullptr, 10) : DEFAULT_SECTIONS;
+	if (argc > 2 || !sections || sections > INT32_MAX) {
+		fprintf(stderr, "Usage: %s [sections]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	char *data = nullptr;
+	size_t size = 0;
+	if (make_corpus(&data, &size, sections)) {
+		perror("corpus");
+		return EXIT_FAILURE;
+	}
+
+	struct input input = {.format = NBTS_COMPRESSION_GZIP};
+	enum nbts_error err = nbts_compress(
+		&input.compressed, input.format, NBTS_COMPRESSION_DEFAULT_LEVEL, data, size);
+	if (err == NBTS_UNSUPPORTED) {
+		input.format = NBTS_COMPRESSION_NONE;
+		err = nbts_buffer_reserve(&input.compressed, size);
+		if (!err) memcpy(input.compressed.data, data, size);
+		input.compressed.size = size;
+	}
+	free(data);
+	if (err) {
+		fprintf(stderr, "compress: error %d\n", err);
+		return EXIT_FAILURE;
+	}
+
+	FILE *ostream = fopen("/dev/null", "wb");
+	if (!ostream) {
+		perror("/dev/null");
+		nbts_buffer_free(&input.compressed);
+		return EXIT_FAILURE;
+	}
+
+	int status = EXIT_SUCCESS;
+	for (size_t i = 0; i < 2; ++i) {
+		FILE *print = i ? ostream : nullptr;
+		char const *name = i ? "print" : "skip";
+		double serial = 0;
+		double pipelined = 0;
+		err = measure(&input, print, &run_serial, &serial);
+		if (!err) err = measure(&input, print, &run_pipeline, &pipelined);
+		if (err) {
+			fprintf(stderr, "%s: error %d\n", name, err);
+			status = EXIT_FAILURE;
+			continue;
+		}
+
+		bool slow = pipelined > serial * MAX_SLOWDOWN;
+		printf("%-5s decompressed first %8.3f ms, pipelined %8.3f ms, %5.2fx%s\n", name,
+			serial / 1e6, pipelined / 1e6, serial / pipelined, slow ? "  TOO SLOW" : "");
+		if (slow) status = EXIT_FAILURE;
+	}
+
+	fclose(ostream);
+	nbts_buffer_free(&input.compressed);
+	return status;
+}
@@ -0,0 +1,153 @@
+#include <nbts/compression.h>
+#include <nbts/measure.h>
+#include <nbts/nbts.h>
+#include <nbts/pipeline.h>
+#include <nbts/print.h>
+#include <nbts/write.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The ring is far smaller than the input, so the thread has to wait for the
+// parser to release blocks, and skipping the byte array spans many blocks.
+enum : size_t {
+	BLOCK_SIZE = 1024,
+	BLOCKS = 4,
+	ARRAY_SIZE = 100000,
+	ELEMENTS = 1000,
+};
+
+static bool write_input(FILE *restrict stream)
+{
+	static nbts_byte array[ARRAY_SIZE];
+	for (size_t i = 0; i < ARRAY_SIZE; ++i) array[i] = (nbts_byte) (i * 7);
+
+	bool ok = !nbts_write_tag_header(stream, NBTS_COMPOUND, nullptr, 0) &&
+		!nbts_write_tag_header(stream, NBTS_BYTE_ARRAY, (nbts_char const *) "a", 1) &&
+		!nbts_write_size(stream, ARRAY_SIZE) && !nbts_write_byte_array(stream, array, ARRAY_SIZE) &&
+		!nbts_write_tag_header(stream, NBTS_LIST, (nbts_char const *) "l", 1) &&
+		!nbts_write_typeid(stream, NBTS_COMPOUND) && !nbts_write_size(stream, ELEMENTS);
+	for (size_t i = 0; ok && i < ELEMENTS; ++i) {
+		ok = !nbts_write_tag_header(stream, NBTS_INT, (nbts_char const *) "i", 1) &&
+			!nbts_write_int(stream, (nbts_int) i) &&
+			!nbts_write_tag_header(stream, NBTS_STRING, (nbts_char const *) "s", 1) &&
+			!nbts_write_strsize(stream, 5) &&
+			!nbts_write_string(stream, (nbts_char const *) "stone", 5) &&
+			!nbts_write_typeid(stream, NBTS_END);
+	}
+	return ok && !nbts_write_typeid(stream, NBTS_END);
+}
+
+/// Prints the tag in `source` through a pipeline to `output`, or only
+/// measures it if `output` is `nullptr`, which skips every payload.
+static enum nbts_error run(
+	struct nbts_buffer const *source,
+	enum nbts_compression format,
+	FILE *output,
+	size_t *size)
+{
+	FILE *stream = fmemopen(source->data, source->size, "rb");
+	if (!stream) return NBTS_READ_ERR;
+
+	struct nbts_pipeline pipeline;
+	enum nbts_error err = nbts_pipeline_open(&pipeline, stream, format, BLOCK_SIZE, BLOCKS);
+	if (!err) {
+		if (output) {
+			struct nbts_print_handler_data data = nbts_print_handler_data(output);
+			err = nbts_parse_tag(pipeline.stream, &nbts_print_handler, &data);
+		} else {
+			err = nbts_measure_tag(size, pipeline.stream);
+		}
+		// The parser only sees that reading failed, closing returns why.
+		enum nbts_error close_err = nbts_pipeline_close(&pipeline);
+		if (close_err) err = close_err;
+	}
+	fclose(stream);
+	return err;
+}
+
+/// Checks that the pipeline reproduces the printed and measured input.
+static bool test_format(
+	struct nbts_buffer const *source,
+	enum nbts_compression format,
+	char const *expected,
+	size_t input_size)
+{
+	char *output = nullptr;
+	size_t output_size = 0;
+	FILE *ostream = open_memstream(&output, &output_size);
+	if (!ostream) return false;
+	enum nbts_error err = run(source, format, ostream, nullptr);
+	fclose(ostream);
+
+	size_t size = 0;
+	if (!err) err = run(source, format, nullptr, &size);
+
+	bool ok = false;
+	if (err) {
+		fprintf(stderr, "format %d: error %d\n", format, err);
+	} else if (strcmp(output, expected)) {
+		fprintf(stderr, "format %d: the output differs from the input\n", format);
+	} else if (size != input_size) {
+		fprintf(stderr, "format %d: measured %zu bytes of %zu\n", format, size, input_size);
+	} else {
+		ok = true;
+	}
+	free(output);
+	return ok;
+}
+
+int main()
+{
+	int ret = EXIT_FAILURE;
+
+	struct nbts_buffer input = {};
+	FILE *istream = open_memstream((char **) &input.data, &input.size);
+	if (!istream) return ret;
+	bool written = write_input(istream);
+	fclose(istream);
+	if (!written) goto input_failed;
+
+	char *expected = nullptr;
+	size_t expected_size = 0;
+	FILE *ostream = open_memstream(&expected, &expected_size);
+	if (!ostream) goto input_failed;
+	istream = fmemopen(input.data, input.size, "rb");
+	struct nbts_print_handler_data data = nbts_print_handler_data(ostream);
+	enum nbts_error err = istream ? nbts_parse_tag(istream, &nbts_print_handler, &data)
+	                              : NBTS_READ_ERR;
+	if (istream) fclose(istream);
+	fclose(ostream);
+	if (err) goto expected_failed;
+
+	bool ok = test_format(&input, NBTS_COMPRESSION_NONE, expected, input.size);
+
+	struct nbts_buffer compressed = {};
+	err = nbts_compress(
+		&compressed, NBTS_COMPRESSION_GZIP, NBTS_COMPRESSION_DEFAULT_LEVEL, input.data, input.size);
+	if (!err) {
+		ok = test_format(&compressed, NBTS_COMPRESSION_GZIP, expected, input.size) && ok;
+
+		// The thread runs out of input in the middle of the byte array.
+		compressed.size /= 2;
+		size_t size = 0;
+		err = run(&compressed, NBTS_COMPRESSION_GZIP, nullptr, &size);
+		if (err != NBTS_UNEXPECTED_EOF) {
+			fprintf(stderr, "truncated: expected error %d, got %d\n", NBTS_UNEXPECTED_EOF, err);
+			ok = false;
+		}
+	} else if (err != NBTS_UNSUPPORTED) {
+		fprintf(stderr, "compress: error %d\n", err);
+		ok = false;
+	}
+	nbts_buffer_free(&compressed);
+
+	if (ok) ret = EXIT_SUCCESS;
+
+expected_failed:
+	free(expected);
+input_failed:
+	free(input.data);
+	return ret;
+}
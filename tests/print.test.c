@@ -0,0 +1,52 @@
+#include <nbts/nbts.h>
+#include <nbts/print.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// {"":{i:[I;1,-2],l:[L;3L],b:5B}}, where the tag after the arrays is only
+// reached if the arrays are read with their element sizes.
+static uint8_t const input[] = {
+	NBTS_COMPOUND, 0, 0,                    //
+	NBTS_INT_ARRAY, 0, 1, 'i', 0, 0, 0, 2,  //
+	0, 0, 0, 1, 0xff, 0xff, 0xff, 0xfe,     //
+	NBTS_LONG_ARRAY, 0, 1, 'l', 0, 0, 0, 1, //
+	0, 0, 0, 0, 0, 0, 0, 3,                 //
+	NBTS_BYTE, 0, 1, 'b', 5,                //
+	NBTS_END,                               //
+};
+
+static char const expected[] = "{\"i\":[I;1,-2], \"l\":[L;3L], \"b\":5B}";
+
+int main()
+{
+	int ret = EXIT_FAILURE;
+
+	FILE *istream = fmemopen((void *) input, sizeof(input), "rb");
+	if (!istream) goto istream_failed;
+
+	char *output = nullptr;
+	size_t output_size = 0;
+	FILE *ostream = open_memstream(&output, &output_size);
+	if (!ostream) goto ostream_failed;
+
+	struct nbts_print_handler_data data = nbts_print_handler_data(ostream);
+	enum nbts_error err = nbts_parse_tag(istream, &nbts_print_handler, &data);
+	fclose(ostream);
+
+	if (err) {
+		fprintf(stderr, "error %d\n", err);
+	} else if (strcmp(output, expected)) {
+		fprintf(stderr, "expected %s\n     got %s\n", expected, output);
+	} else {
+		ret = EXIT_SUCCESS;
+	}
+
+	free(output);
+ostream_failed:
+	fclose(istream);
+istream_failed:
+	return ret;
+}
@@ -0,0 +1,77 @@
+#include <nbts/compression.h>
+#include <nbts/nbts.h>
+#include <nbts/region.h>
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/// Reads and parses every chunk of the region file at `path`, and returns
+/// the number of chunks it has.
+static size_t read_chunks(char const *path)
+{
+	struct nbts_region region;
+	if (nbts_region_open(&region, path)) return 0;
+
+	size_t count = 0;
+	struct nbts_buffer raw = {};
+	struct nbts_buffer decompressed = {};
+	for (size_t i = 0; i < NBTS_REGION_CHUNKS; ++i) {
+		if (!nbts_region_has_chunk(&region, i)) continue;
+		++count;
+
+		enum nbts_compression compression = 0;
+		if (nbts_region_read(&region, i, &raw, &compression)) continue;
+		struct nbts_buffer *chunk = &raw;
+		if (compression != NBTS_COMPRESSION_NONE) {
+			if (nbts_decompress(&decompressed, compression, raw.data, raw.size)) continue;
+			chunk = &decompressed;
+		}
+
+		FILE *stream = fmemopen(chunk->data, chunk->size, "rb");
+		if (!stream) continue;
+		(void) nbts_parse_tag(stream, &nbts_skip_handler, nullptr);
+		fclose(stream);
+	}
+
+	nbts_buffer_free(&decompressed);
+	nbts_buffer_free(&raw);
+	nbts_region_close(&region);
+	return count;
+}
+
+int LLVMFuzzerTestOneInput(uint8_t const *data, size_t data_size)
+{
+	// Regions are opened by path, and external chunks are looked up next to
+	// them, so every input gets its own directory.
+	char dir[] = "/tmp/nbts_region_fuzz.XXXXXX";
+	if (!mkdtemp(dir)) goto dir_failed;
+
+	char src[PATH_MAX];
+	char dest[PATH_MAX];
+	snprintf(src, sizeof(src), "%s/r.0.0.mca", dir);
+	snprintf(dest, sizeof(dest), "%s/r.1.0.mca", dir);
+
+	FILE *stream = fopen(src, "wb");
+	if (!stream) goto src_failed;
+	size_t written = fwrite(data, 1, data_size, stream);
+	if (fclose(stream) || written != data_size) goto src_failed;
+
+	size_t count = read_chunks(src);
+
+	// A compacted region has to open again with the same chunks.
+	struct nbts_region_options options = nbts_region_options(NBTS_COMPRESSION_ZLIB);
+	options.threads = 1;
+	if (!nbts_region_compact(dest, src, &options)) {
+		if (read_chunks(dest) != count) abort();
+	}
+
+	unlink(dest);
+src_failed:
+	unlink(src);
+	rmdir(dir);
+dir_failed:
+	return 0;
+}
@@ -0,0 +1,221 @@
+// Scaling benchmark of nbts_split_parse.
+//
+// Generates one structure-like tag whose bulk is a list of many block
+// compounds, preceded by enough other children that the index of the root
+// does not fit the first arena block. The list is parsed with 1, 2, 4, ...
+// threads up to the number of online processors, summing the numbers of
+// every element. Each time is the minimum over several runs. Fails if a run
+// fails or the sums differ between thread counts.
+//
+// Usage: nbts_perf_split [elements]
+
+#include <nbts/nbts.h>
+#include <nbts/pool.h>
+#include <nbts/split.h>
+#include <nbts/write.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum : size_t {
+	RUNS = 5,
+	DEFAULT_ELEMENTS = 1 << 20,
+	OTHER_CHILDREN = 1024,
+};
+
+static void write_name(FILE *stream, enum nbts_type type, char const *name)
+{
+	(void) nbts_write_tag_header(stream, type, (nbts_char const *) name, strlen(name));
+}
+
+static void write_string(FILE *stream, char const *name, char const *value)
+{
+	write_name(stream, NBTS_STRING, name);
+	(void) nbts_write_strsize(stream, strlen(value));
+	(void) nbts_write_string(stream, (nbts_char const *) value, strlen(value));
+}
+
+/// Writes a tag shaped like a structure file with `elements` blocks.
+static int make_corpus(char **data, size_t *size, size_t elements)
+{
+	FILE *stream = open_memstream(data, size);
+	if (!stream) return -1;
+
+	write_name(stream, NBTS_COMPOUND, "");
+	for (size_t i = 0; i < OTHER_CHILDREN; ++i) {
+		char name[32];
+		snprintf(name, sizeof(name), "meta%zu", i);
+		write_name(stream, NBTS_INT, name);
+		(void) nbts_write_int(stream, (nbts_int) i);
+	}
+
+	write_name(stream, NBTS_LIST, "blocks");
+	(void) nbts_write_typeid(stream, NBTS_COMPOUND);
+	(void) nbts_write_size(stream, (nbts_size) elements);
+	for (size_t i = 0; i < elements; ++i) {
+		write_name(stream, NBTS_LIST, "pos");
+		(void) nbts_write_typeid(stream, NBTS_INT);
+		(void) nbts_write_size(stream, 3);
+		for (size_t j = 0; j < 3; ++j) (void) nbts_write_int(stream, (nbts_int) (i >> 6 * j & 63));
+		write_name(stream, NBTS_INT, "state");
+		(void) nbts_write_int(stream, (nbts_int) (i % 17));
+		write_name(stream, NBTS_COMPOUND, "nbt");
+		write_string(stream, "id", i % 3 ? "minecraft:chest" : "minecraft:sign");
+		write_name(stream, NBTS_LONG, "seed");
+		(void) nbts_write_long(stream, (nbts_long) (i * 2654435761u));
+		(void) nbts_write_typeid(stream, NBTS_END);
+		(void) nbts_write_typeid(stream, NBTS_END);
+	}
+	(void) nbts_write_typeid(stream, NBTS_END);
+
+	return fclose(stream);
+}
+
+static struct nbts_handler element_handler;
+
+static enum nbts_error sum_int(void *userdata, nbts_strsize name_size, FILE *stream)
+{
+	nbts_int x = 0;
+	enum nbts_error err = nbts_skip_end(nullptr, name_size, stream);
+	if (!err) err = nbts_parse_int(&x, stream);
+	*(int64_t *) userdata += x;
+	return err;
+}
+
+static enum nbts_error sum_long(void *userdata, nbts_strsize name_size, FILE *stream)
+{
+	nbts_long x = 0;
+	enum nbts_error err = nbts_skip_end(nullptr, name_size, stream);
+	if (!err) err = nbts_parse_long(&x, stream);
+	*(int64_t *) userdata += x;
+	return err;
+}
+
+static enum nbts_error sum_list(void *userdata, nbts_strsize name_size, FILE *stream)
+{
+	enum nbts_type type = NBTS_END;
+	nbts_size size = 0;
+	enum nbts_error err = nbts_skip_end(nullptr, name_size, stream);
+	if (!err) err = nbts_parse_typeid(&type, stream);
+	if (!err) err = nbts_parse_size(&size, stream);
+	if (!err) err = nbts_parse_list(type, size, stream, &element_handler, userdata);
+	return err;
+}
+
+static enum nbts_error sum_compound(void *userdata, nbts_strsize name_size, FILE *stream)
+{
+	enum nbts_error err = nbts_skip_end(nullptr, name_size, stream);
+	if (!err) err = nbts_parse_compound(stream, &element_handler, userdata);
+	return err;
+}
+
+static enum nbts_error begin(
+	void *,
+	size_t,
+	size_t,
+	size_t,
+	size_t,
+	struct nbts_handler const **restrict handler,
+	void **restrict handler_userdata)
+{
+	int64_t *sum = calloc(1, sizeof(*sum));
+	if (!sum) return NBTS_ALLOC_ERR;
+	*handler = &element_handler;
+	*handler_userdata = sum;
+	return NBTS_OK;
+}
+
+static enum nbts_error merge(void *userdata, size_t, void *handler_userdata, enum nbts_error err)
+{
+	*(int64_t *) userdata += *(int64_t *) handler_userdata;
+	free(handler_userdata);
+	return err;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/// Stores the minimum time of `RUNS` runs with `threads` threads in `time`
+/// and their sum in `sum`.
+static enum nbts_error
+measure(char const *data, size_t size, size_t threads, double *time, int64_t *sum)
+{
+	*time = HUGE_VAL;
+	for (size_t run = 0; run < RUNS; ++run) {
+		*sum = 0;
+		struct nbts_split_options options = nbts_split_options(&begin, &merge, sum);
+		options.threads = threads;
+
+		double start = now();
+		enum nbts_error err = nbts_split_parse(data, size, ".blocks", &options);
+		double elapsed = now() - start;
+		if (err) return err;
+		if (elapsed < *time) *time = elapsed;
+	}
+	return NBTS_OK;
+}
+
+/// Returns the thread count to measure after `threads`: the next power of
+/// two, or `max` once it is exceeded.
+static size_t next_threads(size_t threads, size_t max)
+{
+	if (threads < max && 2 * threads > max) return max;
+	return 2 * threads;
+}
+
+int main(int argc, char **argv)
+{
+	size_t elements = argc > 1 ? strtoull(argv[1], nullptr, 10) : DEFAULT_ELEMENTS;
+	if (argc > 2 || !elements || elements > INT32_MAX) {
+		fprintf(stderr, "Usage: %s [elements]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	element_handler.handle[NBTS_INT] = &sum_int;
+	element_handler.handle[NBTS_LONG] = &sum_long;
+	element_handler.handle[NBTS_LIST] = &sum_list;
+	element_handler.handle[NBTS_COMPOUND] = &sum_compound;
+
+	char *data = nullptr;
+	size_t size = 0;
+	if (make_corpus(&data, &size, elements)) {
+		perror("corpus");
+		return EXIT_FAILURE;
+	}
+
+	int status = EXIT_SUCCESS;
+	size_t max_threads = nbts_pool_threads(0);
+	double base_time = 0;
+	int64_t base_sum = 0;
+	for (size_t threads = 1; threads <= max_threads; threads = next_threads(threads, max_threads)) {
+		double time = 0;
+		int64_t sum = 0;
+		enum nbts_error err = measure(data, size, threads, &time, &sum);
+		if (err) {
+			fprintf(stderr, "%zu threads: error %d\n", threads, err);
+			status = EXIT_FAILURE;
+			break;
+		}
+		if (threads == 1) {
+			base_time = time;
+			base_sum = sum;
+		} else if (sum != base_sum) {
+			fprintf(stderr, "%zu threads: sum %lld, expected %lld\n", threads, (long long) sum,
+				(long long) base_sum);
+			status = EXIT_FAILURE;
+		}
+		printf("%3zu threads %10.3f ms %6.2fx %8.3f ns per element\n", threads, time / 1e6,
+			base_time / time, time / (double) elements);
+	}
+
+	free(data);
+	return status;
+}
@@ -0,0 +1,65 @@
+#include <nbts/nbts.h>
+#include <nbts/tape.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/// Visits every entry below `index`, like a reader of the tape would.
+static void walk(struct nbts_tape const *tape, size_t index)
+{
+	struct nbts_tape_entry const *entry = &tape->entries[index];
+	if (entry->type == NBTS_LIST) {
+		enum nbts_type type = 0;
+		nbts_size size = 0;
+		(void) nbts_tape_list(tape, index, &type, &size);
+		if (size) (void) nbts_tape_element(tape, index, (size_t) size - 1);
+	}
+
+	size_t child = nbts_tape_first(tape, index);
+	for (; child != NBTS_TAPE_NONE; child = nbts_tape_next(tape, index, child)) {
+		if (entry->type == NBTS_COMPOUND) {
+			nbts_strsize name_size = 0;
+			nbts_char const *name = nbts_tape_name(tape, child, &name_size);
+			if (nbts_tape_find(tape, index, name, name_size) == NBTS_TAPE_NONE) abort();
+		}
+		(void) nbts_tape_payload(tape, child);
+		walk(tape, child);
+	}
+}
+
+int LLVMFuzzerTestOneInput(uint8_t const *data, size_t data_size)
+{
+	struct nbts_tape tape;
+	struct nbts_tape_entry none;
+	if (nbts_tape_build(&tape, data, data_size, &none, 0) != NBTS_LIMIT_EXCEEDED) goto done;
+
+	size_t capacity = tape.size;
+	struct nbts_tape_entry *entries = malloc(capacity * sizeof(*entries));
+	if (!entries) goto done;
+	if (nbts_tape_build(&tape, data, data_size, entries, capacity)) abort();
+	walk(&tape, 0);
+
+	// A written tape has to load again for the same buffer.
+	char *output = nullptr;
+	size_t output_size = 0;
+	FILE *stream = open_memstream(&output, &output_size);
+	if (!stream) goto stream_failed;
+	enum nbts_error err = nbts_tape_write(stream, &tape);
+	if (!err) err = fflush(stream) ? NBTS_WRITE_ERR : NBTS_OK;
+	fclose(stream);
+
+	stream = err ? nullptr : fmemopen(output, output_size, "rb");
+	if (stream) {
+		struct nbts_tape loaded;
+		if (nbts_tape_read(&loaded, data, data_size, entries, capacity, stream)) abort();
+		if (loaded.size != tape.size) abort();
+		fclose(stream);
+	}
+	free(output);
+
+stream_failed:
+	free(entries);
+done:
+	return 0;
+}
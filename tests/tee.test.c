@@ -0,0 +1,103 @@
+#include <nbts/nbts.h>
+#include <nbts/print.h>
+#include <nbts/tee.h>
+#include <nbts/write.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The byte array is larger than the ring of the tee, so the children have to
+// keep up with the copy, and the skipping child seeks across most of it.
+enum : size_t { ARRAY_SIZE = 300000 };
+
+static enum nbts_error write_header(FILE *restrict stream, enum nbts_type type, char const *name)
+{
+	size_t name_size = strlen(name);
+	if (nbts_write_typeid(stream, type) || nbts_write_strsize(stream, name_size)) {
+		return NBTS_WRITE_ERR;
+	}
+	return nbts_write_string(stream, (nbts_char const *) name, name_size);
+}
+
+static bool write_input(FILE *restrict stream)
+{
+	static nbts_byte array[ARRAY_SIZE];
+	for (size_t i = 0; i < ARRAY_SIZE; ++i) array[i] = (nbts_byte) (i * 7);
+
+	return !nbts_write_typeid(stream, NBTS_COMPOUND) && !nbts_write_strsize(stream, 0) &&
+		!write_header(stream, NBTS_INT, "i") && !nbts_write_int(stream, -3) &&
+		!write_header(stream, NBTS_BYTE_ARRAY, "a") && !nbts_write_size(stream, ARRAY_SIZE) &&
+		!nbts_write_byte_array(stream, array, ARRAY_SIZE) &&
+		!write_header(stream, NBTS_STRING, "s") && !nbts_write_strsize(stream, 2) &&
+		!nbts_write_string(stream, (nbts_char const *) "ok", 2) &&
+		!nbts_write_typeid(stream, NBTS_END);
+}
+
+int main()
+{
+	int ret = EXIT_FAILURE;
+
+	char *input = nullptr;
+	size_t input_size = 0;
+	FILE *istream = open_memstream(&input, &input_size);
+	if (!istream) goto istream_failed;
+	bool written = write_input(istream);
+	fclose(istream);
+	if (!written) goto input_failed;
+	istream = fmemopen(input, input_size, "rb");
+	if (!istream) goto input_failed;
+
+	char *outputs[3] = {};
+	size_t output_sizes[3] = {};
+	FILE *ostreams[3] = {};
+	for (size_t i = 0; i < 3; ++i) {
+		ostreams[i] = open_memstream(&outputs[i], &output_sizes[i]);
+		if (!ostreams[i]) goto ostreams_failed;
+	}
+
+	struct nbts_print_handler_data print_data[3] = {
+		nbts_print_handler_data(ostreams[0]),
+		nbts_print_handler_data(ostreams[1]),
+		nbts_print_handler_data(ostreams[2]),
+	};
+	struct nbts_tee_child const children[] = {
+		{.handler = &nbts_print_handler, .userdata = &print_data[1]},
+		{.handler = &nbts_skip_handler},
+		{.handler = &nbts_print_handler, .userdata = &print_data[2]},
+	};
+
+	struct nbts_tee_handler_data tee;
+	if (nbts_tee_handler_data_init(&tee, children, sizeof(children) / sizeof(*children))) {
+		goto ostreams_failed;
+	}
+
+	enum nbts_error err = nbts_parse_tag(istream, &nbts_print_handler, &print_data[0]);
+	if (!err) {
+		rewind(istream);
+		err = nbts_parse_tag(istream, &nbts_tee_handler, &tee);
+	}
+	// The stream must be left after the tag.
+	if (!err && fgetc(istream) != EOF) err = NBTS_INVALID_SIZE;
+	nbts_tee_handler_data_free(&tee);
+	for (size_t i = 0; i < 3; ++i) fflush(ostreams[i]);
+
+	if (err) {
+		fprintf(stderr, "error %d\n", err);
+	} else if (strcmp(outputs[0], outputs[1]) || strcmp(outputs[0], outputs[2])) {
+		fprintf(stderr, "the children printed different output\n");
+	} else {
+		ret = EXIT_SUCCESS;
+	}
+
+ostreams_failed:
+	for (size_t i = 0; i < 3; ++i) {
+		if (ostreams[i]) fclose(ostreams[i]);
+		free(outputs[i]);
+	}
+	fclose(istream);
+input_failed:
+	free(input);
+istream_failed:
+	return ret;
+}
@@ -0,0 +1,48 @@
+#include <nbts/nbts.h>
+#include <nbts/view.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+enum : size_t { ARENA_SIZE = 1 << 16 };
+
+/// Indexes every node below `node` until the arena runs out.
+static void walk(struct nbts_view *view, struct nbts_view_node *node)
+{
+	if (node->type == NBTS_LIST) {
+		enum nbts_type type = 0;
+		nbts_size size = 0;
+		(void) nbts_view_list(view, node, &type, &size);
+	}
+	if (node->type != NBTS_COMPOUND && node->type != NBTS_LIST) return;
+
+	struct nbts_view_node *children = nullptr;
+	size_t size = 0;
+	if (nbts_view_children(view, node, &children, &size)) return;
+
+	for (size_t i = 0; i < size; ++i) {
+		struct nbts_view_node *child = &children[i];
+		if (node->type == NBTS_COMPOUND) {
+			nbts_strsize name_size = 0;
+			nbts_char const *name = nbts_view_name(view, child, &name_size);
+			struct nbts_view_node *found = nullptr;
+			if (nbts_view_find(view, node, name, name_size, &found) || !found) abort();
+		}
+		(void) nbts_view_payload(view, child);
+		walk(view, child);
+	}
+}
+
+int LLVMFuzzerTestOneInput(uint8_t const *data, size_t data_size)
+{
+	void *memory = malloc(ARENA_SIZE);
+	if (!memory) goto memory_failed;
+	struct nbts_arena arena = nbts_arena(memory, ARENA_SIZE);
+
+	struct nbts_view view;
+	if (!nbts_view_open(&view, data, data_size, &arena)) walk(&view, &view.root);
+
+	free(memory);
+memory_failed:
+	return 0;
+}